@@ -0,0 +1,41 @@
+/**
+ * \file did_converters.cpp
+ * \brief Conversions per second of the generated data set to ROS message converters
+ *
+ * One benchmark per message in scripts/did_schema.yaml.  The source data set changes every
+ * iteration so the copy cannot be hoisted out of the loop.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include "did_converters.h"
+
+template <typename Struct, typename Message>
+static void BM_convert(benchmark::State &state)
+{
+    Struct in;
+    memset(&in, 0, sizeof(in));
+    Message out;
+    uint8_t counter = 0;
+    for (auto _ : state)
+    {
+        reinterpret_cast<uint8_t *>(&in)[0] = counter++;
+        benchmark::DoNotOptimize(&in);
+        did_converters::convert(in, out);
+        benchmark::DoNotOptimize(&out);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * sizeof(Struct));
+}
+
+BENCHMARK_TEMPLATE(BM_convert, ins_1_t, inertial_sense_ros::DID_INS1);
+BENCHMARK_TEMPLATE(BM_convert, ins_2_t, inertial_sense_ros::DID_INS2);
+BENCHMARK_TEMPLATE(BM_convert, ins_4_t, inertial_sense_ros::DID_INS4);
+BENCHMARK_TEMPLATE(BM_convert, inl2_states_t, inertial_sense_ros::INL2States);
+BENCHMARK_TEMPLATE(BM_convert, eph_t, inertial_sense_ros::GNSSEphemeris);
+BENCHMARK_TEMPLATE(BM_convert, geph_t, inertial_sense_ros::GlonassEphemeris);
+
+BENCHMARK_MAIN();
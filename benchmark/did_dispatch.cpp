@@ -0,0 +1,130 @@
+/**
+ * \file did_dispatch.cpp
+ * \brief Per packet cost of dispatching uINS data to its handler
+ *
+ * Compares one std::function lambda per DID, as registered by the former SET_CALLBACK macro,
+ * with the shared SDK handler and the DidDispatchTable lookup used by the node.  The SDK
+ * itself always calls a std::function, so both paths include one type-erased call.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+#include <string.h>
+
+#include "did_dispatch.h"
+
+typedef std::function<void(void *sdk, p_data_t *data, int pHandle)> sdk_handler_t;
+
+class Owner
+{
+public:
+    Owner()
+    {
+        memset(sdk_handlers_, 0, sizeof(sdk_handlers_));
+        shared_handler_ = [this](void *sdk, p_data_t *data, int pHandle) { this->on_device_data(data); };
+        table_.set<DID_INS_1, &Owner::INS1_callback>();
+        table_.set<DID_INS_4, &Owner::INS4_callback>();
+        table_.set<DID_PIMU, &Owner::preint_IMU_callback>();
+    }
+
+    // Former registration: a lambda per DID doing the cast
+    void register_lambdas()
+    {
+        sdk_handlers_[DID_INS_1] = new sdk_handler_t([this](void *sdk, p_data_t *data, int pHandle)
+            { this->INS1_callback(DID_INS_1, reinterpret_cast<ins_1_t *>(data->buf)); });
+        sdk_handlers_[DID_INS_4] = new sdk_handler_t([this](void *sdk, p_data_t *data, int pHandle)
+            { this->INS4_callback(DID_INS_4, reinterpret_cast<ins_4_t *>(data->buf)); });
+        sdk_handlers_[DID_PIMU] = new sdk_handler_t([this](void *sdk, p_data_t *data, int pHandle)
+            { this->preint_IMU_callback(DID_PIMU, reinterpret_cast<pimu_t *>(data->buf)); });
+    }
+
+    ~Owner()
+    {
+        for (int i = 0; i < DID_COUNT; i++)
+            delete sdk_handlers_[i];
+    }
+
+    void on_device_data(const p_data_t *data) { table_.dispatch(this, data); }
+
+    void INS1_callback(eDataIDs DID, const ins_1_t *const msg) { sink_ += msg->timeOfWeek; }
+    void INS4_callback(eDataIDs DID, const ins_4_t *const msg) { sink_ += msg->timeOfWeek; }
+    void preint_IMU_callback(eDataIDs DID, const pimu_t *const msg) { sink_ += msg->time; }
+
+    sdk_handler_t *sdk_handlers_[DID_COUNT];
+    sdk_handler_t shared_handler_;
+    DidDispatchTable<Owner> table_;
+    double sink_ = 0.0;
+};
+
+struct Packets
+{
+    Packets()
+    {
+        memset(packets, 0, sizeof(packets));
+        const eDataIDs dids[3] = {DID_INS_1, DID_INS_4, DID_PIMU};
+        for (int i = 0; i < 3; i++)
+        {
+            packets[i].hdr.id = dids[i];
+            packets[i].hdr.size = sizeof(ins_4_t);
+            packets[i].hdr.offset = 0;
+        }
+    }
+    p_data_t packets[3];
+};
+
+static void BM_dispatch_lambda_per_did(benchmark::State &state)
+{
+    Owner owner;
+    owner.register_lambdas();
+    Packets p;
+    int i = 0;
+    for (auto _ : state)
+    {
+        p_data_t *data = &p.packets[i];
+        (*owner.sdk_handlers_[data->hdr.id])(NULL, data, 0);
+        i = (i == 2) ? 0 : i + 1;
+    }
+    benchmark::DoNotOptimize(owner.sink_);
+}
+BENCHMARK(BM_dispatch_lambda_per_did);
+
+static void BM_dispatch_table(benchmark::State &state)
+{
+    Owner owner;
+    Packets p;
+    int i = 0;
+    for (auto _ : state)
+    {
+        owner.shared_handler_(NULL, &p.packets[i], 0);
+        i = (i == 2) ? 0 : i + 1;
+    }
+    benchmark::DoNotOptimize(owner.sink_);
+}
+BENCHMARK(BM_dispatch_table);
+
+// Registering the same stream repeatedly, as configure_data_streams does for DID_INS_4 and DID_PIMU
+static void BM_register_lambda(benchmark::State &state)
+{
+    Owner owner;
+    for (auto _ : state)
+    {
+        sdk_handler_t handler = [&owner](void *sdk, p_data_t *data, int pHandle)
+            { owner.INS4_callback(DID_INS_4, reinterpret_cast<ins_4_t *>(data->buf)); };
+        benchmark::DoNotOptimize(handler);
+    }
+}
+BENCHMARK(BM_register_lambda);
+
+static void BM_register_table(benchmark::State &state)
+{
+    Owner owner;
+    for (auto _ : state)
+    {
+        bool changed = owner.table_.set<DID_INS_4, &Owner::INS4_callback>();
+        benchmark::DoNotOptimize(changed);
+    }
+}
+BENCHMARK(BM_register_table);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,335 @@
+/**
+ * \file inertial_sense_ros_benchmarks.cpp
+ * \brief ns/op of the node's per message hot paths on fixed synthetic inputs
+ *
+ * Every benchmark runs a real InertialSenseROS constructed without a device, with only the
+ * streams it needs enabled.  Nobody subscribes to the node's topics, so messages are built and
+ * published but never serialized or sent.  Advertising still registers with the master, so a
+ * roscore must be running.  The conversion math without ROS is measured by ins_core_benchmark.
+ * BM_serialize_ins_state adds the serialization a subscriber would cost.
+ *
+ * usage: inertial_sense_ros_benchmarks [--benchmark_filter=INS4] [google benchmark options]
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "inertial_sense_ros.h"
+
+// Node with the given streams enabled, constructed once per configuration
+static InertialSenseROS &node(const std::string &yaml)
+{
+    static std::map<std::string, std::unique_ptr<InertialSenseROS>> nodes;
+    std::unique_ptr<InertialSenseROS> &n = nodes[yaml];
+    if (!n)
+    {
+        // Defaults assigned first, so the configuration overrides them rather than adding a
+        // duplicate key, of which yaml-cpp would keep the first
+        YAML::Node config;
+        config["stream_odom_ins_ned"] = false;
+        config["enable_log"] = false;
+        YAML::Node streams = YAML::Load("{" + yaml + "}");
+        for (YAML::const_iterator it = streams.begin(); it != streams.end(); ++it)
+            config[it->first.as<std::string>()] = it->second;
+        n.reset(new InertialSenseROS(config, false, false));
+    }
+    return *n;
+}
+
+// A vehicle in Salt Lake valley heading north-east, as the uINS reports it
+static ins_4_t make_ins4()
+{
+    ins_4_t ins;
+    memset(&ins, 0, sizeof(ins));
+    ins.week = 2230;
+    ins.timeOfWeek = 345600.125;
+    ins.insStatus = 0x00130F77;
+    ins.qe2b[0] = 0.4196f;
+    ins.qe2b[1] = -0.5470f;
+    ins.qe2b[2] = 0.2339f;
+    ins.qe2b[3] = 0.6863f;
+    ins.ve[0] = 1.2f;
+    ins.ve[1] = -3.4f;
+    ins.ve[2] = 0.7f;
+    ins.ecef[0] = -1766021.7;
+    ins.ecef[1] = -4460133.6;
+    ins.ecef[2] = 4244683.5;
+    return ins;
+}
+
+static ros_covariance_pose_twist_t make_covariance()
+{
+    ros_covariance_pose_twist_t cov;
+    memset(&cov, 0, sizeof(cov));
+    cov.timeOfWeek = 345600.125;
+    // Lower triangular, row by row: small correlations under a dominant diagonal
+    for (int i = 0, k = 0; i < 6; i++)
+    {
+        for (int j = 0; j <= i; j++, k++)
+        {
+            cov.covPoseLD[k] = i == j ? 0.01f * (i + 1) : 0.001f;
+            cov.covTwistLD[k] = i == j ? 0.002f * (i + 1) : 0.0002f;
+        }
+    }
+    return cov;
+}
+
+static void odom_frames(benchmark::internal::Benchmark *b)
+{
+    // NED, ENU, ECEF, all three and the compact ins_state, each without and with covariance
+    for (int frames : {1, 2, 4, 7, 8})
+        for (int covariance = 0; covariance <= 1; covariance++)
+            b->Args({frames, covariance});
+}
+
+static void BM_INS4_callback(benchmark::State &state)
+{
+    int frames = state.range(0);
+    bool covariance = state.range(1);
+    std::string yaml = std::string("stream_odom_ins_ned: ") + (frames & 1 ? "true" : "false") +
+                       ", stream_odom_ins_enu: " + (frames & 2 ? "true" : "false") +
+                       ", stream_odom_ins_ecef: " + (frames & 4 ? "true" : "false") +
+                       ", stream_ins_state: " + (frames & 8 ? "true" : "false") +
+                       ", stream_covariance_data: " + (covariance ? "true" : "false");
+    InertialSenseROS &n = node(yaml);
+    n.refLLA_known = true;
+    if (covariance)
+    {
+        ros_covariance_pose_twist_t cov = make_covariance();
+        n.INS_covariance_callback(DID_ROS_COVARIANCE_POSE_TWIST, &cov);
+    }
+
+    ins_4_t ins = make_ins4();
+    for (auto _ : state)
+    {
+        ins.timeOfWeek += 0.004;
+        n.INS4_callback(DID_INS_4, &ins);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(std::string(frames & 1 ? "ned " : "") + (frames & 2 ? "enu " : "") + (frames & 4 ? "ecef " : "") +
+                   (frames & 8 ? "ins_state " : "") + (covariance ? "+cov" : "-cov"));
+}
+BENCHMARK(BM_INS4_callback)->Apply(odom_frames);
+
+template <typename Message>
+static uint32_t serialize(const Message &msg)
+{
+    // As ros::Publisher::publish does once there is a subscriber
+    ros::SerializedMessage m = ros::serialization::serializeMessage(msg);
+    benchmark::DoNotOptimize(m.buf.get());
+    return m.num_bytes;
+}
+
+// Bytes and time to serialize one state: the three odometry topics and DID_INS_4 (0), or ins_state (1)
+static void BM_serialize_ins_state(benchmark::State &state)
+{
+    bool compact = state.range(0);
+    bool covariance = state.range(1);
+    InertialSenseROS &n = node(std::string("stream_odom_ins_ned: true, stream_odom_ins_enu: true, stream_odom_ins_ecef: true, "
+                                           "stream_DID_INS_4: true, stream_ins_state: true, stream_covariance_data: ") +
+                               (covariance ? "true" : "false"));
+    n.refLLA_known = true;
+    if (covariance)
+    {
+        ros_covariance_pose_twist_t cov = make_covariance();
+        n.INS_covariance_callback(DID_ROS_COVARIANCE_POSE_TWIST, &cov);
+    }
+    ins_4_t ins = make_ins4();
+    n.INS4_callback(DID_INS_4, &ins);
+
+    uint32_t bytes = 0;
+    for (auto _ : state)
+    {
+        if (compact)
+            bytes = serialize(n.ins_state_msg_);
+        else
+            bytes = serialize(n.ned_odom_msg) + serialize(n.enu_odom_msg) + serialize(n.ecef_odom_msg) + serialize(n.did_ins_4_msg);
+    }
+    state.counters["bytes"] = bytes;
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.SetLabel(std::string(compact ? "ins_state " : "odom x3 + DID_INS_4 ") + (covariance ? "+cov" : "-cov"));
+}
+BENCHMARK(BM_serialize_ins_state)->Args({0, 0})->Args({0, 1})->Args({1, 0})->Args({1, 1});
+
+static void BM_INS_covariance_callback(benchmark::State &state)
+{
+    InertialSenseROS &n = node("stream_covariance_data: true");
+    ros_covariance_pose_twist_t cov = make_covariance();
+    for (auto _ : state)
+    {
+        cov.timeOfWeek += 0.004;
+        n.INS_covariance_callback(DID_ROS_COVARIANCE_POSE_TWIST, &cov);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_INS_covariance_callback);
+
+static void BM_preint_IMU_callback(benchmark::State &state)
+{
+    // IMU and preintegrated IMU messages, both built from each PIMU
+    InertialSenseROS &n = node("stream_IMU: true, stream_preint_IMU: true");
+    pimu_t pimu;
+    memset(&pimu, 0, sizeof(pimu));
+    pimu.time = 1234.5;
+    pimu.dt = 0.004f;
+    pimu.theta[0] = 1.0e-4f;
+    pimu.theta[1] = -2.0e-4f;
+    pimu.theta[2] = 4.0e-3f;
+    pimu.vel[0] = 0.001f;
+    pimu.vel[1] = 0.002f;
+    pimu.vel[2] = -0.0392f;
+    for (auto _ : state)
+    {
+        pimu.time += 0.004;
+        n.preint_IMU_callback(DID_PIMU, &pimu);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_preint_IMU_callback);
+
+static void BM_GPS_obs_callback(benchmark::State &state)
+{
+    // Each iteration is one epoch: the previous epoch's bundle is published, then this one is collected
+    InertialSenseROS &n = node("stream_GPS1: true, stream_GPS_raw: true");
+    int count = state.range(0);
+    std::vector<obsd_t> obs(count);
+    memset(obs.data(), 0, obs.size() * sizeof(obsd_t));
+    for (int i = 0; i < count; i++)
+    {
+        obs[i].time.time = 1660000000;
+        obs[i].sat = 1 + i;
+        obs[i].SNR[0] = 160 + i % 40;
+        obs[i].code[0] = 1;
+        obs[i].P[0] = 2.0e7 + 1.5e5 * i;
+        obs[i].L[0] = obs[i].P[0] / 0.1903;
+        obs[i].D[0] = -150.0f + i;
+    }
+
+    // The bundle is published once the observations are 10 ms old in ROS time, 5 Hz epochs
+    ros::Time now(1660000000, 0);
+    int epoch = 0;
+    for (auto _ : state)
+    {
+        epoch++;
+        now += ros::Duration(0.2);
+        ros::Time::setNow(now);
+        for (int i = 0; i < count; i++)
+        {
+            obs[i].time.time = 1660000000 + epoch / 5;
+            obs[i].time.sec = 0.2 * (epoch % 5);
+        }
+        n.GPS_obs_callback(DID_GPS1_RAW, obs.data(), count);
+    }
+    ros::Time::useSystemTime();
+    n.gps1_obs_Vec_.obs.clear();
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_GPS_obs_callback)->Arg(30)->Arg(45)->Arg(60);
+
+static void BM_GPS_eph_callback(benchmark::State &state)
+{
+    InertialSenseROS &n = node("stream_GPS1: true, stream_GPS_raw: true");
+    eph_t eph;
+    memset(&eph, 0, sizeof(eph));
+    eph.sat = 12;
+    eph.week = 2230;
+    eph.toe.time = 1660000000;
+    eph.toc = eph.ttr = eph.toe;
+    eph.A = 26559710.0;
+    eph.e = 0.0123;
+    eph.i0 = 0.9613;
+    eph.toes = 345600.0;
+    for (auto _ : state)
+    {
+        eph.toe.time++;
+        n.GPS_eph_callback(DID_GPS1_RAW, &eph);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GPS_eph_callback);
+
+// Argument 1 with a GPS fix, 0 without, where the local offset filter runs instead
+static void set_gps_fix(InertialSenseROS &n, bool fix)
+{
+    n.core_.time_sync.gps_week = 2230;
+    n.core_.time_sync.gps_tow_offset = fix ? 345000.25 : 0.0;
+}
+
+static void BM_ros_time_from_week_and_tow(benchmark::State &state)
+{
+    InertialSenseROS &n = node("");
+    set_gps_fix(n, state.range(0));
+    double tow = 345600.125;
+    for (auto _ : state)
+    {
+        tow += 0.004;
+        benchmark::DoNotOptimize(n.ros_time_from_week_and_tow(2230, tow));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ros_time_from_week_and_tow)->Arg(0)->Arg(1);
+
+static void BM_ros_time_from_start_time(benchmark::State &state)
+{
+    InertialSenseROS &n = node("");
+    set_gps_fix(n, state.range(0));
+    double time = 1234.5;
+    for (auto _ : state)
+    {
+        time += 0.004;
+        benchmark::DoNotOptimize(n.ros_time_from_start_time(time));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ros_time_from_start_time)->Arg(0)->Arg(1);
+
+static void BM_ros_time_from_tow(benchmark::State &state)
+{
+    InertialSenseROS &n = node("");
+    set_gps_fix(n, state.range(0));
+    double tow = 345600.125;
+    for (auto _ : state)
+    {
+        tow += 0.004;
+        benchmark::DoNotOptimize(n.ros_time_from_tow(tow));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ros_time_from_tow)->Arg(0)->Arg(1);
+
+static void BM_ros_time_from_gtime(benchmark::State &state)
+{
+    InertialSenseROS &n = node("");
+    uint64_t sec = 1660000000;
+    for (auto _ : state)
+    {
+        sec++;
+        benchmark::DoNotOptimize(n.ros_time_from_gtime(sec, 0.125));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ros_time_from_gtime);
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "inertial_sense_ros_benchmarks", ros::init_options::AnonymousName | ros::init_options::NoRosout);
+    if (!ros::master::check())
+    {
+        fprintf(stderr, "inertial_sense_ros_benchmarks needs a running roscore\n");
+        return 1;
+    }
+    // Keep per message logging out of the measurements
+    if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn))
+        ros::console::notifyLoggerLevelsChanged();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -0,0 +1,199 @@
+/**
+ * \file ins_core.cpp
+ * \brief ns/op of the INS core library's conversions, without ROS
+ *
+ * The same synthetic inputs as inertial_sense_ros_benchmarks, fed to InsCore with a sink that
+ * only consumes the outputs.  The difference between the two is the cost of building and
+ * publishing the ROS messages.  Needs no roscore.
+ *
+ * usage: ins_core_benchmark [--benchmark_filter=ins4] [google benchmark options]
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+#include <string>
+
+#include "ins_core.h"
+
+class NullSink : public InsSink
+{
+public:
+    void odometry(frame_t frame, const ins_odometry_t &odom) { benchmark::DoNotOptimize(odom.position[0]); }
+    void imu(const ins_imu_t &imu) { benchmark::DoNotOptimize(imu.angular_velocity[0]); }
+    void preint_imu(const ins_preint_imu_t &preint) { benchmark::DoNotOptimize(preint.dt); }
+};
+
+// A vehicle in Salt Lake valley heading north-east, as the uINS reports it
+static ins_4_t make_ins4()
+{
+    ins_4_t ins;
+    memset(&ins, 0, sizeof(ins));
+    ins.week = 2230;
+    ins.timeOfWeek = 345600.125;
+    ins.insStatus = 0x00130F77;
+    ins.qe2b[0] = 0.4196f;
+    ins.qe2b[1] = -0.5470f;
+    ins.qe2b[2] = 0.2339f;
+    ins.qe2b[3] = 0.6863f;
+    ins.ve[0] = 1.2f;
+    ins.ve[1] = -3.4f;
+    ins.ve[2] = 0.7f;
+    ins.ecef[0] = -1766021.7;
+    ins.ecef[1] = -4460133.6;
+    ins.ecef[2] = 4244683.5;
+    return ins;
+}
+
+static ros_covariance_pose_twist_t make_covariance()
+{
+    ros_covariance_pose_twist_t cov;
+    memset(&cov, 0, sizeof(cov));
+    cov.timeOfWeek = 345600.125;
+    // Lower triangular, row by row: small correlations under a dominant diagonal
+    for (int i = 0, k = 0; i < 6; i++)
+    {
+        for (int j = 0; j <= i; j++, k++)
+        {
+            cov.covPoseLD[k] = i == j ? 0.01f * (i + 1) : 0.001f;
+            cov.covTwistLD[k] = i == j ? 0.002f * (i + 1) : 0.0002f;
+        }
+    }
+    return cov;
+}
+
+static pimu_t make_pimu()
+{
+    pimu_t pimu;
+    memset(&pimu, 0, sizeof(pimu));
+    pimu.time = 1234.5;
+    pimu.dt = 0.004f;
+    pimu.theta[0] = 0.0001f;
+    pimu.theta[1] = -0.0002f;
+    pimu.theta[2] = 0.0004f;
+    pimu.vel[0] = 0.001f;
+    pimu.vel[1] = 0.002f;
+    pimu.vel[2] = -0.0392f;
+    return pimu;
+}
+
+static void BM_ins4(benchmark::State &state)
+{
+    // Same bits as the odom_frames arguments of BM_INS4_callback
+    int outputs = state.range(0);
+    NullSink sink;
+    InsCore core(&sink);
+    const double refLla[3] = {40.7608, -111.8910, 1300.0};
+    core.set_ref_lla(refLla);
+    core.time_sync.gps_week = 2230;
+    core.time_sync.gps_tow_offset = 345000.25;
+    ros_covariance_pose_twist_t cov = make_covariance();
+    core.covariance(cov);
+
+    ins_4_t ins = make_ins4();
+    for (auto _ : state)
+    {
+        ins.timeOfWeek += 0.004;
+        core.ins4(ins, outputs);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(std::string(outputs & InsCore::ODOM_NED ? "ned " : "") + (outputs & InsCore::ODOM_ENU ? "enu " : "") +
+                   (outputs & InsCore::ODOM_ECEF ? "ecef" : ""));
+}
+BENCHMARK(BM_ins4)->Arg(1)->Arg(2)->Arg(4)->Arg(7);
+
+static void BM_covariance(benchmark::State &state)
+{
+    InsCore core;
+    ros_covariance_pose_twist_t cov = make_covariance();
+    for (auto _ : state)
+    {
+        cov.timeOfWeek += 0.004;
+        core.covariance(cov);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_covariance);
+
+static void BM_pimu(benchmark::State &state)
+{
+    NullSink sink;
+    InsCore core(&sink);
+    core.time_sync.gps_week = 2230;
+    core.time_sync.gps_tow_offset = 345000.25;
+    pimu_t pimu = make_pimu();
+    for (auto _ : state)
+    {
+        pimu.time += 0.004;
+        core.pimu(pimu, InsCore::IMU | InsCore::PREINT_IMU);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_pimu);
+
+static void BM_LD2Cov(benchmark::State &state)
+{
+    ros_covariance_pose_twist_t cov = make_covariance();
+    float out[36];
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cov.covPoseLD);
+        InsCore::LD2Cov(cov.covPoseLD, out, 6);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LD2Cov);
+
+static void BM_rotMatB2R(benchmark::State &state)
+{
+    ins_4_t ins = make_ins4();
+    ixVector4 q = {ins.qe2b[0], ins.qe2b[1], ins.qe2b[2], ins.qe2b[3]};
+    ixMatrix3 R;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(q);
+        InsCore::rotMatB2R(q, R);
+        benchmark::DoNotOptimize(R);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_rotMatB2R);
+
+static void BM_transform_6x6_covariance(benchmark::State &state)
+{
+    ros_covariance_pose_twist_t cov = make_covariance();
+    ins_4_t ins = make_ins4();
+    ixVector4 q = {ins.qe2b[0], ins.qe2b[1], ins.qe2b[2], ins.qe2b[3]};
+    ixMatrix3 R1, R2;
+    InsCore::rotMatB2R(q, R1);
+    InsCore::rotMatB2R(q, R2);
+    float in[36], out[36];
+    InsCore::LD2Cov(cov.covPoseLD, in, 6);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(in);
+        InsCore::transform_6x6_covariance(out, in, R1, R2);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_transform_6x6_covariance);
+
+// Argument 1 with a GPS fix, 0 without, where the local offset filter runs instead
+static void BM_time_from_week_and_tow(benchmark::State &state)
+{
+    InsTimeSync time_sync;
+    time_sync.gps_week = 2230;
+    time_sync.gps_tow_offset = state.range(0) ? 345000.25 : 0.0;
+    double tow = 345600.125;
+    for (auto _ : state)
+    {
+        tow += 0.004;
+        benchmark::DoNotOptimize(time_sync.from_week_and_tow(2230, tow));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_time_from_week_and_tow)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
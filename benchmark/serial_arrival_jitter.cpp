@@ -0,0 +1,160 @@
+/**
+ * \file serial_arrival_jitter.cpp
+ * \brief Measures host arrival jitter of uINS packets against their timeOfWeek spacing
+ *
+ * Streams DID_INS_1 from a uINS through Serial and compares the time between packet arrivals
+ * on the host with the time between them on the device.  Run it with and without the tuning
+ * options to see what the adapter and scheduler add.
+ *
+ * usage: serial_arrival_jitter <port> [baud] [seconds] [--low-latency] [--vmin N] [--vtime N]
+ *                              [--priority N] [--cpu N] [--period N]
+ */
+
+#include <serial.h>
+
+#include "data_sets.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JitterListener : public SerialListener
+{
+public:
+  void handle_packet(const IsbPacket& packet) override
+  {
+    double arrival = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    const ins_1_t* ins = packet.view<ins_1_t>(DID_INS_1);
+    if (ins == NULL)
+      return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (last_arrival_ > 0.0)
+    {
+      double device_dt = ins->timeOfWeek - last_tow_;
+      if (device_dt > 0.0 && device_dt < 1.0)
+      {
+        jitter_.push_back(1000.0 * ((arrival - last_arrival_) - device_dt));
+        device_dt_.push_back(1000.0 * device_dt);
+      }
+    }
+    last_arrival_ = arrival;
+    last_tow_ = ins->timeOfWeek;
+  }
+
+  void report()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (jitter_.empty())
+    {
+      printf("no DID_INS_1 packets received\n");
+      return;
+    }
+
+    double sum = 0.0, sum_sq = 0.0;
+    for (double j : jitter_)
+    {
+      sum += j;
+      sum_sq += j * j;
+    }
+    double mean = sum / jitter_.size();
+    double stddev = std::sqrt(std::max(0.0, sum_sq / jitter_.size() - mean * mean));
+
+    std::vector<double> magnitude(jitter_.size());
+    for (size_t i = 0; i < jitter_.size(); i++)
+      magnitude[i] = std::fabs(jitter_[i]);
+    std::sort(magnitude.begin(), magnitude.end());
+    std::sort(device_dt_.begin(), device_dt_.end());
+
+    printf("packets          %zu\n", jitter_.size() + 1);
+    printf("device spacing   %.3f ms (median)\n", device_dt_[device_dt_.size() / 2]);
+    printf("arrival jitter   mean %.3f ms, stddev %.3f ms\n", mean, stddev);
+    printf("|jitter|         p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+           magnitude[magnitude.size() / 2], magnitude[(magnitude.size() * 99) / 100], magnitude.back());
+  }
+
+private:
+  std::mutex mutex_;
+  double last_arrival_ = 0.0;
+  double last_tow_ = 0.0;
+  std::vector<double> jitter_;
+  std::vector<double> device_dt_;
+};
+
+static void request_stream(Serial& serial, uint32_t did, uint32_t size, uint32_t period)
+{
+  p_data_get_t get = { did, 0, size, period };
+  uint8_t packet[2 * sizeof(get) + 16];
+  size_t n = IsbFramer::encode(PID_GET_DATA, 0, &get, sizeof(get), packet, sizeof(packet));
+  serial.write(packet, n);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s <port> [baud] [seconds] [--low-latency] [--vmin N] [--vtime N] [--priority N] [--cpu N] [--period N]\n", argv[0]);
+    return 1;
+  }
+
+  std::string port = argv[1];
+  int baud = 921600;
+  double seconds = 10.0;
+  int period = 1;
+  SerialTuning tuning;
+  int positional = 0;
+  for (int i = 2; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--low-latency")
+      tuning.low_latency = true;
+    else if (arg == "--vmin" && i + 1 < argc)
+      tuning.vmin = atoi(argv[++i]);
+    else if (arg == "--vtime" && i + 1 < argc)
+      tuning.vtime = atoi(argv[++i]);
+    else if (arg == "--priority" && i + 1 < argc)
+      tuning.thread_priority = atoi(argv[++i]);
+    else if (arg == "--cpu" && i + 1 < argc)
+      tuning.thread_cpu = atoi(argv[++i]);
+    else if (arg == "--period" && i + 1 < argc)
+      period = atoi(argv[++i]);
+    else if (positional++ == 0)
+      baud = atoi(arg.c_str());
+    else
+      seconds = atof(arg.c_str());
+  }
+
+  JitterListener listener;
+  Serial serial(port, baud);
+  serial.set_tuning(tuning);
+  serial.register_listener(&listener);
+  try
+  {
+    serial.open();
+  }
+  catch (SerialException& e)
+  {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  request_stream(serial, DID_INS_1, sizeof(ins_1_t), period);
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  request_stream(serial, DID_INS_1, sizeof(ins_1_t), 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  serial.close();
+
+  printf("%s at %d baud, low latency %s, VMIN %d, VTIME %d, priority %d, cpu %d\n", port.c_str(), baud,
+         tuning.low_latency ? "on" : "off", tuning.vmin, tuning.vtime, tuning.thread_priority, tuning.thread_cpu);
+  listener.report();
+  printf("framing: %u packets, %u checksum errors, %u dropped bytes\n", serial.framer().packets(),
+         serial.framer().checksum_errors(), serial.framer().dropped_bytes());
+  return 0;
+}
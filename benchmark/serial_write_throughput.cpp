@@ -0,0 +1,94 @@
+/**
+ * \file serial_write_throughput.cpp
+ * \brief Measures Serial::write throughput and heap allocations per write over a pty pair
+ *
+ * usage: serial_write_throughput [writes per message size]
+ */
+
+#include <serial.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+
+static std::atomic<size_t> g_allocations(0);
+
+void* operator new(size_t size)
+{
+  g_allocations++;
+  if (void* p = malloc(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+int main(int argc, char** argv)
+{
+  size_t writes = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+
+  int master, slave;
+  char name[256];
+  if (openpty(&master, &slave, name, NULL, NULL) != 0)
+  {
+    perror("openpty");
+    return 1;
+  }
+  struct termios tio;
+  tcgetattr(slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+
+  // Drain the master side as fast as possible, standing in for the uINS
+  std::atomic<bool> done(false);
+  std::atomic<size_t> received(0);
+  std::thread reader([&]()
+  {
+    std::vector<uint8_t> buf(65536);
+    while (!done)
+    {
+      ssize_t n = read(master, buf.data(), buf.size());
+      if (n > 0)
+        received += n;
+    }
+  });
+
+  Serial serial(name, 921600);
+  serial.open();
+
+  printf("%10s %12s %12s %12s\n", "bytes", "writes/s", "MB/s", "allocs/write");
+  const size_t sizes[] = { 16, 64, 255, 1024, 4096 };
+  std::vector<uint8_t> message(4096, 0x55);
+  for (size_t size : sizes)
+  {
+    size_t start_received = received;
+    size_t start_allocations = g_allocations;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < writes; i++)
+      serial.write(message.data(), size);
+    while (received - start_received < writes * size)
+      std::this_thread::yield();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%10zu %12.0f %12.1f %12.4f\n", size, writes / seconds, writes * size / seconds / 1e6,
+           (double)(g_allocations - start_allocations) / writes);
+  }
+
+  done = true;
+  serial.close();
+  close(slave);
+  close(master);
+  reader.join();
+  return 0;
+}
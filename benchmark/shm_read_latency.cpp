@@ -0,0 +1,197 @@
+/**
+ * \file shm_read_latency.cpp
+ * \brief Latency of the INS state from writer to a reader in another process: shared memory
+ *        (shm_state.h) against a ROS subscriber to nav_msgs::Odometry
+ *
+ * Writes a state at the given rate for the given time and reports how long after it was
+ * written the reader had it.  The shared memory reader polls latest state like a control loop
+ * would, the ROS subscriber uses TCP without Nagle.  The ROS half needs a running roscore and
+ * is skipped without one.
+ *
+ * usage: shm_read_latency [seconds] [--rate HZ] [--no-ros]
+ */
+
+#include <nav_msgs/Odometry.h>
+#include <ros/ros.h>
+
+#include "shm_state_writer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+static double now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+static void report(const char* name, std::vector<double>& latency, uint64_t lost)
+{
+  if (latency.empty())
+  {
+    printf("%-16s  nothing received\n", name);
+    return;
+  }
+  std::sort(latency.begin(), latency.end());
+  printf("%-16s  %8zu  %6llu  %8.1f  %8.1f  %8.1f\n", name, latency.size(), (unsigned long long)lost,
+         latency[latency.size() / 2], latency[(latency.size() * 99) / 100], latency.back());
+  fflush(stdout);
+}
+
+static void shm_reader(const std::string& name, double seconds)
+{
+  ShmStateReader reader(name);
+  while (!reader.open())
+    usleep(1000);
+
+  std::vector<double> latency;
+  shm_ins_state_t state;
+  double end = now() + seconds;
+  while (now() < end)
+  {
+    // Busy polling, as a control loop checking for a new state each cycle would
+    if (reader.next_ins(state))
+      latency.push_back(1.0e6 * (now() - state.host_time));
+  }
+  report("shared memory", latency, reader.lost());
+}
+
+static void run_shm(double seconds, double rate)
+{
+  std::string name = "/shm_read_latency_" + std::to_string(getpid());
+  ShmStateWriter writer;
+  if (!writer.open(name, 64))
+  {
+    perror("shm_open");
+    return;
+  }
+
+  pid_t child = fork();
+  if (child == 0)
+  {
+    shm_reader(name, seconds + 0.5);
+    _exit(0);
+  }
+  usleep(200000);
+
+  shm_ins_state_t state = {};
+  timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  long period = (long)(1.0e9 / rate);
+  for (int i = 0; i < seconds * rate; i++)
+  {
+    next.tv_nsec += period;
+    while (next.tv_nsec >= 1000000000L)
+    {
+      next.tv_nsec -= 1000000000L;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    state.stamp = state.host_time = now();
+    state.position[0] = i;
+    writer.write_ins(state);
+  }
+  waitpid(child, NULL, 0);
+}
+
+static int ros_subscriber(const std::string& topic, double seconds)
+{
+  ros::NodeHandle nh;
+  std::vector<double> latency;
+  uint32_t expected = 0, lost = 0;
+  boost::function<void(const nav_msgs::Odometry::ConstPtr&)> callback = [&](const nav_msgs::Odometry::ConstPtr& msg)
+  {
+    latency.push_back(1.0e6 * (now() - msg->header.stamp.toSec()));
+    if (expected && msg->header.seq > expected)
+      lost += msg->header.seq - expected;
+    expected = msg->header.seq + 1;
+  };
+  ros::Subscriber sub = nh.subscribe<nav_msgs::Odometry>(topic, 100, callback, ros::VoidConstPtr(),
+                                                         ros::TransportHints().tcpNoDelay());
+  ros::WallTime end = ros::WallTime::now() + ros::WallDuration(seconds);
+  while (ros::ok() && ros::WallTime::now() < end)
+    ros::getGlobalCallbackQueue()->callAvailable(ros::WallDuration(0.01));
+  report("ROS subscriber", latency, lost);
+  return 0;
+}
+
+static void run_ros(int argc, char** argv, double seconds, double rate)
+{
+  ros::init(argc, argv, "shm_read_latency", ros::init_options::AnonymousName);
+  if (!ros::master::check())
+  {
+    printf("%-16s  skipped, no roscore\n", "ROS subscriber");
+    return;
+  }
+  ros::NodeHandle nh;
+  std::string topic = "/shm_read_latency/odom";
+  ros::Publisher pub = nh.advertise<nav_msgs::Odometry>(topic, 100);
+
+  char self[4096];
+  ssize_t n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+  self[n > 0 ? n : 0] = '\0';
+  std::string duration = std::to_string(seconds + 1.5);
+  pid_t child = fork();
+  if (child == 0)
+  {
+    execl(self, self, "--ros-subscriber", topic.c_str(), duration.c_str(), (char*)NULL);
+    _exit(1);
+  }
+
+  ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(5.0);
+  while (pub.getNumSubscribers() == 0 && ros::WallTime::now() < deadline)
+    ros::WallDuration(0.01).sleep();
+  ros::WallDuration(0.2).sleep();
+
+  nav_msgs::Odometry msg;
+  msg.header.frame_id = "ins_ned";
+  ros::WallRate loop(rate);
+  for (int i = 0; i < seconds * rate; i++)
+  {
+    loop.sleep();
+    msg.header.seq = i + 1;
+    msg.header.stamp = ros::Time(now());
+    msg.pose.pose.position.x = i;
+    pub.publish(msg);
+  }
+  waitpid(child, NULL, 0);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc >= 4 && std::string(argv[1]) == "--ros-subscriber")
+  {
+    ros::init(argc, argv, "shm_read_latency_sub", ros::init_options::AnonymousName);
+    return ros_subscriber(argv[2], atof(argv[3]));
+  }
+
+  double seconds = 10.0;
+  double rate = 250.0;
+  bool with_ros = true;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--rate" && i + 1 < argc)
+      rate = atof(argv[++i]);
+    else if (arg == "--no-ros")
+      with_ros = false;
+    else
+      seconds = atof(arg.c_str());
+  }
+
+  printf("%.0f Hz for %.1f s, latency from write to read in us\n", rate, seconds);
+  printf("reader            received    lost       p50       p99       max\n");
+  fflush(stdout);
+  // Before ros::init, which starts threads that a fork would not carry along
+  run_shm(seconds, rate);
+  if (with_ros)
+    run_ros(argc, argv, seconds, rate);
+  return 0;
+}
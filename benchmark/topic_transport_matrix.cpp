@@ -0,0 +1,179 @@
+/**
+ * \file topic_transport_matrix.cpp
+ * \brief Latency and loss of a 250 Hz stream for each queue depth, latch and transport setting
+ *
+ * Publishes nav_msgs::Odometry like odom_ins_ned to a subscriber in a second process, which
+ * stalls for a while every second like a briefly slow consumer.  Each case is run with the
+ * publisher and subscriber queue depth set to the same value, and reports the fraction of
+ * messages lost, the latency from publish to callback, and whether a subscriber joining after
+ * the first message still got it (latch).  Needs a running roscore.
+ *
+ * usage: topic_transport_matrix [seconds per case] [--rate HZ] [--stall-ms N]
+ */
+
+#include <nav_msgs/Odometry.h>
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+struct Case
+{
+  int queue_size;
+  bool latch;
+  std::string transport; // tcp, tcp_nodelay or udp
+};
+
+// Subscriber side, run as a child process, prints one result line
+static int run_subscriber(const std::string& topic, int queue_size, const std::string& transport, double seconds,
+                          double stall)
+{
+  ros::NodeHandle nh;
+  ros::TransportHints hints;
+  if (transport == "udp")
+    hints = ros::TransportHints().udp();
+  else
+    hints = ros::TransportHints().tcp().tcpNoDelay(transport == "tcp_nodelay");
+
+  std::vector<double> latency;
+  bool got_first = false;
+  ros::WallTime last_stall = ros::WallTime::now();
+  boost::function<void(const nav_msgs::Odometry::ConstPtr&)> callback = [&](const nav_msgs::Odometry::ConstPtr& msg)
+  {
+    latency.push_back(1000.0 * (ros::Time::now() - msg->header.stamp).toSec());
+    if (msg->header.seq == 0)
+      got_first = true;
+    if ((ros::WallTime::now() - last_stall).toSec() >= 1.0)
+    {
+      last_stall = ros::WallTime::now();
+      ros::WallDuration(stall).sleep();
+    }
+  };
+  ros::Subscriber sub = nh.subscribe<nav_msgs::Odometry>(topic, queue_size, callback, ros::VoidConstPtr(), hints);
+
+  ros::WallTime end = ros::WallTime::now() + ros::WallDuration(seconds);
+  while (ros::ok() && ros::WallTime::now() < end)
+    ros::getGlobalCallbackQueue()->callAvailable(ros::WallDuration(0.01));
+
+  size_t received = latency.size();
+  std::sort(latency.begin(), latency.end());
+  if (latency.empty())
+    latency.push_back(0.0);
+  printf("%zu %d %.3f %.3f %.3f\n", received, got_first ? 1 : 0, latency[latency.size() / 2],
+         latency[(latency.size() * 99) / 100], latency.back());
+  return 0;
+}
+
+static std::string self_path()
+{
+  char path[4096];
+  ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  if (n <= 0)
+    return "topic_transport_matrix";
+  path[n] = '\0';
+  return path;
+}
+
+static void run_case(ros::NodeHandle& nh, const Case& c, int index, double seconds, double rate, double stall)
+{
+  std::string topic = "/topic_transport_matrix/case" + std::to_string(index);
+  ros::Publisher pub = nh.advertise<nav_msgs::Odometry>(topic, c.queue_size, c.latch);
+
+  nav_msgs::Odometry msg;
+  msg.header.frame_id = "ned";
+  msg.child_frame_id = "body";
+  msg.header.seq = 0;
+  msg.header.stamp = ros::Time::now();
+  pub.publish(msg); // before anyone subscribed, only a latched topic delivers it
+
+  char command[4352];
+  snprintf(command, sizeof(command), "%s --subscriber %s %d %s %f %f", self_path().c_str(), topic.c_str(),
+           c.queue_size, c.transport.c_str(), seconds + 2.0, stall);
+  FILE* child = popen(command, "r");
+  if (child == NULL)
+  {
+    fprintf(stderr, "failed to start the subscriber\n");
+    return;
+  }
+
+  ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(5.0);
+  while (pub.getNumSubscribers() == 0 && ros::WallTime::now() < deadline)
+    ros::WallDuration(0.01).sleep();
+  ros::WallDuration(0.2).sleep(); // connection header exchange
+
+  ros::WallRate loop(rate);
+  uint32_t published = 0;
+  ros::WallTime end = ros::WallTime::now() + ros::WallDuration(seconds);
+  while (ros::WallTime::now() < end)
+  {
+    msg.header.seq = ++published;
+    msg.header.stamp = ros::Time::now();
+    pub.publish(msg);
+    loop.sleep();
+  }
+
+  unsigned received = 0;
+  int got_first = 0;
+  double p50 = 0.0, p99 = 0.0, max = 0.0;
+  int fields = fscanf(child, "%u %d %lf %lf %lf", &received, &got_first, &p50, &p99, &max);
+  pclose(child);
+  if (fields != 5)
+  {
+    printf("%5d  %-5s  %-11s  subscriber failed\n", c.queue_size, c.latch ? "on" : "off", c.transport.c_str());
+    return;
+  }
+  received -= got_first;
+  double loss = published ? 100.0 * (1.0 - std::min<double>(received, published) / published) : 0.0;
+  printf("%5d  %-5s  %-11s  %8u  %7.2f  %8.3f  %8.3f  %8.3f  %s\n", c.queue_size, c.latch ? "on" : "off",
+         c.transport.c_str(), published, loss, p50, p99, max, got_first ? "yes" : "no");
+  fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc >= 7 && std::string(argv[1]) == "--subscriber")
+  {
+    ros::init(argc, argv, "topic_transport_matrix_sub", ros::init_options::AnonymousName);
+    return run_subscriber(argv[2], atoi(argv[3]), argv[4], atof(argv[5]), atof(argv[6]));
+  }
+
+  double seconds = 5.0;
+  double rate = 250.0;
+  double stall = 0.05;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--rate" && i + 1 < argc)
+      rate = atof(argv[++i]);
+    else if (arg == "--stall-ms" && i + 1 < argc)
+      stall = 1.0e-3 * atof(argv[++i]);
+    else
+      seconds = atof(arg.c_str());
+  }
+
+  ros::init(argc, argv, "topic_transport_matrix", ros::init_options::AnonymousName);
+  ros::NodeHandle nh;
+  if (!ros::master::check())
+  {
+    fprintf(stderr, "no roscore\n");
+    return 1;
+  }
+
+  std::vector<Case> cases;
+  const int depths[] = { 1, 10, 100 };
+  const char* transports[] = { "tcp", "tcp_nodelay", "udp" };
+  for (int latch = 0; latch < 2; latch++)
+    for (int d = 0; d < 3; d++)
+      for (int t = 0; t < 3; t++)
+        cases.push_back(Case{ depths[d], latch == 1, transports[t] });
+
+  printf("%.0f Hz for %.1f s per case, subscriber stalls %.0f ms every second\n", rate, seconds, 1000.0 * stall);
+  printf("queue  latch  transport    published  loss %%  p50 ms    p99 ms    max ms    late join\n");
+  for (size_t i = 0; i < cases.size() && ros::ok(); i++)
+    run_case(nh, cases[i], (int)i, seconds, rate, stall);
+  return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * \file uins_simulator_main.cpp
+ * \brief Serves a simulated uINS on a pseudo-terminal for load and soak testing of the node
+ *
+ * Point the node's port parameter at the printed device (or at --link) and it connects as to a
+ * real uINS.  Statistics are printed as one JSON object per line, so scripts/soak_test.py can
+ * compare what the device sent with what the node published.
+ *
+ * usage: uins_simulator [--link /tmp/ttyUINS] [--nav-ms N] [--gps-ms N] [--baud N] [--sats N]
+ *                       [--serial N] [--duration seconds]
+ */
+
+#include "uins_simulator.h"
+
+#include <signal.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+static volatile bool stop = false;
+
+static void handle_signal(int)
+{
+  stop = true;
+}
+
+static double steady_now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#define DID_NAME(DID) \
+  case DID:             \
+    return #DID
+
+static const char* did_name(uint32_t did)
+{
+  switch (did)
+  {
+    DID_NAME(DID_DEV_INFO);
+    DID_NAME(DID_FLASH_CONFIG);
+    DID_NAME(DID_INS_1);
+    DID_NAME(DID_INS_2);
+    DID_NAME(DID_INS_4);
+    DID_NAME(DID_INL2_STATES);
+    DID_NAME(DID_PIMU);
+    DID_NAME(DID_MAGNETOMETER);
+    DID_NAME(DID_BAROMETER);
+    DID_NAME(DID_GPS1_POS);
+    DID_NAME(DID_GPS2_POS);
+    DID_NAME(DID_GPS1_VEL);
+    DID_NAME(DID_GPS2_VEL);
+    DID_NAME(DID_GPS1_SAT);
+    DID_NAME(DID_GPS2_SAT);
+    DID_NAME(DID_GPS1_RAW);
+    DID_NAME(DID_GPS2_RAW);
+  default:
+    return "DID_UNKNOWN";
+  }
+}
+
+static void print_stats(const UinsSimulator& sim, double elapsed)
+{
+  const UinsSimulator::stats_t& stats = sim.stats();
+  printf("{\"elapsed\": %.3f, \"nav_period\": %.4f, \"packets_sent\": %llu, \"bytes_sent\": %llu, "
+         "\"packets_dropped\": %llu, \"requests\": %llu, \"late_ticks\": %llu, \"sent\": {",
+         elapsed, sim.nav_period(), (unsigned long long)stats.packets_sent, (unsigned long long)stats.bytes_sent,
+         (unsigned long long)stats.packets_dropped, (unsigned long long)stats.requests,
+         (unsigned long long)stats.late_ticks);
+  const char* separator = "";
+  for (std::map<uint32_t, uint64_t>::const_iterator it = stats.sent.begin(); it != stats.sent.end(); ++it)
+  {
+    printf("%s\"%s\": %llu", separator, did_name(it->first), (unsigned long long)it->second);
+    separator = ", ";
+  }
+  printf("}}\n");
+  fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+  UinsSimulator::options_t options;
+  std::string link;
+  double duration = 0.0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--link" && i + 1 < argc)
+      link = argv[++i];
+    else if (arg == "--nav-ms" && i + 1 < argc)
+      options.nav_period_ms = atoi(argv[++i]);
+    else if (arg == "--gps-ms" && i + 1 < argc)
+      options.gps_period_ms = atoi(argv[++i]);
+    else if (arg == "--baud" && i + 1 < argc)
+      options.baudrate = atoi(argv[++i]);
+    else if (arg == "--sats" && i + 1 < argc)
+      options.num_sats = atoi(argv[++i]);
+    else if (arg == "--serial" && i + 1 < argc)
+      options.serial_number = strtoul(argv[++i], NULL, 10);
+    else if (arg == "--duration" && i + 1 < argc)
+      duration = atof(argv[++i]);
+    else
+    {
+      fprintf(stderr, "usage: %s [--link /tmp/ttyUINS] [--nav-ms N] [--gps-ms N] [--baud N] [--sats N] [--serial N] [--duration seconds]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (options.nav_period_ms <= 0 || options.gps_period_ms <= 0)
+  {
+    fprintf(stderr, "periods must be positive\n");
+    return 1;
+  }
+
+  UinsSimulator sim(options);
+  std::string error;
+  if (!sim.open(link, error))
+  {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  signal(SIGINT, handle_signal);
+  signal(SIGTERM, handle_signal);
+  fprintf(stderr, "simulated uINS %u on %s\n", options.serial_number, sim.port().c_str());
+
+  double start = steady_now();
+  double next_report = start + 1.0;
+  while (!stop)
+  {
+    sim.step(0.1);
+    double now = steady_now();
+    if (now >= next_report)
+    {
+      print_stats(sim, now - start);
+      next_report += 1.0;
+    }
+    if (duration > 0.0 && now - start >= duration)
+      break;
+  }
+  print_stats(sim, steady_now() - start);
+  return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+#include "data_sets.h"
+
+/**
+ * @brief DeviceCache
+ * On-disk record of the last known state of a uINS, keyed by serial number and firmware
+ * version, used to skip configuration round trips when the node restarts against the same
+ * device.
+ */
+class DeviceCache
+{
+public:
+    typedef std::map<uint32_t, int> stream_set_t; // DID -> period multiple
+
+    /**
+     * @param directory folder holding one cache file per device serial number
+     */
+    explicit DeviceCache(const std::string &directory = "");
+
+    /**
+     * @brief load
+     * Load the cache of a device. The cache is only valid if it was written for the same firmware.
+     * @return true if a valid cache was found
+     */
+    bool load(uint32_t serialNumber, const uint8_t firmwareVer[4]);
+
+    /**
+     * @brief save
+     * Write the cache of the device passed to load()
+     * @return true on success
+     */
+    bool save();
+
+    /**
+     * @brief load_port_baudrate
+     * Baud rate last negotiated with the device on port, which is needed before the device is known
+     * @return the baud rate, or 0 if none was saved
+     */
+    static int load_port_baudrate(const std::string &directory, const std::string &port);
+    static bool save_port_baudrate(const std::string &directory, const std::string &port, int baudrate);
+
+    bool valid() const { return valid_; }
+    std::string filename() const;
+
+    nvm_flash_cfg_t flash_cfg;
+    stream_set_t streams;
+    uint64_t gps_week = 0;
+    double ins_local_offset = 0.0; // uINS start time in ROS time seconds
+    double cold_startup_ms = 0.0;  // Duration of the last startup without / with a valid cache
+    double warm_startup_ms = 0.0;
+
+private:
+    std::string directory_;
+    uint32_t serial_number_ = 0;
+    std::string firmware_;
+    bool valid_ = false;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ISComm.h"
+#include "data_sets.h"
+#include "probes.h"
+
+/**
+ * @brief did_traits
+ * Compile-time mapping of a data set ID to the struct it carries
+ */
+template <eDataIDs DID>
+struct did_traits;
+
+#define DID_TRAITS(DID, TYPE)      \
+    template <>                    \
+    struct did_traits<DID>         \
+    {                              \
+        typedef TYPE type;         \
+    }
+
+DID_TRAITS(DID_FLASH_CONFIG, nvm_flash_cfg_t);
+DID_TRAITS(DID_INS_1, ins_1_t);
+DID_TRAITS(DID_INS_2, ins_2_t);
+DID_TRAITS(DID_INS_4, ins_4_t);
+DID_TRAITS(DID_INL2_STATES, inl2_states_t);
+DID_TRAITS(DID_ROS_COVARIANCE_POSE_TWIST, ros_covariance_pose_twist_t);
+DID_TRAITS(DID_PIMU, pimu_t);
+DID_TRAITS(DID_MAGNETOMETER, magnetometer_t);
+DID_TRAITS(DID_BAROMETER, barometer_t);
+DID_TRAITS(DID_STROBE_IN_TIME, strobe_in_time_t);
+DID_TRAITS(DID_MAG_CAL, mag_cal_t);
+DID_TRAITS(DID_GPS1_POS, gps_pos_t);
+DID_TRAITS(DID_GPS2_POS, gps_pos_t);
+DID_TRAITS(DID_GPS1_VEL, gps_vel_t);
+DID_TRAITS(DID_GPS2_VEL, gps_vel_t);
+DID_TRAITS(DID_GPS1_SAT, gps_sat_t);
+DID_TRAITS(DID_GPS2_SAT, gps_sat_t);
+DID_TRAITS(DID_GPS1_RAW, gps_raw_t);
+DID_TRAITS(DID_GPS2_RAW, gps_raw_t);
+DID_TRAITS(DID_GPS_BASE_RAW, gps_raw_t);
+DID_TRAITS(DID_GPS1_RTK_POS_REL, gps_rtk_rel_t);
+DID_TRAITS(DID_GPS2_RTK_CMP_REL, gps_rtk_rel_t);
+DID_TRAITS(DID_GPS1_RTK_POS_MISC, gps_rtk_misc_t);
+DID_TRAITS(DID_GPS2_RTK_CMP_MISC, gps_rtk_misc_t);
+
+/**
+ * @brief DidDispatchTable
+ * Table of Owner member functions indexed by DID.  Each entry is a function template
+ * instantiated for one DID and handler, so dispatching a packet is an array lookup and one
+ * direct call, with the cast of the data to its struct resolved at compile time.
+ */
+template <typename Owner>
+class DidDispatchTable
+{
+public:
+    typedef void (*stub_t)(Owner *owner, const p_data_t *data);
+
+    DidDispatchTable()
+    {
+        for (int i = 0; i < DID_COUNT; i++)
+            table_[i] = nullptr;
+    }
+
+    /**
+     * @brief set
+     * Route DID to Handler.  Setting the same handler again has no effect.
+     * @return true if the entry changed
+     */
+    template <eDataIDs DID, void (Owner::*Handler)(eDataIDs, const typename did_traits<DID>::type *)>
+    bool set()
+    {
+        static_assert(DID < DID_COUNT, "DID out of range of the dispatch table");
+        stub_t stub = &DidDispatchTable::call<DID, Handler>;
+        if (table_[DID] == stub)
+            return false;
+        table_[DID] = stub;
+        return true;
+    }
+
+    void clear(eDataIDs DID) { table_[DID] = nullptr; }
+
+    bool contains(uint32_t DID) const { return DID < DID_COUNT && table_[DID] != nullptr; }
+
+    /**
+     * @brief dispatch
+     * Call the handler of the packet's DID, if any
+     * @return true if a handler was called
+     */
+    inline bool dispatch(Owner *owner, const p_data_t *data) const
+    {
+        uint32_t DID = data->hdr.id;
+        if (DID >= DID_COUNT || table_[DID] == nullptr)
+            return false;
+        table_[DID](owner, data);
+        return true;
+    }
+
+private:
+    template <eDataIDs DID, void (Owner::*Handler)(eDataIDs, const typename did_traits<DID>::type *)>
+    static void call(Owner *owner, const p_data_t *data)
+    {
+        IS_PROBE1(callback_entry, DID);
+        (owner->*Handler)(DID, reinterpret_cast<const typename did_traits<DID>::type *>(data->buf));
+        IS_PROBE1(callback_exit, DID);
+    }
+
+    stub_t table_[DID_COUNT];
+};
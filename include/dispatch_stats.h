@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "ISComm.h"
+
+/**
+ * @brief DispatchStats
+ * Per DID counters and latency histograms of the packets the node dispatches, to tell whether
+ * a late message was late from the device, on the serial link or in the node.  Each packet
+ * contributes three latencies:
+ *   dispatch: host receive (the read that returned the packet) to callback entry
+ *   handler:  callback entry to return from the callback, after publish()
+ *   age:      device measurement time to host receive, if the device has GPS time.  Only
+ *             meaningful when the host clock is synchronized to GPS (NTP, PTP or chrony)
+ * Gaps and duplicates are detected from discontinuities of the time in the data set.
+ *
+ * Counters are cumulative.  Histograms are kept per window, so several readers (the diagnostics
+ * and the stats topic) can each report over their own period.
+ */
+class DispatchStats
+{
+public:
+    enum latency_t
+    {
+        LATENCY_DISPATCH,
+        LATENCY_HANDLER,
+        LATENCY_AGE,
+        LATENCY_COUNT
+    };
+
+    /**
+     * @brief histogram_t
+     * Log scale histogram of latencies, 4 buckets per octave from 1 us to 16 s
+     */
+    struct histogram_t
+    {
+        static const int BUCKETS = 96;
+
+        uint32_t buckets[BUCKETS] = {};
+        uint32_t count = 0;
+        double max = 0.0; // seconds
+
+        void add(double seconds);
+        double percentile(double p) const; // seconds, upper bound of the bucket holding percentile p (0-100)
+        static int bucket(double seconds);
+        static double upper_bound(int bucket);
+    };
+
+    struct window_t
+    {
+        uint32_t packets = 0;
+        uint64_t bytes = 0;
+        uint32_t gaps = 0;
+        uint32_t duplicates = 0;
+        histogram_t latency[LATENCY_COUNT];
+    };
+
+    struct did_t
+    {
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        uint32_t gaps = 0;       // discontinuities longer than 1.5 nominal periods
+        uint32_t missed = 0;     // packets estimated lost in gaps
+        uint32_t duplicates = 0; // packets repeating the time of the previous one
+        double last_time = 0.0;  // device time of the previous packet, seconds
+        double period = 0.0;     // nominal period, 0 until two packets were received
+        bool has_time = false;
+        std::vector<window_t> windows;
+    };
+
+    /**
+     * @brief sample_t
+     * One dispatched packet.  Times are seconds; receive, entry and done on a steady clock.
+     */
+    struct sample_t
+    {
+        uint32_t did = 0;
+        size_t size = 0;
+        bool has_device_time = false;
+        double device_time = 0.0;
+        bool has_age = false;
+        double age = 0.0;
+        double receive = 0.0;
+        double entry = 0.0;
+        double done = 0.0;
+    };
+
+    /**
+     * @brief add_window
+     * Register a reader of windowed histograms
+     * @return the window to pass to take_window()
+     */
+    int add_window();
+
+    void record(const sample_t &sample);
+
+    /**
+     * @brief reset_timing
+     * Forget the nominal period of a stream, for when its period multiple changes
+     */
+    void reset_timing(uint32_t did);
+
+    /**
+     * @brief take_window
+     * Close a window and open the next one
+     * @param elapsed seconds the window was open
+     * @return the window of every DID received so far, by DID
+     */
+    std::vector<std::pair<uint32_t, window_t>> take_window(int window, double now, double &elapsed);
+
+    const did_t *find(uint32_t did) const { return did < dids_.size() && dids_[did].packets ? &dids_[did] : nullptr; }
+
+    /**
+     * @brief device_time
+     * Time of the measurement in a data set, for the DIDs that carry one
+     * @param time GPS time of week, or time since boot if sinceBoot is set, in seconds
+     * @return false if the DID has no periodic time
+     */
+    static bool device_time(const p_data_t *data, double &time, bool &sinceBoot);
+
+    static double now(); // steady clock, seconds
+
+private:
+    void update_timing(did_t &stats, double time);
+
+    std::vector<did_t> dids_;
+    std::vector<double> window_start_;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "data_sets.h"
+
+/**
+ * @brief FlashConfigPlanner
+ * Plans the writes needed to bring the device flash configuration from its current state to
+ * the desired one.  The desired configuration starts as a copy of the current one and is
+ * edited in place; only the bytes that actually differ are written.
+ */
+class FlashConfigPlanner
+{
+public:
+    typedef struct
+    {
+        uint32_t offset; // offset into nvm_flash_cfg_t
+        uint32_t size;
+    } range_t;
+
+    /**
+     * @param current flash configuration read from the device
+     * @param mergeGap changed ranges separated by at most this many bytes are written as one
+     * (defaults to the size of an ISB packet header, footer and data header)
+     */
+    explicit FlashConfigPlanner(const nvm_flash_cfg_t &current, uint32_t mergeGap = 20);
+
+    nvm_flash_cfg_t &desired() { return desired_; }
+    const nvm_flash_cfg_t &desired() const { return desired_; }
+    const nvm_flash_cfg_t &current() const { return current_; }
+
+    /**
+     * @brief changes
+     * @return minimal set of byte ranges (after merging small gaps) that differ between current and desired
+     */
+    const std::vector<range_t> &changes() const;
+
+    /**
+     * @brief changed
+     * @return true if any byte in [offset, offset + size) differs between current and desired
+     */
+    bool changed(uint32_t offset, uint32_t size) const;
+
+    /**
+     * @brief verify
+     * Check a flash config readback against the planned changes
+     * @param buf readback data
+     * @param offset offset of buf into nvm_flash_cfg_t
+     * @param size number of bytes in buf
+     * @return true if every planned range is covered by the readback and matches
+     */
+    bool verify(const uint8_t *buf, uint32_t offset, uint32_t size) const;
+
+private:
+    nvm_flash_cfg_t current_;
+    nvm_flash_cfg_t desired_;
+    uint32_t merge_gap_;
+    mutable std::vector<range_t> changes_;
+};
@@ -5,6 +5,12 @@
 #include <algorithm>
 #include <string>
 #include <cstdlib>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
 #include <yaml-cpp/yaml.h>
 
 #include "InertialSense.h"
@@ -31,32 +37,39 @@
 #include "inertial_sense_ros/DID_INS2.h"
 #include "inertial_sense_ros/DID_INS1.h"
 #include "inertial_sense_ros/DID_INS4.h"
+#include "inertial_sense_ros/DIDStats.h"
+#include "inertial_sense_ros/INSState.h"
 #include "nav_msgs/Odometry.h"
 #include "std_srvs/Trigger.h"
 #include "std_msgs/Header.h"
+#include "std_msgs/Float32.h"
 #include "geometry_msgs/Vector3Stamped.h"
 #include "geometry_msgs/PoseWithCovarianceStamped.h"
 #include "diagnostic_msgs/DiagnosticArray.h"
 #include <tf/transform_broadcaster.h>
 #include "ISConstants.h"
+#include "flash_config_planner.h"
+#include "device_cache.h"
+#include "reconnect_supervisor.h"
+#include "serial_tuning.h"
+#include "link_budget.h"
+#include "stream_monitor.h"
+#include "overload_policy.h"
+#include "shm_state_writer.h"
+#include "udp_telemetry.h"
+#include "ins_state.h"
+#include "did_dispatch.h"
+#include "isb_raw.h"
+#include "ins_core.h"
+#include "dispatch_stats.h"
+#include "probes.h"
 //#include "geometry/xform.h"
 
-#define GPS_UNIX_OFFSET 315964800 // GPS time started on 6/1/1980 while UNIX time started 1/1/1970 this is the difference between those in seconds
-#define LEAP_SECONDS 18           // GPS time does not have leap seconds, UNIX does (as of 1/1/2017 - next one is probably in 2020 sometime unless there is some crazy earthquake or nuclear blast)
-#define UNIX_TO_GPS_OFFSET (GPS_UNIX_OFFSET - LEAP_SECONDS)
 #define FIRMWARE_VERSION_CHAR0 1
 #define FIRMWARE_VERSION_CHAR1 9
 #define FIRMWARE_VERSION_CHAR2 0
 
-#define SET_CALLBACK(DID, __type, __cb_fun, __periodmultiple)                          \
-    IS_.BroadcastBinaryData(DID, __periodmultiple,                                     \
-                            [this](InertialSense *i, p_data_t *data, int pHandle)      \
-                            {                                                          \
-                                /* ROS_INFO("Got message %d", DID);*/                  \
-                                this->__cb_fun(DID, reinterpret_cast<__type *>(data->buf)); \
-                            })
-
-class InertialSenseROS //: SerialListener
+class InertialSenseROS : public InsSink //: SerialListener
 {
 public:
     typedef enum
@@ -69,10 +82,21 @@ public:
         NMEA_SER1 = 0x02
     } NMEA_message_config_t;
 
-    InertialSenseROS(YAML::Node paramNode = YAML::Node(YAML::NodeType::Undefined), bool configFlashParameters = true);
+    /**
+     * @param connectDevice false to run without a uINS, with data delivered through replay_data()
+     */
+    InertialSenseROS(YAML::Node paramNode = YAML::Node(YAML::NodeType::Undefined), bool configFlashParameters = true, bool connectDevice = true);
+    ~InertialSenseROS();
     void callback(p_data_t *data);
     void update();
 
+    /**
+     * @brief replay_data
+     * Handle a recorded data set packet exactly like one received from the uINS.  Only valid
+     * when constructed with connectDevice false.
+     */
+    void replay_data(const p_data_t *data);
+
     void load_params_srv();
     void load_params_yaml(YAML::Node node);
     template <typename Type>
@@ -80,29 +104,178 @@ public:
     template <typename Derived1>
     bool get_node_vector_yaml(YAML::Node node, const std::string key, int size, Derived1 &val);
     void connect();
+    bool open_port();
+    bool device_responding(double timeout);
+    SerialTuning serial_tuning_;
+
+    // Baud rate negotiation
+    bool negotiate_baudrate_ = false;
+    std::vector<int> baudrate_candidates_ = {3000000, 2000000, 1500000, 921600, 460800, 230400, 115200};
+    int device_serial_port_ = 0;     // uINS serial port (0 or 1) the host is wired to
+    int link_test_round_trips_ = 20; // flash config readbacks that must all succeed for a rate to be accepted
+    void negotiate_baudrate();
+    bool switch_baudrate(int baudrate);
+    void save_device_baudrate();
+    bool test_link(int roundTrips);
+
+    // Serial link supervision
+    ReconnectSupervisor link_supervisor_;
+    ros::Timer link_supervisor_timer_;
+    double link_timeout_ = 2.0;         // seconds without data before the device is considered lost
+    double reconnect_backoff_min_ = 0.5; // seconds
+    double reconnect_backoff_max_ = 10.0;
+
+    // Data dispatch, every stream is registered with the SDK through the same handler
+    DidDispatchTable<InertialSenseROS> dispatch_table_;
+    pfnHandleBinaryData dispatch_handler_;
+    typedef struct
+    {
+        int period_multiple = 0;     // last requested period multiple
+        double last_request = -1e9;  // wall time of the last request
+        bool received = false;       // data arrived since the last request
+    } stream_request_t;
+    stream_request_t stream_requests_[DID_COUNT];
+    double stream_request_retry_ = 0.5; // seconds before an unanswered request is repeated
+    void on_device_data(const p_data_t *data);
+    void dispatch_data(const p_data_t *data, double receiveTime);
+    void read_device();
+    uint32_t dispatch_did_ = DID_NULL; // data set being dispatched, for the publish probes
+
+    template <typename Message>
+    void publish(const ros::Publisher &pub, const Message &msg)
+    {
+        IS_PROBE1(publish_entry, dispatch_did_);
+        pub.publish(msg);
+        IS_PROBE1(publish_exit, dispatch_did_);
+    }
+    void request_stream(eDataIDs DID, size_t size, int periodMultiple);
+    void forget_stream_requests();
+
+    /**
+     * @brief register_stream
+     * Route DID to Handler and request it from the device.  The data struct is taken from
+     * did_traits, so the handler signature is checked at compile time.  Registering the same
+     * stream again only repeats the device request while the stream has not started.
+     */
+    template <eDataIDs DID, void (InertialSenseROS::*Handler)(eDataIDs, const typename did_traits<DID>::type *)>
+    void register_stream(int periodMultiple)
+    {
+        dispatch_table_.set<DID, Handler>();
+        request_stream(DID, sizeof(typename did_traits<DID>::type), periodMultiple);
+    }
+
+    // Serial link bandwidth
+    LinkBudget link_budget_;
+    double link_headroom_ = 0.8; // fraction of the link the requested streams may use
+    bool link_auto_scale_ = false;
+    double link_planned_rate_ = 0.0; // planned rate at the last check
+    void check_link_budget();
+    void start_link_supervisor();
+    void link_supervisor_timer_callback(const ros::TimerEvent &event);
+    void resume_data_streams();
+
+    // Liveness of the individual data streams once they are running
+    StreamMonitor stream_monitor_;
+    ros::Timer stream_monitor_timer_;
+    bool stream_monitor_enabled_ = true;
+    double stream_stall_periods_ = 10.0; // expected periods without data before a stream is requested again
+    void start_stream_monitor();
+    void stream_monitor_timer_callback(const ros::TimerEvent &event);
+    void add_stream_monitor_diagnostics(diagnostic_msgs::DiagnosticArray &diag_array);
+
+    // Shedding of low priority streams when the node cannot keep up
+    OverloadPolicy overload_;
+    bool overload_policy_enabled_ = true;
+    double overload_shed_low_ = 0.8;     // utilization of the reading thread above which low priority streams are shed
+    double overload_shed_normal_ = 0.95; // and above which normal priority streams are shed as well
+    int diagnostics_skipped_ = 0;
+    int did_stats_skipped_ = 0;
+    void configure_overload_policy();
+    void add_overload_diagnostics(diagnostic_msgs::DiagnosticArray &diag_array);
+
+    // INS and IMU states in shared memory for processes outside ROS (shm_state.h)
+    bool shm_enabled_ = false;
+    std::string shm_name_ = "/inertial_sense";
+    int shm_slots_ = 64; // states kept per ring
+    ShmStateWriter shm_writer_;
+    void start_shm_output();
+    void write_shm_ins(const ins_odometry_t &odom);
+
+    // Compact INS records over UDP multicast, for telemetry (udp_telemetry.h)
+    bool udp_telemetry_enabled_ = false;
+    std::string udp_telemetry_address_ = "239.255.73.1";
+    int udp_telemetry_port_ = 7373;
+    int udp_telemetry_ttl_ = 1;
+    std::string udp_telemetry_interface_; // address of the interface to send from, default route if empty
+    double udp_telemetry_rate_ = 10.0;    // records per second, 0 for every state
+    int udp_telemetry_batch_ = 1;         // records per datagram
+    UdpTelemetry udp_telemetry_;
+    void start_udp_telemetry();
+    void send_udp_telemetry(const ins_odometry_t &odom);
+    void add_udp_telemetry_diagnostics(diagnostic_msgs::DiagnosticArray &diag_array);
+
+    // States of the DID_INS_4 being converted and the latest GPS1 fix, for the outputs above
+    uint32_t last_ins_status_ = 0;
+    uint32_t last_hdw_status_ = 0;
+    uint8_t gps1_fix_type_ = 0;
+    bool ned_state_needed() const { return odom_ins_ned_.enabled || shm_enabled_ || udp_telemetry_enabled_; }
+
+    // Per DID dispatch latency and rate, for the diagnostics and the did_stats topic
+    DispatchStats dispatch_stats_;
+    bool dispatch_stats_enabled_ = false;
+    double receive_time_ = 0.0;      // steady clock time the current read returned
+    double receive_wall_time_ = 0.0; // wall time the current read returned
+    int diagnostics_window_ = -1;
+    int did_stats_window_ = -1;
+    ros::Timer did_stats_timer_;
+    void did_stats_callback(const ros::TimerEvent &event);
+    void add_dispatch_diagnostics(diagnostic_msgs::DiagnosticArray &diag_array);
+
+    // Raw ISB passthrough
+    std::vector<int> isb_raw_dids_; // data sets streamed only for the raw topic
+    IsbRawWriter isb_raw_writer_;
+    inertial_sense_ros::ISBRaw isb_raw_msg_;
+    ros::Time isb_raw_read_time_; // host time the read completed, stamps the batch
+    void publish_isb_raw();
     bool firmware_compatiblity_check();
     void set_navigation_dt_ms();
     void configure_flash_parameters();
+    bool write_flash_config(const FlashConfigPlanner &planner);
     void configure_rtk();
     void connect_rtk_client(const std::string &RTK_correction_protocol, const std::string &RTK_server_IP, const int RTK_server_port);
     void start_rtk_server(const std::string &RTK_server_IP, const int RTK_server_port);
 
     void configure_data_streams(bool startup);
     void configure_data_streams(const ros::TimerEvent& event);
+    void restart_data_streams();
     void configure_ascii_output();
     void start_log();
 
+    // Device configuration cache
+    bool load_device_cache();
+    void save_device_cache();
+    bool device_cache_enabled_ = true;
+    std::string device_cache_dir_ = ""; // defaults to $HOME/.ros/inertial_sense
+    DeviceCache device_cache_;
+    DeviceCache::stream_set_t active_streams_; // DID -> period multiple of every broadcast requested from the device
+    bool warm_start_ = false;
+
     template <typename T>
     void get_vector_flash_config(std::string param_name, uint32_t size, T &data);
     //void set_vector_flash_config(std::string param_name, uint32_t size, uint32_t offset);
     void get_flash_config();
-    void reset_device();
+    bool reset_device();
+    bool wait_for_device(uint32_t serialNumber, double timeout);
     void flash_config_callback(eDataIDs DID, const nvm_flash_cfg_t *const msg);
     bool flashConfigStreaming_ = false;
     // Serial Port Configuration
     std::string port_ = "/dev/ttyACM0";
     int baudrate_ = 921600;
     bool initialized_;
+    bool replay_ = false; // no uINS, data comes from replay_data()
+    void start_replay();
+    bool config_flash_parameters_ = true;
+    double device_reboot_timeout_ = 15.0; // seconds to wait for the uINS to come back after a reset
     bool log_enabled_ = false;
     bool covariance_enabled_ = false;
 
@@ -116,8 +289,39 @@ public:
         ros::Publisher pub2;
         ros::Publisher pub3;
         int period_multiple = 1;
+        OverloadPolicy::priority_t priority = OverloadPolicy::PRIORITY_HIGH;
+        OverloadPolicy::drop_t drop_policy = OverloadPolicy::DROP_NEVER;
+        int queue_size = 1;       // publisher queue, 0 is unbounded
+        bool latch = false;
+        bool tcp_nodelay = false; // requested by subscribers using stream_transport_hints()
+        bool udp = false;         // UDPROS preferred over TCPROS, likewise
     } ros_stream_t;
 
+    template <typename Message>
+    ros::Publisher advertise(const ros_stream_t &stream, const std::string &topic)
+    {
+        return nh_.advertise<Message>(topic, stream.queue_size, stream.latch);
+    }
+
+    /**
+     * @brief stream_params_t
+     * A ROS stream, the data sets it is converted from and its defaults.  Streams sharing a name
+     * share their <name>_priority, _drop_policy, _queue_size, _latch, _tcp_nodelay and _udp parameters.
+     */
+    typedef struct
+    {
+        std::string name;
+        ros_stream_t *stream;
+        std::vector<uint32_t> dids;
+        OverloadPolicy::priority_t priority;
+        OverloadPolicy::drop_t drop_policy;
+        int queue_size;
+    } stream_params_t;
+    std::vector<stream_params_t> stream_params();
+    void set_stream_defaults();
+    void set_overload_params(const stream_params_t &entry, const std::string &priority, const std::string &dropPolicy);
+    void publish_transport_params();
+
 
     tf::TransformBroadcaster br;
     bool publishTf_ = true;
@@ -211,11 +415,14 @@ public:
     ros_stream_t odom_ins_ned_;
     ros_stream_t odom_ins_ecef_;
     ros_stream_t odom_ins_enu_;
+    ros_stream_t ins_state_; // compact INSState, one message for NED, ENU and ECEF
     ros_stream_t IMU_;
     ros_stream_t mag_;
     ros_stream_t baro_;
     ros_stream_t preint_IMU_;
     ros_stream_t diagnostics_;
+    ros_stream_t did_stats_;
+    ros_stream_t isb_raw_;
     ros_stream_t GPS1_;
     ros_stream_t GPS1_info_;
     ros_stream_t GPS1_raw_;
@@ -239,6 +446,7 @@ public:
     bool baroStreaming_ = false;
     bool preintImuStreaming_ = false;
     bool imuStreaming_ = false;
+    bool pimuStreaming_ = false;
     bool strobeInStreaming_ = false;
     bool diagnosticsStreaming_ = false;
     // NOTE: that GPS streaming flags are applicable for all GPS devices/receivers
@@ -267,6 +475,71 @@ public:
     bool perform_mag_cal_srv_callback(std_srvs::Trigger::Request &req, std_srvs::Trigger::Response &res);
     bool perform_multi_mag_cal_srv_callback(std_srvs::Trigger::Request &req, std_srvs::Trigger::Response &res);
     bool update_firmware_srv_callback(inertial_sense_ros::FirmwareUpdate::Request &req, inertial_sense_ros::FirmwareUpdate::Response &res);
+    bool set_refLLA(const double lla[3], std::string &message);
+
+    bool start_mag_cal(uint32_t command, std::string &message);
+    void mag_cal_callback(eDataIDs DID, const mag_cal_t *const msg);
+    void finish_mag_cal(bool completed);
+    ros::Publisher mag_cal_progress_pub_;
+    bool mag_cal_running_ = false;
+    bool mag_cal_enabled_ins1_ = false; // INS1 was only enabled to observe the calibration
+    double mag_cal_timeout_ = 600.0;    // seconds
+
+    // Asynchronous device commands
+    typedef std::function<bool(const p_data_t *data)> device_command_predicate_t;
+    typedef std::function<void(bool completed)> device_command_handler_t;
+    typedef struct
+    {
+        uint32_t completion_did;              // DID whose callbacks are checked for completion
+        device_command_predicate_t predicate; // Returns true once the device reflects the command
+        device_command_handler_t on_complete; // Optional, called from the dispatch path when resolved
+        bool poll;                            // Request the completion DID until resolved (for DIDs that are not streaming)
+        ros::Time deadline;
+        ros::Time next_poll;
+        std::shared_ptr<std::promise<bool>> result;
+    } device_command_t;
+    std::list<device_command_t> device_commands_;
+    double device_command_timeout_ = 2.0;      // seconds
+    double device_command_poll_period_ = 0.1;  // seconds between readback requests of the completion DID
+
+    /**
+     * @brief await_device_data
+     * Register a condition which is evaluated on every subsequent callback of DID in the normal dispatch path.
+     * @param DID data set checked by the predicate
+     * @param predicate returns true once the condition is met
+     * @param timeout seconds until the condition is resolved as failed
+     * @param poll if true, DID is requested from the device until the condition is resolved
+     * @param on_complete optional handler called with the outcome when the condition is resolved
+     * @return future resolved with true when the condition is met or false on timeout
+     */
+    std::shared_future<bool> await_device_data(eDataIDs DID, device_command_predicate_t predicate, double timeout, bool poll = false,
+                                               device_command_handler_t on_complete = device_command_handler_t());
+
+    /**
+     * @brief send_device_command
+     * Write data to the device and await completionDID satisfying predicate (see await_device_data).
+     * @param DID data set to write
+     * @param data pointer to the bytes to write
+     * @param size number of bytes to write
+     * @param offset offset of the write into the data set
+     * @param completionDID data set checked by the predicate
+     * @param predicate returns true once the device reflects the command
+     * @param poll if true, completionDID is requested from the device until the command is resolved
+     * @return future resolved with true on completion or false on timeout
+     */
+    std::shared_future<bool> send_device_command(eDataIDs DID, const void *data, uint32_t size, uint32_t offset, eDataIDs completionDID,
+                                                 device_command_predicate_t predicate, bool poll = true);
+
+    /**
+     * @brief await_device_command
+     * Keep dispatching device data until the command completes or times out
+     * @param result future returned by send_device_command or await_device_data
+     * @return true if the command completed before its deadline
+     */
+    bool await_device_command(std::shared_future<bool> result);
+    void process_device_commands(const p_data_t *data);
+    void service_device_commands();
+    void resolve_device_command(device_command_t &cmd, bool completed);
 
     void publishGPS1();
     void publishGPS2();
@@ -323,40 +596,15 @@ public:
     double tow_from_ros_time(const ros::Time &rt);
     ros::Time ros_time_from_gtime(const uint64_t sec, double subsec);
 
-    double GPS_towOffset_ = 0; // The offset between GPS time-of-week and local time on the uINS
-                               //  If this number is 0, then we have not yet got a fix
-    uint64_t GPS_week_ = 0;    // Week number to start of GPS_towOffset_ in GPS time
-    // Time sync variables
-    double INS_local_offset_ = 0.0;  // Current estimate of the uINS start time in ROS time seconds
-    bool got_first_message_ = false; // Flag to capture first uINS start time guess
-
-    /**
-     * @brief LD2Cov
-     * Transform array of covariance lower diagonals itno the full covariance matrix
-     * @param LD array of lower diagonals
-     * @param Cov full covariance matrix
-     * @param width size (width or height) of the covariance matrix
-     */
-    void LD2Cov(const float *LD, float *Cov, int width);
-
-    /**
-     * @brief rotMatB2R
-     * Make a rotation matrix body-to-reference from quaternion
-     * @param quat attitude quaternion (rotation from the reference frame to body)
-     * @param R rotation matrix body-to-reference
-     */
-    void rotMatB2R(const ixVector4 quat, ixMatrix3 R);
+    static ros::Time to_ros_time(const ins_stamp_t &stamp) { return ros::Time(stamp.sec, stamp.nsec); }
 
-    /**
-     * @brief transform_6x6_covariance
-     * Transform covariance matrix due to the change of coordinates, such that
-     * the fisrt 3 coordinates are rotated by R1 and the last 3 coordinates are rotated by R2
-     * @param Pout output covariance matrix (in the new coordinates)
-     * @param Pin  input covariance matrix (in the old coordinates)
-     * @param R1   rotation matrix describing transformation of the first 3 coordinates
-     * @param R2   rotation matrix describing transformation of the last 3 coordinates
-     */
-    void transform_6x6_covariance(float Pout[36], float Pin[36], ixMatrix3 R1, ixMatrix3 R2);
+    // Frame conversion, covariance and time sync of the odometry and IMU outputs.  The node feeds
+    // it uINS data and publishes what it returns through the InsSink overrides below.
+    InsCore core_;
+    void odometry(frame_t frame, const ins_odometry_t &odom) override;
+    void imu(const ins_imu_t &imu) override;
+    void preint_imu(const ins_preint_imu_t &preint) override;
+    void ins_state(const ins_4_t &msg, const ins_stamp_t &stamp) override;
 
     // Data to hold on to in between callbacks
     double lla_[3];
@@ -378,10 +626,9 @@ public:
     inertial_sense_ros::DID_INS1 did_ins_1_msg;
     inertial_sense_ros::DID_INS2 did_ins_2_msg;
     inertial_sense_ros::DID_INS4 did_ins_4_msg;
+    inertial_sense_ros::INSState ins_state_msg_;
     inertial_sense_ros::PreIntIMU preintIMU_msg;
 
-    float poseCov[36], twistCov[36];
-
     ros::NodeHandle nh_;
     ros::NodeHandle nh_private_;
 
@@ -401,6 +648,7 @@ public:
     int insDynModel_ = INS_DYN_MODEL_AIRBORNE_4G;
     bool refLLA_known = false;
     int ioConfig_ = 39624800; //F9P RUG2 RTK CMP: 0x025ca060
+    uint32_t rtk_cfg_bits_ = 0; // Determined by configure_rtk(), written by configure_flash_parameters()
     float gpsTimeUserDelay_ = 0;
 
 };
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+#include "ISConstants.h"
+#include "data_sets.h"
+
+#define GPS_UNIX_OFFSET 315964800 // GPS time started on 6/1/1980 while UNIX time started 1/1/1970 this is the difference between those in seconds
+#define LEAP_SECONDS 18           // GPS time does not have leap seconds, UNIX does (as of 1/1/2017 - next one is probably in 2020 sometime unless there is some crazy earthquake or nuclear blast)
+#define UNIX_TO_GPS_OFFSET (GPS_UNIX_OFFSET - LEAP_SECONDS)
+
+/**
+ * @brief UNIX time of a measurement, split like ros::Time
+ */
+struct ins_stamp_t
+{
+    uint32_t sec = 0;
+    uint32_t nsec = 0;
+
+    static ins_stamp_t from_sec(double t);
+    double to_sec() const { return sec + nsec * 1.0e-9; }
+};
+
+/**
+ * @brief InsTimeSync
+ * Converts uINS time to UNIX time.  With a GPS fix, from GPS week and time of week.  Without
+ * one, from a low-pass filtered offset between the uINS time and the host clock.
+ */
+class InsTimeSync
+{
+public:
+    InsTimeSync();
+
+    bool has_gps_time() const;
+
+    /**
+     * @param week Weeks since January 6th, 1980
+     * @param timeOfWeek Time of week (since Sunday morning) in seconds, GMT
+     */
+    ins_stamp_t from_week_and_tow(uint32_t week, double timeOfWeek);
+
+    /**
+     * @param time Time since boot up in seconds, converted to GPS time of week by adding gps_tow_offset
+     */
+    ins_stamp_t from_start_time(double time);
+
+    /**
+     * @param tow Time of week in seconds of gps_week
+     */
+    ins_stamp_t from_tow(double tow) { return from_week_and_tow(gps_week, tow); }
+
+    static ins_stamp_t from_gtime(uint64_t sec, double subsec);
+    double tow(const ins_stamp_t &stamp) const;
+
+    void update_local_offset(double y_offset);
+
+    std::function<double()> clock; // host UNIX time in seconds, the system clock by default
+
+    double gps_tow_offset = 0.0;    // The offset between GPS time-of-week and local time on the uINS
+                                    //  If this number is 0, then we have not yet got a fix
+    uint64_t gps_week = 0;          // Week number to start of gps_tow_offset in GPS time
+    double local_offset = 0.0;      // Current estimate of the uINS start time in host clock seconds
+    bool got_first_message = false; // Flag to capture first uINS start time guess
+    bool seeded = false;            // local_offset restored from a previous run, not yet confirmed by a measurement
+};
+
+/**
+ * @brief Pose and twist of the INS in one reference frame
+ */
+struct ins_odometry_t
+{
+    ins_stamp_t stamp;
+    double position[3] = {0, 0, 0};
+    double orientation[4] = {0, 0, 0, 0}; // w, x, y, z rotation from the reference frame to body
+    double linear_velocity[3] = {0, 0, 0};
+    double angular_velocity[3] = {0, 0, 0};
+    float pose_covariance[36] = {};  // position, attitude
+    float twist_covariance[36] = {}; // linear velocity, angular rate
+};
+
+struct ins_imu_t
+{
+    ins_stamp_t stamp;
+    double angular_velocity[3];
+    double linear_acceleration[3];
+    double orientation[4];               // w, x, y, z of the latest ENU odometry
+    double orientation_covariance[3];    // diagonals
+    double angular_velocity_covariance[3];
+    double linear_acceleration_covariance[3];
+};
+
+struct ins_preint_imu_t
+{
+    ins_stamp_t stamp;
+    float dtheta[3];
+    float dvel[3];
+    float dt;
+};
+
+/**
+ * @brief InsSink
+ * Receiver of the states InsCore computes, e.g. the ROS node's publishers
+ */
+class InsSink
+{
+public:
+    enum frame_t
+    {
+        FRAME_NED,
+        FRAME_ENU,
+        FRAME_ECEF
+    };
+
+    virtual ~InsSink() {}
+    virtual void odometry(frame_t frame, const ins_odometry_t &odom) {}
+    virtual void imu(const ins_imu_t &imu) {}
+    virtual void preint_imu(const ins_preint_imu_t &preint) {}
+    virtual void ins_state(const ins_4_t &msg, const ins_stamp_t &stamp) {} // DID_INS_4 as received, time stamped
+};
+
+/**
+ * @brief InsCore
+ * The ROS independent part of the node's fast path: uINS data sets in, time stamped states in
+ * the requested reference frames out to an InsSink.  Needs neither a device nor a ROS master.
+ */
+class InsCore
+{
+public:
+    enum output_t
+    {
+        ODOM_NED = 0x01,
+        ODOM_ENU = 0x02,
+        ODOM_ECEF = 0x04,
+        IMU = 0x08,
+        PREINT_IMU = 0x10,
+        INS_STATE = 0x20
+    };
+
+    explicit InsCore(InsSink *sink = nullptr) : sink_(sink) {}
+
+    void set_sink(InsSink *sink) { sink_ = sink; }
+
+    /**
+     * @param lla reference latitude, longitude (deg) and altitude (m) of the NED and ENU frames
+     */
+    void set_ref_lla(const double lla[3]);
+
+    /**
+     * @brief Pose and twist covariance for the following odometry
+     */
+    void covariance(const ros_covariance_pose_twist_t &msg);
+
+    /**
+     * @brief Odometry in each frame of outputs (ODOM_*), and the data set itself with INS_STATE.
+     * All outputs of one data set share its time stamp.
+     */
+    void ins4(const ins_4_t &msg, int outputs);
+
+    /**
+     * @brief IMU and preintegrated IMU as selected by outputs.  The angular rate is kept for
+     * the odometry.
+     */
+    void pimu(const pimu_t &msg, int outputs);
+
+    const ins_odometry_t &last_odometry(InsSink::frame_t frame) const { return odom_[frame]; }
+    const double *lla() const { return lla_; } // of the latest ins4(), degrees and meters
+    const float *pose_covariance() const { return pose_cov_; }
+    const float *twist_covariance() const { return twist_cov_; }
+    const float *angular_rate() const { return angular_rate_; } // body, from the latest pimu()
+
+    /**
+     * @brief Transform array of covariance lower diagonals into the full covariance matrix
+     * @param LD array of lower diagonals
+     * @param Cov full covariance matrix
+     * @param width size (width or height) of the covariance matrix
+     */
+    static void LD2Cov(const float *LD, float *Cov, int width);
+
+    /**
+     * @brief Make a rotation matrix body-to-reference from quaternion
+     * @param quat attitude quaternion (rotation from the reference frame to body)
+     * @param R rotation matrix body-to-reference
+     */
+    static void rotMatB2R(const ixVector4 quat, ixMatrix3 R);
+
+    /**
+     * @brief Transform covariance matrix due to the change of coordinates, such that
+     * the first 3 coordinates are rotated by R1 and the last 3 coordinates are rotated by R2
+     * @param Pout output covariance matrix (in the new coordinates)
+     * @param Pin  input covariance matrix (in the old coordinates)
+     * @param R1   rotation matrix describing transformation of the first 3 coordinates
+     * @param R2   rotation matrix describing transformation of the last 3 coordinates
+     */
+    static void transform_6x6_covariance(float Pout[36], const float Pin[36], const ixMatrix3 R1, const ixMatrix3 R2);
+
+    InsTimeSync time_sync;
+
+private:
+    InsSink *sink_;
+    double ref_lla_[3] = {0, 0, 0};
+    double lla_[3] = {0, 0, 0};
+    float pose_cov_[36] = {};
+    float twist_cov_[36] = {};
+    ixVector3 angular_rate_ = {0, 0, 0}; // body, from the latest PIMU
+    ins_odometry_t odom_[3];
+};
@@ -0,0 +1,304 @@
+#pragma once
+
+/**
+ * Consumer side of the ins_state topic (inertial_sense_ros/INSState): the navigation state of
+ * DID_INS_4 carried once in ECEF, from which NED, ENU and ECEF odometry is derived locally.
+ * Header only, without the InertialSense SDK.
+ *
+ *   void callback(const inertial_sense_ros::INSState &msg)
+ *   {
+ *       ins_state_frame_t ned;
+ *       ins_state_to_frame(msg, INS_STATE_NED, ned);
+ *       ...
+ *   }
+ *
+ * As on odom_ins_ned and odom_ins_enu, attitude, velocity and covariances are rotated into the
+ * NED or ENU frame at the current position and position is relative to ref_lla.  Position is
+ * taken in the tangent plane at ref_lla, where the node's linearized lla2ned differs by
+ * millimeters a kilometer from the reference.  ECEF position is plain ECEF, odom_ins_ecef
+ * negates z.  Quaternions may differ from the node's in sign.
+ */
+
+#include <math.h>
+#include <stddef.h>
+
+#define INS_STATE_COVARIANCE_SIZE 21 // upper triangle of a 6x6 matrix
+
+enum ins_state_frame_id_t
+{
+    INS_STATE_NED,
+    INS_STATE_ENU,
+    INS_STATE_ECEF
+};
+
+/**
+ * @brief Pose and twist in one reference frame, as in nav_msgs::Odometry
+ */
+struct ins_state_frame_t
+{
+    double position[3];
+    double orientation[4];      // w, x, y, z rotation from the reference frame to body
+    double linear_velocity[3];  // reference frame
+    double angular_velocity[3]; // reference frame
+    double pose_covariance[36];  // position, attitude, all zero without covariance
+    double twist_covariance[36]; // linear velocity, angular rate
+    bool has_covariance;
+};
+
+/**
+ * @brief Index into the packed upper triangle, row by row, of element (row, col) of a 6x6 matrix
+ */
+inline int ins_state_upper_index(int row, int col)
+{
+    if (row > col)
+    {
+        int t = row;
+        row = col;
+        col = t;
+    }
+    return row * 6 - row * (row - 1) / 2 + (col - row);
+}
+
+template <typename Float>
+inline void ins_state_pack_covariance(const Float full[36], float packed[INS_STATE_COVARIANCE_SIZE])
+{
+    for (int row = 0, k = 0; row < 6; row++)
+        for (int col = row; col < 6; col++, k++)
+            packed[k] = (float)full[row * 6 + col];
+}
+
+inline void ins_state_unpack_covariance(const float packed[INS_STATE_COVARIANCE_SIZE], double full[36])
+{
+    for (int row = 0; row < 6; row++)
+        for (int col = 0; col < 6; col++)
+            full[row * 6 + col] = packed[ins_state_upper_index(row, col)];
+}
+
+/**
+ * @brief Body to reference rotation matrix of a w, x, y, z quaternion
+ */
+inline void ins_state_quat_to_matrix(const double q[4], double R[3][3])
+{
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+    R[0][0] = 1 - 2 * (y * y + z * z);
+    R[0][1] = 2 * (x * y - w * z);
+    R[0][2] = 2 * (x * z + w * y);
+    R[1][0] = 2 * (x * y + w * z);
+    R[1][1] = 1 - 2 * (x * x + z * z);
+    R[1][2] = 2 * (y * z - w * x);
+    R[2][0] = 2 * (x * z - w * y);
+    R[2][1] = 2 * (y * z + w * x);
+    R[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+inline void ins_state_matrix_to_quat(const double R[3][3], double q[4])
+{
+    double trace = R[0][0] + R[1][1] + R[2][2];
+    if (trace > 0)
+    {
+        double s = 2.0 * sqrt(1.0 + trace);
+        q[0] = 0.25 * s;
+        q[1] = (R[2][1] - R[1][2]) / s;
+        q[2] = (R[0][2] - R[2][0]) / s;
+        q[3] = (R[1][0] - R[0][1]) / s;
+    }
+    else if (R[0][0] > R[1][1] && R[0][0] > R[2][2])
+    {
+        double s = 2.0 * sqrt(1.0 + R[0][0] - R[1][1] - R[2][2]);
+        q[0] = (R[2][1] - R[1][2]) / s;
+        q[1] = 0.25 * s;
+        q[2] = (R[0][1] + R[1][0]) / s;
+        q[3] = (R[0][2] + R[2][0]) / s;
+    }
+    else if (R[1][1] > R[2][2])
+    {
+        double s = 2.0 * sqrt(1.0 + R[1][1] - R[0][0] - R[2][2]);
+        q[0] = (R[0][2] - R[2][0]) / s;
+        q[1] = (R[0][1] + R[1][0]) / s;
+        q[2] = 0.25 * s;
+        q[3] = (R[1][2] + R[2][1]) / s;
+    }
+    else
+    {
+        double s = 2.0 * sqrt(1.0 + R[2][2] - R[0][0] - R[1][1]);
+        q[0] = (R[1][0] - R[0][1]) / s;
+        q[1] = (R[0][2] + R[2][0]) / s;
+        q[2] = (R[1][2] + R[2][1]) / s;
+        q[3] = 0.25 * s;
+    }
+    if (q[0] < 0)
+        for (int i = 0; i < 4; i++)
+            q[i] = -q[i];
+}
+
+/**
+ * @brief WGS84 latitude, longitude (deg) and altitude (m) to ECEF (m)
+ */
+inline void ins_state_lla_to_ecef(const double lla[3], double ecef[3])
+{
+    const double a = 6378137.0, e2 = 6.69437999014e-3;
+    double lat = lla[0] * M_PI / 180.0, lon = lla[1] * M_PI / 180.0;
+    double n = a / sqrt(1.0 - e2 * sin(lat) * sin(lat));
+    ecef[0] = (n + lla[2]) * cos(lat) * cos(lon);
+    ecef[1] = (n + lla[2]) * cos(lat) * sin(lon);
+    ecef[2] = (n * (1.0 - e2) + lla[2]) * sin(lat);
+}
+
+/**
+ * @brief ECEF (m) to WGS84 latitude, longitude (deg) and altitude (m)
+ */
+inline void ins_state_ecef_to_lla(const double ecef[3], double lla[3])
+{
+    const double a = 6378137.0, e2 = 6.69437999014e-3;
+    double p = sqrt(ecef[0] * ecef[0] + ecef[1] * ecef[1]);
+    double lat = atan2(ecef[2], p * (1.0 - e2));
+    double alt = 0.0;
+    for (int i = 0; i < 5; i++)
+    {
+        double n = a / sqrt(1.0 - e2 * sin(lat) * sin(lat));
+        alt = p / cos(lat) - n;
+        lat = atan2(ecef[2], p * (1.0 - e2 * n / (n + alt)));
+    }
+    lla[0] = lat * 180.0 / M_PI;
+    lla[1] = atan2(ecef[1], ecef[0]) * 180.0 / M_PI;
+    lla[2] = alt;
+}
+
+/**
+ * @brief ECEF to NED rotation matrix at the given latitude and longitude (deg)
+ */
+inline void ins_state_ecef_to_ned(double lat, double lon, double R[3][3])
+{
+    lat *= M_PI / 180.0;
+    lon *= M_PI / 180.0;
+    double sl = sin(lat), cl = cos(lat), so = sin(lon), co = cos(lon);
+    R[0][0] = -sl * co;
+    R[0][1] = -sl * so;
+    R[0][2] = cl;
+    R[1][0] = -so;
+    R[1][1] = co;
+    R[1][2] = 0.0;
+    R[2][0] = -cl * co;
+    R[2][1] = -cl * so;
+    R[2][2] = -sl;
+}
+
+inline void ins_state_mul(const double A[3][3], const double B[3][3], double C[3][3])
+{
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            C[i][j] = A[i][0] * B[0][j] + A[i][1] * B[1][j] + A[i][2] * B[2][j];
+}
+
+inline void ins_state_rotate(const double R[3][3], const double v[3], double out[3])
+{
+    for (int i = 0; i < 3; i++)
+        out[i] = R[i][0] * v[0] + R[i][1] * v[1] + R[i][2] * v[2];
+}
+
+/**
+ * @brief P' = T P T' with T block diagonal of R1 (first 3 coordinates) and R2 (last 3)
+ */
+inline void ins_state_transform_covariance(const double P[36], const double R1[3][3], const double R2[3][3], double out[36])
+{
+    double T[6][6] = {};
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            T[i][j] = R1[i][j];
+            T[i + 3][j + 3] = R2[i][j];
+        }
+    }
+    double TP[6][6];
+    for (int i = 0; i < 6; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            TP[i][j] = 0.0;
+            for (int k = 0; k < 6; k++)
+                TP[i][j] += T[i][k] * P[k * 6 + j];
+        }
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            double sum = 0.0;
+            for (int k = 0; k < 6; k++)
+                sum += TP[i][k] * T[j][k];
+            out[i * 6 + j] = sum;
+        }
+    }
+}
+
+/**
+ * @brief Odometry of an INSState message in the given frame
+ * @param msg inertial_sense_ros::INSState, or anything with the same fields
+ */
+template <typename Message>
+inline void ins_state_to_frame(const Message &msg, ins_state_frame_id_t frame, ins_state_frame_t &out)
+{
+    double qe2b[4] = {msg.qe2b[0], msg.qe2b[1], msg.qe2b[2], msg.qe2b[3]};
+    double ecef[3] = {msg.ecef[0], msg.ecef[1], msg.ecef[2]};
+    double ve[3] = {msg.ve[0], msg.ve[1], msg.ve[2]};
+    double rate[3] = {msg.angular_velocity[0], msg.angular_velocity[1], msg.angular_velocity[2]};
+
+    double Rb2e[3][3], Re2f[3][3], Rref[3][3];
+    ins_state_quat_to_matrix(qe2b, Rb2e);
+    double refEcef[3] = {0, 0, 0};
+    if (frame == INS_STATE_ECEF)
+    {
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                Re2f[i][j] = Rref[i][j] = i == j;
+    }
+    else
+    {
+        double lla[3];
+        ins_state_ecef_to_lla(ecef, lla);
+        ins_state_ecef_to_ned(lla[0], lla[1], Re2f);
+        ins_state_ecef_to_ned(msg.ref_lla[0], msg.ref_lla[1], Rref);
+        if (frame == INS_STATE_ENU)
+        {
+            // NED rows reordered to east, north, up
+            for (int j = 0; j < 3; j++)
+            {
+                double north = Re2f[0][j];
+                Re2f[0][j] = Re2f[1][j];
+                Re2f[1][j] = north;
+                Re2f[2][j] = -Re2f[2][j];
+                north = Rref[0][j];
+                Rref[0][j] = Rref[1][j];
+                Rref[1][j] = north;
+                Rref[2][j] = -Rref[2][j];
+            }
+        }
+        double refLla[3] = {msg.ref_lla[0], msg.ref_lla[1], msg.ref_lla[2]};
+        ins_state_lla_to_ecef(refLla, refEcef);
+    }
+
+    double Rb2f[3][3], delta[3];
+    ins_state_mul(Re2f, Rb2e, Rb2f);
+    for (int i = 0; i < 3; i++)
+        delta[i] = ecef[i] - refEcef[i];
+    ins_state_rotate(Rref, delta, out.position);
+    ins_state_matrix_to_quat(Rb2f, out.orientation);
+    ins_state_rotate(Re2f, ve, out.linear_velocity);
+    ins_state_rotate(Rb2f, rate, out.angular_velocity);
+
+    // Covariances come in ECEF position and velocity and body attitude and angular rate
+    out.has_covariance = msg.pose_covariance.size() == INS_STATE_COVARIANCE_SIZE &&
+                         msg.twist_covariance.size() == INS_STATE_COVARIANCE_SIZE;
+    if (!out.has_covariance)
+    {
+        for (int i = 0; i < 36; i++)
+            out.pose_covariance[i] = out.twist_covariance[i] = 0.0;
+        return;
+    }
+    double P[36];
+    ins_state_unpack_covariance(&msg.pose_covariance[0], P);
+    ins_state_transform_covariance(P, Re2f, Rb2f, out.pose_covariance);
+    ins_state_unpack_covariance(&msg.twist_covariance[0], P);
+    ins_state_transform_covariance(P, Re2f, Rb2f, out.twist_covariance);
+}
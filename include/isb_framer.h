@@ -0,0 +1,86 @@
+/**
+ * \file isb_framer.h
+ * \brief In-place framing of Inertial Sense binary (ISB) packets
+ */
+
+#ifndef ISB_FRAMER_H
+#define ISB_FRAMER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ISComm.h"
+
+/**
+ * \brief A decoded ISB packet, pointing into the receive buffer it was framed in.  Only valid
+ * until that buffer is reused, i.e. for the duration of SerialListener::handle_packet().
+ */
+struct IsbPacket
+{
+  uint8_t pid;
+  uint8_t counter;
+  uint8_t flags;
+
+  const uint8_t *body; //!< unescaped packet body, between header and checksum
+  size_t body_size;
+
+  const p_data_hdr_t *hdr; //!< data header of PID_DATA / PID_SET_DATA packets, otherwise NULL
+  const uint8_t *data; //!< data following hdr
+
+  /**
+   * \brief Typed view of the data of a complete data set, e.g. packet.view<ins_4_t>(DID_INS_4)
+   * \return NULL unless this packet carries all of DID
+   */
+  template <typename T>
+  const T* view(uint32_t did) const
+  {
+    if (hdr == NULL || hdr->id != did || hdr->offset != 0 || hdr->size != sizeof(T))
+      return NULL;
+    return reinterpret_cast<const T*>(data);
+  }
+};
+
+/**
+ * \brief Frames ISB packets directly in a mutable receive buffer.
+ *
+ * Packets are unescaped in place, moved down so that their data is 8 byte aligned when the
+ * buffer is, and returned as views without copying.  Bytes before the start of the next
+ * incomplete packet are consumed and may be overwritten.
+ */
+class IsbFramer
+{
+public:
+  IsbFramer();
+
+  /**
+   * \brief Frame the next complete packet in buf[pos, len)
+   * \param buf Receive buffer, 8 byte aligned
+   * \param len Number of valid bytes in buf
+   * \param pos In: where to continue scanning.  Out: end of the returned packet, or the start
+   *            of an incomplete packet (len if there is none) when false is returned.
+   * \param packet Receives the packet
+   * \return true if a packet was framed, false if the rest of the buffer holds no complete packet
+   */
+  bool next(uint8_t *buf, size_t len, size_t &pos, IsbPacket &packet);
+
+  /**
+   * \brief Encode an ISB packet, escaping the reserved bytes
+   * \param body Packet body, e.g. p_data_get_t for PID_GET_DATA
+   * \param out Output buffer, 2 * size + 16 bytes always suffice
+   * \return Number of bytes written to out, 0 if capacity is too small
+   */
+  static size_t encode(uint8_t pid, uint8_t counter, const void *body, size_t size, uint8_t *out, size_t capacity);
+
+  uint32_t packets() const { return packets_; }
+  uint32_t checksum_errors() const { return checksum_errors_; }
+  uint32_t dropped_bytes() const { return dropped_bytes_; } //!< bytes outside of any valid packet
+
+private:
+  bool decode(uint8_t *start, uint8_t *end, uint8_t *out, IsbPacket &packet);
+
+  uint32_t packets_;
+  uint32_t checksum_errors_;
+  uint32_t dropped_bytes_;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <ros/time.h>
+
+#include "ISComm.h"
+#include "data_sets.h"
+#include "isb_framer.h"
+#include "did_dispatch.h"
+#include "did_converters.h"
+#include "inertial_sense_ros/ISBRaw.h"
+
+/**
+ * @brief IsbRawWriter
+ * Collects the data set packets handed over by one read of the uINS and frames them into an
+ * ISBRaw message, exactly as they are sent on the wire.  Nothing is decoded, so recording the
+ * raw topic costs a copy per packet regardless of which data sets are streamed.
+ */
+class IsbRawWriter
+{
+public:
+    IsbRawWriter();
+
+    /**
+     * @brief Frame one data set packet into the current batch
+     */
+    void append(const p_data_t *data);
+
+    bool empty() const { return batch_.did.empty(); }
+
+    /**
+     * @brief Move the current batch into out and start a new one.  The vectors of out are kept
+     * for the next batch, so passing the same message every time avoids reallocating.
+     * @param stamp host time the read completed
+     */
+    void take(const ros::Time &stamp, inertial_sense_ros::ISBRaw &out);
+
+private:
+    inertial_sense_ros::ISBRaw batch_;
+    uint8_t counter_;
+};
+
+/**
+ * @brief IsbRawReader
+ * Iterates over the packets of an ISBRaw message and converts them back into typed data sets
+ * and ROS messages, e.g. for decoding a recording offline:
+ *
+ *     IsbRawReader reader(raw);
+ *     IsbPacket packet;
+ *     inertial_sense_ros::DID_INS1 ins1;
+ *     while (reader.next(packet))
+ *         if (IsbRawReader::decode<DID_INS_1>(packet, ins1))
+ *             ...
+ */
+class IsbRawReader
+{
+public:
+    explicit IsbRawReader(const inertial_sense_ros::ISBRaw &raw);
+
+    /**
+     * @brief Frame the next packet with a valid checksum
+     * @return false once all packets have been read
+     */
+    bool next(IsbPacket &packet);
+
+    const ros::Time &stamp() const { return stamp_; }
+    uint32_t checksum_errors() const { return framer_.checksum_errors(); }
+
+    /**
+     * @brief Typed view of a packet carrying a complete DID, NULL for any other packet
+     */
+    template <eDataIDs DID>
+    static const typename did_traits<DID>::type *view(const IsbPacket &packet)
+    {
+        return packet.view<typename did_traits<DID>::type>(DID);
+    }
+
+    /**
+     * @brief Convert a packet carrying a complete DID into its generated ROS message.  Only the
+     * message fields are written, the header is left to the caller.
+     * @return false if the packet does not carry DID
+     */
+    template <eDataIDs DID, typename Message>
+    static bool decode(const IsbPacket &packet, Message &out)
+    {
+        const typename did_traits<DID>::type *data = view<DID>(packet);
+        if (data == NULL)
+            return false;
+        did_converters::convert(*data, out);
+        return true;
+    }
+
+private:
+    std::vector<uint64_t> buffer_; // 8 byte aligned copy of the packets, framed in place
+    size_t size_;
+    size_t pos_;
+    ros::Time stamp_;
+    IsbFramer framer_;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+
+/**
+ * @brief LinkBudget
+ * Expected byte rate of the data streams requested from the uINS compared with what the
+ * serial link can carry.  Streams are planned from their struct size, period multiple and
+ * the rate of the data source, including ISB packet overhead.  Optionally the period
+ * multiples of the heaviest streams are raised until the plan fits under the headroom.
+ * The plan is compared with the bytes actually received at runtime.
+ */
+class LinkBudget
+{
+public:
+    struct stream_t
+    {
+        size_t size = 0;               // bytes of data per message
+        int requested_multiple = 0;    // period multiple asked for by the configuration
+        int period_multiple = 0;       // period multiple after scaling
+        uint64_t received_bytes = 0;   // ISB bytes received, including packet overhead
+        uint32_t received_packets = 0;
+        uint32_t window_packets = 0;   // packets since the previous measure()
+        double measured_rate = 0.0;    // packets/s over the last measure() window
+    };
+    typedef std::map<uint32_t, stream_t> stream_map_t;
+
+    /**
+     * @param baudrate serial baud rate, 8N1 framing is assumed
+     * @param headroom fraction of the link capacity the plan may use
+     */
+    explicit LinkBudget(int baudrate = 921600, double headroom = 0.8);
+
+    void set_link(int baudrate, double headroom);
+    void set_source_periods(double navPeriodMs, double gpsPeriodMs);
+    void set_auto_scale(bool enable) { auto_scale_ = enable; }
+
+    /**
+     * @brief plan_stream
+     * Add or update a stream in the plan
+     * @return the period multiple to request, which differs from periodMultiple if the stream was scaled
+     */
+    int plan_stream(uint32_t did, size_t size, int periodMultiple);
+
+    /**
+     * @brief scale_to_fit
+     * If auto scaling is enabled, double the period multiple of the heaviest streams until the
+     * plan fits under the headroom.
+     * @return DIDs whose period multiple changed
+     */
+    std::map<uint32_t, int> scale_to_fit();
+
+    /**
+     * @brief received
+     * Count a received data packet of a stream
+     */
+    void received(uint32_t did, size_t dataSize);
+
+    /**
+     * @brief measure
+     * Close a measurement window and update the measured packet rate of every stream
+     * @return bytes/s received since the previous call, 0 on the first call
+     */
+    double measure(double now);
+
+    /**
+     * @brief lagging_streams
+     * @return DIDs whose measured packet rate is below ratio times the planned rate
+     */
+    std::map<uint32_t, double> lagging_streams(double ratio) const;
+
+    double planned_packet_rate(uint32_t did, const stream_t &stream) const;
+
+    double capacity() const;     // bytes/s the link can carry
+    double planned_rate() const; // bytes/s of the planned streams
+    double stream_rate(uint32_t did, const stream_t &stream) const;
+    double utilization() const { return planned_rate() / capacity(); }
+    double headroom() const { return headroom_; }
+    bool over_budget() const { return utilization() > headroom_; }
+    const stream_map_t &streams() const { return streams_; }
+
+    /**
+     * @brief packet_size
+     * Bytes on the wire of an ISB data packet carrying dataSize bytes, with the average escaping overhead
+     */
+    static double packet_size(size_t dataSize);
+
+    /**
+     * @brief report
+     * One line per stream, heaviest first, for logging
+     */
+    std::string report() const;
+
+private:
+    double source_period_ms(uint32_t did) const;
+
+    int baudrate_;
+    double headroom_;
+    double nav_period_ms_ = 4.0;
+    double gps_period_ms_ = 200.0;
+    bool auto_scale_ = false;
+    stream_map_t streams_;
+
+    uint64_t measured_bytes_ = 0;
+    double last_measure_time_ = -1.0;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+
+#include "ISComm.h"
+
+/**
+ * @brief OverloadPolicy
+ * Sheds low priority work when the thread reading the uINS cannot keep up.  Load is the
+ * fraction of time the thread is busy: reads that return no packets are idle time, everything
+ * else (parsing, callbacks, publishing, timers) is work.  Past the thresholds the streams of the
+ * lower priorities are shed: their packets are held instead of converted, and converted after
+ * a later read once the load drops.
+ *
+ * How a held stream sheds depends on its drop policy:
+ *   latest:   only the newest packet is kept, older ones are dropped
+ *   coalesce: packets are queued up to a limit and converted together, the oldest are dropped
+ *             from a full queue
+ *   never:    not held, converted on arrival even when its priority is shed
+ * High priority streams are never shed.
+ */
+class OverloadPolicy
+{
+public:
+    enum priority_t
+    {
+        PRIORITY_LOW,
+        PRIORITY_NORMAL,
+        PRIORITY_HIGH
+    };
+
+    enum drop_t
+    {
+        DROP_LATEST,
+        DROP_COALESCE,
+        DROP_NEVER
+    };
+
+    /**
+     * @brief Packet held while its stream is shed, with the time it was received
+     */
+    struct held_t
+    {
+        held_t() {} // leaves the packet buffer uninitialized, only its used bytes are copied in
+        double receive_time;
+        p_data_t data;
+    };
+
+    struct stream_t
+    {
+        priority_t priority = PRIORITY_HIGH;
+        drop_t drop = DROP_NEVER;
+        std::deque<held_t> pending;
+        uint32_t deferred = 0; // packets held while shed
+        uint32_t dropped = 0;  // held packets replaced or pushed out of the queue
+        uint32_t flushed = 0;  // held packets converted later
+    };
+    typedef std::map<uint32_t, stream_t> stream_map_t;
+    typedef std::function<void(const p_data_t *data, double receiveTime)> dispatch_fn_t;
+
+    /**
+     * @param shedLow utilization above which low priority streams are shed
+     * @param shedNormal utilization above which normal priority streams are shed as well
+     * @param window seconds over which utilization is measured
+     * @param coalesceLimit packets a coalescing stream holds
+     */
+    explicit OverloadPolicy(double shedLow = 0.8, double shedNormal = 0.95, double window = 0.25, size_t coalesceLimit = 32);
+
+    void set_dispatch(dispatch_fn_t dispatch) { dispatch_ = dispatch; }
+
+    /**
+     * @brief set_policy
+     * Streams without a policy are high priority and never dropped
+     */
+    void set_policy(uint32_t did, priority_t priority, drop_t drop);
+
+    /**
+     * @brief dispatch
+     * Convert the packet now, or hold it if its stream is shed
+     * @param receiveTime when the packet was read, passed on to the dispatch function when the
+     * packet is converted, also if that is later
+     */
+    void dispatch(const p_data_t *data, double receiveTime);
+
+    /**
+     * @brief flush
+     * Convert the held packets of streams that are no longer shed, highest priority first
+     */
+    void flush();
+
+    /**
+     * @brief read_done
+     * Call after every read of the device, with the times the read started and ended in seconds
+     */
+    void read_done(double start, double end);
+
+    /**
+     * @brief skip
+     * Whether a periodic task of the given priority should skip this run.  At most 4 runs in a
+     * row are skipped, so its output is thinned out rather than silenced.
+     * @param consecutive runs skipped in a row, kept by the caller
+     */
+    bool skip(priority_t priority, int &consecutive);
+
+    bool shed(priority_t priority) const { return (int)priority < level_; }
+    int level() const { return level_; } // 0 nothing shed, 1 low, 2 low and normal priority shed
+    double utilization() const { return utilization_; }
+    uint32_t level_changes() const { return level_changes_; }
+    uint32_t skipped_runs() const { return skipped_runs_; }
+    const stream_map_t &streams() const { return streams_; }
+
+    static bool parse_priority(const std::string &name, priority_t &priority);
+    static bool parse_drop(const std::string &name, drop_t &drop);
+    static const char *priority_name(priority_t priority);
+    static const char *drop_name(drop_t drop);
+
+private:
+    void flush(stream_t &stream);
+
+    double shed_low_;
+    double shed_normal_;
+    double window_;
+    size_t coalesce_limit_;
+    dispatch_fn_t dispatch_;
+    stream_map_t streams_;
+    bool holding_ = false; // any stream has held packets
+
+    uint32_t packets_ = 0;  // packets dispatched since the last read_done()
+    double window_start_ = -1.0;
+    double idle_ = 0.0;     // seconds of reads without packets in the window
+    double utilization_ = 0.0;
+    int level_ = 0;
+    uint32_t level_changes_ = 0;
+    uint32_t skipped_runs_ = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+/**
+ * USDT probes of the driver hot path, provider "inertial_sense", for bpftrace and perf.
+ * Built with INERTIAL_SENSE_PROBES (CMake option USDT_PROBES, needs sys/sdt.h) every probe is a
+ * single nop until a tracer attaches to it.  Without it they compile to nothing and their
+ * arguments are not evaluated.  Arguments are integers, times in ns, so tracers can read them.
+ *
+ *   read_begin, read_end()               one read of the serial port, framing and dispatch of
+ *                                        every packet in it
+ *   packet(did, size, offset)            a packet framed and parsed by the SDK, before dispatch
+ *   callback_entry, callback_exit(did)   the *_callback of a data set
+ *   publish_entry, publish_exit(did)     a publish(), did is the data set being dispatched, 0
+ *                                        from timers
+ *   time_sync_local(offset, measured)    low-pass update of the uINS boot time offset, ns
+ *   time_sync_gps(week, tow_offset)      GPS time of week offset from a GPS fix, ns
+ *   rtk_watchdog(bytes, interruptions)   each check of the RTK correction traffic
+ *   rtk_reconnect(interruptions)         the watchdog reconnecting the correction client
+ *
+ * scripts/bpftrace has examples.
+ */
+
+#ifdef INERTIAL_SENSE_PROBES
+
+#include <sys/sdt.h>
+
+#define IS_PROBE(name) DTRACE_PROBE(inertial_sense, name)
+#define IS_PROBE1(name, a1) DTRACE_PROBE1(inertial_sense, name, a1)
+#define IS_PROBE2(name, a1, a2) DTRACE_PROBE2(inertial_sense, name, a1, a2)
+#define IS_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(inertial_sense, name, a1, a2, a3)
+
+#else
+
+#define IS_PROBE(name) \
+    do                 \
+    {                  \
+    } while (0)
+#define IS_PROBE1(name, a1) IS_PROBE(name)
+#define IS_PROBE2(name, a1, a2) IS_PROBE(name)
+#define IS_PROBE3(name, a1, a2, a3) IS_PROBE(name)
+
+#endif
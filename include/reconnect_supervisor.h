@@ -0,0 +1,72 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+/**
+ * @brief ReconnectSupervisor
+ * Detects loss of the device link (port node removed or no data for a while) and reopens
+ * the port with exponential backoff, without blocking the caller.  Times are passed in by
+ * the caller in seconds so the supervisor can run against any clock.
+ */
+class ReconnectSupervisor
+{
+public:
+    typedef std::function<bool()> open_fn_t;                          // Try to open the device, returns true on success
+    typedef std::function<void(const std::string &reason)> close_fn_t; // Release the port after the device was lost
+    typedef std::function<void()> resume_fn_t;                        // Restore streams and state after reconnecting
+
+    /**
+     * @param port device path, a missing path is treated as a lost device
+     * @param linkTimeout seconds without data after which the link is considered lost (<= 0 disables)
+     * @param minBackoff seconds before the first reopen attempt
+     * @param maxBackoff upper limit of the doubling delay between reopen attempts
+     */
+    ReconnectSupervisor(const std::string &port = "", double linkTimeout = 2.0, double minBackoff = 0.5, double maxBackoff = 10.0);
+
+    void set_handlers(open_fn_t open, close_fn_t close, resume_fn_t resume);
+
+    /**
+     * @brief data_received
+     * Call for every packet received from the device
+     */
+    void data_received(double now);
+
+    /**
+     * @brief update
+     * Call periodically. Detects device loss and attempts to reconnect when due.
+     */
+    void update(double now);
+
+    bool connected() const { return connected_; }
+
+    int outage_count() const { return outage_count_; }
+    int reconnect_attempts() const { return reconnect_attempts_; }
+    double last_outage_duration() const { return last_outage_duration_; }
+    double total_outage_duration() const { return total_outage_duration_; }
+    double current_outage_duration(double now) const { return connected_ ? 0.0 : now - outage_start_; }
+
+private:
+    bool port_present() const;
+    void lost(double now, const char *reason);
+
+    std::string port_;
+    double link_timeout_;
+    double min_backoff_;
+    double max_backoff_;
+    open_fn_t open_;
+    close_fn_t close_;
+    resume_fn_t resume_;
+
+    bool connected_ = true;
+    bool data_seen_ = false;
+    double last_rx_time_ = 0.0;
+    double outage_start_ = 0.0;
+    double next_attempt_ = 0.0;
+    double backoff_ = 0.0;
+
+    int outage_count_ = 0;
+    int reconnect_attempts_ = 0;
+    double last_outage_duration_ = 0.0;
+    double total_outage_duration_ = 0.0;
+};
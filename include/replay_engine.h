@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <ros/time.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include "ISComm.h"
+#include "inertial_sense_ros/ISBRaw.h"
+
+/**
+ * @brief ReplaySource
+ * Recorded batches of ISB packets, in the order they were received
+ */
+class ReplaySource
+{
+public:
+    virtual ~ReplaySource() {}
+
+    /**
+     * @return false at the end of the recording
+     */
+    virtual bool next(inertial_sense_ros::ISBRaw &batch) = 0;
+};
+
+/**
+ * @brief BagReplaySource
+ * The isb_raw messages of a rosbag, as recorded with stream_isb_raw enabled
+ */
+class BagReplaySource : public ReplaySource
+{
+public:
+    /**
+     * @throws rosbag::BagException if the bag cannot be opened
+     */
+    BagReplaySource(const std::string &path, const std::string &topic = "isb_raw");
+
+    bool next(inertial_sense_ros::ISBRaw &batch) override;
+
+private:
+    rosbag::Bag bag_;
+    std::unique_ptr<rosbag::View> view_;
+    rosbag::View::iterator it_;
+};
+
+/**
+ * @brief ReplayTarget
+ * Receiver of the replayed packets, normally an InertialSenseROS constructed without a device
+ */
+class ReplayTarget
+{
+public:
+    virtual ~ReplayTarget() {}
+
+    /**
+     * @brief Called before the packets of a batch with the host time they were received at
+     */
+    virtual void set_time(const ros::Time &stamp) = 0;
+    virtual void deliver(const p_data_t *data) = 0;
+    virtual void batch_done() {}
+    virtual bool ok() { return true; }
+};
+
+/**
+ * @brief ReplayEngine
+ * Delivers every packet of a ReplaySource to a ReplayTarget.  Batches are released at their
+ * recorded spacing divided by the rate, or back to back when the rate is 0.  Time seen by the
+ * target only comes from the recording, so the output does not depend on the rate.
+ */
+class ReplayEngine
+{
+public:
+    struct stats_t
+    {
+        uint64_t batches = 0;
+        uint64_t packets = 0;
+        uint32_t checksum_errors = 0;
+        double recorded_duration = 0.0; // s between the first and last batch
+        double wall_duration = 0.0;     // s the replay took
+    };
+
+    typedef std::function<double()> wall_now_t;
+    typedef std::function<void(double seconds)> wall_sleep_t;
+
+    /**
+     * @param rate playback speed relative to the recording, 0 for as fast as possible
+     */
+    ReplayEngine(ReplaySource &source, double rate = 1.0);
+
+    /**
+     * @brief Replace the monotonic wall clock used for pacing, e.g. in tests
+     */
+    void set_wall_clock(wall_now_t now, wall_sleep_t sleep);
+
+    /**
+     * @brief Replay until the source ends or the target is no longer ok
+     */
+    stats_t run(ReplayTarget &target);
+
+private:
+    ReplaySource &source_;
+    double rate_;
+    wall_now_t wall_now_;
+    wall_sleep_t wall_sleep_;
+};
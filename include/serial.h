@@ -40,19 +40,125 @@
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 #include <boost/function.hpp>
+#include <boost/type_traits/aligned_storage.hpp>
 
-#include <list>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <stdint.h>
 
+#include <isb_framer.h>
+#include <serial_tuning.h>
+
 #define BUFFER_SIZE 2048
+#define READ_BUFFER_SIZE (4 * BUFFER_SIZE)
+#define WRITE_BUFFER_SIZE (32 * BUFFER_SIZE)
+
+/**
+ * \brief Fixed storage for the handler of one outstanding asynchronous operation, so that
+ * starting the operation does not hit the heap.  Falls back to the heap if the storage is
+ * already in use or too small.
+ */
+class HandlerMemory
+{
+public:
+  HandlerMemory() : in_use_(false) {}
+
+  void* allocate(size_t size)
+  {
+    if (!in_use_ && size <= sizeof(storage_))
+    {
+      in_use_ = true;
+      return &storage_;
+    }
+    return ::operator new(size);
+  }
+
+  void deallocate(void* pointer)
+  {
+    if (pointer == &storage_)
+      in_use_ = false;
+    else
+      ::operator delete(pointer);
+  }
+
+private:
+  HandlerMemory(const HandlerMemory&);
+  HandlerMemory& operator=(const HandlerMemory&);
+
+  boost::aligned_storage<1024>::type storage_;
+  bool in_use_;
+};
+
+template <typename T>
+class HandlerAllocator
+{
+public:
+  typedef T value_type;
+
+  explicit HandlerAllocator(HandlerMemory& memory) : memory_(memory) {}
+
+  template <typename U>
+  HandlerAllocator(const HandlerAllocator<U>& other) : memory_(other.memory_) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(memory_.allocate(sizeof(T) * n)); }
+  void deallocate(T* pointer, size_t) { memory_.deallocate(pointer); }
+
+  bool operator==(const HandlerAllocator& other) const { return &memory_ == &other.memory_; }
+  bool operator!=(const HandlerAllocator& other) const { return &memory_ != &other.memory_; }
+
+private:
+  template <typename> friend class HandlerAllocator;
+  HandlerMemory& memory_;
+};
+
+/**
+ * \brief Wraps an asio completion handler so that asio allocates its operation state from a HandlerMemory
+ */
+template <typename Handler>
+class AllocHandler
+{
+public:
+  typedef HandlerAllocator<Handler> allocator_type;
+
+  AllocHandler(HandlerMemory& memory, Handler handler) : memory_(memory), handler_(handler) {}
+
+  allocator_type get_allocator() const { return allocator_type(memory_); }
+
+  template <typename... Args>
+  void operator()(Args&&... args) { handler_(std::forward<Args>(args)...); }
+
+  // Allocation hooks for Boost versions without associated allocators
+  friend void* asio_handler_allocate(size_t size, AllocHandler* handler) { return handler->memory_.allocate(size); }
+  friend void asio_handler_deallocate(void* pointer, size_t, AllocHandler* handler) { handler->memory_.deallocate(pointer); }
+
+private:
+  HandlerMemory& memory_;
+  Handler handler_;
+};
+
+template <typename Handler>
+inline AllocHandler<Handler> make_alloc_handler(HandlerMemory& memory, Handler handler)
+{
+  return AllocHandler<Handler>(memory, handler);
+}
 
 class SerialListener
 {
 public:
-  virtual void handle_bytes(const uint8_t* bytes, uint8_t len) = 0;
+  virtual ~SerialListener() {}
+
+  /**
+   * \brief Called with every chunk of bytes read from the port, before packets are framed
+   */
+  virtual void handle_bytes(const uint8_t* /*bytes*/, size_t /*len*/) {}
+
+  /**
+   * \brief Called with every Inertial Sense binary packet framed from the received bytes.  The
+   * packet points into the receive buffer and must not be used after returning.
+   */
+  virtual void handle_packet(const IsbPacket& /*packet*/) {}
 };
 
 
@@ -65,13 +171,18 @@ public:
    * \param port Name of the serial port (e.g. "/dev/ttyUSB0")
    * \param baud_rate Serial communication baud rate
    */
-  Serial(std::__cxx11::string port, int baud_rate);
+  Serial(std::string port, int baud_rate);
 
   /**
    * \brief Stops communication and closes the serial port before the object is destroyed
    */
   ~Serial();
 
+  /**
+   * \brief Latency settings applied to the port and the io thread by open()
+   */
+  void set_tuning(const SerialTuning& tuning) { tuning_ = tuning; }
+
   /**
    * \brief Opens the port and begins communication
    */
@@ -84,10 +195,15 @@ public:
 
   /**
    * \brief write data
+   *
+   * The bytes are copied into a fixed-size ring and sent from the io thread, so this does
+   * not allocate.  If the ring is full the call blocks until enough has been sent; messages
+   * larger than the ring are streamed through it.  Do not write more than WRITE_BUFFER_SIZE
+   * bytes at once from a SerialListener callback, which runs on the io thread.
    * \param buffer The message to send
    * \param len The number of bytes
    */
-  void write(const uint8_t *buffer, uint8_t len);
+  void write(const uint8_t *buffer, size_t len);
 
   /**
    * \brief Register a listener for received bytes
@@ -95,6 +211,11 @@ public:
    */
   void register_listener(SerialListener * const listener);
 
+  /**
+   * \brief Statistics of the binary packets framed from the received bytes
+   */
+  const IsbFramer& framer() const { return framer_; }
+
   boost::asio::io_service io_service_; //!< boost io service provider
 
 private:
@@ -103,28 +224,6 @@ private:
   // definitions
   //===========================================================================
 
-  /**
-   * \brief Struct for buffering the contents of a mavlink message
-   */
-  struct WriteBuffer
-  {
-    uint8_t data[BUFFER_SIZE];
-    size_t len;
-    size_t pos;
-
-    WriteBuffer() : len(0), pos(0) {}
-
-    WriteBuffer(const uint8_t * buf, uint16_t len) : len(len), pos(0)
-    {
-      assert(len <= BUFFER_SIZE); //! \todo Do something less catastrophic here
-      memcpy(data, buf, len);
-    }
-
-    const uint8_t * dpos() const { return data + pos; }
-
-    size_t nbytes() const { return len - pos; }
-  };
-
   /**
    * \brief Pointer to byte listener
    */
@@ -133,11 +232,12 @@ private:
   boost::asio::serial_port serial_port_; //!< boost serial port object
   std::string port_;
   int baud_rate_;
+  SerialTuning tuning_;
 
   /**
    * \brief Convenience typedef for mutex lock
    */
-  typedef boost::lock_guard<boost::recursive_mutex> mutex_lock;
+  typedef boost::unique_lock<boost::mutex> mutex_lock;
 
   //===========================================================================
   // methods
@@ -156,10 +256,9 @@ private:
   void async_read_end(const boost::system::error_code& error, size_t bytes_transferred);
 
   /**
-   * \brief Initialize an asynchronous write operation
-   * \param check_write_state If true, only start another write operation if a write sequence is not already running
+   * \brief Initiate an asynchronous write of everything queued in the write ring, must be called with mutex_ held
    */
-  void async_write(bool check_write_state);
+  void async_write();
 
   /**
    * \brief Handler for end of asynchronous write operation
@@ -173,15 +272,28 @@ private:
   //===========================================================================
 
   boost::thread io_thread_; //!< thread on which the io service runs
-  boost::recursive_mutex mutex_; //!< mutex for threadsafe operation
+  boost::mutex mutex_; //!< protects the write ring
+  boost::condition_variable write_space_; //!< signalled when bytes leave the write ring
 
   uint8_t sysid_;
   uint8_t compid_;
 
-  uint8_t read_buf_raw_[BUFFER_SIZE];
-
-  std::list<WriteBuffer*> write_queue_; //!< queue of buffers to be written to the serial port
+  /**
+   * \brief Receive buffers.  Reads append to the current buffer, packets are framed in place, and
+   * a trailing partial packet is moved to the front of the other buffer for the next read.
+   */
+  uint8_t read_buf_[2][READ_BUFFER_SIZE] __attribute__((aligned(8)));
+  int read_index_; //!< buffer the next read goes to
+  size_t read_pending_; //!< bytes of an incomplete packet at the front of the current buffer
+  IsbFramer framer_;
+
+  uint8_t write_ring_[WRITE_BUFFER_SIZE]; //!< bytes waiting to be written to the serial port
+  size_t write_head_; //!< index of the oldest unsent byte in write_ring_
+  size_t write_count_; //!< number of unsent bytes in write_ring_
   bool write_in_progress_; //!< flag for whether async_write is already running
+
+  HandlerMemory read_handler_memory_; //!< storage for the outstanding read handler
+  HandlerMemory write_handler_memory_; //!< storage for the outstanding write handler
 };
 
 class SerialException : public std::exception
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <pthread.h>
+#include <string>
+
+/**
+ * @brief SerialTuning
+ * Latency settings applied to an already open serial port and to the thread that reads it.
+ * The defaults leave the port and thread untouched.
+ */
+struct SerialTuning
+{
+    bool low_latency = false; // set ASYNC_LOW_LATENCY, and the USB-serial latency timer if the adapter has one
+    int latency_timer_ms = 1; // FTDI style latency timer applied with low_latency
+    int vmin = -1;            // termios VMIN, bytes a blocking read waits for (-1 leaves it unchanged)
+    int vtime = -1;           // termios VTIME, inter-byte timeout in 1/10 s (-1 leaves it unchanged)
+    int thread_priority = 0;  // SCHED_FIFO priority of the reading thread, which must block on reads (0 leaves the scheduler unchanged)
+    int thread_cpu = -1;      // CPU the reading thread is pinned to (-1 leaves the affinity unchanged)
+
+    /**
+     * @brief apply_to_port
+     * Tune the tty behind port.  Line settings are per tty, so this works on a port opened
+     * elsewhere (e.g. by the SDK) as long as it is still open.
+     * @param error receives a description of the first setting that could not be applied
+     * @return true if every requested setting was applied
+     */
+    bool apply_to_port(const std::string &port, std::string &error) const;
+
+    /**
+     * @brief apply_to_thread
+     * Set the scheduling policy and CPU affinity of thread.  SCHED_FIFO needs CAP_SYS_NICE
+     * or an rtprio limit.
+     * @return true if every requested setting was applied
+     */
+    bool apply_to_thread(pthread_t thread, std::string &error) const;
+};
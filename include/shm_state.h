@@ -0,0 +1,250 @@
+#pragma once
+
+/**
+ * Shared memory output of the inertial_sense node, for processes outside ROS on the same host.
+ * Header only, needs nothing but POSIX (link with -lrt on older glibc).
+ *
+ * The segment holds a header and two rings of the latest INS and IMU states.  Every slot is a
+ * seqlock: the writer makes its sequence odd while it writes and even again when done, a reader
+ * copies the slot and keeps the copy only if the sequence was even and unchanged.  The writer
+ * never waits for readers, and readers never block each other.
+ *
+ *   ShmStateReader reader("/inertial_sense");
+ *   shm_ins_state_t ins;
+ *   if (reader.open() && reader.latest_ins(ins))
+ *       ...
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+
+#define SHM_STATE_MAGIC 0x4D534E49 // "INSM"
+#define SHM_STATE_VERSION 1
+#define SHM_STATE_READ_RETRIES 10000 // of a slot being written, a write takes well under a microsecond
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "shared memory needs lock free atomics");
+
+/**
+ * @brief INS state as published on odom_ins_ned
+ */
+struct shm_ins_state_t
+{
+    double stamp;               // UNIX time of the measurement in seconds
+    double host_time;           // host UNIX time it was written in seconds
+    double position[3];         // NED from ref_lla in meters
+    double orientation[4];      // w, x, y, z rotation from NED to body
+    double linear_velocity[3];  // NED frame, m/s
+    double angular_velocity[3]; // body rate resolved in the NED frame, rad/s
+    double ref_lla[3];          // latitude, longitude (deg) and altitude (m)
+    uint32_t ins_status;        // insStatus of DID_INS_4
+    uint32_t hdw_status;        // hdwStatus of DID_INS_4
+};
+
+/**
+ * @brief IMU state as published on imu
+ */
+struct shm_imu_state_t
+{
+    double stamp;
+    double host_time;
+    double angular_velocity[3];    // rad/s
+    double linear_acceleration[3]; // m/s^2
+};
+
+template <typename State>
+struct alignas(64) shm_slot_t
+{
+    std::atomic<uint32_t> seq;
+    uint32_t reserved;
+    uint64_t index; // of the state in its ring, counting from the first one written
+    State state;
+};
+
+struct alignas(64) shm_header_t
+{
+    uint32_t magic;                // set last, once the segment is ready
+    uint32_t version;
+    uint32_t slots;                // per ring
+    uint32_t writer_pid;
+    std::atomic<uint32_t> closed;  // the writer is gone, reopen to find its successor
+    uint32_t reserved;
+    uint64_t ins_offset;           // bytes from the start of the segment
+    uint64_t imu_offset;
+    uint64_t size;
+    std::atomic<uint64_t> ins_count; // states written
+    std::atomic<uint64_t> imu_count;
+};
+
+/**
+ * @brief Bytes of a segment with the given ring length, and the offsets of its rings
+ */
+inline uint64_t shm_state_size(uint32_t slots, uint64_t *insOffset = nullptr, uint64_t *imuOffset = nullptr)
+{
+    uint64_t ins = sizeof(shm_header_t);
+    uint64_t imu = ins + (uint64_t)slots * sizeof(shm_slot_t<shm_ins_state_t>);
+    if (insOffset)
+        *insOffset = ins;
+    if (imuOffset)
+        *imuOffset = imu;
+    return imu + (uint64_t)slots * sizeof(shm_slot_t<shm_imu_state_t>);
+}
+
+template <typename State>
+inline void shm_write(shm_slot_t<State> *ring, uint32_t slots, std::atomic<uint64_t> &count, const State &state)
+{
+    uint64_t index = count.load(std::memory_order_relaxed);
+    shm_slot_t<State> &slot = ring[index % slots];
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.index = index;
+    memcpy(&slot.state, &state, sizeof(State));
+    slot.seq.store(seq + 2, std::memory_order_release);
+    count.store(index + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Copy the state with the given index, false if its slot has been overwritten since, or
+ * is still being written after SHM_STATE_READ_RETRIES tries (the writer may have died mid-write)
+ */
+template <typename State>
+inline bool shm_read(const shm_slot_t<State> *ring, uint32_t slots, uint64_t index, State &state)
+{
+    const shm_slot_t<State> &slot = ring[index % slots];
+    for (int retry = 0; retry < SHM_STATE_READ_RETRIES; retry++)
+    {
+        uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq & 1)
+            continue;
+        uint64_t slotIndex = slot.index;
+        memcpy(&state, &slot.state, sizeof(State));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == seq)
+            return slotIndex == index;
+    }
+    return false;
+}
+
+/**
+ * @brief ShmStateReader
+ * Reads the states of a segment written by the node.  Either poll latest_*() for the newest
+ * state, or next_*() for every state in order, which counts those overwritten before they were
+ * read in lost().  Reopen when writer_gone() to follow a restarted node.
+ */
+class ShmStateReader
+{
+public:
+    explicit ShmStateReader(const std::string &name = "/inertial_sense") : name_(name) {}
+    ~ShmStateReader() { close(); }
+
+    bool open()
+    {
+        close();
+        int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        void *map = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(shm_header_t))
+            map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return false;
+        map_ = map;
+        map_size_ = st.st_size;
+
+        header_ = (const shm_header_t *)map_;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header_->magic != SHM_STATE_MAGIC || header_->version != SHM_STATE_VERSION || header_->size > map_size_ ||
+            header_->slots == 0)
+        {
+            close();
+            return false;
+        }
+        ins_ = (const shm_slot_t<shm_ins_state_t> *)((const uint8_t *)map_ + header_->ins_offset);
+        imu_ = (const shm_slot_t<shm_imu_state_t> *)((const uint8_t *)map_ + header_->imu_offset);
+        next_ins_ = header_->ins_count.load(std::memory_order_acquire);
+        next_imu_ = header_->imu_count.load(std::memory_order_acquire);
+        return true;
+    }
+
+    void close()
+    {
+        if (map_)
+            munmap(map_, map_size_);
+        map_ = nullptr;
+        header_ = nullptr;
+    }
+
+    bool is_open() const { return header_ != nullptr; }
+
+    bool writer_gone() const
+    {
+        if (!header_)
+            return true;
+        return header_->closed.load(std::memory_order_acquire) || (kill(header_->writer_pid, 0) != 0 && errno == ESRCH);
+    }
+
+    bool latest_ins(shm_ins_state_t &state) const { return header_ && latest(header_->ins_count, ins_, state); }
+    bool latest_imu(shm_imu_state_t &state) const { return header_ && latest(header_->imu_count, imu_, state); }
+    bool next_ins(shm_ins_state_t &state) { return header_ && next(header_->ins_count, ins_, next_ins_, state); }
+    bool next_imu(shm_imu_state_t &state) { return header_ && next(header_->imu_count, imu_, next_imu_, state); }
+
+    uint64_t lost() const { return lost_; }
+    uint32_t slots() const { return header_ ? header_->slots : 0; }
+
+private:
+    template <typename State>
+    bool latest(const std::atomic<uint64_t> &count, const shm_slot_t<State> *ring, State &state) const
+    {
+        for (int retry = 0; retry < SHM_STATE_READ_RETRIES; retry++)
+        {
+            uint64_t written = count.load(std::memory_order_acquire);
+            if (written == 0)
+                return false;
+            // Fails if the writer went around the whole ring while the slot was copied, or died writing it
+            if (shm_read(ring, header_->slots, written - 1, state))
+                return true;
+        }
+        return false;
+    }
+
+    template <typename State>
+    bool next(const std::atomic<uint64_t> &count, const shm_slot_t<State> *ring, uint64_t &next, State &state)
+    {
+        uint64_t written = count.load(std::memory_order_acquire);
+        if (written - next > header_->slots)
+        {
+            lost_ += written - next - header_->slots;
+            next = written - header_->slots;
+        }
+        for (; next < written; next++)
+        {
+            if (shm_read(ring, header_->slots, next, state))
+            {
+                next++;
+                return true;
+            }
+            lost_++;
+        }
+        return false;
+    }
+
+    std::string name_;
+    void *map_ = nullptr;
+    size_t map_size_ = 0;
+    const shm_header_t *header_ = nullptr;
+    const shm_slot_t<shm_ins_state_t> *ins_ = nullptr;
+    const shm_slot_t<shm_imu_state_t> *imu_ = nullptr;
+    uint64_t next_ins_ = 0;
+    uint64_t next_imu_ = 0;
+    uint64_t lost_ = 0;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "shm_state.h"
+
+/**
+ * @brief ShmStateWriter
+ * Writes the node's INS and IMU states to a shared memory segment in /dev/shm, for
+ * ShmStateReader in other processes.  Writing never blocks.
+ */
+class ShmStateWriter
+{
+public:
+    ShmStateWriter() {}
+    ~ShmStateWriter() { close(); }
+    ShmStateWriter(const ShmStateWriter &) = delete;
+    ShmStateWriter &operator=(const ShmStateWriter &) = delete;
+
+    /**
+     * @brief open
+     * Replace any segment of the name, e.g. left behind by a previous run, with a new one.
+     * Readers of the old segment see writer_gone().  On failure errno is set.
+     * @param name POSIX shared memory name, e.g. "/inertial_sense"
+     * @param slots states kept per ring
+     */
+    bool open(const std::string &name, uint32_t slots);
+
+    /**
+     * @brief close
+     * Mark the segment closed for its readers and remove it
+     */
+    void close();
+
+    bool is_open() const { return header_ != nullptr; }
+
+    void write_ins(const shm_ins_state_t &state);
+    void write_imu(const shm_imu_state_t &state);
+
+private:
+    std::string name_;
+    void *map_ = nullptr;
+    size_t size_ = 0;
+    shm_header_t *header_ = nullptr;
+    shm_slot_t<shm_ins_state_t> *ins_ = nullptr;
+    shm_slot_t<shm_imu_state_t> *imu_ = nullptr;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+/**
+ * @brief StreamMonitor
+ * Liveness of the data streams once they are running.  Each watched DID has an expected
+ * period; a stream that stays silent for several periods is reported as stalled so it can be
+ * requested from the device again, once per retry interval until data arrives.  Gaps and
+ * restarts are counted from jumps of the time in the data sets.  Times are passed in by the
+ * caller in seconds so the monitor can run against any clock.
+ */
+class StreamMonitor
+{
+public:
+    struct stream_t
+    {
+        double period = 0.0;         // expected seconds between packets, 0 if not watched
+        double last_received = 0.0;  // host time of the last packet, or of the start of watching
+        double last_request = -1e9;  // host time the stream was last requested again
+        bool has_time = false;
+        double last_time = 0.0;      // device time of the last packet
+        bool stalled = false;
+        uint32_t packets = 0;
+        uint32_t gaps = 0;           // device time jumps longer than 1.5 expected periods
+        uint32_t missed = 0;         // packets estimated lost in gaps
+        uint32_t restarts = 0;       // device time going backwards, the uINS restarted
+        uint32_t stalls = 0;         // times the stream stopped
+        uint32_t reenables = 0;      // requests sent to restart it
+    };
+    typedef std::map<uint32_t, stream_t> stream_map_t;
+
+    /**
+     * @param stallPeriods expected periods without data after which a stream is stalled
+     * @param minTimeout lower limit of the stall timeout in seconds, for fast streams
+     * @param retryInterval seconds between requests of a stream that stays stalled
+     */
+    explicit StreamMonitor(double stallPeriods = 10.0, double minTimeout = 1.0, double retryInterval = 2.0);
+
+    /**
+     * @brief watch
+     * Set the expected period of a stream.  Starting to watch or changing the period restarts
+     * the stall timeout and gap detection of the stream.
+     * @param period seconds, 0 to stop watching
+     */
+    void watch(uint32_t did, double period, double now);
+
+    /**
+     * @brief received
+     * Call for every packet of a stream
+     * @param hasTime deviceTime holds the time of the data set, see DispatchStats::device_time()
+     */
+    void received(uint32_t did, double now, bool hasTime, double deviceTime);
+
+    /**
+     * @brief check
+     * Call periodically
+     * @return stalled DIDs that are due to be requested again
+     */
+    std::vector<uint32_t> check(double now);
+
+    double timeout(const stream_t &stream) const;
+    int stalled_count() const;
+    const stream_map_t &streams() const { return streams_; }
+
+private:
+    double stall_periods_;
+    double min_timeout_;
+    double retry_interval_;
+    stream_map_t streams_;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+#include <ros/ros.h>
+
+/**
+ * @brief stream_transport_hints
+ * Transport hints for subscribing to a stream of the inertial_sense node.  Only subscribers can
+ * disable Nagle's algorithm on a TCPROS connection or ask for UDPROS, so the node sets its
+ * ~<stream>_tcp_nodelay and ~<stream>_udp parameters for them to pick up here.  With udp, TCPROS
+ * remains the fallback for publishers that do not offer UDPROS.
+ *
+ *   ros::Subscriber sub = nh.subscribe("odom_ins_ned", 10, &callback,
+ *                                      stream_transport_hints("/inertial_sense", "odom_ins_ned"));
+ *
+ * @param node namespace of the node
+ * @param stream name of the stream in its parameters, e.g. "ins1" for DID_INS_1
+ */
+inline ros::TransportHints stream_transport_hints(const std::string &node, const std::string &stream)
+{
+    bool noDelay = false, udp = false;
+    ros::param::get(node + "/" + stream + "_tcp_nodelay", noDelay);
+    ros::param::get(node + "/" + stream + "_udp", udp);
+    ros::TransportHints hints;
+    if (udp)
+        hints.udp();
+    return hints.tcp().tcpNoDelay(noDelay);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+/**
+ * UDP telemetry of the inertial_sense node: datagrams of a udp_telemetry_header_t followed by
+ * count fixed size udp_ins_record_t, little endian and without padding.  The record layout
+ * needs nothing but this header to decode, e.g. on a ground station.
+ */
+
+#define UDP_TELEMETRY_MAGIC 0x54555349 // "ISUT"
+#define UDP_TELEMETRY_VERSION 1
+#define UDP_TELEMETRY_MAX_BATCH 16
+
+#pragma pack(push, 1)
+
+struct udp_telemetry_header_t
+{
+    uint32_t magic;
+    uint8_t version;
+    uint8_t count;        // records in the datagram
+    uint16_t record_size; // sizeof(udp_ins_record_t)
+    uint32_t sequence;    // datagram, counting from 0 when the node started sending
+    double send_time;     // host UNIX time the datagram was sent in seconds
+};
+
+struct udp_ins_record_t
+{
+    uint32_t sequence;  // record, counting from 0, gaps are records lost
+    double time;        // UNIX time of the state in seconds
+    double lla[3];      // latitude, longitude (deg) and ellipsoid altitude (m)
+    float qn2b[4];      // w, x, y, z rotation from NED to body
+    float vel_ned[3];   // m/s
+    uint32_t ins_status; // insStatus of DID_INS_4
+    uint32_t hdw_status; // hdwStatus of DID_INS_4
+    uint8_t fix_type;   // GPS1 fix type, (status & GPS_STATUS_FIX_MASK) >> GPS_STATUS_FIX_BIT_OFFSET
+    uint8_t reserved[3];
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(udp_telemetry_header_t) == 20, "udp_telemetry_header_t layout");
+static_assert(sizeof(udp_ins_record_t) == 76, "udp_ins_record_t layout");
+
+/**
+ * @brief Number of records in a datagram, or -1 if it is not valid telemetry
+ */
+inline int udp_telemetry_parse(const uint8_t *data, size_t size, udp_telemetry_header_t &header)
+{
+    if (size < sizeof(header))
+        return -1;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != UDP_TELEMETRY_MAGIC || header.version != UDP_TELEMETRY_VERSION ||
+        header.record_size != sizeof(udp_ins_record_t) || size != sizeof(header) + header.count * sizeof(udp_ins_record_t))
+        return -1;
+    return header.count;
+}
+
+inline void udp_telemetry_record(const uint8_t *data, int index, udp_ins_record_t &record)
+{
+    memcpy(&record, data + sizeof(udp_telemetry_header_t) + index * sizeof(udp_ins_record_t), sizeof(record));
+}
+
+/**
+ * @brief UdpTelemetry
+ * Sends INS records to a UDP multicast group (or a unicast address), at most at the configured
+ * rate and optionally several records to a datagram.  Sending never blocks, a datagram the
+ * socket cannot take is dropped and counted.
+ */
+class UdpTelemetry
+{
+public:
+    UdpTelemetry() {}
+    ~UdpTelemetry() { close(); }
+    UdpTelemetry(const UdpTelemetry &) = delete;
+    UdpTelemetry &operator=(const UdpTelemetry &) = delete;
+
+    /**
+     * @param address multicast group or unicast address
+     * @param ttl multicast hops, 1 stays on the local network
+     * @param interface address of the interface to send multicast from, empty for the default route
+     * @param error why it failed
+     */
+    bool open(const std::string &address, int port, int ttl, const std::string &interface, std::string &error);
+    void close();
+    bool is_open() const { return socket_ >= 0; }
+
+    /**
+     * @param rate records per second, 0 sends every record added
+     * @param batch records per datagram, a partial batch is sent once its first record is
+     * batch periods old (0.1 s without a rate)
+     */
+    void configure(double rate, int batch);
+
+    /**
+     * @brief add
+     * Queue a record, sending the batch once full.  Records closer than the rate allows to the
+     * last one taken are skipped.  The record's sequence is set here.
+     * @param now host UNIX time in seconds
+     * @return whether the record was taken
+     */
+    bool add(udp_ins_record_t &record, double now);
+
+    /**
+     * @brief Send a partial batch that has waited long enough, call periodically
+     */
+    void poll(double now);
+
+    uint32_t records_sent() const { return records_sent_; }
+    uint32_t datagrams_sent() const { return datagrams_sent_; }
+    uint32_t send_errors() const { return send_errors_; }
+
+private:
+    void send(double now);
+
+    int socket_ = -1;
+    sockaddr_in address_;
+    double period_ = 0.0;
+    int batch_ = 1;
+    double next_due_ = 0.0;
+    uint32_t record_sequence_ = 0;
+    uint32_t datagram_sequence_ = 0;
+    uint8_t datagram_[sizeof(udp_telemetry_header_t) + UDP_TELEMETRY_MAX_BATCH * sizeof(udp_ins_record_t)];
+    int pending_ = 0;
+    double first_pending_ = 0.0;
+    uint32_t records_sent_ = 0;
+    uint32_t datagrams_sent_ = 0;
+    uint32_t send_errors_ = 0;
+};
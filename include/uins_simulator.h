@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ISComm.h"
+#include "data_sets.h"
+#include "isb_framer.h"
+
+/**
+ * @brief SimMotion
+ * A vehicle driving a level circle at constant speed while slowly climbing and descending.
+ * Position, velocity, attitude and the inertial measurements are derived from the same
+ * trajectory, so the simulated data sets agree with each other.
+ */
+struct SimMotion
+{
+    double ref_lla[3] = {40.25, -111.67, 1400.0}; // deg, deg, m: center of the circle's start
+    double radius = 50.0;                         // m
+    double speed = 5.0;                           // m/s
+    double climb = 2.0;                           // m, amplitude of the altitude oscillation
+    double climb_period = 60.0;                   // s
+
+    struct state_t
+    {
+        double ned[3];      // m from ref_lla
+        double vel_ned[3];  // m/s
+        double euler[3];    // rad roll, pitch, yaw
+        double pqr[3];      // rad/s body rates
+        double accel[3];    // m/s^2 body specific force
+        double uvw[3];      // m/s body velocity
+        double lla[3];      // deg, deg, m
+        double ecef[3];     // m
+        double vel_ecef[3]; // m/s
+        float qn2b[4];      // w, x, y, z
+        float qe2b[4];      // w, x, y, z
+    };
+
+    state_t at(double t) const;
+};
+
+/**
+ * @brief UinsSimulator
+ * Enough of a uINS behind a pseudo-terminal for the unmodified node to connect and stream:
+ * device info and flash configuration requests, flash writes, broadcast requests at any period
+ * multiple, stop broadcast commands, save persistent messages and reset.  INS, IMU,
+ * magnetometer, barometer and GPS data sets follow SimMotion.  Data sets whose data source is
+ * the navigation filter are produced every startupNavDtMs, GPS data sets every startupGPSDtMs.
+ *
+ * Output can be limited to the bytes per second of a serial baud rate.  Packets that do not
+ * fit into the device's transmit buffer are dropped and counted, as on a real uINS.
+ */
+class UinsSimulator
+{
+public:
+    struct options_t
+    {
+        int nav_period_ms = 4;          // initial startupNavDtMs
+        int gps_period_ms = 200;        // startupGPSDtMs
+        int baudrate = 0;               // throttle output to baudrate / 10 bytes/s, 0 for no limit
+        int num_sats = 12;
+        uint32_t serial_number = 90000;
+        uint8_t firmware_ver[4] = {FIRMWARE_VERSION_CHAR0, FIRMWARE_VERSION_CHAR1, FIRMWARE_VERSION_CHAR2, FIRMWARE_VERSION_CHAR3};
+        double reboot_time = 0.5;       // s the device stays silent after a reset
+        size_t tx_buffer = 4096;        // bytes the device can queue for transmission
+    };
+
+    struct stats_t
+    {
+        uint64_t packets_sent = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t packets_dropped = 0; // did not fit into the transmit buffer
+        uint64_t requests = 0;        // packets received from the host
+        uint64_t late_ticks = 0;      // navigation periods produced late because the simulator fell behind
+        std::map<uint32_t, uint64_t> sent; // packets produced per DID, including dropped ones
+    };
+
+    typedef std::function<double()> clock_fn_t;
+
+    explicit UinsSimulator(const options_t &options);
+    ~UinsSimulator();
+
+    /**
+     * @brief Replace the monotonic clock the device runs on, e.g. in tests.  The device boots at
+     * the clock's current time.
+     */
+    void set_clock(clock_fn_t now);
+
+    /**
+     * @brief Open the pseudo-terminal, optionally with a symlink to its slave, e.g. /tmp/ttyUINS
+     */
+    bool open(const std::string &link, std::string &error);
+
+    /**
+     * @brief Device path the node should open
+     */
+    const std::string &port() const { return link_.empty() ? slave_name_ : link_; }
+
+    /**
+     * @brief Serve requests and produce data until stop becomes true
+     */
+    void run(const volatile bool &stop);
+
+    /**
+     * @brief Serve requests and produce the data that is due, waiting at most timeout seconds
+     */
+    void step(double timeout);
+
+    const stats_t &stats() const { return stats_; }
+    double nav_period() const { return nav_period_; }
+
+private:
+    void handle_packet(const IsbPacket &packet);
+    void handle_set_data(const p_data_hdr_t *hdr, const uint8_t *data);
+    void reset();
+    void produce(double t, bool gpsEpoch);
+    bool fill(uint32_t DID, double t, std::vector<uint8_t> &out);
+    void send_data(uint32_t DID, const void *data, uint32_t size);
+    void send(uint8_t pid, const void *body, size_t size);
+    void flush();
+    void receive();
+
+    double now() const;
+    double sim_time() const { return sim_base_ + nav_tick_ * nav_period_; }
+    double tow(double t) const { return tow_start_ + t; }
+
+    options_t options_;
+    clock_fn_t clock_;
+    SimMotion motion_;
+    int master_fd_;
+    std::string slave_name_;
+    std::string link_;
+
+    IsbFramer framer_;
+    std::vector<uint64_t> rx_; // 8 byte aligned receive buffer
+    size_t rx_len_;
+    std::vector<uint8_t> tx_;  // device transmit buffer, drained into the pty at the baud rate
+    std::vector<uint8_t> body_;
+    std::vector<uint8_t> packet_;
+    uint8_t counter_;
+    double tx_budget_;         // bytes the baud rate allows to write now
+    double tx_budget_time_;
+
+    dev_info_t dev_info_;
+    nvm_flash_cfg_t flash_;
+    std::map<uint32_t, int> broadcasts_; // DID -> period multiple
+    std::map<uint32_t, int> persistent_; // broadcasts restored after a reset
+
+    double nav_period_;     // s, startupNavDtMs as of the last boot
+    double gps_period_;     // s, startupGPSDtMs as of the last boot
+    double start_;          // clock time of navigation tick 0
+    double silent_until_;   // clock time a reset completes, 0 when running
+    double sim_base_;       // simulated seconds at navigation tick 0
+    double boot_at_;        // simulated seconds of the last boot
+    uint64_t nav_tick_;
+    int64_t gps_tick_;      // last GPS epoch produced
+    uint32_t gps_week_;
+    double tow_start_;      // GPS time of week at simulated second 0
+
+    stats_t stats_;
+};
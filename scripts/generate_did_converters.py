@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""Generate ROS messages and C++ converters for the data sets listed in did_schema.yaml.
+
+    generate_did_converters.py --schema did_schema.yaml --msg-dir msg --header did_converters.h
+
+Files are only rewritten when their contents change so that catkin does not rebuild the
+message packages on every build. With --check nothing is written and the exit status
+is non-zero if any output is out of date.
+"""
+
+import argparse
+import os
+import sys
+
+import yaml
+
+GENERATED_NOTICE = "Generated by scripts/generate_did_converters.py from scripts/did_schema.yaml, do not edit"
+
+BUILTIN_TYPES = {
+    "bool", "int8", "uint8", "int16", "uint16", "int32", "uint32", "int64", "uint64",
+    "float32", "float64", "string",
+}
+VECTOR3_AXES = ("x", "y", "z")
+QUATERNION_AXES = ("w", "x", "y", "z")
+
+
+MESSAGE_KEYS = {"struct", "header", "header_comment", "fields"}
+FIELD_KEYS = {"name", "type", "count", "from", "comment"}
+
+
+class SchemaError(Exception):
+    pass
+
+
+def load_schema(path):
+    with open(path) as f:
+        schema = yaml.safe_load(f)
+    messages = schema.get("messages") or {}
+    for name, message in messages.items():
+        if "struct" not in message:
+            raise SchemaError("%s: missing struct" % name)
+        # A stray key is usually a value YAML split, e.g. an unquoted comma in a flow mapping
+        unknown = set(message) - MESSAGE_KEYS
+        if unknown:
+            raise SchemaError("%s: unknown keys %s" % (name, ", ".join(sorted(map(str, unknown)))))
+        for field in message.get("fields", []):
+            unknown = set(field) - FIELD_KEYS
+            if unknown:
+                raise SchemaError("%s.%s: unknown keys %s" % (name, field.get("name"), ", ".join(sorted(map(str, unknown)))))
+            if "name" not in field:
+                raise SchemaError("%s: field without a name" % name)
+            kind = field.get("type")
+            if kind not in BUILTIN_TYPES and kind not in ("GTime", "geometry_msgs/Vector3", "geometry_msgs/Quaternion"):
+                raise SchemaError("%s.%s: unsupported type %s" % (name, field.get("name"), kind))
+            if "count" in field and kind not in BUILTIN_TYPES:
+                raise SchemaError("%s.%s: only builtin types can be arrays" % (name, field["name"]))
+    return messages
+
+
+def msg_type(field):
+    if "count" in field:
+        return "%s[%d]" % (field["type"], field["count"])
+    return field["type"]
+
+
+def render_msg(message):
+    rows = []
+    if message.get("header", False):
+        rows.append(("Header", "header", message.get("header_comment")))
+    for field in message["fields"]:
+        rows.append((msg_type(field), field["name"], field.get("comment")))
+
+    width = max(len("%s %s" % (kind, name)) for kind, name, _ in rows) + 1
+    lines = ["# " + GENERATED_NOTICE]
+    for kind, name, comment in rows:
+        declaration = "%s %s" % (kind, name)
+        lines.append("%s# %s" % (declaration.ljust(width), comment) if comment else declaration)
+    return "\n".join(lines) + "\n"
+
+
+def render_field(field):
+    name = field["name"]
+    source = "in." + field.get("from", name)
+    kind = field["type"]
+    if "count" in field:
+        return ["    copy_array(out.%s, %s);" % (name, source)]
+    if kind == "GTime":
+        return ["    out.%s.time = %s.time;" % (name, source),
+                "    out.%s.sec = %s.sec;" % (name, source)]
+    if kind == "geometry_msgs/Vector3":
+        return ["    out.%s.%s = %s[%d];" % (name, axis, source, i) for i, axis in enumerate(VECTOR3_AXES)]
+    if kind == "geometry_msgs/Quaternion":
+        return ["    out.%s.%s = %s[%d];" % (name, axis, source, i) for i, axis in enumerate(QUATERNION_AXES)]
+    return ["    out.%s = %s;" % (name, source)]
+
+
+def render_header(messages):
+    lines = [
+        "// " + GENERATED_NOTICE,
+        "#pragma once",
+        "",
+        "#include <string.h>",
+        "#include <type_traits>",
+        "#include \"data_sets.h\"",
+    ]
+    lines += ["#include \"inertial_sense_ros/%s.h\"" % name for name in messages]
+    lines += [
+        "",
+        "namespace did_converters",
+        "{",
+        "",
+        "template <typename Array, typename T, size_t N>",
+        "inline void copy_array(Array &out, const T (&in)[N], std::true_type)",
+        "{",
+        "    memcpy(out.data(), in, sizeof(in));",
+        "}",
+        "",
+        "template <typename Array, typename T, size_t N>",
+        "inline void copy_array(Array &out, const T (&in)[N], std::false_type)",
+        "{",
+        "    for (size_t i = 0; i < N; i++)",
+        "        out[i] = in[i];",
+        "}",
+        "",
+        "/**",
+        " * @brief Copies a fixed C array into a fixed message array, with memcpy when the element types match",
+        " */",
+        "template <typename Array, typename T, size_t N>",
+        "inline void copy_array(Array &out, const T (&in)[N])",
+        "{",
+        "    static_assert(sizeof(Array) / sizeof(typename Array::value_type) == N, \"message and data set array lengths differ\");",
+        "    copy_array(out, in, std::is_same<typename Array::value_type, T>());",
+        "}",
+        "",
+    ]
+    for name, message in messages.items():
+        lines.append("/**")
+        lines.append(" * @brief Copies every %s field into %s. The header is left to the caller." % (message["struct"], name))
+        lines.append(" */")
+        lines.append("inline void convert(const %s &in, inertial_sense_ros::%s &out)" % (message["struct"], name))
+        lines.append("{")
+        for field in message["fields"]:
+            lines += render_field(field)
+        lines.append("}")
+        lines.append("")
+    lines.append("} // namespace did_converters")
+    return "\n".join(lines) + "\n"
+
+
+def update_file(path, contents, check):
+    try:
+        with open(path) as f:
+            if f.read() == contents:
+                return True
+    except IOError:
+        pass
+    if check:
+        print("%s is out of date" % path, file=sys.stderr)
+        return False
+    directory = os.path.dirname(path)
+    if directory and not os.path.isdir(directory):
+        os.makedirs(directory)
+    with open(path, "w") as f:
+        f.write(contents)
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--schema", required=True)
+    parser.add_argument("--msg-dir", help="write <message>.msg files here")
+    parser.add_argument("--header", help="write the converter header here")
+    parser.add_argument("--check", action="store_true", help="only report outputs that are out of date")
+    args = parser.parse_args()
+
+    try:
+        messages = load_schema(args.schema)
+    except (IOError, SchemaError, yaml.YAMLError) as e:
+        print("%s: %s" % (args.schema, e), file=sys.stderr)
+        return 2
+
+    up_to_date = True
+    if args.msg_dir:
+        for name, message in messages.items():
+            up_to_date &= update_file(os.path.join(args.msg_dir, name + ".msg"), render_msg(message), args.check)
+    if args.header:
+        up_to_date &= update_file(args.header, render_header(messages), args.check)
+    return 0 if up_to_date else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""Soak test of inertial_sense_node against the uins_simulator.
+
+For each navigation period, starts a simulated uINS on a pseudo-terminal and the unmodified
+node connected to it, streams INS and IMU data for a while and compares what the node
+published with what the device sent.  Prints one row per rate:
+
+  nav_ms   period the simulated uINS ran at
+  sent     data packets the simulator sent for the measured topics
+  recv     messages received on the measured topics
+  drop%    packets that did not make it to a topic, including those the simulated
+           transmit buffer dropped at the baud rate
+  p50/p99  latency in ms from the message stamp (device GPS time, which the simulator derives
+           from the host clock) to its arrival at this script
+  cpu%     CPU time of the node process over the measurement
+
+--ins-output selects how the INS state is published and subscribed to: DID_INS_4 alone, the
+three odometry topics and DID_INS_4, or the compact ins_state.  Comparing the cpu% of the last
+two at the same rate gives the publish cost of each, including serialization to a subscriber.
+
+Requires a ROS master and the package built with -DBUILD_BENCHMARKS=ON.
+
+usage: soak_test.py [--rates 16,8,4,2,1] [--seconds 30] [--baud 921600] [--warmup 5]
+                    [--ins-output DID_INS_4|odometry|ins_state]
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import threading
+import time
+
+import rospy
+from nav_msgs.msg import Odometry
+from sensor_msgs.msg import Imu
+from inertial_sense_ros.msg import DID_INS1, DID_INS4, INSState
+
+LINK = '/tmp/ttyUINS_soak'
+# Topics measured besides those of --ins-output, with the data set each is published from
+TOPICS = [
+    ('DID_INS_1', DID_INS1, 'DID_INS_1'),
+    ('imu', Imu, 'DID_PIMU'),
+]
+INS_OUTPUTS = {
+    'DID_INS_4': [('DID_INS_4', DID_INS4, 'DID_INS_4')],
+    'odometry': [('DID_INS_4', DID_INS4, 'DID_INS_4'),
+                 ('odom_ins_ned', Odometry, 'DID_INS_4'),
+                 ('odom_ins_enu', Odometry, 'DID_INS_4'),
+                 ('odom_ins_ecef', Odometry, 'DID_INS_4')],
+    'ins_state': [('ins_state', INSState, 'DID_INS_4')],
+}
+
+
+class TopicStats(object):
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.counting = False
+        self.count = 0
+        self.latency = []
+
+    def callback(self, msg):
+        now = rospy.get_rostime()
+        with self.lock:
+            if self.counting:
+                self.count += 1
+                self.latency.append((now - msg.header.stamp).to_sec() * 1000.0)
+
+
+def cpu_seconds(pid):
+    with open('/proc/%d/stat' % pid) as f:
+        fields = f.read().rsplit(')', 1)[1].split()
+    # utime and stime are fields 14 and 15 of the whole line
+    return (int(fields[11]) + int(fields[12])) / float(os.sysconf('SC_CLK_TCK'))
+
+
+def percentile(values, p):
+    if not values:
+        return float('nan')
+    values = sorted(values)
+    return values[min(len(values) - 1, int(p / 100.0 * len(values)))]
+
+
+def last_stats(lines):
+    for line in reversed(lines):
+        try:
+            return json.loads(line)
+        except ValueError:
+            continue
+    return None
+
+
+def run_rate(nav_ms, args):
+    sim = subprocess.Popen(['rosrun', 'inertial_sense_ros', 'uins_simulator', '--link', LINK,
+                            '--nav-ms', str(nav_ms), '--baud', str(args.baud)],
+                           stdout=subprocess.PIPE, universal_newlines=True)
+    sim_lines = []
+    reader = threading.Thread(target=lambda: sim_lines.extend(sim.stdout))
+    reader.start()
+    time.sleep(0.5)
+
+    topics = TOPICS + INS_OUTPUTS[args.ins_output]
+    enabled = set(topic for topic, _, _ in topics)
+    node = subprocess.Popen(['rosrun', 'inertial_sense_ros', 'inertial_sense_node',
+                             '_port:=' + LINK, '_baudrate:=%d' % args.baud,
+                             '_navigation_dt_ms:=%d' % nav_ms, '_enable_device_cache:=false',
+                             '_stream_DID_INS_1:=true', '_stream_IMU:=true', '_publishTf:=false'] +
+                            ['_stream_%s:=%s' % (topic, 'true' if topic in enabled else 'false')
+                             for topic in ('DID_INS_4', 'odom_ins_ned', 'odom_ins_enu', 'odom_ins_ecef', 'ins_state')])
+    stats = {}
+    subscribers = []
+    for topic, msg_type, did in topics:
+        stats[topic] = TopicStats()
+        subscribers.append(rospy.Subscriber('/' + topic, msg_type, stats[topic].callback, queue_size=1000,
+                                            tcp_nodelay=True))
+    try:
+        time.sleep(args.warmup)
+        sent_before = last_stats(sim_lines)
+        cpu_before = cpu_seconds(node.pid)
+        for s in stats.values():
+            with s.lock:
+                s.counting = True
+        start = time.time()
+
+        time.sleep(args.seconds)
+
+        for s in stats.values():
+            with s.lock:
+                s.counting = False
+        elapsed = time.time() - start
+        cpu = cpu_seconds(node.pid) - cpu_before
+        sent_after = last_stats(sim_lines)
+    finally:
+        for sub in subscribers:
+            sub.unregister()
+        node.terminate()
+        node.wait()
+        sim.terminate()
+        sim.wait()
+        reader.join()
+
+    if sent_before is None or sent_after is None:
+        print('%6d  simulator did not report statistics' % nav_ms)
+        return
+    # Simulator statistics are reported once a second, scale them to the measured interval
+    sent = 0.0
+    for _, _, did in topics:
+        delta = sent_after['sent'].get(did, 0) - sent_before['sent'].get(did, 0)
+        sent += delta * elapsed / max(1e-3, sent_after['elapsed'] - sent_before['elapsed'])
+    received = sum(s.count for s in stats.values())
+    latency = [l for s in stats.values() for l in s.latency]
+    drop = 100.0 * max(0.0, sent - received) / sent if sent > 0 else float('nan')
+    print('%6d %10d %10d %7.2f %8.2f %8.2f %6.1f' % (nav_ms, sent, received, drop, percentile(latency, 50),
+                                                      percentile(latency, 99), 100.0 * cpu / elapsed))
+    sys.stdout.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--rates', default='16,8,4,2,1', help='navigation periods in ms, slowest first')
+    parser.add_argument('--seconds', type=float, default=30.0, help='measurement time per rate')
+    parser.add_argument('--warmup', type=float, default=5.0, help='time for the node to connect and configure')
+    parser.add_argument('--baud', type=int, default=921600)
+    parser.add_argument('--ins-output', choices=sorted(INS_OUTPUTS), default='DID_INS_4',
+                        help='topics the INS state is published on')
+    args = parser.parse_args()
+
+    rospy.init_node('inertial_sense_soak_test', anonymous=True, disable_signals=True)
+    print('%6s %10s %10s %7s %8s %8s %6s' % ('nav_ms', 'sent', 'recv', 'drop%', 'p50', 'p99', 'cpu%'))
+    for nav_ms in [int(r) for r in args.rates.split(',')]:
+        run_rate(nav_ms, args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Startup time of inertial_sense_node on the cold and the warm path, against the uins_simulator.
+
+Each run starts a fresh simulated uINS on a pseudo-terminal and an empty device cache directory.
+The node is started once against it (cold: no cache, the streams are stopped, negotiated and
+saved) and then restarted against the same, still broadcasting device (warm: the cache matches
+the device).  Prints one row per start:
+
+  run      run number
+  path     cold or warm, as the node reported it
+  startup  ms the node's constructor took, as logged by the node
+  first    ms from starting the node process to the first DID_INS_4 message received here,
+           including process start and ROS registration
+
+and the median of both columns per path.
+
+Requires a ROS master and the package built with -DBUILD_BENCHMARKS=ON.
+
+usage: startup_benchmark.py [--runs 5] [--nav-ms 4] [--baud 921600] [--timeout 30]
+"""
+
+import argparse
+import re
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+import rospy
+from inertial_sense_ros.msg import DID_INS4
+
+LINK = '/tmp/ttyUINS_startup'
+STARTUP_LOG = re.compile(r'InertialSense: (cold|warm) startup took ([0-9.]+) ms')
+
+
+class FirstMessage(object):
+    def __init__(self):
+        self.event = threading.Event()
+        self.time = None
+
+    def callback(self, msg):
+        if not self.event.is_set():
+            self.time = time.time()
+            self.event.set()
+
+
+def start_node(cache_dir, args):
+    return subprocess.Popen(['rosrun', 'inertial_sense_ros', 'inertial_sense_node',
+                             '_port:=' + LINK, '_baudrate:=%d' % args.baud,
+                             '_navigation_dt_ms:=%d' % args.nav_ms,
+                             '_enable_device_cache:=true', '_device_cache_dir:=' + cache_dir,
+                             '_stream_DID_INS_4:=true', '_stream_IMU:=true',
+                             '_stream_odom_ins_ned:=false', '_publishTf:=false'],
+                            stdout=subprocess.PIPE, universal_newlines=True)
+
+
+def measure_start(cache_dir, args):
+    """Start the node, wait for its first DID_INS_4 message, stop it.  Returns (path, startup ms, first ms)."""
+    first = FirstMessage()
+    subscriber = rospy.Subscriber('/DID_INS_4', DID_INS4, first.callback, queue_size=1, tcp_nodelay=True)
+    result = {}
+
+    def read_log(stream):
+        for line in stream:
+            match = STARTUP_LOG.search(line)
+            if match:
+                result['path'] = match.group(1)
+                result['startup'] = float(match.group(2))
+
+    start = time.time()
+    node = start_node(cache_dir, args)
+    reader = threading.Thread(target=read_log, args=(node.stdout,))
+    reader.start()
+    try:
+        first.event.wait(args.timeout)
+    finally:
+        subscriber.unregister()
+        # SIGINT lets the node save the device cache on exit
+        node.send_signal(signal.SIGINT)
+        node.wait()
+        reader.join()
+    if not first.event.is_set():
+        return result.get('path', '?'), result.get('startup', float('nan')), float('nan')
+    return result.get('path', '?'), result.get('startup', float('nan')), (first.time - start) * 1000.0
+
+
+def median(values):
+    values = sorted(v for v in values if v == v)
+    if not values:
+        return float('nan')
+    return values[len(values) // 2]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--runs', type=int, default=5, help='cold and warm starts to measure')
+    parser.add_argument('--nav-ms', type=int, default=4, help='navigation period of the simulated uINS')
+    parser.add_argument('--baud', type=int, default=921600)
+    parser.add_argument('--timeout', type=float, default=30.0, help='seconds to wait for the first message')
+    args = parser.parse_args()
+
+    rospy.init_node('inertial_sense_startup_benchmark', anonymous=True, disable_signals=True)
+    print('%4s %5s %9s %9s' % ('run', 'path', 'startup', 'first'))
+    rows = []
+    for run in range(args.runs):
+        cache_dir = tempfile.mkdtemp(prefix='inertial_sense_cache_')
+        sim = subprocess.Popen(['rosrun', 'inertial_sense_ros', 'uins_simulator', '--link', LINK,
+                                '--nav-ms', str(args.nav_ms), '--baud', str(args.baud)],
+                               stdout=subprocess.DEVNULL)
+        try:
+            time.sleep(0.5)
+            for _ in ('cold', 'warm'):
+                path, startup, first = measure_start(cache_dir, args)
+                rows.append((path, startup, first))
+                print('%4d %5s %9.1f %9.1f' % (run, path, startup, first))
+                sys.stdout.flush()
+        finally:
+            sim.terminate()
+            sim.wait()
+            shutil.rmtree(cache_dir, ignore_errors=True)
+
+    print('median')
+    for path in ('cold', 'warm'):
+        print('%4s %5s %9.1f %9.1f' % ('', path, median(r[1] for r in rows if r[0] == path),
+                                       median(r[2] for r in rows if r[0] == path)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Receiver for the UDP telemetry of inertial_sense_node (~udp_telemetry).
+
+Joins the multicast group, decodes the INS records (include/udp_telemetry.h) and prints once a
+second:
+
+  rate     records received per second
+  lost     records missing from the sequence since the start
+  p50/max  latency in ms from sending to arrival, only meaningful with the clocks of the two
+           hosts synchronized (e.g. chrony)
+  lla, fix of the latest record
+
+usage: udp_telemetry_receiver.py [--group 239.255.73.1] [--port 7373] [--interface 0.0.0.0]
+"""
+
+import argparse
+import socket
+import struct
+import time
+
+HEADER = struct.Struct('<IBBHId')
+RECORD = struct.Struct('<Id3d4f3fIIB3x')
+MAGIC = 0x54555349
+VERSION = 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--group', default='239.255.73.1')
+    parser.add_argument('--port', type=int, default=7373)
+    parser.add_argument('--interface', default='0.0.0.0', help='address of the interface to join the group on')
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(('', args.port))
+    membership = socket.inet_aton(args.group) + socket.inet_aton(args.interface)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+    sock.settimeout(1.0)
+
+    last_sequence = None
+    lost = 0
+    received = 0
+    latency = []
+    latest = None
+    report = time.time() + 1.0
+    while True:
+        try:
+            data = sock.recv(2048)
+        except socket.timeout:
+            data = None
+        now = time.time()
+        if data and len(data) >= HEADER.size:
+            magic, version, count, record_size, _, send_time = HEADER.unpack_from(data)
+            if magic == MAGIC and version == VERSION and record_size == RECORD.size and \
+                    len(data) == HEADER.size + count * RECORD.size:
+                latency.append(1000.0 * (now - send_time))
+                for i in range(count):
+                    latest = RECORD.unpack_from(data, HEADER.size + i * RECORD.size)
+                    if last_sequence is not None and latest[0] > last_sequence + 1:
+                        lost += latest[0] - last_sequence - 1
+                    last_sequence = latest[0]
+                    received += 1
+        if now >= report:
+            latency.sort()
+            if latest:
+                print('rate %5d  lost %6d  latency p50 %7.2f max %7.2f ms  lla %.7f %.7f %.2f  fix %d' % (
+                    received, lost, latency[len(latency) // 2] if latency else 0.0, latency[-1] if latency else 0.0,
+                    latest[2], latest[3], latest[4], latest[14]))
+            else:
+                print('nothing received')
+            received = 0
+            latency = []
+            report = now + 1.0
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,176 @@
+#include "device_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+#include <yaml-cpp/yaml.h>
+
+static std::string to_hex(const uint8_t *data, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(2 * size, '0');
+    for (size_t i = 0; i < size; i++)
+    {
+        hex[2 * i] = digits[data[i] >> 4];
+        hex[2 * i + 1] = digits[data[i] & 0x0F];
+    }
+    return hex;
+}
+
+static bool from_hex(const std::string &hex, uint8_t *data, size_t size)
+{
+    if (hex.size() != 2 * size)
+        return false;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        unsigned int byte;
+        if (sscanf(hex.c_str() + 2 * i, "%2x", &byte) != 1)
+            return false;
+        data[i] = (uint8_t)byte;
+    }
+    return true;
+}
+
+static bool make_directories(const std::string &path)
+{
+    for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1))
+    {
+        std::string dir = path.substr(0, pos);
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+        if (pos == std::string::npos)
+            return true;
+    }
+}
+
+static std::string port_filename(const std::string &directory, const std::string &port)
+{
+    std::string name = port;
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        if (name[i] == '/')
+            name[i] = '_';
+    }
+    return directory + "/port" + name + ".yaml";
+}
+
+DeviceCache::DeviceCache(const std::string &directory) : directory_(directory)
+{
+    memset(&flash_cfg, 0, sizeof(flash_cfg));
+}
+
+std::string DeviceCache::filename() const
+{
+    return directory_ + "/uINS_" + std::to_string(serial_number_) + ".yaml";
+}
+
+bool DeviceCache::load(uint32_t serialNumber, const uint8_t firmwareVer[4])
+{
+    serial_number_ = serialNumber;
+    firmware_ = std::to_string(firmwareVer[0]) + "." + std::to_string(firmwareVer[1]) + "." +
+                std::to_string(firmwareVer[2]) + "." + std::to_string(firmwareVer[3]);
+    valid_ = false;
+
+    try
+    {
+        YAML::Node node = YAML::LoadFile(filename());
+        if (node["serial_number"].as<uint32_t>() != serial_number_ ||
+            node["firmware"].as<std::string>() != firmware_ ||
+            !from_hex(node["flash_cfg"].as<std::string>(), reinterpret_cast<uint8_t *>(&flash_cfg), sizeof(flash_cfg)))
+        {
+            return false;
+        }
+
+        streams.clear();
+        for (YAML::const_iterator it = node["streams"].begin(); it != node["streams"].end(); ++it)
+        {
+            streams[it->first.as<uint32_t>()] = it->second.as<int>();
+        }
+        gps_week = node["gps_week"].as<uint64_t>();
+        ins_local_offset = node["ins_local_offset"].as<double>();
+        cold_startup_ms = node["cold_startup_ms"].as<double>(0.0);
+        warm_startup_ms = node["warm_startup_ms"].as<double>(0.0);
+    }
+    catch (const YAML::Exception &e)
+    {
+        // Missing or unreadable cache, fall back to a cold start
+        return false;
+    }
+
+    valid_ = true;
+    return true;
+}
+
+bool DeviceCache::save()
+{
+    if (serial_number_ == 0 || directory_.empty() || !make_directories(directory_))
+        return false;
+
+    YAML::Emitter out;
+    out << YAML::BeginMap;
+    out << YAML::Key << "serial_number" << YAML::Value << serial_number_;
+    out << YAML::Key << "firmware" << YAML::Value << firmware_;
+    out << YAML::Key << "flash_cfg" << YAML::Value << to_hex(reinterpret_cast<const uint8_t *>(&flash_cfg), sizeof(flash_cfg));
+    out << YAML::Key << "streams" << YAML::Value << YAML::BeginMap;
+    for (stream_set_t::const_iterator it = streams.begin(); it != streams.end(); ++it)
+    {
+        out << YAML::Key << it->first << YAML::Value << it->second;
+    }
+    out << YAML::EndMap;
+    out << YAML::Key << "gps_week" << YAML::Value << gps_week;
+    out << YAML::Key << "ins_local_offset" << YAML::Value << YAML::Precision(17) << ins_local_offset;
+    out << YAML::Key << "cold_startup_ms" << YAML::Value << cold_startup_ms;
+    out << YAML::Key << "warm_startup_ms" << YAML::Value << warm_startup_ms;
+    out << YAML::EndMap;
+
+    // Write to a temporary file first so a crash never leaves a truncated cache behind
+    std::string tmp = filename() + ".tmp";
+    {
+        std::ofstream file(tmp.c_str());
+        if (!file)
+            return false;
+        file << out.c_str() << "\n";
+        if (!file)
+            return false;
+    }
+    if (rename(tmp.c_str(), filename().c_str()) != 0)
+        return false;
+
+    valid_ = true;
+    return true;
+}
+
+int DeviceCache::load_port_baudrate(const std::string &directory, const std::string &port)
+{
+    try
+    {
+        YAML::Node node = YAML::LoadFile(port_filename(directory, port));
+        return node["baudrate"].as<int>();
+    }
+    catch (const YAML::Exception &e)
+    {
+        return 0;
+    }
+}
+
+bool DeviceCache::save_port_baudrate(const std::string &directory, const std::string &port, int baudrate)
+{
+    if (directory.empty() || !make_directories(directory))
+        return false;
+
+    std::string filename = port_filename(directory, port);
+    std::string tmp = filename + ".tmp";
+    {
+        std::ofstream file(tmp.c_str());
+        if (!file)
+            return false;
+        file << "baudrate: " << baudrate << "\n";
+        if (!file)
+            return false;
+    }
+    return rename(tmp.c_str(), filename.c_str()) == 0;
+}
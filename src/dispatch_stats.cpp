@@ -0,0 +1,209 @@
+#include "dispatch_stats.h"
+
+#include <math.h>
+#include <chrono>
+
+#include "data_sets.h"
+
+static const int BUCKETS_PER_OCTAVE = 4;
+static const double BUCKET_UNIT = 1.0e-6; // upper bound of bucket 0, seconds
+
+int DispatchStats::histogram_t::bucket(double seconds)
+{
+    if (seconds <= BUCKET_UNIT)
+        return 0;
+    int b = (int)ceil(BUCKETS_PER_OCTAVE * log2(seconds / BUCKET_UNIT));
+    return b < BUCKETS ? b : BUCKETS - 1;
+}
+
+double DispatchStats::histogram_t::upper_bound(int bucket)
+{
+    return BUCKET_UNIT * exp2((double)bucket / BUCKETS_PER_OCTAVE);
+}
+
+void DispatchStats::histogram_t::add(double seconds)
+{
+    buckets[bucket(seconds)]++;
+    if (count == 0 || seconds > max)
+        max = seconds;
+    count++;
+}
+
+double DispatchStats::histogram_t::percentile(double p) const
+{
+    if (count == 0)
+        return 0.0;
+    // Rank of the sample at percentile p, 1 based
+    uint32_t rank = (uint32_t)ceil(p / 100.0 * count);
+    if (rank < 1)
+        rank = 1;
+    uint32_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return upper_bound(i) < max ? upper_bound(i) : max;
+    }
+    return max;
+}
+
+int DispatchStats::add_window()
+{
+    window_start_.push_back(now());
+    for (size_t i = 0; i < dids_.size(); i++)
+        dids_[i].windows.resize(window_start_.size());
+    return (int)window_start_.size() - 1;
+}
+
+void DispatchStats::update_timing(did_t &stats, double time)
+{
+    if (!stats.has_time)
+    {
+        stats.has_time = true;
+        stats.last_time = time;
+        return;
+    }
+    double dt = time - stats.last_time;
+    if (fabs(dt) < 1.0e-6)
+    {
+        stats.duplicates++;
+        return;
+    }
+    stats.last_time = time;
+    if (dt < 0.0)
+    {
+        // The device restarted or the week rolled over, start over
+        stats.period = 0.0;
+        return;
+    }
+    if (stats.period <= 0.0 || dt < 0.75 * stats.period)
+    {
+        stats.period = dt;
+    }
+    else if (dt > 1.5 * stats.period)
+    {
+        stats.gaps++;
+        stats.missed += (uint32_t)lround(dt / stats.period) - 1;
+    }
+    else
+    {
+        // Follow drift of the device clock against its nominal rate
+        stats.period = 0.9 * stats.period + 0.1 * dt;
+    }
+}
+
+void DispatchStats::record(const sample_t &sample)
+{
+    if (sample.did >= dids_.size())
+    {
+        dids_.resize(sample.did + 1);
+        for (size_t i = 0; i < dids_.size(); i++)
+            dids_[i].windows.resize(window_start_.size());
+    }
+    did_t &stats = dids_[sample.did];
+    stats.packets++;
+    stats.bytes += sample.size;
+
+    uint32_t gaps = stats.gaps, duplicates = stats.duplicates;
+    if (sample.has_device_time)
+        update_timing(stats, sample.device_time);
+
+    double dispatch = sample.entry - sample.receive;
+    double handler = sample.done - sample.entry;
+    for (size_t i = 0; i < stats.windows.size(); i++)
+    {
+        window_t &window = stats.windows[i];
+        window.packets++;
+        window.bytes += sample.size;
+        window.gaps += stats.gaps - gaps;
+        window.duplicates += stats.duplicates - duplicates;
+        window.latency[LATENCY_DISPATCH].add(dispatch);
+        window.latency[LATENCY_HANDLER].add(handler);
+        if (sample.has_age)
+            window.latency[LATENCY_AGE].add(sample.age);
+    }
+}
+
+void DispatchStats::reset_timing(uint32_t did)
+{
+    if (did < dids_.size())
+    {
+        dids_[did].has_time = false;
+        dids_[did].period = 0.0;
+    }
+}
+
+std::vector<std::pair<uint32_t, DispatchStats::window_t>> DispatchStats::take_window(int window, double now, double &elapsed)
+{
+    std::vector<std::pair<uint32_t, window_t>> windows;
+    elapsed = now - window_start_[window];
+    window_start_[window] = now;
+    for (size_t did = 0; did < dids_.size(); did++)
+    {
+        if (dids_[did].packets == 0)
+            continue;
+        windows.push_back(std::make_pair((uint32_t)did, dids_[did].windows[window]));
+        dids_[did].windows[window] = window_t();
+    }
+    return windows;
+}
+
+// Time field of a complete data set of type T
+template <typename T, typename F>
+static bool field_time(const p_data_t *data, F T::*field, double scale, double &time)
+{
+    if (data->hdr.offset != 0 || data->hdr.size < sizeof(T))
+        return false;
+    time = (reinterpret_cast<const T *>(data->buf)->*field) * scale;
+    return true;
+}
+
+bool DispatchStats::device_time(const p_data_t *data, double &time, bool &sinceBoot)
+{
+    sinceBoot = false;
+    switch (data->hdr.id)
+    {
+    case DID_INS_1:
+        return field_time(data, &ins_1_t::timeOfWeek, 1.0, time);
+    case DID_INS_2:
+        return field_time(data, &ins_2_t::timeOfWeek, 1.0, time);
+    case DID_INS_4:
+        return field_time(data, &ins_4_t::timeOfWeek, 1.0, time);
+    case DID_INL2_STATES:
+        return field_time(data, &inl2_states_t::timeOfWeek, 1.0, time);
+    case DID_ROS_COVARIANCE_POSE_TWIST:
+        return field_time(data, &ros_covariance_pose_twist_t::timeOfWeek, 1.0, time);
+    case DID_GPS1_POS:
+    case DID_GPS2_POS:
+        return field_time(data, &gps_pos_t::timeOfWeekMs, 1.0e-3, time);
+    case DID_GPS1_VEL:
+    case DID_GPS2_VEL:
+        return field_time(data, &gps_vel_t::timeOfWeekMs, 1.0e-3, time);
+    case DID_GPS1_SAT:
+    case DID_GPS2_SAT:
+        return field_time(data, &gps_sat_t::timeOfWeekMs, 1.0e-3, time);
+    case DID_GPS1_RTK_POS_REL:
+    case DID_GPS2_RTK_CMP_REL:
+        return field_time(data, &gps_rtk_rel_t::timeOfWeekMs, 1.0e-3, time);
+    case DID_GPS1_RTK_POS_MISC:
+    case DID_GPS2_RTK_CMP_MISC:
+        return field_time(data, &gps_rtk_misc_t::timeOfWeekMs, 1.0e-3, time);
+    case DID_PIMU:
+        sinceBoot = true;
+        return field_time(data, &pimu_t::time, 1.0, time);
+    case DID_MAGNETOMETER:
+        sinceBoot = true;
+        return field_time(data, &magnetometer_t::time, 1.0, time);
+    case DID_BAROMETER:
+        sinceBoot = true;
+        return field_time(data, &barometer_t::time, 1.0, time);
+    default:
+        // Strobe events and raw GNSS data have no period
+        return false;
+    }
+}
+
+double DispatchStats::now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
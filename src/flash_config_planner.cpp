@@ -0,0 +1,51 @@
+#include "flash_config_planner.h"
+
+#include <string.h>
+
+FlashConfigPlanner::FlashConfigPlanner(const nvm_flash_cfg_t &current, uint32_t mergeGap) : current_(current), desired_(current), merge_gap_(mergeGap)
+{
+}
+
+const std::vector<FlashConfigPlanner::range_t> &FlashConfigPlanner::changes() const
+{
+    const uint8_t *cur = reinterpret_cast<const uint8_t *>(&current_);
+    const uint8_t *des = reinterpret_cast<const uint8_t *>(&desired_);
+
+    changes_.clear();
+    for (uint32_t i = 0; i < sizeof(nvm_flash_cfg_t); i++)
+    {
+        if (cur[i] == des[i])
+            continue;
+
+        if (!changes_.empty() && i - (changes_.back().offset + changes_.back().size) <= merge_gap_)
+        {
+            // Cheaper to rewrite the unchanged bytes in between than to send another packet
+            changes_.back().size = i + 1 - changes_.back().offset;
+        }
+        else
+        {
+            range_t range = {i, 1};
+            changes_.push_back(range);
+        }
+    }
+    return changes_;
+}
+
+bool FlashConfigPlanner::changed(uint32_t offset, uint32_t size) const
+{
+    return memcmp(reinterpret_cast<const uint8_t *>(&current_) + offset, reinterpret_cast<const uint8_t *>(&desired_) + offset, size) != 0;
+}
+
+bool FlashConfigPlanner::verify(const uint8_t *buf, uint32_t offset, uint32_t size) const
+{
+    const uint8_t *des = reinterpret_cast<const uint8_t *>(&desired_);
+
+    for (const range_t &range : changes())
+    {
+        if (range.offset < offset || range.offset + range.size > offset + size)
+            return false;
+        if (memcmp(buf + (range.offset - offset), des + range.offset, range.size) != 0)
+            return false;
+    }
+    return true;
+}
@@ -32,5 +32,6 @@ int main(int argc, char**argv)
         ros::spinOnce();
         thing->update();
     }
+    delete thing;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "inertial_sense_ros.h"
+#include "replay_engine.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <rosgraph_msgs/Clock.h>
+
+// Feeds the replay into the node and drives ROS time from the recording
+class NodeReplayTarget : public ReplayTarget
+{
+public:
+    NodeReplayTarget(InertialSenseROS &node, ros::NodeHandle &nh) :
+        node_(node),
+        clock_pub_(nh.advertise<rosgraph_msgs::Clock>("/clock", 10))
+    {
+    }
+
+    void set_time(const ros::Time &stamp) override
+    {
+        ros::Time::setNow(stamp);
+        rosgraph_msgs::Clock clock;
+        clock.clock = stamp;
+        clock_pub_.publish(clock);
+    }
+
+    void deliver(const p_data_t *data) override { node_.replay_data(data); }
+
+    // Timers and services see the recorded time of the batch
+    void batch_done() override { ros::spinOnce(); }
+
+    bool ok() override { return ros::ok(); }
+
+private:
+    InertialSenseROS &node_;
+    ros::Publisher clock_pub_;
+};
+
+static void usage()
+{
+    std::cout << "usage: inertial_sense_replay <bag> [--rate N | --afap] [--topic isb_raw] [--params file.yaml]\n"
+              << "  Replays the isb_raw messages of a bag through the node.  --rate 1 (default) replays\n"
+              << "  in real time, --afap as fast as possible.  ROS time follows the recording.\n";
+}
+
+int main(int argc, char **argv)
+{
+    // Same name as the live node, so topics and private parameters match
+    ros::init(argc, argv, "inertial_sense_node");
+    std::vector<std::string> args;
+    ros::removeROSArgs(argc, argv, args);
+
+    std::string bagPath, topic = "isb_raw", paramYamlPath;
+    double rate = 1.0;
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        if (args[i] == "--rate" && i + 1 < args.size())
+            rate = atof(args[++i].c_str());
+        else if (args[i] == "--afap")
+            rate = 0.0;
+        else if (args[i] == "--topic" && i + 1 < args.size())
+            topic = args[++i];
+        else if (args[i] == "--params" && i + 1 < args.size())
+            paramYamlPath = args[++i];
+        else if (bagPath.empty() && args[i][0] != '-')
+            bagPath = args[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (bagPath.empty() || rate < 0.0)
+    {
+        usage();
+        return 1;
+    }
+
+    YAML::Node node(YAML::NodeType::Undefined);
+    if (!paramYamlPath.empty())
+        node = YAML::LoadFile(paramYamlPath)["inertial_sense_ros"];
+
+    std::unique_ptr<BagReplaySource> source;
+    try
+    {
+        source.reset(new BagReplaySource(bagPath, topic));
+    }
+    catch (const rosbag::BagException &e)
+    {
+        ROS_FATAL("Unable to open %s: %s", bagPath.c_str(), e.what());
+        return 1;
+    }
+
+    // The node must only ever see recorded time, including while it is constructed
+    ros::Time::setNow(ros::Time(0, 1));
+    ros::NodeHandle nh;
+    InertialSenseROS isROS(node, false, false);
+    NodeReplayTarget target(isROS, nh);
+
+    ReplayEngine engine(*source, rate);
+    ReplayEngine::stats_t stats = engine.run(target);
+
+    ROS_INFO("Replayed %lu packets in %lu batches, %.1f s of recording in %.3f s (%.1fx, %.0f packets/s), %u checksum errors",
+             (unsigned long)stats.packets, (unsigned long)stats.batches, stats.recorded_duration, stats.wall_duration,
+             stats.wall_duration > 0.0 ? stats.recorded_duration / stats.wall_duration : 0.0,
+             stats.wall_duration > 0.0 ? stats.packets / stats.wall_duration : 0.0, stats.checksum_errors);
+    return 0;
+}
@@ -1,17 +1,27 @@
 #include "inertial_sense_ros.h"
+#include <array>
 #include <chrono>
 #include <stddef.h>
 #include <unistd.h>
 #include <tf/tf.h>
 #include <ros/console.h>
-#include <ISPose.h>
-#include <ISEarth.h>
 #include <tf2/LinearMath/Quaternion.h>
-#include "ISMatrix.h"
-#include "ISEarth.h"
+#include "did_converters.h"
 
-InertialSenseROS::InertialSenseROS(YAML::Node paramNode, bool configFlashParameters) : nh_(), nh_private_("~"), initialized_(false), rtk_connectivity_watchdog_timer_()
+InertialSenseROS::InertialSenseROS(YAML::Node paramNode, bool configFlashParameters, bool connectDevice) : nh_(), nh_private_("~"), initialized_(false), config_flash_parameters_(configFlashParameters), rtk_connectivity_watchdog_timer_()
 {
+    ros::WallTime startup_begin = ros::WallTime::now();
+    dispatch_handler_ = [this](InertialSense *i, p_data_t *data, int pHandle)
+    {
+        this->on_device_data(data);
+    };
+    core_.set_sink(this);
+    core_.time_sync.clock = []()
+    {
+        return ros::Time::now().toSec();
+    };
+    set_stream_defaults();
+
     if (paramNode.IsDefined())
     {
         load_params_yaml(paramNode);
@@ -22,6 +32,48 @@ InertialSenseROS::InertialSenseROS(YAML::Node paramNode, bool configFlashParamet
         load_params_srv();
         ROS_INFO("Using parameter server.\n\n");
     }
+    if (device_cache_dir_.empty())
+    {
+        const char *home = getenv("HOME");
+        if (home)
+            device_cache_dir_ = std::string(home) + "/.ros/inertial_sense";
+        else if (device_cache_enabled_)
+        {
+            ROS_WARN("HOME is not set and device_cache_dir is empty, device cache disabled");
+            device_cache_enabled_ = false;
+        }
+    }
+    overload_ = OverloadPolicy(overload_shed_low_, overload_shed_normal_);
+    overload_.set_dispatch([this](const p_data_t *data, double receiveTime)
+    {
+        dispatch_data(data, receiveTime);
+    });
+    dispatch_stats_enabled_ = diagnostics_.enabled || did_stats_.enabled;
+    if (diagnostics_.enabled)
+        diagnostics_window_ = dispatch_stats_.add_window();
+    if (did_stats_.enabled)
+    {
+        did_stats_window_ = dispatch_stats_.add_window();
+        did_stats_.pub = advertise<inertial_sense_ros::DIDStats>(did_stats_, "did_stats");
+        did_stats_timer_ = nh_.createTimer(ros::Duration(1.0), &InertialSenseROS::did_stats_callback, this); // 1 Hz
+    }
+    start_shm_output();
+    start_udp_telemetry();
+    if (!connectDevice)
+    {
+        start_replay();
+        return;
+    }
+    // The main loop polls the port without blocking, so SCHED_FIFO would keep it from ever giving up its CPU
+    SerialTuning ingestTuning = serial_tuning_;
+    if (ingestTuning.thread_priority > 0)
+    {
+        ROS_WARN("ingest_thread_priority ignored: the node reads the uINS from its main loop, which does not block");
+        ingestTuning.thread_priority = 0;
+    }
+    std::string tuning_error;
+    if (!ingestTuning.apply_to_thread(pthread_self(), tuning_error))
+        ROS_WARN("Unable to tune the ingest thread: %s", tuning_error.c_str());
     connect();
 
     // Check protocol and firmware version
@@ -30,6 +82,15 @@ InertialSenseROS::InertialSenseROS(YAML::Node paramNode, bool configFlashParamet
         ROS_FATAL("Protocol version of ROS node does not match device protocol!");
     }
 
+    // A device that is unchanged since the last run is still broadcasting our streams
+    warm_start_ = load_device_cache();
+    start_link_supervisor();
+    start_stream_monitor();
+
+    // The baud rate is part of the flash configuration, so a warm start is already at the negotiated rate
+    if (!warm_start_)
+        negotiate_baudrate();
+
     // Start Up ROS service servers
     refLLA_set_current_srv_ = nh_.advertiseService("set_refLLA_current", &InertialSenseROS::set_current_position_as_refLLA, this);
     refLLA_set_value_srv_ = nh_.advertiseService("set_refLLA_value", &InertialSenseROS::set_refLLA_to_value, this);
@@ -39,19 +100,38 @@ InertialSenseROS::InertialSenseROS(YAML::Node paramNode, bool configFlashParamet
     data_stream_timer_ = nh_.createTimer(ros::Duration(1), configure_data_streams, this); // 2 Hz
     if (diagnostics_.enabled)
     {
-        diagnostics_.pub = nh_.advertise<diagnostic_msgs::DiagnosticArray>("diagnostics", 1);
+        diagnostics_.pub = advertise<diagnostic_msgs::DiagnosticArray>(diagnostics_, "diagnostics");
         diagnostics_timer_ = nh_.createTimer(ros::Duration(0.5), &InertialSenseROS::diagnostics_callback, this); // 2 Hz
     }
+    if (isb_raw_.enabled)
+    {
+        isb_raw_.pub = advertise<inertial_sense_ros::ISBRaw>(isb_raw_, "isb_raw");
+        isb_raw_msg_.header.frame_id = frame_id_;
+    }
 
-    IS_.StopBroadcasts(true);
+    if (!warm_start_)
+        IS_.StopBroadcasts(true);
+    link_budget_.set_link(baudrate_, link_headroom_);
+    link_budget_.set_auto_scale(link_auto_scale_);
     configure_data_streams(true);
+    check_link_budget();
     configure_rtk();
-    IS_.SavePersistent();
-
-    if (configFlashParameters)
-    { // Set uINS flash parameters after everything thing else so uINS flash write processor stall doesn't interfere.
-        configure_flash_parameters();
+    configure_overload_policy();
+    publish_transport_params();
+    if (warm_start_)
+    {
+        // Only stop the broadcasts of the last run that are no longer wanted
+        for (DeviceCache::stream_set_t::const_iterator it = device_cache_.streams.begin(); it != device_cache_.streams.end(); ++it)
+        {
+            if (active_streams_.find(it->first) == active_streams_.end())
+                comManagerDisableData(0, it->first);
+        }
     }
+    if (!warm_start_ || active_streams_ != device_cache_.streams)
+        IS_.SavePersistent();
+
+    // Set uINS flash parameters after everything thing else so uINS flash write processor stall doesn't interfere.
+    configure_flash_parameters();
 
     if (log_enabled_)
     {
@@ -61,6 +141,38 @@ InertialSenseROS::InertialSenseROS(YAML::Node paramNode, bool configFlashParamet
     //  configure_ascii_output(); //does not work right now
 
     initialized_ = true;
+
+    double startup_ms = (ros::WallTime::now() - startup_begin).toSec() * 1.0e3;
+    ROS_INFO("InertialSense: %s startup took %.1f ms", warm_start_ ? "warm" : "cold", startup_ms);
+    if (warm_start_)
+        device_cache_.warm_startup_ms = startup_ms;
+    else
+        device_cache_.cold_startup_ms = startup_ms;
+    save_device_cache();
+}
+
+InertialSenseROS::~InertialSenseROS()
+{
+    // Keep the latest time sync state for the next start
+    save_device_cache();
+}
+
+void InertialSenseROS::start_replay()
+{
+    // Nothing may be sent to or remembered about a device.  The raw topic would only repeat its input.
+    replay_ = true;
+    device_cache_enabled_ = false;
+    isb_raw_.enabled = false;
+    configure_data_streams(true);
+    initialized_ = true;
+    ROS_INFO("InertialSense: replaying recorded data");
+}
+
+void InertialSenseROS::replay_data(const p_data_t *data)
+{
+    receive_time_ = DispatchStats::now();
+    receive_wall_time_ = ros::WallTime::now().toSec();
+    on_device_data(data);
 }
 
 void InertialSenseROS::load_params_yaml(YAML::Node node)
@@ -69,6 +181,15 @@ void InertialSenseROS::load_params_yaml(YAML::Node node)
     get_node_param_yaml(node, "port", port_);
     get_node_param_yaml(node, "navigation_dt_ms", navigation_dt_ms_);
     get_node_param_yaml(node, "baudrate", baudrate_);
+    get_node_param_yaml(node, "negotiate_baudrate", negotiate_baudrate_);
+    get_node_param_yaml(node, "baudrate_candidates", baudrate_candidates_);
+    get_node_param_yaml(node, "device_serial_port", device_serial_port_);
+    get_node_param_yaml(node, "serial_low_latency", serial_tuning_.low_latency);
+    get_node_param_yaml(node, "serial_latency_timer_ms", serial_tuning_.latency_timer_ms);
+    get_node_param_yaml(node, "serial_vmin", serial_tuning_.vmin);
+    get_node_param_yaml(node, "serial_vtime", serial_tuning_.vtime);
+    get_node_param_yaml(node, "ingest_thread_priority", serial_tuning_.thread_priority);
+    get_node_param_yaml(node, "ingest_thread_cpu", serial_tuning_.thread_cpu);
     get_node_param_yaml(node, "frame_id", frame_id_);
     get_node_param_yaml(node, "stream_DID_INS_1", DID_INS_1_.enabled);
     get_node_param_yaml(node, "ins1_period_multiple", DID_INS_1_.period_multiple);
@@ -82,6 +203,7 @@ void InertialSenseROS::load_params_yaml(YAML::Node node)
     get_node_param_yaml(node, "odom_ins_enu_period_multiple", odom_ins_enu_.period_multiple);
     get_node_param_yaml(node, "stream_odom_ins_ecef", odom_ins_ecef_.enabled);
     get_node_param_yaml(node, "odom_ins_ecef_period_multiple", odom_ins_ecef_.period_multiple);
+    get_node_param_yaml(node, "stream_ins_state", ins_state_.enabled);
     get_node_param_yaml(node, "stream_covariance_data", covariance_enabled_);
     get_node_param_yaml(node, "stream_INL2_states", INL2_states_.enabled);
     get_node_param_yaml(node, "INL2_states_period_multiple", INL2_states_.period_multiple);
@@ -111,6 +233,7 @@ void InertialSenseROS::load_params_yaml(YAML::Node node)
     get_node_param_yaml(node, "preint_imu_period_multiple", preint_IMU_.period_multiple);
     get_node_param_yaml(node, "stream_diagnostics", diagnostics_.enabled);
     get_node_param_yaml(node, "diagnostics_period_multiple", diagnostics_.period_multiple);
+    get_node_param_yaml(node, "stream_did_stats", did_stats_.enabled);
     get_node_param_yaml(node, "publishTf", publishTf_);
     get_node_param_yaml(node, "enable_log", log_enabled_);
     get_node_param_yaml(node, "ioConfig", ioConfig_);
@@ -137,6 +260,44 @@ void InertialSenseROS::load_params_yaml(YAML::Node node)
     get_node_param_yaml(node, "gpsTimeUserDelay", gpsTimeUserDelay_);
     get_node_param_yaml(node, "declination", magDeclination_);
     get_node_param_yaml(node, "dynamic_model", insDynModel_);
+    get_node_param_yaml(node, "device_command_timeout", device_command_timeout_);
+    get_node_param_yaml(node, "enable_device_cache", device_cache_enabled_);
+    get_node_param_yaml(node, "device_cache_dir", device_cache_dir_);
+    get_node_param_yaml(node, "link_timeout", link_timeout_);
+    get_node_param_yaml(node, "reconnect_backoff_min", reconnect_backoff_min_);
+    get_node_param_yaml(node, "reconnect_backoff_max", reconnect_backoff_max_);
+    get_node_param_yaml(node, "stream_monitor", stream_monitor_enabled_);
+    get_node_param_yaml(node, "stream_stall_periods", stream_stall_periods_);
+    get_node_param_yaml(node, "link_headroom", link_headroom_);
+    get_node_param_yaml(node, "link_auto_scale", link_auto_scale_);
+    get_node_param_yaml(node, "stream_isb_raw", isb_raw_.enabled);
+    get_node_param_yaml(node, "isb_raw_dids", isb_raw_dids_);
+    get_node_param_yaml(node, "isb_raw_period_multiple", isb_raw_.period_multiple);
+    get_node_param_yaml(node, "shared_memory", shm_enabled_);
+    get_node_param_yaml(node, "shared_memory_name", shm_name_);
+    get_node_param_yaml(node, "shared_memory_slots", shm_slots_);
+    get_node_param_yaml(node, "udp_telemetry", udp_telemetry_enabled_);
+    get_node_param_yaml(node, "udp_telemetry_address", udp_telemetry_address_);
+    get_node_param_yaml(node, "udp_telemetry_port", udp_telemetry_port_);
+    get_node_param_yaml(node, "udp_telemetry_ttl", udp_telemetry_ttl_);
+    get_node_param_yaml(node, "udp_telemetry_interface", udp_telemetry_interface_);
+    get_node_param_yaml(node, "udp_telemetry_rate", udp_telemetry_rate_);
+    get_node_param_yaml(node, "udp_telemetry_batch", udp_telemetry_batch_);
+    get_node_param_yaml(node, "overload_policy", overload_policy_enabled_);
+    get_node_param_yaml(node, "overload_shed_low", overload_shed_low_);
+    get_node_param_yaml(node, "overload_shed_normal", overload_shed_normal_);
+    std::vector<stream_params_t> streams = stream_params();
+    for (size_t i = 0; i < streams.size(); i++)
+    {
+        std::string priority, dropPolicy;
+        get_node_param_yaml(node, streams[i].name + "_priority", priority);
+        get_node_param_yaml(node, streams[i].name + "_drop_policy", dropPolicy);
+        set_overload_params(streams[i], priority, dropPolicy);
+        get_node_param_yaml(node, streams[i].name + "_queue_size", streams[i].stream->queue_size);
+        get_node_param_yaml(node, streams[i].name + "_latch", streams[i].stream->latch);
+        get_node_param_yaml(node, streams[i].name + "_tcp_nodelay", streams[i].stream->tcp_nodelay);
+        get_node_param_yaml(node, streams[i].name + "_udp", streams[i].stream->udp);
+    }
 
     // Params with arrays
     get_node_vector_yaml(node, "INS_rpy_radians", 3, insRotation_);
@@ -153,6 +314,15 @@ void InertialSenseROS::load_params_srv()
     nh_private_.getParam("port", port_);
     nh_private_.getParam("navigation_dt_ms", navigation_dt_ms_);
     nh_private_.getParam("baudrate", baudrate_);
+    nh_private_.getParam("negotiate_baudrate", negotiate_baudrate_);
+    nh_private_.getParam("baudrate_candidates", baudrate_candidates_);
+    nh_private_.getParam("device_serial_port", device_serial_port_);
+    nh_private_.getParam("serial_low_latency", serial_tuning_.low_latency);
+    nh_private_.getParam("serial_latency_timer_ms", serial_tuning_.latency_timer_ms);
+    nh_private_.getParam("serial_vmin", serial_tuning_.vmin);
+    nh_private_.getParam("serial_vtime", serial_tuning_.vtime);
+    nh_private_.getParam("ingest_thread_priority", serial_tuning_.thread_priority);
+    nh_private_.getParam("ingest_thread_cpu", serial_tuning_.thread_cpu);
     nh_private_.getParam("frame_id", frame_id_);
     nh_private_.param("stream_DID_INS_1", DID_INS_1_.enabled, true);
     nh_private_.getParam("ins1_period_multiple", DID_INS_1_.period_multiple);
@@ -166,6 +336,7 @@ void InertialSenseROS::load_params_srv()
     nh_private_.getParam("odom_ins_enu_period_multiple", odom_ins_enu_.period_multiple);
     nh_private_.getParam("stream_odom_ins_ecef", odom_ins_ecef_.enabled);
     nh_private_.getParam("odom_ins_ecef_period_multiple", odom_ins_ecef_.period_multiple);
+    nh_private_.getParam("stream_ins_state", ins_state_.enabled);
     nh_private_.getParam("stream_covariance_data", covariance_enabled_);
     nh_private_.getParam("stream_INL2_states", INL2_states_.enabled);
     nh_private_.getParam("INL2_states_period_multiple", INL2_states_.period_multiple);
@@ -193,6 +364,7 @@ void InertialSenseROS::load_params_srv()
     nh_private_.getParam("preint_imu_period_multiple", preint_IMU_.period_multiple);
     nh_private_.getParam("stream_diagnostics", diagnostics_.enabled);
     nh_private_.getParam("diagnostics_period_multiple", diagnostics_.period_multiple);
+    nh_private_.getParam("stream_did_stats", did_stats_.enabled);
     nh_private_.getParam("publishTf", publishTf_);
     nh_private_.getParam("ioConfig", ioConfig_);
     nh_private_.getParam("enable_log", log_enabled_);
@@ -221,6 +393,44 @@ void InertialSenseROS::load_params_srv()
     nh_private_.getParam("gpsTimeUserDelay", gpsTimeUserDelay_);
     nh_private_.getParam("declination", magDeclination_);
     nh_private_.getParam("dynamic_model", insDynModel_);
+    nh_private_.getParam("device_command_timeout", device_command_timeout_);
+    nh_private_.getParam("enable_device_cache", device_cache_enabled_);
+    nh_private_.getParam("device_cache_dir", device_cache_dir_);
+    nh_private_.getParam("link_timeout", link_timeout_);
+    nh_private_.getParam("reconnect_backoff_min", reconnect_backoff_min_);
+    nh_private_.getParam("reconnect_backoff_max", reconnect_backoff_max_);
+    nh_private_.getParam("stream_monitor", stream_monitor_enabled_);
+    nh_private_.getParam("stream_stall_periods", stream_stall_periods_);
+    nh_private_.getParam("link_headroom", link_headroom_);
+    nh_private_.getParam("link_auto_scale", link_auto_scale_);
+    nh_private_.getParam("stream_isb_raw", isb_raw_.enabled);
+    nh_private_.getParam("isb_raw_dids", isb_raw_dids_);
+    nh_private_.getParam("isb_raw_period_multiple", isb_raw_.period_multiple);
+    nh_private_.getParam("shared_memory", shm_enabled_);
+    nh_private_.getParam("shared_memory_name", shm_name_);
+    nh_private_.getParam("shared_memory_slots", shm_slots_);
+    nh_private_.getParam("udp_telemetry", udp_telemetry_enabled_);
+    nh_private_.getParam("udp_telemetry_address", udp_telemetry_address_);
+    nh_private_.getParam("udp_telemetry_port", udp_telemetry_port_);
+    nh_private_.getParam("udp_telemetry_ttl", udp_telemetry_ttl_);
+    nh_private_.getParam("udp_telemetry_interface", udp_telemetry_interface_);
+    nh_private_.getParam("udp_telemetry_rate", udp_telemetry_rate_);
+    nh_private_.getParam("udp_telemetry_batch", udp_telemetry_batch_);
+    nh_private_.getParam("overload_policy", overload_policy_enabled_);
+    nh_private_.getParam("overload_shed_low", overload_shed_low_);
+    nh_private_.getParam("overload_shed_normal", overload_shed_normal_);
+    std::vector<stream_params_t> streams = stream_params();
+    for (size_t i = 0; i < streams.size(); i++)
+    {
+        std::string priority, dropPolicy;
+        nh_private_.getParam(streams[i].name + "_priority", priority);
+        nh_private_.getParam(streams[i].name + "_drop_policy", dropPolicy);
+        set_overload_params(streams[i], priority, dropPolicy);
+        nh_private_.getParam(streams[i].name + "_queue_size", streams[i].stream->queue_size);
+        nh_private_.getParam(streams[i].name + "_latch", streams[i].stream->latch);
+        nh_private_.getParam(streams[i].name + "_tcp_nodelay", streams[i].stream->tcp_nodelay);
+        nh_private_.getParam(streams[i].name + "_udp", streams[i].stream->udp);
+    }
 
     // Params with arrays
     get_vector_flash_config("INS_rpy_radians", 3, insRotation_);
@@ -233,6 +443,175 @@ void InertialSenseROS::load_params_srv()
 void InertialSenseROS::configure_data_streams(const ros::TimerEvent &event)
 {
     configure_data_streams(false);
+    check_link_budget();
+}
+
+void InertialSenseROS::on_device_data(const p_data_t *data)
+{
+    double now = ros::WallTime::now().toSec();
+    link_supervisor_.data_received(now);
+    link_budget_.received(data->hdr.id, data->hdr.size);
+    if (data->hdr.id < DID_COUNT)
+        stream_requests_[data->hdr.id].received = true;
+    if (stream_monitor_enabled_)
+    {
+        double deviceTime;
+        bool sinceBoot;
+        bool hasTime = DispatchStats::device_time(data, deviceTime, sinceBoot);
+        stream_monitor_.received(data->hdr.id, now, hasTime, deviceTime);
+    }
+    if (isb_raw_.enabled)
+        isb_raw_writer_.append(data);
+    IS_PROBE3(packet, data->hdr.id, data->hdr.size, data->hdr.offset);
+    if (overload_policy_enabled_)
+        overload_.dispatch(data, receive_time_);
+    else
+        dispatch_data(data, receive_time_);
+}
+
+void InertialSenseROS::dispatch_data(const p_data_t *data, double receiveTime)
+{
+    dispatch_did_ = data->hdr.id;
+    if (!dispatch_stats_enabled_)
+    {
+        dispatch_table_.dispatch(this, data);
+        dispatch_did_ = DID_NULL;
+        process_device_commands(data);
+        return;
+    }
+
+    DispatchStats::sample_t sample;
+    sample.did = data->hdr.id;
+    sample.size = data->hdr.size;
+    sample.receive = receiveTime; // of a held packet, the read it arrived with
+    sample.entry = DispatchStats::now();
+    dispatch_table_.dispatch(this, data);
+    sample.done = DispatchStats::now();
+    dispatch_did_ = DID_NULL;
+    process_device_commands(data);
+
+    bool sinceBoot;
+    sample.has_device_time = DispatchStats::device_time(data, sample.device_time, sinceBoot);
+    if (sample.has_device_time && core_.time_sync.has_gps_time())
+    {
+        // Age against the host wall clock, only meaningful when that follows GPS time
+        double tow = sinceBoot ? sample.device_time + core_.time_sync.gps_tow_offset : sample.device_time;
+        double unixTime = UNIX_TO_GPS_OFFSET + core_.time_sync.gps_week * 7 * 24 * 3600 + tow;
+        sample.has_age = true;
+        sample.age = receive_wall_time_ - unixTime;
+    }
+    dispatch_stats_.record(sample);
+}
+
+void InertialSenseROS::read_device()
+{
+    // The SDK reads and parses in one call, every packet it dispatches arrived with this read
+    receive_time_ = DispatchStats::now();
+    receive_wall_time_ = ros::WallTime::now().toSec();
+    IS_PROBE(read_begin);
+    IS_.Update();
+    IS_PROBE(read_end);
+    if (isb_raw_.enabled)
+        isb_raw_read_time_ = ros::Time::now();
+}
+
+void InertialSenseROS::request_stream(eDataIDs DID, size_t size, int periodMultiple)
+{
+    if (DID <= DID_NULL || DID >= DID_COUNT)
+    {
+        ROS_ERROR("Data set id %d is out of range, not requested", (int)DID);
+        return;
+    }
+    int period = link_budget_.plan_stream(DID, size, periodMultiple);
+    stream_request_t &request = stream_requests_[DID];
+    double now = ros::WallTime::now().toSec();
+
+    // Several ROS streams share DIDs, so the same request is only repeated while its data has not arrived
+    if (period == request.period_multiple && (request.received || now - request.last_request < stream_request_retry_))
+        return;
+
+    if (period != request.period_multiple)
+        dispatch_stats_.reset_timing(DID);
+    request.period_multiple = period;
+    request.last_request = now;
+    request.received = false;
+    if (period > 0)
+        active_streams_[DID] = period;
+    else
+        active_streams_.erase(DID);
+    if (!replay_)
+        IS_.BroadcastBinaryData(DID, period, dispatch_handler_);
+}
+
+void InertialSenseROS::forget_stream_requests()
+{
+    for (int i = 0; i < DID_COUNT; i++)
+        stream_requests_[i] = stream_request_t();
+}
+
+void InertialSenseROS::check_link_budget()
+{
+    const nvm_flash_cfg_t &flash = IS_.GetFlashConfig();
+    link_budget_.set_source_periods(config_flash_parameters_ ? navigation_dt_ms_ : flash.startupNavDtMs, flash.startupGPSDtMs);
+
+    double planned = link_budget_.planned_rate();
+    if (planned == link_planned_rate_)
+        return;
+
+    ROS_INFO("Data streams use %.1f%% of the %d baud link:\n%s", 100.0 * link_budget_.utilization(), baudrate_, link_budget_.report().c_str());
+    if (link_budget_.over_budget())
+    {
+        std::map<uint32_t, int> scaled = link_budget_.scale_to_fit();
+        if (scaled.empty())
+        {
+            ROS_WARN("Data streams need %.1f%% of the %d baud link, more than the %.0f%% headroom. "
+                     "The uINS will drop data, raise the baud rate or period multiples, or enable link_auto_scale.",
+                     100.0 * link_budget_.utilization(), baudrate_, 100.0 * link_budget_.headroom());
+        }
+        else
+        {
+            // Requested as configured, the plan hands out the scaled period, and request_stream
+            // restarts the timing statistics and the retries for it
+            for (std::map<uint32_t, int>::const_iterator it = scaled.begin(); it != scaled.end(); ++it)
+            {
+                const LinkBudget::stream_t &stream = link_budget_.streams().at(it->first);
+                request_stream((eDataIDs)it->first, stream.size, stream.requested_multiple);
+            }
+            ROS_WARN("Scaled data stream periods to use %.1f%% of the %d baud link:\n%s",
+                     100.0 * link_budget_.utilization(), baudrate_, link_budget_.report().c_str());
+        }
+    }
+    link_planned_rate_ = link_budget_.planned_rate();
+}
+
+void InertialSenseROS::restart_data_streams()
+{
+    // Forget which streams have been seen so every enabled stream is requested again
+    forget_stream_requests();
+    flashConfigStreaming_ = false;
+    strobeInStreaming_ = false;
+    ins1Streaming_ = false;
+    ins2Streaming_ = false;
+    ins4Streaming_ = false;
+    inl2StatesStreaming_ = false;
+    insCovarianceStreaming_ = false;
+    magStreaming_ = false;
+    baroStreaming_ = false;
+    preintImuStreaming_ = false;
+    imuStreaming_ = false;
+    pimuStreaming_ = false;
+    gps1PosStreaming_ = false;
+    gps1VelStreaming_ = false;
+    gps2PosStreaming_ = false;
+    gps2VelStreaming_ = false;
+    gps1RawStreaming_ = false;
+    gps2RawStreaming_ = false;
+    gps1InfoStreaming_ = false;
+    gps2InfoStreaming_ = false;
+    data_streams_enabled_ = false;
+
+    configure_data_streams(true);
+    data_stream_timer_.start();
 }
 
 void InertialSenseROS::configure_data_streams(bool startup) // if startup is true each step will be attempted without returning
@@ -240,12 +619,12 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
     if (!gps1PosStreaming_) // we always need GPS for Fix status
     {
         ROS_INFO("Attempting to enable GPS1 Pos data stream.");
-        SET_CALLBACK(DID_GPS1_POS, gps_pos_t, GPS_pos_callback, 1);
+        register_stream<DID_GPS1_POS, &InertialSenseROS::GPS_pos_callback>(1);
     }
     if (!strobeInStreaming_)
     {
         ROS_INFO("Attempting to enable strobe in data stream.");
-        SET_CALLBACK(DID_STROBE_IN_TIME, strobe_in_time_t, strobe_in_time_callback, 1); // we always want the strobe
+        register_stream<DID_STROBE_IN_TIME, &InertialSenseROS::strobe_in_time_callback>(1); // we always want the strobe
         strobeInStreaming_ = true;
         if (!startup)
             return;
@@ -253,7 +632,7 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
     if (!flashConfigStreaming_)
     {
         ROS_INFO("Attempting to enable flash config data stream.");
-        SET_CALLBACK(DID_FLASH_CONFIG, nvm_flash_cfg_t, flash_config_callback, 0);
+        register_stream<DID_FLASH_CONFIG, &InertialSenseROS::flash_config_callback>(0);
         if (!startup)
             return;
     }
@@ -261,35 +640,35 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
     if (DID_INS_1_.enabled && !ins1Streaming_)
     {
         ROS_INFO("Attempting to enable INS1 data stream.");
-        SET_CALLBACK(DID_INS_1, ins_1_t, INS1_callback, DID_INS_1_.period_multiple);
+        register_stream<DID_INS_1, &InertialSenseROS::INS1_callback>(DID_INS_1_.period_multiple);
         if (!startup)
             return;
     }
     if (DID_INS_2_.enabled && !ins2Streaming_)
     {
         ROS_INFO("Attempting to enable INS2 data stream.");
-        SET_CALLBACK(DID_INS_2, ins_2_t, INS2_callback, DID_INS_2_.period_multiple);
+        register_stream<DID_INS_2, &InertialSenseROS::INS2_callback>(DID_INS_2_.period_multiple);
         if (!startup)
             return;
     }
     if (DID_INS_4_.enabled && !ins4Streaming_)
     {
         ROS_INFO("Attempting to enable INS4 data stream.");
-        SET_CALLBACK(DID_INS_4, ins_4_t, INS4_callback, DID_INS_4_.period_multiple);
+        register_stream<DID_INS_4, &InertialSenseROS::INS4_callback>(DID_INS_4_.period_multiple);
         if (!startup)
             return;
     }
 
     bool covarianceConfiged = (covariance_enabled_ && insCovarianceStreaming_) || !covariance_enabled_;
 
-    if (odom_ins_ned_.enabled && !(ins4Streaming_ && imuStreaming_ && covarianceConfiged))
+    if (ned_state_needed() && !(ins4Streaming_ && imuStreaming_ && covarianceConfiged))
     {
         ROS_INFO("Attempting to enable odom INS NED data stream.");
 
-        SET_CALLBACK(DID_INS_4, ins_4_t, INS4_callback, DID_INS_4_.period_multiple); // Need NED
+        register_stream<DID_INS_4, &InertialSenseROS::INS4_callback>(DID_INS_4_.period_multiple); // Need NED
         if (covariance_enabled_)
-            SET_CALLBACK(DID_ROS_COVARIANCE_POSE_TWIST, ros_covariance_pose_twist_t, INS_covariance_callback, 200); // Need Covariance data
-        SET_CALLBACK(DID_PIMU, pimu_t, preint_IMU_callback, preint_IMU_.period_multiple);                           // Need angular rate data from IMU
+            register_stream<DID_ROS_COVARIANCE_POSE_TWIST, &InertialSenseROS::INS_covariance_callback>(200); // Need Covariance data
+        register_stream<DID_PIMU, &InertialSenseROS::preint_IMU_callback>(preint_IMU_.period_multiple);                           // Need angular rate data from IMU
         IMU_.enabled = true;
         // Create Identity Matrix
         //
@@ -314,13 +693,25 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
         ;
     }
 
+    // The compact state needs the angular rate but not the imu topic
+    if (ins_state_.enabled && !(ins4Streaming_ && pimuStreaming_ && covarianceConfiged))
+    {
+        ROS_INFO("Attempting to enable INS state data stream.");
+        register_stream<DID_INS_4, &InertialSenseROS::INS4_callback>(DID_INS_4_.period_multiple);
+        if (covariance_enabled_)
+            register_stream<DID_ROS_COVARIANCE_POSE_TWIST, &InertialSenseROS::INS_covariance_callback>(200);
+        register_stream<DID_PIMU, &InertialSenseROS::preint_IMU_callback>(preint_IMU_.period_multiple);
+        if (!startup)
+            return;
+    }
+
     if (odom_ins_ecef_.enabled && !(ins4Streaming_ && imuStreaming_ && covarianceConfiged))
     {
         ROS_INFO("Attempting to enable odom INS ECEF data stream.");
-        SET_CALLBACK(DID_INS_4, ins_4_t, INS4_callback, DID_INS_4_.period_multiple); // Need quaternion and ecef
+        register_stream<DID_INS_4, &InertialSenseROS::INS4_callback>(DID_INS_4_.period_multiple); // Need quaternion and ecef
         if (covariance_enabled_)
-            SET_CALLBACK(DID_ROS_COVARIANCE_POSE_TWIST, ros_covariance_pose_twist_t, INS_covariance_callback, 200); // Need Covariance data
-        SET_CALLBACK(DID_PIMU, pimu_t, preint_IMU_callback, preint_IMU_.period_multiple);                           // Need angular rate data from IMU
+            register_stream<DID_ROS_COVARIANCE_POSE_TWIST, &InertialSenseROS::INS_covariance_callback>(200); // Need Covariance data
+        register_stream<DID_PIMU, &InertialSenseROS::preint_IMU_callback>(preint_IMU_.period_multiple);                           // Need angular rate data from IMU
         IMU_.enabled = true;
         // Create Identity Matrix
         //
@@ -347,10 +738,10 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
     if (odom_ins_enu_.enabled && !(ins4Streaming_ && imuStreaming_ && covarianceConfiged))
     {
         ROS_INFO("Attempting to enable odom INS ENU data stream.");
-        SET_CALLBACK(DID_INS_4, ins_4_t, INS4_callback, DID_INS_4_.period_multiple); // Need ENU
+        register_stream<DID_INS_4, &InertialSenseROS::INS4_callback>(DID_INS_4_.period_multiple); // Need ENU
         if (covariance_enabled_)
-            SET_CALLBACK(DID_ROS_COVARIANCE_POSE_TWIST, ros_covariance_pose_twist_t, INS_covariance_callback, 200); // Need Covariance data
-        SET_CALLBACK(DID_PIMU, pimu_t, preint_IMU_callback, preint_IMU_.period_multiple);                           // Need angular rate data from IMU
+            register_stream<DID_ROS_COVARIANCE_POSE_TWIST, &InertialSenseROS::INS_covariance_callback>(200); // Need Covariance data
+        register_stream<DID_PIMU, &InertialSenseROS::preint_IMU_callback>(preint_IMU_.period_multiple);                           // Need angular rate data from IMU
         IMU_.enabled = true;
         // Create Identity Matrix
         //
@@ -377,7 +768,7 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
     if (NavSatFix_.enabled && !NavSatFixConfigured)
     {
         ROS_INFO("Attempting to enable NavSatFix.");
-        NavSatFix_.pub = nh_.advertise<sensor_msgs::NavSatFix>("NavSatFix", 1);
+        NavSatFix_.pub = advertise<sensor_msgs::NavSatFix>(NavSatFix_, "NavSatFix");
 
         // Satellite system constellation used in GNSS solution.  (see eGnssSatSigConst) 0x0003=GPS, 0x000C=QZSS, 0x0030=Galileo, 0x00C0=Beidou, 0x0300=GLONASS, 0x1000=SBAS
         uint16_t gnssSatSigConst = IS_.GetFlashConfig().gnssSatSigConst;
@@ -407,27 +798,27 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
     if (INL2_states_.enabled && !inl2StatesStreaming_)
     {
         ROS_INFO("Attempting to enable INS2 States data stream.");
-        SET_CALLBACK(DID_INL2_STATES, inl2_states_t, INL2_states_callback, INL2_states_.period_multiple);
+        register_stream<DID_INL2_STATES, &InertialSenseROS::INL2_states_callback>(INL2_states_.period_multiple);
         if (!startup)
             return;
     }
 
     if (GPS1_.enabled)
     {
-        GPS1_.pub = nh_.advertise<inertial_sense_ros::GPS>(gps1_topic_, 1);
+        GPS1_.pub = advertise<inertial_sense_ros::GPS>(GPS1_, gps1_topic_);
 
         // Set up the GPS ROS stream - we always need GPS information for time sync, just don't always need to publish it
         if (!gps1PosStreaming_)
         {
             ROS_INFO("Attempting to enable GPS1 Pos data stream.");
-            SET_CALLBACK(DID_GPS1_POS, gps_pos_t, GPS_pos_callback, GPS1_.period_multiple); // we always need GPS for Fix status
+            register_stream<DID_GPS1_POS, &InertialSenseROS::GPS_pos_callback>(GPS1_.period_multiple); // we always need GPS for Fix status
             if (!startup)
                 return;
         }
         if (!gps1VelStreaming_)
         {
             ROS_INFO("Attempting to enable GPS1 Vel data stream.");
-            SET_CALLBACK(DID_GPS1_VEL, gps_vel_t, GPS_vel_callback, GPS1_.period_multiple); // we always need GPS for Fix status
+            register_stream<DID_GPS1_VEL, &InertialSenseROS::GPS_vel_callback>(GPS1_.period_multiple); // we always need GPS for Fix status
             if (!startup)
                 return;
         }
@@ -436,14 +827,14 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
         if (GPS1_raw_.enabled && !gps1RawStreaming_)
         {
             ROS_INFO("Attempting to enable GPS1 RAW data stream.");
-            GPS1_raw_.pub = nh_.advertise<inertial_sense_ros::GNSSObsVec>(gps1_topic_ + "/obs", 50);
-            GPS1_raw_.pub2 = nh_.advertise<inertial_sense_ros::GNSSEphemeris>(gps1_topic_ + "/eph", 50);
-            GPS1_raw_.pub3 = nh_.advertise<inertial_sense_ros::GlonassEphemeris>(gps1_topic_ + "/geph", 50);
-            SET_CALLBACK(DID_GPS1_RAW, gps_raw_t, GPS_raw_callback, gps_raw_period_multiple);
-            GPS_base_raw_.pub = nh_.advertise<inertial_sense_ros::GlonassEphemeris>("/base_geph", 50);
-            GPS_base_raw_.pub2 = nh_.advertise<inertial_sense_ros::GNSSEphemeris>(gps1_topic_ + "/base_eph", 50);
-            GPS_base_raw_.pub3 = nh_.advertise<inertial_sense_ros::GlonassEphemeris>(gps1_topic_ + "/base_geph", 50);
-            SET_CALLBACK(DID_GPS_BASE_RAW, gps_raw_t, GPS_raw_callback, gps_raw_period_multiple);
+            GPS1_raw_.pub = advertise<inertial_sense_ros::GNSSObsVec>(GPS1_raw_, gps1_topic_ + "/obs");
+            GPS1_raw_.pub2 = advertise<inertial_sense_ros::GNSSEphemeris>(GPS1_raw_, gps1_topic_ + "/eph");
+            GPS1_raw_.pub3 = advertise<inertial_sense_ros::GlonassEphemeris>(GPS1_raw_, gps1_topic_ + "/geph");
+            register_stream<DID_GPS1_RAW, &InertialSenseROS::GPS_raw_callback>(gps_raw_period_multiple);
+            GPS_base_raw_.pub = advertise<inertial_sense_ros::GlonassEphemeris>(GPS_base_raw_, "/base_geph");
+            GPS_base_raw_.pub2 = advertise<inertial_sense_ros::GNSSEphemeris>(GPS_base_raw_, gps1_topic_ + "/base_eph");
+            GPS_base_raw_.pub3 = advertise<inertial_sense_ros::GlonassEphemeris>(GPS_base_raw_, gps1_topic_ + "/base_geph");
+            register_stream<DID_GPS_BASE_RAW, &InertialSenseROS::GPS_raw_callback>(gps_raw_period_multiple);
             obs_bundle_timer_ = nh_.createTimer(ros::Duration(0.001), InertialSenseROS::GPS_obs_bundle_timer_callback, this);
             if (!startup)
                 return;
@@ -453,7 +844,7 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
         if (GPS1_info_.enabled && !gps1InfoStreaming_)
         {
             ROS_INFO("Attempting to enable GPS1 Info data stream.");
-            SET_CALLBACK(DID_GPS1_SAT, gps_sat_t, GPS_info_callback, gps_info_period_multiple);
+            register_stream<DID_GPS1_SAT, &InertialSenseROS::GPS_info_callback>(gps_info_period_multiple);
             if (!startup)
                 return;
         }
@@ -462,20 +853,20 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
     // we only publish the second GPS is dual_GNSS (compassing) is disabled
     if (GPS2_.enabled)
     {
-        GPS2_.pub = nh_.advertise<inertial_sense_ros::GPS>(gps2_topic_, 1);
+        GPS2_.pub = advertise<inertial_sense_ros::GPS>(GPS2_, gps2_topic_);
 
         // Set up the GPS ROS stream - we always need GPS information for time sync, just don't always need to publish it
         if (!gps2PosStreaming_)
         {
             ROS_INFO("Attempting to enable GPS2 Pos data stream.");
-            SET_CALLBACK(DID_GPS2_POS, gps_pos_t, GPS_pos_callback, GPS2_.period_multiple); // we always need GPS for Fix status
+            register_stream<DID_GPS2_POS, &InertialSenseROS::GPS_pos_callback>(GPS2_.period_multiple); // we always need GPS for Fix status
             if (!startup)
                 return;
         }
         if (!gps2VelStreaming_)
         {
             ROS_INFO("Attempting to enable GPS2 Vel data stream.");
-            SET_CALLBACK(DID_GPS2_VEL, gps_vel_t, GPS_vel_callback, GPS2_.period_multiple); // we always need GPS for Fix status
+            register_stream<DID_GPS2_VEL, &InertialSenseROS::GPS_vel_callback>(GPS2_.period_multiple); // we always need GPS for Fix status
             if (!startup)
                 return;
         }
@@ -484,14 +875,14 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
         if (GPS2_raw_.enabled && !gps2RawStreaming_)
         {
             ROS_INFO("Attempting to enable GPS2 Obs data stream.");
-            GPS2_raw_.pub = nh_.advertise<inertial_sense_ros::GNSSObsVec>(gps2_topic_ + "/obs", 50);
-            GPS2_raw_.pub2 = nh_.advertise<inertial_sense_ros::GNSSEphemeris>(gps2_topic_ + "/eph", 50);
-            GPS2_raw_.pub3 = nh_.advertise<inertial_sense_ros::GlonassEphemeris>(gps2_topic_ + "/geph", 50);
-            SET_CALLBACK(DID_GPS2_RAW, gps_raw_t, GPS_raw_callback, gps_raw_period_multiple);
-            GPS_base_raw_.pub = nh_.advertise<inertial_sense_ros::GlonassEphemeris>("/base_geph", 50);
-            GPS_base_raw_.pub2 = nh_.advertise<inertial_sense_ros::GNSSEphemeris>(gps1_topic_ + "/base_eph", 50);
-            GPS_base_raw_.pub3 = nh_.advertise<inertial_sense_ros::GlonassEphemeris>(gps1_topic_ + "/base_geph", 50);
-            SET_CALLBACK(DID_GPS_BASE_RAW, gps_raw_t, GPS_raw_callback, gps_raw_period_multiple);
+            GPS2_raw_.pub = advertise<inertial_sense_ros::GNSSObsVec>(GPS2_raw_, gps2_topic_ + "/obs");
+            GPS2_raw_.pub2 = advertise<inertial_sense_ros::GNSSEphemeris>(GPS2_raw_, gps2_topic_ + "/eph");
+            GPS2_raw_.pub3 = advertise<inertial_sense_ros::GlonassEphemeris>(GPS2_raw_, gps2_topic_ + "/geph");
+            register_stream<DID_GPS2_RAW, &InertialSenseROS::GPS_raw_callback>(gps_raw_period_multiple);
+            GPS_base_raw_.pub = advertise<inertial_sense_ros::GlonassEphemeris>(GPS_base_raw_, "/base_geph");
+            GPS_base_raw_.pub2 = advertise<inertial_sense_ros::GNSSEphemeris>(GPS_base_raw_, gps1_topic_ + "/base_eph");
+            GPS_base_raw_.pub3 = advertise<inertial_sense_ros::GlonassEphemeris>(GPS_base_raw_, gps1_topic_ + "/base_geph");
+            register_stream<DID_GPS_BASE_RAW, &InertialSenseROS::GPS_raw_callback>(gps_raw_period_multiple);
             obs_bundle_timer_ = nh_.createTimer(ros::Duration(0.001), InertialSenseROS::GPS_obs_bundle_timer_callback, this);
             if (!startup)
                 return;
@@ -501,7 +892,7 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
         if (GPS2_info_.enabled && !gps2InfoStreaming_)
         {
             ROS_INFO("Attempting to enable GPS Info data stream.");
-            SET_CALLBACK(DID_GPS2_SAT, gps_sat_t, GPS_info_callback, gps_info_period_multiple);
+            register_stream<DID_GPS2_SAT, &InertialSenseROS::GPS_info_callback>(gps_info_period_multiple);
             if (!startup)
                 return;
         }
@@ -511,7 +902,7 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
     if (mag_.enabled && !magStreaming_)
     {
         ROS_INFO("Attempting to enable Mag data stream.");
-        SET_CALLBACK(DID_MAGNETOMETER, magnetometer_t, mag_callback, mag_.period_multiple);
+        register_stream<DID_MAGNETOMETER, &InertialSenseROS::mag_callback>(mag_.period_multiple);
         if (!startup)
             return;
     }
@@ -520,7 +911,7 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
     if (baro_.enabled && !baroStreaming_)
     {
         ROS_INFO("Attempting to enable baro data stream.");
-        SET_CALLBACK(DID_BAROMETER, barometer_t, baro_callback, baro_.period_multiple);
+        register_stream<DID_BAROMETER, &InertialSenseROS::baro_callback>(baro_.period_multiple);
         if (!startup)
             return;
     }
@@ -529,17 +920,34 @@ void InertialSenseROS::configure_data_streams(bool startup) // if startup is tru
     if (preint_IMU_.enabled && !preintImuStreaming_)
     {
         ROS_INFO("Attempting to enable preint IMU data stream.");
-        SET_CALLBACK(DID_PIMU, pimu_t, preint_IMU_callback, preint_IMU_.period_multiple);
+        register_stream<DID_PIMU, &InertialSenseROS::preint_IMU_callback>(preint_IMU_.period_multiple);
         if (!startup)
             return;
     }
     if (IMU_.enabled && !imuStreaming_)
     {
         ROS_INFO("Attempting to enable IMU data stream.");
-        SET_CALLBACK(DID_PIMU, pimu_t, preint_IMU_callback, IMU_.period_multiple);
+        register_stream<DID_PIMU, &InertialSenseROS::preint_IMU_callback>(IMU_.period_multiple);
         if (!startup)
             return;
     }
+
+    // Data sets only recorded on the raw topic have no handler and are never decoded
+    if (isb_raw_.enabled)
+    {
+        for (std::vector<int>::iterator it = isb_raw_dids_.begin(); it != isb_raw_dids_.end();)
+        {
+            // From a parameter, so dropped with a warning unless the SDK knows the data set
+            if (*it <= DID_NULL || *it >= DID_COUNT || cISDataMappings::GetSize(*it) == 0)
+            {
+                ROS_WARN("isb_raw_dids: %d is not a known data set id, ignored", *it);
+                it = isb_raw_dids_.erase(it);
+                continue;
+            }
+            request_stream((eDataIDs)*it, cISDataMappings::GetSize(*it), isb_raw_.period_multiple);
+            ++it;
+        }
+    }
     if (!startup)
     {
         data_streams_enabled_ = true;
@@ -557,6 +965,56 @@ void InertialSenseROS::start_log()
     IS_.SetLoggerEnabled(true, filename, cISLogger::LOGTYPE_DAT, RMC_PRESET_PPD_GROUND_VEHICLE);
 }
 
+bool InertialSenseROS::load_device_cache()
+{
+    if (!device_cache_enabled_)
+        return false;
+
+    device_cache_ = DeviceCache(device_cache_dir_);
+
+    dev_info_t dev_info = IS_.GetDeviceInfo();
+    if (!device_cache_.load(dev_info.serialNumber, dev_info.firmwareVer))
+    {
+        ROS_INFO("No device cache for uINS %d, performing full configuration.", dev_info.serialNumber);
+        return false;
+    }
+
+    // Flash configuration changed by someone else since the cache was written
+    nvm_flash_cfg_t flash_cfg = IS_.GetFlashConfig();
+    if (memcmp(&flash_cfg, &device_cache_.flash_cfg, sizeof(nvm_flash_cfg_t)) != 0)
+    {
+        ROS_INFO("Device cache of uINS %d is stale, performing full configuration.", dev_info.serialNumber);
+        return false;
+    }
+
+    // The reference LLA is known without waiting for DID_FLASH_CONFIG, so INS4 can be published from the first packet
+    if (!config_flash_parameters_)
+        memcpy(refLla_, device_cache_.flash_cfg.refLla, sizeof(refLla_));
+    refLLA_known = true;
+    core_.set_ref_lla(refLla_);
+
+    core_.time_sync.gps_week = device_cache_.gps_week;
+    core_.time_sync.local_offset = device_cache_.ins_local_offset;
+    core_.time_sync.got_first_message = true;
+    core_.time_sync.seeded = true;
+
+    ROS_INFO("Loaded device cache %s", device_cache_.filename().c_str());
+    return true;
+}
+
+void InertialSenseROS::save_device_cache()
+{
+    if (!device_cache_enabled_ || !initialized_)
+        return;
+
+    device_cache_.flash_cfg = IS_.GetFlashConfig();
+    device_cache_.streams = active_streams_;
+    device_cache_.gps_week = core_.time_sync.gps_week;
+    device_cache_.ins_local_offset = core_.time_sync.local_offset;
+    if (!device_cache_.save())
+        ROS_WARN("Unable to write device cache %s", device_cache_.filename().c_str());
+}
+
 void InertialSenseROS::configure_ascii_output()
 {
     //  ascii_msgs_t msgs = {};
@@ -572,19 +1030,495 @@ void InertialSenseROS::configure_ascii_output()
 void InertialSenseROS::connect()
 {
     /// Connect to the uINS
+    // A previously negotiated rate is used for as long as the device on the port answers at it
+    int negotiated = negotiate_baudrate_ ? DeviceCache::load_port_baudrate(device_cache_dir_, port_) : 0;
+    if (negotiated > 0 && negotiated != baudrate_)
+    {
+        int configured = baudrate_;
+        baudrate_ = negotiated;
+        ROS_INFO("Connecting to serial port \"%s\", at negotiated %d baud", port_.c_str(), baudrate_);
+        if (open_port())
+        {
+            if (device_responding(1.0))
+            {
+                ROS_INFO("Connected to uINS %d on \"%s\", at %d baud", IS_.GetDeviceInfo().serialNumber, port_.c_str(), baudrate_);
+                return;
+            }
+            IS_.Close();
+        }
+        baudrate_ = configured;
+    }
+
     ROS_INFO("Connecting to serial port \"%s\", at %d baud", port_.c_str(), baudrate_);
+    double backoff = reconnect_backoff_min_;
+    while (!open_port())
+    {
+        ROS_ERROR("inertialsense: Unable to open serial port \"%s\", at %d baud, retrying in %.1f s", port_.c_str(), baudrate_, backoff);
+        ros::WallDuration(backoff).sleep();
+        if (!ros::ok())
+        {
+            ROS_FATAL("inertialsense: Unable to open serial port \"%s\", at %d baud", port_.c_str(), baudrate_);
+            exit(0);
+        }
+        backoff = std::min(2.0 * backoff, reconnect_backoff_max_);
+    }
+
+    // Print if Successful
+    ROS_INFO("Connected to uINS %d on \"%s\", at %d baud", IS_.GetDeviceInfo().serialNumber, port_.c_str(), baudrate_);
+}
+
+bool InertialSenseROS::open_port()
+{
     if (!IS_.Open(port_.c_str(), baudrate_))
+        return false;
+
+    // Settings of the tty are lost when the device re-enumerates, apply them on every open
+    std::string error;
+    if (!serial_tuning_.apply_to_port(port_, error))
+        ROS_WARN("Unable to tune serial port \"%s\": %s", port_.c_str(), error.c_str());
+    return true;
+}
+
+bool InertialSenseROS::device_responding(double timeout)
+{
+    // Device info is requested by Open(), the device answers if the baud rate matches
+    ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(timeout);
+    while (ros::WallTime::now() < deadline)
     {
-        ROS_FATAL("inertialsense: Unable to open serial port \"%s\", at %d baud", port_.c_str(), baudrate_);
-        exit(0);
+        read_device();
+        if (IS_.GetDeviceInfo().serialNumber != 0)
+            return true;
+        ros::WallDuration(0.01).sleep();
     }
-    else
+    return false;
+}
+
+void InertialSenseROS::negotiate_baudrate()
+{
+    if (!negotiate_baudrate_)
+        return;
+
+    // Readbacks of the flash configuration are the test traffic
+    register_stream<DID_FLASH_CONFIG, &InertialSenseROS::flash_config_callback>(0);
+
+    std::vector<int> candidates = baudrate_candidates_;
+    std::sort(candidates.rbegin(), candidates.rend());
+    int initial = baudrate_;
+
+    int working = baudrate_;
+    bool working_stable = test_link(link_test_round_trips_);
+    ROS_INFO("Negotiating baud rate, %d baud is %s", working, working_stable ? "stable" : "not stable");
+
+    // Candidates only change the rate the uINS runs at, until one passes the link test its
+    // saved rate is untouched, so a uINS lost at an unusable rate comes back at it after a reset
+    bool lost = false;
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        int candidate = candidates[i];
+        // A stable rate is only replaced by a faster one, an unstable one by a slower one
+        if (candidate == working || (working_stable && candidate < working) || (!working_stable && candidate > working))
+            continue;
+
+        ROS_INFO("Trying %d baud", candidate);
+        if (switch_baudrate(candidate) && test_link(link_test_round_trips_))
+        {
+            working = candidate;
+            working_stable = true;
+            break;
+        }
+
+        ROS_WARN("%d baud is not stable, returning to %d baud", candidate, working);
+        if (!switch_baudrate(working))
+        {
+            ROS_ERROR("uINS did not confirm the return to %d baud, it returns to its saved baud rate when reset", working);
+            lost = true;
+            break;
+        }
+    }
+    if (lost)
+        return;
+
+    ROS_INFO("Using %d baud", working);
+    if (working != initial)
+        save_device_baudrate();
+    link_supervisor_.data_received(ros::WallTime::now().toSec());
+    if (!DeviceCache::save_port_baudrate(device_cache_dir_, port_, working))
+        ROS_WARN("Unable to save the negotiated baud rate to %s", device_cache_dir_.c_str());
+}
+
+bool InertialSenseROS::switch_baudrate(int baudrate)
+{
+    uint32_t offset = (device_serial_port_ == 1) ? offsetof(nvm_flash_cfg_t, ser1BaudRate) : offsetof(nvm_flash_cfg_t, ser0BaudRate);
+    uint32_t rate = baudrate;
+
+    // The uINS reconfigures its port once the write is applied, so the rest of the exchange happens at the new rate.
+    // The write only changes its working copy of the flash configuration, save_device_baudrate() keeps it.
+    IS_.SendData(DID_FLASH_CONFIG, reinterpret_cast<uint8_t *>(&rate), sizeof(rate), offset);
+    ros::WallDuration(0.2).sleep();
+    IS_.Close();
+    baudrate_ = baudrate;
+    if (!open_port())
+        return false;
+
+    return await_device_command(await_device_data(DID_FLASH_CONFIG, [rate, offset](const p_data_t *data)
+    {
+        return data->hdr.offset <= offset && offset + sizeof(rate) <= data->hdr.offset + data->hdr.size &&
+               memcmp(data->buf + offset - data->hdr.offset, &rate, sizeof(rate)) == 0;
+    }, device_command_timeout_, true));
+}
+
+void InertialSenseROS::save_device_baudrate()
+{
+    system_command_t save_command;
+    save_command.command = 97; // SYS_CMD_SAVE_FLASH
+    save_command.invCommand = ~save_command.command;
+    IS_.SendData(DID_SYS_CMD, reinterpret_cast<uint8_t *>(&save_command), sizeof(system_command_t), 0);
+}
+
+bool InertialSenseROS::test_link(int roundTrips)
+{
+    // Every answer is a checksummed packet of several hundred bytes, a corrupted or lost one fails the test
+    for (int i = 0; i < roundTrips; i++)
+    {
+        std::shared_future<bool> readback = await_device_data(DID_FLASH_CONFIG, [](const p_data_t *data) { return true; }, 0.5);
+        comManagerGetData(0, DID_FLASH_CONFIG, 0, 0, 0);
+        if (!await_device_command(readback))
+            return false;
+    }
+    return true;
+}
+
+void InertialSenseROS::start_link_supervisor()
+{
+    link_supervisor_ = ReconnectSupervisor(port_, link_timeout_, reconnect_backoff_min_, reconnect_backoff_max_);
+    link_supervisor_.set_handlers(
+        [this]()
+        {
+            return open_port();
+        },
+        [this](const std::string &reason)
+        {
+            ROS_WARN("Lost uINS on \"%s\" (%s), reconnecting...", port_.c_str(), reason.c_str());
+            IS_.Close();
+        },
+        std::bind(&InertialSenseROS::resume_data_streams, this));
+    link_supervisor_timer_ = nh_.createTimer(ros::Duration(0.25), &InertialSenseROS::link_supervisor_timer_callback, this);
+}
+
+void InertialSenseROS::link_supervisor_timer_callback(const ros::TimerEvent &event)
+{
+    link_supervisor_.update(ros::WallTime::now().toSec());
+}
+
+void InertialSenseROS::resume_data_streams()
+{
+    ROS_INFO("Reconnected to uINS %d after %.2f s, restoring %d data streams", IS_.GetDeviceInfo().serialNumber,
+             link_supervisor_.last_outage_duration(), (int)active_streams_.size());
+
+    // Request the previously active broadcast set again
+    for (DeviceCache::stream_set_t::const_iterator it = active_streams_.begin(); it != active_streams_.end(); ++it)
+    {
+        IS_.BroadcastBinaryData(it->first, it->second, dispatch_handler_);
+    }
+
+    // The uINS may have restarted while disconnected, confirm the time sync offset with the next message
+    core_.time_sync.seeded = core_.time_sync.got_first_message;
+}
+
+std::vector<InertialSenseROS::stream_params_t> InertialSenseROS::stream_params()
+{
+    // Navigation output is never shed.  Satellite info and raw GNSS data are the first to go.
+    const OverloadPolicy::priority_t HIGH = OverloadPolicy::PRIORITY_HIGH, NORMAL = OverloadPolicy::PRIORITY_NORMAL, LOW = OverloadPolicy::PRIORITY_LOW;
+    const OverloadPolicy::drop_t NEVER = OverloadPolicy::DROP_NEVER, LATEST = OverloadPolicy::DROP_LATEST, COALESCE = OverloadPolicy::DROP_COALESCE;
+    std::vector<stream_params_t> streams = {
+        {"ins1", &DID_INS_1_, {DID_INS_1}, HIGH, NEVER, 1},
+        {"ins2", &DID_INS_2_, {DID_INS_2}, HIGH, NEVER, 1},
+        {"ins4", &DID_INS_4_, {DID_INS_4}, HIGH, NEVER, 1},
+        {"odom_ins_ned", &odom_ins_ned_, {DID_INS_4}, HIGH, NEVER, 1},
+        {"odom_ins_enu", &odom_ins_enu_, {DID_INS_4}, HIGH, NEVER, 1},
+        {"odom_ins_ecef", &odom_ins_ecef_, {DID_INS_4}, HIGH, NEVER, 1},
+        {"ins_state", &ins_state_, {DID_INS_4}, HIGH, NEVER, 1},
+        {"imu", &IMU_, {DID_PIMU}, HIGH, NEVER, 1},
+        {"preint_imu", &preint_IMU_, {DID_PIMU}, HIGH, NEVER, 1},
+        {"INL2_states", &INL2_states_, {DID_INL2_STATES}, NORMAL, LATEST, 1},
+        {"gps1", &GPS1_, {DID_GPS1_POS, DID_GPS1_VEL}, NORMAL, LATEST, 1},
+        {"gps2", &GPS2_, {DID_GPS2_POS, DID_GPS2_VEL}, NORMAL, LATEST, 1},
+        {"NavSatFix", &NavSatFix_, {DID_GPS1_POS}, NORMAL, LATEST, 1},
+        {"mag", &mag_, {DID_MAGNETOMETER}, NORMAL, LATEST, 1},
+        {"baro", &baro_, {DID_BAROMETER}, NORMAL, LATEST, 1},
+        {"RTK_pos", &RTK_pos_, {DID_GPS1_RTK_POS_MISC, DID_GPS1_RTK_POS_REL}, NORMAL, LATEST, 10},
+        {"RTK_cmp", &RTK_cmp_, {DID_GPS2_RTK_CMP_MISC, DID_GPS2_RTK_CMP_REL}, NORMAL, LATEST, 10},
+        {"gps_info", &GPS1_info_, {DID_GPS1_SAT}, LOW, LATEST, 1},
+        {"gps_info", &GPS2_info_, {DID_GPS2_SAT}, LOW, LATEST, 1},
+        {"gps_raw", &GPS1_raw_, {DID_GPS1_RAW}, LOW, COALESCE, 50},
+        {"gps_raw", &GPS2_raw_, {DID_GPS2_RAW}, LOW, COALESCE, 50},
+        {"gps_raw", &GPS_base_raw_, {DID_GPS_BASE_RAW}, LOW, COALESCE, 50},
+        {"isb_raw", &isb_raw_, {}, HIGH, NEVER, 100},
+        {"diagnostics", &diagnostics_, {}, LOW, NEVER, 1},
+        {"did_stats", &did_stats_, {}, LOW, NEVER, 1},
+    };
+    return streams;
+}
+
+void InertialSenseROS::set_stream_defaults()
+{
+    std::vector<stream_params_t> streams = stream_params();
+    for (size_t i = 0; i < streams.size(); i++)
+    {
+        streams[i].stream->priority = streams[i].priority;
+        streams[i].stream->drop_policy = streams[i].drop_policy;
+        streams[i].stream->queue_size = streams[i].queue_size;
+        // Nagle's algorithm holds small messages back for up to 40 ms
+        streams[i].stream->tcp_nodelay = (streams[i].priority == OverloadPolicy::PRIORITY_HIGH);
+    }
+}
+
+void InertialSenseROS::set_overload_params(const stream_params_t &entry, const std::string &priority, const std::string &dropPolicy)
+{
+    if (!priority.empty() && !OverloadPolicy::parse_priority(priority, entry.stream->priority))
+        ROS_WARN("Unknown %s_priority \"%s\", expected high, normal or low", entry.name.c_str(), priority.c_str());
+    if (!dropPolicy.empty() && !OverloadPolicy::parse_drop(dropPolicy, entry.stream->drop_policy))
+        ROS_WARN("Unknown %s_drop_policy \"%s\", expected latest, coalesce or never", entry.name.c_str(), dropPolicy.c_str());
+}
+
+void InertialSenseROS::configure_overload_policy()
+{
+    // A data set feeding several streams gets the highest priority and the least lossy policy among them
+    std::map<uint32_t, std::pair<OverloadPolicy::priority_t, OverloadPolicy::drop_t>> policies;
+    std::vector<stream_params_t> streams = stream_params();
+    for (size_t i = 0; i < streams.size(); i++)
+    {
+        const ros_stream_t &stream = *streams[i].stream;
+        if (!stream.enabled)
+            continue;
+        for (size_t j = 0; j < streams[i].dids.size(); j++)
+        {
+            std::map<uint32_t, std::pair<OverloadPolicy::priority_t, OverloadPolicy::drop_t>>::iterator it = policies.find(streams[i].dids[j]);
+            if (it == policies.end())
+                policies[streams[i].dids[j]] = std::make_pair(stream.priority, stream.drop_policy);
+            else
+                it->second = std::make_pair(std::max(it->second.first, stream.priority), std::max(it->second.second, stream.drop_policy));
+        }
+    }
+    for (std::map<uint32_t, std::pair<OverloadPolicy::priority_t, OverloadPolicy::drop_t>>::const_iterator it = policies.begin(); it != policies.end(); ++it)
+        overload_.set_policy(it->first, it->second.first, it->second.second);
+}
+
+void InertialSenseROS::publish_transport_params()
+{
+    std::vector<stream_params_t> streams = stream_params();
+    for (size_t i = 0; i < streams.size(); i++)
+    {
+        if (streams[i].stream->enabled)
+        {
+            nh_private_.setParam(streams[i].name + "_tcp_nodelay", streams[i].stream->tcp_nodelay);
+            nh_private_.setParam(streams[i].name + "_udp", streams[i].stream->udp);
+        }
+    }
+}
+
+void InertialSenseROS::add_overload_diagnostics(diagnostic_msgs::DiagnosticArray &diag_array)
+{
+    diagnostic_msgs::DiagnosticStatus overload_status;
+    overload_status.name = "Overload";
+    static const char *messages[] = {"Keeping up", "Shedding low priority streams", "Shedding low and normal priority streams"};
+    overload_status.level = overload_.level() ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+    overload_status.message = messages[overload_.level()];
+
+    diagnostic_msgs::KeyValue kv;
+    kv.key = "Utilization (%)";
+    kv.value = std::to_string(100.0 * overload_.utilization());
+    overload_status.values.push_back(kv);
+    kv.key = "Level Changes";
+    kv.value = std::to_string(overload_.level_changes());
+    overload_status.values.push_back(kv);
+    kv.key = "Skipped Timer Runs";
+    kv.value = std::to_string(overload_.skipped_runs());
+    overload_status.values.push_back(kv);
+
+    const OverloadPolicy::stream_map_t &streams = overload_.streams();
+    for (OverloadPolicy::stream_map_t::const_iterator it = streams.begin(); it != streams.end(); ++it)
+    {
+        const OverloadPolicy::stream_t &stream = it->second;
+        if (!stream.deferred)
+            continue;
+        std::string name = cISDataMappings::GetDataSetName(it->first);
+        kv.key = name + " Deferred";
+        kv.value = std::to_string(stream.deferred);
+        overload_status.values.push_back(kv);
+        kv.key = name + " Dropped";
+        kv.value = std::to_string(stream.dropped);
+        overload_status.values.push_back(kv);
+        kv.key = name + " Flushed";
+        kv.value = std::to_string(stream.flushed);
+        overload_status.values.push_back(kv);
+    }
+    diag_array.status.push_back(overload_status);
+}
+
+void InertialSenseROS::start_shm_output()
+{
+    if (!shm_enabled_)
+        return;
+    if (shm_slots_ < 2)
+    {
+        ROS_WARN("shared_memory_slots must be at least 2, using 2");
+        shm_slots_ = 2;
+    }
+    if (!shm_writer_.open(shm_name_, shm_slots_))
+    {
+        ROS_ERROR("Unable to create shared memory \"%s\": %s", shm_name_.c_str(), strerror(errno));
+        return;
+    }
+    ROS_INFO("Writing INS and IMU states to shared memory \"%s\"", shm_name_.c_str());
+}
+
+void InertialSenseROS::write_shm_ins(const ins_odometry_t &odom)
+{
+    shm_ins_state_t state;
+    state.stamp = odom.stamp.to_sec();
+    state.host_time = ros::WallTime::now().toSec();
+    for (int i = 0; i < 3; i++)
+    {
+        state.position[i] = odom.position[i];
+        state.linear_velocity[i] = odom.linear_velocity[i];
+        state.angular_velocity[i] = odom.angular_velocity[i];
+        state.ref_lla[i] = refLla_[i];
+    }
+    for (int i = 0; i < 4; i++)
+        state.orientation[i] = odom.orientation[i];
+    state.ins_status = last_ins_status_;
+    state.hdw_status = last_hdw_status_;
+    shm_writer_.write_ins(state);
+}
+
+void InertialSenseROS::start_udp_telemetry()
+{
+    if (!udp_telemetry_enabled_)
+        return;
+    std::string error;
+    if (!udp_telemetry_.open(udp_telemetry_address_, udp_telemetry_port_, udp_telemetry_ttl_, udp_telemetry_interface_, error))
+    {
+        ROS_ERROR("Unable to send UDP telemetry to %s:%d: %s", udp_telemetry_address_.c_str(), udp_telemetry_port_, error.c_str());
+        return;
+    }
+    udp_telemetry_.configure(udp_telemetry_rate_, udp_telemetry_batch_);
+    ROS_INFO("Sending UDP telemetry to %s:%d", udp_telemetry_address_.c_str(), udp_telemetry_port_);
+}
+
+void InertialSenseROS::send_udp_telemetry(const ins_odometry_t &odom)
+{
+    udp_ins_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.time = odom.stamp.to_sec();
+    const double *lla = core_.lla();
+    for (int i = 0; i < 3; i++)
+    {
+        record.lla[i] = lla[i];
+        record.vel_ned[i] = (float)odom.linear_velocity[i];
+    }
+    for (int i = 0; i < 4; i++)
+        record.qn2b[i] = (float)odom.orientation[i];
+    record.ins_status = last_ins_status_;
+    record.hdw_status = last_hdw_status_;
+    record.fix_type = gps1_fix_type_;
+    udp_telemetry_.add(record, ros::WallTime::now().toSec());
+}
+
+void InertialSenseROS::add_udp_telemetry_diagnostics(diagnostic_msgs::DiagnosticArray &diag_array)
+{
+    diagnostic_msgs::DiagnosticStatus udp_status;
+    udp_status.name = "UDP Telemetry";
+    udp_status.level = udp_telemetry_.send_errors() ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+    udp_status.message = udp_telemetry_address_ + ":" + std::to_string(udp_telemetry_port_);
+
+    diagnostic_msgs::KeyValue kv;
+    kv.key = "Records Sent";
+    kv.value = std::to_string(udp_telemetry_.records_sent());
+    udp_status.values.push_back(kv);
+    kv.key = "Datagrams Sent";
+    kv.value = std::to_string(udp_telemetry_.datagrams_sent());
+    udp_status.values.push_back(kv);
+    kv.key = "Send Errors";
+    kv.value = std::to_string(udp_telemetry_.send_errors());
+    udp_status.values.push_back(kv);
+    diag_array.status.push_back(udp_status);
+}
+
+void InertialSenseROS::start_stream_monitor()
+{
+    if (!stream_monitor_enabled_)
+        return;
+    stream_monitor_ = StreamMonitor(stream_stall_periods_, 1.0, 2.0);
+    stream_monitor_timer_ = nh_.createTimer(ros::Duration(0.25), &InertialSenseROS::stream_monitor_timer_callback, this);
+}
+
+void InertialSenseROS::stream_monitor_timer_callback(const ros::TimerEvent &event)
+{
+    // Streams are still being started, or the whole link is down and the link supervisor restores them
+    if (!data_streams_enabled_ || !link_supervisor_.connected())
+        return;
+
+    // Expected periods follow the planned streams, which change with period multiples and auto scaling
+    double now = ros::WallTime::now().toSec();
+    for (LinkBudget::stream_map_t::const_iterator it = link_budget_.streams().begin(); it != link_budget_.streams().end(); ++it)
+    {
+        double rate = active_streams_.count(it->first) ? link_budget_.planned_packet_rate(it->first, it->second) : 0.0;
+        stream_monitor_.watch(it->first, rate > 0.0 ? 1.0 / rate : 0.0, now);
+    }
+    // Streams turned off since, e.g. after a mag recalibration, are no longer in the plan
+    for (StreamMonitor::stream_map_t::const_iterator it = stream_monitor_.streams().begin(); it != stream_monitor_.streams().end(); ++it)
     {
-        // Print if Successful
-        ROS_INFO("Connected to uINS %d on \"%s\", at %d baud", IS_.GetDeviceInfo().serialNumber, port_.c_str(), baudrate_);
+        if (!active_streams_.count(it->first))
+            stream_monitor_.watch(it->first, 0.0, now);
+    }
+
+    std::vector<uint32_t> stalled = stream_monitor_.check(now);
+    for (size_t i = 0; i < stalled.size(); i++)
+    {
+        uint32_t DID = stalled[i];
+        const StreamMonitor::stream_t &stream = stream_monitor_.streams().at(DID);
+        ROS_WARN("%s stream silent for %.1f s, requesting it again", cISDataMappings::GetDataSetName(DID), now - stream.last_received);
+        IS_.BroadcastBinaryData(DID, active_streams_[DID], dispatch_handler_);
     }
 }
 
+void InertialSenseROS::add_stream_monitor_diagnostics(diagnostic_msgs::DiagnosticArray &diag_array)
+{
+    diagnostic_msgs::DiagnosticStatus liveness_status;
+    liveness_status.name = "Stream Liveness";
+    int stalled = stream_monitor_.stalled_count();
+    liveness_status.level = stalled ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+    liveness_status.message = stalled ? std::to_string(stalled) + " streams stalled" : "All streams alive";
+
+    // Only streams that had trouble, the rates of all of them are in "Data Streams"
+    const StreamMonitor::stream_map_t &streams = stream_monitor_.streams();
+    for (StreamMonitor::stream_map_t::const_iterator it = streams.begin(); it != streams.end(); ++it)
+    {
+        const StreamMonitor::stream_t &stream = it->second;
+        if (!stream.stalls && !stream.gaps && !stream.restarts)
+            continue;
+        std::string name = cISDataMappings::GetDataSetName(it->first);
+        diagnostic_msgs::KeyValue kv;
+        kv.key = name + " Stalls";
+        kv.value = std::to_string(stream.stalls);
+        liveness_status.values.push_back(kv);
+        kv.key = name + " Re-enables";
+        kv.value = std::to_string(stream.reenables);
+        liveness_status.values.push_back(kv);
+        kv.key = name + " Gaps";
+        kv.value = std::to_string(stream.gaps);
+        liveness_status.values.push_back(kv);
+        kv.key = name + " Missed";
+        kv.value = std::to_string(stream.missed);
+        liveness_status.values.push_back(kv);
+        kv.key = name + " Restarts";
+        kv.value = std::to_string(stream.restarts);
+        liveness_status.values.push_back(kv);
+    }
+    diag_array.status.push_back(liveness_status);
+}
+
 bool InertialSenseROS::firmware_compatiblity_check()
 {
     if (IS_.GetDeviceInfo().protocolVer[0] != PROTOCOL_VERSION_CHAR0 ||
@@ -605,49 +1539,76 @@ bool InertialSenseROS::firmware_compatiblity_check()
 
 void InertialSenseROS::configure_flash_parameters()
 {
-    bool reboot = false;
-    nvm_flash_cfg_t current_flash_cfg = IS_.GetFlashConfig();
-    // ROS_INFO("Configuring flash: \nCurrent: %i, \nDesired: %i\n", current_flash_cfg.ioConfig, ioConfig_);
+    FlashConfigPlanner planner(IS_.GetFlashConfig());
+    nvm_flash_cfg_t &desired = planner.desired();
 
-    if (current_flash_cfg.startupNavDtMs != navigation_dt_ms_)
+    // RTK configuration is always applied, the remaining parameters only if requested
+    desired.RTKCfgBits = rtk_cfg_bits_;
+    if (config_flash_parameters_)
+    {
+        desired.startupNavDtMs = navigation_dt_ms_;
+        memcpy(desired.insRotation, insRotation_, sizeof(insRotation_));
+        memcpy(desired.insOffset, insOffset_, sizeof(insOffset_));
+        memcpy(desired.gps1AntOffset, gps1AntOffset_, sizeof(gps1AntOffset_));
+        memcpy(desired.gps2AntOffset, gps2AntOffset_, sizeof(gps2AntOffset_));
+        memcpy(desired.refLla, refLla_, sizeof(refLla_));
+        desired.ioConfig = ioConfig_;
+        desired.gpsTimeUserDelay = gpsTimeUserDelay_;
+        desired.magDeclination = magDeclination_;
+        desired.insDynModel = insDynModel_;
+    }
+
+    if (planner.changes().empty())
+    {
+        ROS_INFO("Flash configuration up to date.");
+        return;
+    }
+
+    bool reboot = false;
+    if (planner.changed(offsetof(nvm_flash_cfg_t, startupNavDtMs), sizeof(desired.startupNavDtMs)))
     {
         reboot = true;
-        ROS_INFO("navigation rate change from %dms to %dms, resetting uINS to make change", current_flash_cfg.startupNavDtMs, navigation_dt_ms_);
+        ROS_INFO("navigation rate change from %dms to %dms, resetting uINS to make change", planner.current().startupNavDtMs, desired.startupNavDtMs);
     }
-    if (current_flash_cfg.ioConfig != ioConfig_)
+    if (planner.changed(offsetof(nvm_flash_cfg_t, ioConfig), sizeof(desired.ioConfig)))
     {
-        ROS_INFO("ioConfig change from %x to %x, resetting uINS to make change", current_flash_cfg.ioConfig, ioConfig_);
         reboot = true;
+        ROS_INFO("ioConfig change from %x to %x, resetting uINS to make change", planner.current().ioConfig, desired.ioConfig);
     }
 
-    if (current_flash_cfg.startupNavDtMs != navigation_dt_ms_ ||
-        current_flash_cfg.insRotation != insRotation_ ||
-        current_flash_cfg.insOffset != insOffset_ ||
-        current_flash_cfg.gps1AntOffset != gps1AntOffset_ ||
-        current_flash_cfg.gps2AntOffset != gps2AntOffset_ ||
-        current_flash_cfg.refLla != refLla_ ||
-        current_flash_cfg.insDynModel != insDynModel_ ||
-        current_flash_cfg.ioConfig != ioConfig_)
+    if (!write_flash_config(planner))
     {
-        current_flash_cfg.startupNavDtMs = navigation_dt_ms_;
-        memcpy(current_flash_cfg.insRotation, insRotation_, sizeof(insRotation_));
-        memcpy(current_flash_cfg.insOffset, insOffset_, sizeof(insOffset_));
-        memcpy(current_flash_cfg.gps1AntOffset, gps1AntOffset_, sizeof(gps1AntOffset_));
-        memcpy(current_flash_cfg.gps2AntOffset, gps2AntOffset_, sizeof(gps2AntOffset_));
-        memcpy(current_flash_cfg.refLla, refLla_, sizeof(refLla_));
-        current_flash_cfg.ioConfig = ioConfig_;
-        current_flash_cfg.gpsTimeUserDelay = gpsTimeUserDelay_;
-        current_flash_cfg.magDeclination = magDeclination_;
-        current_flash_cfg.insDynModel = insDynModel_;
+        ROS_ERROR("Unable to verify flash configuration written to uINS.");
+        return;
+    }
 
-        IS_.SendData(DID_FLASH_CONFIG, (uint8_t *)(&current_flash_cfg), sizeof(nvm_flash_cfg_t), 0);
+    if (reboot && reset_device())
+    {
+        restart_data_streams();
     }
+}
+
+bool InertialSenseROS::write_flash_config(const FlashConfigPlanner &planner)
+{
+    const nvm_flash_cfg_t &desired = planner.desired();
+    const std::vector<FlashConfigPlanner::range_t> &changes = planner.changes();
 
-    if (reboot)
+    // Write all changed ranges back-to-back, then confirm them with a single readback
+    for (const FlashConfigPlanner::range_t &range : changes)
     {
-        sleep(3);
-        reset_device();
+        // SendData only reads the buffer
+        uint8_t *data = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(&desired));
+        IS_.SendData(DID_FLASH_CONFIG, data + range.offset, range.size, range.offset);
     }
+    ROS_INFO("Wrote %d changed flash config range(s).", (int)changes.size());
+
+    std::shared_future<bool> result = await_device_data(DID_FLASH_CONFIG,
+                                                        [&planner](const p_data_t *data)
+                                                        {
+                                                            return planner.verify(data->buf, data->hdr.offset, data->hdr.size);
+                                                        },
+                                                        device_command_timeout_, true);
+    return await_device_command(result);
 }
 
 void InertialSenseROS::connect_rtk_client(const std::string &RTK_correction_protocol, const std::string &RTK_server_IP, const int RTK_server_port)
@@ -739,6 +1700,7 @@ void InertialSenseROS::rtk_connectivity_watchdog_timer_callback(const ros::Timer
     }
 
     int latest_byte_count = IS_.GetClientServerByteCount();
+    IS_PROBE2(rtk_watchdog, latest_byte_count, rtk_data_transmission_interruption_count_);
     if (rtk_traffic_total_byte_count_ == latest_byte_count)
     {
         ++rtk_data_transmission_interruption_count_;
@@ -746,6 +1708,7 @@ void InertialSenseROS::rtk_connectivity_watchdog_timer_callback(const ros::Timer
         if (rtk_data_transmission_interruption_count_ >= rtk_data_transmission_interruption_limit_)
         {
             ROS_WARN("RTK transmission interruption, reconnecting...");
+            IS_PROBE1(rtk_reconnect, rtk_data_transmission_interruption_count_);
 
             connect_rtk_client(RTK_correction_protocol_, RTK_server_IP_, RTK_server_port_);
         }
@@ -770,10 +1733,10 @@ void InertialSenseROS::configure_rtk()
             ROS_INFO("InertialSense: RTK Rover Configured.");
             connect_rtk_client(RTK_correction_protocol_, RTK_server_IP_, RTK_server_port_);
 
-            SET_CALLBACK(DID_GPS1_RTK_POS_MISC, gps_rtk_misc_t, RTK_Misc_callback, RTK_pos_.period_multiple);
-            SET_CALLBACK(DID_GPS1_RTK_POS_REL, gps_rtk_rel_t, RTK_Rel_callback, RTK_pos_.period_multiple);
-            RTK_pos_.pub = nh_.advertise<inertial_sense_ros::RTKInfo>("RTK/info", 10);
-            RTK_pos_.pub2 = nh_.advertise<inertial_sense_ros::RTKRel>("RTK/rel", 10);
+            register_stream<DID_GPS1_RTK_POS_MISC, &InertialSenseROS::RTK_Misc_callback>(RTK_pos_.period_multiple);
+            register_stream<DID_GPS1_RTK_POS_REL, &InertialSenseROS::RTK_Rel_callback>(RTK_pos_.period_multiple);
+            RTK_pos_.pub = advertise<inertial_sense_ros::RTKInfo>(RTK_pos_, "RTK/info");
+            RTK_pos_.pub2 = advertise<inertial_sense_ros::RTKRel>(RTK_pos_, "RTK/rel");
 
             start_rtk_connectivity_watchdog_timer();
         }
@@ -781,10 +1744,10 @@ void InertialSenseROS::configure_rtk()
         {
             RTK_cmp_.enabled = true;
             RTKCfgBits |= RTK_CFG_BITS_ROVER_MODE_RTK_COMPASSING_F9P;
-            SET_CALLBACK(DID_GPS2_RTK_CMP_MISC, gps_rtk_misc_t, RTK_Misc_callback, RTK_cmp_.period_multiple);
-            SET_CALLBACK(DID_GPS2_RTK_CMP_REL, gps_rtk_rel_t, RTK_Rel_callback, RTK_cmp_.period_multiple);
-            RTK_cmp_.pub = nh_.advertise<inertial_sense_ros::RTKInfo>("RTK/info", 10);
-            RTK_cmp_.pub2 = nh_.advertise<inertial_sense_ros::RTKRel>("RTK/rel", 10);
+            register_stream<DID_GPS2_RTK_CMP_MISC, &InertialSenseROS::RTK_Misc_callback>(RTK_cmp_.period_multiple);
+            register_stream<DID_GPS2_RTK_CMP_REL, &InertialSenseROS::RTK_Rel_callback>(RTK_cmp_.period_multiple);
+            RTK_cmp_.pub = advertise<inertial_sense_ros::RTKInfo>(RTK_cmp_, "RTK/info");
+            RTK_cmp_.pub2 = advertise<inertial_sense_ros::RTKRel>(RTK_cmp_, "RTK/rel");
             ROS_INFO("InertialSense: Dual GNSS (compassing) configured");
         }
         if (RTK_rover_radio_enable_)
@@ -795,10 +1758,10 @@ void InertialSenseROS::configure_rtk()
             RTK_base_serial_ = RTK_base_serial_ = false;
             ROS_INFO("InertialSense: Configured as RTK Rover with radio enabled");
             RTKCfgBits |= RTK_CFG_BITS_ROVER_MODE_RTK_POSITIONING_EXTERNAL;
-            SET_CALLBACK(DID_GPS1_RTK_POS_MISC, gps_rtk_misc_t, RTK_Misc_callback, RTK_pos_.period_multiple);
-            SET_CALLBACK(DID_GPS1_RTK_POS_REL, gps_rtk_rel_t, RTK_Rel_callback, RTK_pos_.period_multiple);
-            RTK_pos_.pub = nh_.advertise<inertial_sense_ros::RTKInfo>("RTK/info", 10);
-            RTK_pos_.pub2 = nh_.advertise<inertial_sense_ros::RTKRel>("RTK/rel", 10);
+            register_stream<DID_GPS1_RTK_POS_MISC, &InertialSenseROS::RTK_Misc_callback>(RTK_pos_.period_multiple);
+            register_stream<DID_GPS1_RTK_POS_REL, &InertialSenseROS::RTK_Rel_callback>(RTK_pos_.period_multiple);
+            RTK_pos_.pub = advertise<inertial_sense_ros::RTKInfo>(RTK_pos_, "RTK/info");
+            RTK_pos_.pub2 = advertise<inertial_sense_ros::RTKRel>(RTK_pos_, "RTK/rel");
         }
         if (RTK_base_USB_)
         {
@@ -815,7 +1778,7 @@ void InertialSenseROS::configure_rtk()
             start_rtk_server(RTK_server_IP_, RTK_server_port_);
         }
 
-        IS_.SendData(DID_FLASH_CONFIG, reinterpret_cast<uint8_t *>(&RTKCfgBits), sizeof(RTKCfgBits), offsetof(nvm_flash_cfg_t, RTKCfgBits));
+        rtk_cfg_bits_ = RTKCfgBits;
     }
 
     else
@@ -831,10 +1794,10 @@ void InertialSenseROS::configure_rtk()
             ROS_INFO("InertialSense: Configured as dual GNSS (compassing)");
 
             RTKCfgBits |= RTK_CFG_BITS_ROVER_MODE_RTK_COMPASSING;
-            SET_CALLBACK(DID_GPS2_RTK_CMP_MISC, gps_rtk_misc_t, RTK_Misc_callback, RTK_cmp_.period_multiple);
-            SET_CALLBACK(DID_GPS2_RTK_CMP_REL, gps_rtk_rel_t, RTK_Rel_callback, RTK_cmp_.period_multiple);
-            RTK_pos_.pub = nh_.advertise<inertial_sense_ros::RTKInfo>("RTK_cmp/info", 10);
-            RTK_pos_.pub2 = nh_.advertise<inertial_sense_ros::RTKRel>("RTK_cmp/rel", 10);
+            register_stream<DID_GPS2_RTK_CMP_MISC, &InertialSenseROS::RTK_Misc_callback>(RTK_cmp_.period_multiple);
+            register_stream<DID_GPS2_RTK_CMP_REL, &InertialSenseROS::RTK_Rel_callback>(RTK_cmp_.period_multiple);
+            RTK_pos_.pub = advertise<inertial_sense_ros::RTKInfo>(RTK_pos_, "RTK_cmp/info");
+            RTK_pos_.pub2 = advertise<inertial_sense_ros::RTKRel>(RTK_pos_, "RTK_cmp/rel");
         }
 
         if (RTK_rover_radio_enable_)
@@ -846,10 +1809,10 @@ void InertialSenseROS::configure_rtk()
 
             RTKCfgBits |= (gps1_type_ == "F9P" ? RTK_CFG_BITS_ROVER_MODE_RTK_POSITIONING_EXTERNAL : RTK_CFG_BITS_ROVER_MODE_RTK_POSITIONING);
 
-            SET_CALLBACK(DID_GPS1_RTK_POS_MISC, gps_rtk_misc_t, RTK_Misc_callback, RTK_pos_.period_multiple);
-            SET_CALLBACK(DID_GPS1_RTK_POS_REL, gps_rtk_rel_t, RTK_Rel_callback, RTK_pos_.period_multiple);
-            RTK_pos_.pub = nh_.advertise<inertial_sense_ros::RTKInfo>("RTK_pos/info", 10);
-            RTK_pos_.pub2 = nh_.advertise<inertial_sense_ros::RTKRel>("RTK_pos/rel", 10);
+            register_stream<DID_GPS1_RTK_POS_MISC, &InertialSenseROS::RTK_Misc_callback>(RTK_pos_.period_multiple);
+            register_stream<DID_GPS1_RTK_POS_REL, &InertialSenseROS::RTK_Rel_callback>(RTK_pos_.period_multiple);
+            RTK_pos_.pub = advertise<inertial_sense_ros::RTKInfo>(RTK_pos_, "RTK_pos/info");
+            RTK_pos_.pub2 = advertise<inertial_sense_ros::RTKRel>(RTK_pos_, "RTK_pos/rel");
         }
         else if (RTK_rover_)
         {
@@ -863,10 +1826,10 @@ void InertialSenseROS::configure_rtk()
 
             connect_rtk_client(RTK_correction_protocol_, RTK_server_IP_, RTK_server_port_);
 
-            SET_CALLBACK(DID_GPS1_RTK_POS_MISC, gps_rtk_misc_t, RTK_Misc_callback, RTK_pos_.period_multiple);
-            SET_CALLBACK(DID_GPS1_RTK_POS_REL, gps_rtk_rel_t, RTK_Rel_callback, RTK_pos_.period_multiple);
-            RTK_pos_.pub = nh_.advertise<inertial_sense_ros::RTKInfo>("RTK_pos/info", 10);
-            RTK_pos_.pub2 = nh_.advertise<inertial_sense_ros::RTKRel>("RTK_pos/rel", 10);
+            register_stream<DID_GPS1_RTK_POS_MISC, &InertialSenseROS::RTK_Misc_callback>(RTK_pos_.period_multiple);
+            register_stream<DID_GPS1_RTK_POS_REL, &InertialSenseROS::RTK_Rel_callback>(RTK_pos_.period_multiple);
+            RTK_pos_.pub = advertise<inertial_sense_ros::RTKInfo>(RTK_pos_, "RTK_pos/info");
+            RTK_pos_.pub2 = advertise<inertial_sense_ros::RTKRel>(RTK_pos_, "RTK_pos/rel");
 
             start_rtk_connectivity_watchdog_timer();
         }
@@ -880,9 +1843,9 @@ void InertialSenseROS::configure_rtk()
             if (RTK_base_TCP_)
                 start_rtk_server(RTK_server_IP_, RTK_server_port_);
         }
-        IS_.SendData(DID_FLASH_CONFIG, reinterpret_cast<uint8_t *>(&RTKCfgBits), sizeof(RTKCfgBits), offsetof(nvm_flash_cfg_t, RTKCfgBits));
+        rtk_cfg_bits_ = RTKCfgBits;
     }
-    printf("\n\nRTKCfgBits: %x\n", RTKCfgBits);
+    printf("\n\nRTKCfgBits: %x\n", rtk_cfg_bits_);
 }
 
 template <typename T>
@@ -912,6 +1875,7 @@ void InertialSenseROS::flash_config_callback(eDataIDs DID, const nvm_flash_cfg_t
     refLla_[1] = msg->refLla[1];
     refLla_[2] = msg->refLla[2];
     refLLA_known = true;
+    core_.set_ref_lla(refLla_);
     ROS_INFO("refLla was set");
 }
 
@@ -922,7 +1886,7 @@ void InertialSenseROS::INS1_callback(eDataIDs DID, const ins_1_t *const msg)
         ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
         if (DID_INS_1_.enabled)
         {
-            DID_INS_1_.pub = nh_.advertise<inertial_sense_ros::DID_INS1>("DID_INS_1", 1);
+            DID_INS_1_.pub = advertise<inertial_sense_ros::DID_INS1>(DID_INS_1_, "DID_INS_1");
         }
     }
 
@@ -932,23 +1896,8 @@ void InertialSenseROS::INS1_callback(eDataIDs DID, const ins_1_t *const msg)
     {
         did_ins_1_msg.header.stamp = ros_time_from_week_and_tow(msg->week, msg->timeOfWeek);
         did_ins_1_msg.header.frame_id = frame_id_;
-        did_ins_1_msg.week = msg->week;
-        did_ins_1_msg.timeOfWeek = msg->timeOfWeek;
-        did_ins_1_msg.insStatus = msg->insStatus;
-        did_ins_1_msg.hdwStatus = msg->hdwStatus;
-        did_ins_1_msg.theta[0] = msg->theta[0];
-        did_ins_1_msg.theta[1] = msg->theta[1];
-        did_ins_1_msg.theta[2] = msg->theta[2];
-        did_ins_1_msg.uvw[0] = msg->uvw[0];
-        did_ins_1_msg.uvw[1] = msg->uvw[1];
-        did_ins_1_msg.uvw[2] = msg->uvw[2];
-        did_ins_1_msg.lla[0] = msg->lla[0];
-        did_ins_1_msg.lla[1] = msg->lla[1];
-        did_ins_1_msg.lla[2] = msg->lla[2];
-        did_ins_1_msg.ned[0] = msg->ned[0];
-        did_ins_1_msg.ned[1] = msg->ned[1];
-        did_ins_1_msg.ned[2] = msg->ned[2];
-        DID_INS_1_.pub.publish(did_ins_1_msg);
+        did_converters::convert(*msg, did_ins_1_msg);
+        publish(DID_INS_1_.pub, did_ins_1_msg);
     }
 }
 
@@ -958,7 +1907,7 @@ void InertialSenseROS::INS2_callback(eDataIDs DID, const ins_2_t *const msg)
     {
         ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
         if (DID_INS_2_.enabled)
-            DID_INS_2_.pub = nh_.advertise<inertial_sense_ros::DID_INS2>("DID_INS_2", 1);
+            DID_INS_2_.pub = advertise<inertial_sense_ros::DID_INS2>(DID_INS_2_, "DID_INS_2");
     }
 
     ins2Streaming_ = true;
@@ -966,21 +1915,8 @@ void InertialSenseROS::INS2_callback(eDataIDs DID, const ins_2_t *const msg)
     {
         // Standard DID_INS_2 message
         did_ins_2_msg.header.frame_id = frame_id_;
-        did_ins_2_msg.week = msg->week;
-        did_ins_2_msg.timeOfWeek = msg->timeOfWeek;
-        did_ins_2_msg.insStatus = msg->insStatus;
-        did_ins_2_msg.hdwStatus = msg->hdwStatus;
-        did_ins_2_msg.qn2b[0] = msg->qn2b[0];
-        did_ins_2_msg.qn2b[1] = msg->qn2b[1];
-        did_ins_2_msg.qn2b[2] = msg->qn2b[2];
-        did_ins_2_msg.qn2b[3] = msg->qn2b[3];
-        did_ins_2_msg.uvw[0] = msg->uvw[0];
-        did_ins_2_msg.uvw[1] = msg->uvw[1];
-        did_ins_2_msg.uvw[2] = msg->uvw[2];
-        did_ins_2_msg.lla[0] = msg->lla[0];
-        did_ins_2_msg.lla[1] = msg->lla[1];
-        did_ins_2_msg.lla[2] = msg->lla[2];
-        DID_INS_2_.pub.publish(did_ins_2_msg);
+        did_converters::convert(*msg, did_ins_2_msg);
+        publish(DID_INS_2_.pub, did_ins_2_msg);
     }
 }
 
@@ -990,306 +1926,150 @@ void InertialSenseROS::INS4_callback(eDataIDs DID, const ins_4_t *const msg)
     {
         ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
         if (DID_INS_4_.enabled)
-            DID_INS_4_.pub = nh_.advertise<inertial_sense_ros::DID_INS4>("DID_INS_4", 1);
+            DID_INS_4_.pub = advertise<inertial_sense_ros::DID_INS4>(DID_INS_4_, "DID_INS_4");
 
         if (odom_ins_ned_.enabled)
-            odom_ins_ned_.pub = nh_.advertise<nav_msgs::Odometry>("odom_ins_ned", 1);
+            odom_ins_ned_.pub = advertise<nav_msgs::Odometry>(odom_ins_ned_, "odom_ins_ned");
 
         if (odom_ins_enu_.enabled)
-            odom_ins_enu_.pub = nh_.advertise<nav_msgs::Odometry>("odom_ins_enu", 1);
+            odom_ins_enu_.pub = advertise<nav_msgs::Odometry>(odom_ins_enu_, "odom_ins_enu");
 
         if (odom_ins_ecef_.enabled)
-            odom_ins_ecef_.pub = nh_.advertise<nav_msgs::Odometry>("odom_ins_ecef", 1);
+            odom_ins_ecef_.pub = advertise<nav_msgs::Odometry>(odom_ins_ecef_, "odom_ins_ecef");
+
+        if (ins_state_.enabled)
+            ins_state_.pub = advertise<inertial_sense_ros::INSState>(ins_state_, "ins_state");
     }
 
     ins4Streaming_ = true;
     if (!refLLA_known)
     {
         ROS_INFO("REFERENCE LLA MUST BE RECEIVED");
-        return;
-    }
-    if (DID_INS_4_.enabled)
-    {
-        // Standard DID_INS_2 message
-        did_ins_4_msg.header.frame_id = frame_id_;
-        did_ins_4_msg.week = msg->week;
-        did_ins_4_msg.timeOfWeek = msg->timeOfWeek;
-        did_ins_4_msg.insStatus = msg->insStatus;
-        did_ins_4_msg.hdwStatus = msg->hdwStatus;
-        did_ins_4_msg.qe2b[0] = msg->qe2b[0];
-        did_ins_4_msg.qe2b[1] = msg->qe2b[1];
-        did_ins_4_msg.qe2b[2] = msg->qe2b[2];
-        did_ins_4_msg.qe2b[3] = msg->qe2b[3];
-        did_ins_4_msg.ve[0] = msg->ve[0];
-        did_ins_4_msg.ve[1] = msg->ve[1];
-        did_ins_4_msg.ve[2] = msg->ve[2];
-        did_ins_4_msg.ecef[0] = msg->ecef[0];
-        did_ins_4_msg.ecef[1] = msg->ecef[1];
-        did_ins_4_msg.ecef[2] = msg->ecef[2];
-        DID_INS_4_.pub.publish(did_ins_4_msg);
-    }
-
-    if (odom_ins_ned_.enabled || odom_ins_enu_.enabled || odom_ins_ecef_.enabled)
-    {
-        // Note: the covariance matrices need to be transformed into required frames of reference before publishing the ROS message!
-        ixMatrix3 Rb2e, I;
-        ixVector4 qe2b, qe2n;
-        ixVector3d Pe, lla;
-        float Pout[36];
-
-        eye_MatN(I, 3);
-        qe2b[0] = msg->qe2b[0];
-        qe2b[1] = msg->qe2b[1];
-        qe2b[2] = msg->qe2b[2];
-        qe2b[3] = msg->qe2b[3];
-
-        rotMatB2R(qe2b, Rb2e);
-        Pe[0] = msg->ecef[0];
-        Pe[1] = msg->ecef[1];
-        Pe[2] = msg->ecef[2];
-        ecef2lla(Pe, lla);
-        quat_ecef2ned(lla[0], lla[1], qe2n);
-
-        if (odom_ins_ecef_.enabled)
-        {
-            // Pose
-            // Transform attitude body to ECEF
-            transform_6x6_covariance(Pout, poseCov, I, Rb2e);
-            for (int i = 0; i < 36; i++)
-            {
-                ecef_odom_msg.pose.covariance[i] = Pout[i];
-            }
-            // Twist
-            // Transform angular_rate from body to ECEF
-            transform_6x6_covariance(Pout, twistCov, I, Rb2e);
-            for (int i = 0; i < 36; i++)
-            {
-                ecef_odom_msg.twist.covariance[i] = Pout[i];
-            }
-            ecef_odom_msg.header.stamp = ros_time_from_week_and_tow(msg->week, msg->timeOfWeek);
-            ecef_odom_msg.header.frame_id = frame_id_;
-
-            // Position
-
-            ecef_odom_msg.pose.pose.position.x = msg->ecef[0];
-            ecef_odom_msg.pose.pose.position.y = msg->ecef[1];
-            ecef_odom_msg.pose.pose.position.z = -msg->ecef[2];
-
-            // Attitude
-
-            ecef_odom_msg.pose.pose.orientation.w = msg->qe2b[0];
-            ecef_odom_msg.pose.pose.orientation.x = msg->qe2b[1];
-            ecef_odom_msg.pose.pose.orientation.y = msg->qe2b[2];
-            ecef_odom_msg.pose.pose.orientation.z = msg->qe2b[3];
-
-            // Linear Velocity
-
-            ecef_odom_msg.twist.twist.linear.x = msg->ve[0];
-            ecef_odom_msg.twist.twist.linear.y = msg->ve[1];
-            ecef_odom_msg.twist.twist.linear.z = msg->ve[2];
-
-            // Angular Velocity
-            ixVector3 result;
-            ixEuler theta;
-            quat2euler(msg->qe2b, theta);
-            ixVector3 angVelImu = {(f_t)imu_msg.angular_velocity.x, (f_t)imu_msg.angular_velocity.y, (f_t)imu_msg.angular_velocity.z};
-            vectorBodyToReference(angVelImu, theta, result);
-
-            ecef_odom_msg.twist.twist.angular.x = result[0];
-            ecef_odom_msg.twist.twist.angular.y = result[1];
-            ecef_odom_msg.twist.twist.angular.z = result[2];
-
-            odom_ins_ecef_.pub.publish(ecef_odom_msg);
-
-            if (publishTf_)
-            {
-                // Calculate the TF from the pose...
-                transform_ECEF.setOrigin(tf::Vector3(ecef_odom_msg.pose.pose.position.x, ecef_odom_msg.pose.pose.position.y, ecef_odom_msg.pose.pose.position.z));
-                tf::Quaternion q;
-                tf::quaternionMsgToTF(ecef_odom_msg.pose.pose.orientation, q);
-                transform_ECEF.setRotation(q);
-
-                br.sendTransform(tf::StampedTransform(transform_ECEF, ros::Time::now(), "ins_ecef", "ins_base_link_ecef"));
-            }
-        }
-
-        if (odom_ins_ned_.enabled)
-        {
-            ixVector4 qn2b;
-            ixMatrix3 Rb2n, Re2n, buf;
-
-            // NED-to-body quaternion
-            mul_Quat_ConjQuat(qn2b, qe2b, qe2n);
-            // Body-to-NED rotation matrix
-            rotMatB2R(qn2b, Rb2n);
-            // ECEF-to-NED rotation matrix
-            rotMatB2R(qe2n, buf);
-            transpose_Mat3(Re2n, buf);
-
-            // Pose
-            // Transform position from ECEF to NED and attitude from body to NED
-            transform_6x6_covariance(Pout, poseCov, Re2n, Rb2n);
-            for (int i = 0; i < 36; i++)
-            {
-                ned_odom_msg.pose.covariance[i] = Pout[i];
-            }
-            // Twist
-            // Transform velocity from ECEF to NED and angular rate from body to NED
-            transform_6x6_covariance(Pout, twistCov, Re2n, Rb2n);
-            for (int i = 0; i < 36; i++)
-            {
-                ned_odom_msg.twist.covariance[i] = Pout[i];
-            }
-
-            ned_odom_msg.header.stamp = ros_time_from_week_and_tow(msg->week, msg->timeOfWeek);
-            ned_odom_msg.header.frame_id = frame_id_;
-
-            // Position
-            ixVector3d llaPosRadians;
-            // ecef to lla (rad,rad,m)
-            ecef2lla(msg->ecef, llaPosRadians);
-            ixVector3 ned;
-            ixVector3d refLlaRadians;
-            // convert refLla_ to radians
-            lla_Deg2Rad_d(refLlaRadians, refLla_);
-            // lla to ned
-            lla2ned_d(refLlaRadians, llaPosRadians, ned);
-
-            ned_odom_msg.pose.pose.position.x = ned[0];
-            ned_odom_msg.pose.pose.position.y = ned[1];
-            ned_odom_msg.pose.pose.position.z = ned[2];
-
-            // Attitude
-
-            ned_odom_msg.pose.pose.orientation.w = qn2b[0]; // w
-            ned_odom_msg.pose.pose.orientation.x = qn2b[1]; // x
-            ned_odom_msg.pose.pose.orientation.y = qn2b[2]; // y
-            ned_odom_msg.pose.pose.orientation.z = qn2b[3]; // z
-
-            // Linear Velocity
-            ixVector3 result, theta;
-
-            quatConjRot(result, qe2n, msg->ve);
-
-            ned_odom_msg.twist.twist.linear.x = result[0];
-            ned_odom_msg.twist.twist.linear.y = result[1];
-            ned_odom_msg.twist.twist.linear.z = result[2];
-
-            // Angular Velocity
-
-            // Transform from body frame to NED
-            ixVector3 angVelImu = {(f_t)imu_msg.angular_velocity.x, (f_t)imu_msg.angular_velocity.y, (f_t)imu_msg.angular_velocity.z};
-            quatRot(result, qn2b, angVelImu);
-
-            ned_odom_msg.twist.twist.angular.x = result[0];
-            ned_odom_msg.twist.twist.angular.y = result[1];
-            ned_odom_msg.twist.twist.angular.z = result[2];
-            odom_ins_ned_.pub.publish(ned_odom_msg);
-
-            if (publishTf_)
-            {
-                // Calculate the TF from the pose...
-                transform_NED.setOrigin(tf::Vector3(ned_odom_msg.pose.pose.position.x, ned_odom_msg.pose.pose.position.y, ned_odom_msg.pose.pose.position.z));
-                tf::Quaternion q;
-                tf::quaternionMsgToTF(ned_odom_msg.pose.pose.orientation, q);
-                transform_NED.setRotation(q);
+        return;
+    }
+    if (DID_INS_4_.enabled)
+    {
+        // Standard DID_INS_2 message
+        did_ins_4_msg.header.frame_id = frame_id_;
+        did_converters::convert(*msg, did_ins_4_msg);
+        publish(DID_INS_4_.pub, did_ins_4_msg);
+    }
+
+    int outputs = 0;
+    if (ins_state_.enabled)
+        outputs |= InsCore::INS_STATE;
+    if (ned_state_needed())
+        outputs |= InsCore::ODOM_NED;
+    if (odom_ins_enu_.enabled)
+        outputs |= InsCore::ODOM_ENU;
+    if (odom_ins_ecef_.enabled)
+        outputs |= InsCore::ODOM_ECEF;
+    last_ins_status_ = msg->insStatus;
+    last_hdw_status_ = msg->hdwStatus;
+    core_.ins4(*msg, outputs);
+}
 
-                br.sendTransform(tf::StampedTransform(transform_NED, ros::Time::now(), "ins_ned", "ins_base_link_ned"));
-            }
-        }
+void InertialSenseROS::ins_state(const ins_4_t &msg, const ins_stamp_t &stamp)
+{
+    ins_state_msg_.header.stamp = to_ros_time(stamp);
+    ins_state_msg_.header.frame_id = frame_id_;
+    for (int i = 0; i < 3; i++)
+    {
+        ins_state_msg_.ecef[i] = msg.ecef[i];
+        ins_state_msg_.ve[i] = msg.ve[i];
+        ins_state_msg_.angular_velocity[i] = core_.angular_rate()[i];
+        ins_state_msg_.ref_lla[i] = refLla_[i];
+    }
+    for (int i = 0; i < 4; i++)
+        ins_state_msg_.qe2b[i] = msg.qe2b[i];
+    ins_state_msg_.ins_status = msg.insStatus;
+    ins_state_msg_.hdw_status = msg.hdwStatus;
 
-        if (odom_ins_enu_.enabled)
-        {
-            ixVector4 qn2b, qn2enu, qe2enu, qenu2b;
-            ixMatrix3 Rb2enu, Re2enu, buf;
-            ixEuler eul = {M_PI, 0, 0.5 * M_PI};
-            // ENU-to-NED quaternion
-            euler2quat(eul, qn2enu);
-            // NED-to-body quaternion
-            mul_Quat_ConjQuat(qn2b, qe2b, qe2n);
-            // ENU-to-body quaternion
-            mul_Quat_ConjQuat(qenu2b, qn2b, qn2enu);
-            // ECEF-to-ENU quaternion
-            mul_Quat_Quat(qe2enu, qn2enu, qe2n);
-            // Body-to-ENU rotation matrix
-            rotMatB2R(qenu2b, Rb2enu);
-            // ECEF-to-ENU rotation matrix
-            rotMatB2R(qe2enu, buf);
-            transpose_Mat3(Re2enu, buf);
-
-            // Pose
-            // Transform position from ECEF to ENU and attitude from body to ENU
-            transform_6x6_covariance(Pout, poseCov, Re2enu, Rb2enu);
-            for (int i = 0; i < 36; i++)
-            {
-                enu_odom_msg.pose.covariance[i] = Pout[i];
-            }
-            // Twist
-            // Transform velocity from ECEF to ENU and angular rate from body to ENU
-            transform_6x6_covariance(Pout, twistCov, Re2enu, Rb2enu);
-            for (int i = 0; i < 36; i++)
-            {
-                enu_odom_msg.twist.covariance[i] = Pout[i];
-            }
+    // Raw covariances, ins_state.h rotates them into the frame it is asked for
+    if (covariance_enabled_ && insCovarianceStreaming_)
+    {
+        ins_state_msg_.pose_covariance.resize(INS_STATE_COVARIANCE_SIZE);
+        ins_state_msg_.twist_covariance.resize(INS_STATE_COVARIANCE_SIZE);
+        ins_state_pack_covariance(core_.pose_covariance(), &ins_state_msg_.pose_covariance[0]);
+        ins_state_pack_covariance(core_.twist_covariance(), &ins_state_msg_.twist_covariance[0]);
+    }
+    else
+    {
+        ins_state_msg_.pose_covariance.clear();
+        ins_state_msg_.twist_covariance.clear();
+    }
+    publish(ins_state_.pub, ins_state_msg_);
+}
 
-            enu_odom_msg.header.stamp = ros_time_from_week_and_tow(msg->week, msg->timeOfWeek);
-            enu_odom_msg.header.frame_id = frame_id_;
-
-            // Position
-            // Calculate in NED then convert
-            ixVector3d llaPosRadians;
-            // ecef to lla (rad,rad,m)
-            ecef2lla(msg->ecef, llaPosRadians);
-            ixVector3 ned;
-            ixVector3d refLlaRadians;
-            // convert refLla_ to radians
-            lla_Deg2Rad_d(refLlaRadians, refLla_);
-            // lla to ned
-            lla2ned_d(refLlaRadians, llaPosRadians, ned);
-
-            // Rearrange from NED to ENU
-            enu_odom_msg.pose.pose.position.x = ned[1];
-            enu_odom_msg.pose.pose.position.y = ned[0];
-            enu_odom_msg.pose.pose.position.z = -ned[2];
-
-            // Attitude
-
-            enu_odom_msg.pose.pose.orientation.w = qenu2b[0];
-            enu_odom_msg.pose.pose.orientation.x = qenu2b[1];
-            enu_odom_msg.pose.pose.orientation.y = qenu2b[2];
-            enu_odom_msg.pose.pose.orientation.z = qenu2b[3];
-
-            // Linear Velocity
-            // same as NED but rearranged.
-            ixVector3 result, theta;
-            quatConjRot(result, qe2n, msg->ve);
-
-            enu_odom_msg.twist.twist.linear.x = result[1];
-            enu_odom_msg.twist.twist.linear.y = result[0];
-            enu_odom_msg.twist.twist.linear.z = -result[2];
-
-            // Angular Velocity
-
-            // Transform from body frame to ENU
-            ixVector3 angVelImu = {(f_t)imu_msg.angular_velocity.x, (f_t)imu_msg.angular_velocity.y, (f_t)imu_msg.angular_velocity.z};
-            quatRot(result, qenu2b, angVelImu);
-
-            enu_odom_msg.twist.twist.angular.x = result[0];
-            enu_odom_msg.twist.twist.angular.y = result[1];
-            enu_odom_msg.twist.twist.angular.z = result[2];
-
-            odom_ins_enu_.pub.publish(enu_odom_msg);
-            if (publishTf_)
-            {
-                // Calculate the TF from the pose...
-                transform_ENU.setOrigin(tf::Vector3(enu_odom_msg.pose.pose.position.x, enu_odom_msg.pose.pose.position.y, enu_odom_msg.pose.pose.position.z));
-                tf::Quaternion q;
-                tf::quaternionMsgToTF(enu_odom_msg.pose.pose.orientation, q);
-                transform_ENU.setRotation(q);
+void InertialSenseROS::odometry(frame_t frame, const ins_odometry_t &odom)
+{
+    nav_msgs::Odometry *odom_msg;
+    ros_stream_t *stream;
+    tf::Transform *transform;
+    const char *parent_frame, *child_frame;
+    switch (frame)
+    {
+    case FRAME_NED:
+        odom_msg = &ned_odom_msg;
+        stream = &odom_ins_ned_;
+        transform = &transform_NED;
+        parent_frame = "ins_ned";
+        child_frame = "ins_base_link_ned";
+        break;
+    case FRAME_ENU:
+        odom_msg = &enu_odom_msg;
+        stream = &odom_ins_enu_;
+        transform = &transform_ENU;
+        parent_frame = "ins_enu";
+        child_frame = "ins_base_link_enu";
+        break;
+    default:
+        odom_msg = &ecef_odom_msg;
+        stream = &odom_ins_ecef_;
+        transform = &transform_ECEF;
+        parent_frame = "ins_ecef";
+        child_frame = "ins_base_link_ecef";
+        break;
+    }
 
-                br.sendTransform(tf::StampedTransform(transform_ENU, ros::Time::now(), "ins_enu", "ins_base_link_enu"));
-            }
-        }
+    if (frame == FRAME_NED && shm_writer_.is_open())
+        write_shm_ins(odom);
+    if (frame == FRAME_NED && udp_telemetry_.is_open())
+        send_udp_telemetry(odom);
+    if (!stream->enabled)
+        return; // only converted for the shared memory or UDP output
+
+    odom_msg->header.stamp = to_ros_time(odom.stamp);
+    odom_msg->header.frame_id = frame_id_;
+    for (int i = 0; i < 36; i++)
+    {
+        odom_msg->pose.covariance[i] = odom.pose_covariance[i];
+        odom_msg->twist.covariance[i] = odom.twist_covariance[i];
+    }
+    odom_msg->pose.pose.position.x = odom.position[0];
+    odom_msg->pose.pose.position.y = odom.position[1];
+    odom_msg->pose.pose.position.z = odom.position[2];
+    odom_msg->pose.pose.orientation.w = odom.orientation[0];
+    odom_msg->pose.pose.orientation.x = odom.orientation[1];
+    odom_msg->pose.pose.orientation.y = odom.orientation[2];
+    odom_msg->pose.pose.orientation.z = odom.orientation[3];
+    odom_msg->twist.twist.linear.x = odom.linear_velocity[0];
+    odom_msg->twist.twist.linear.y = odom.linear_velocity[1];
+    odom_msg->twist.twist.linear.z = odom.linear_velocity[2];
+    odom_msg->twist.twist.angular.x = odom.angular_velocity[0];
+    odom_msg->twist.twist.angular.y = odom.angular_velocity[1];
+    odom_msg->twist.twist.angular.z = odom.angular_velocity[2];
+    publish(stream->pub, *odom_msg);
+
+    if (publishTf_)
+    {
+        // Calculate the TF from the pose...
+        transform->setOrigin(tf::Vector3(odom.position[0], odom.position[1], odom.position[2]));
+        tf::Quaternion q;
+        tf::quaternionMsgToTF(odom_msg->pose.pose.orientation, q);
+        transform->setRotation(q);
+
+        br.sendTransform(tf::StampedTransform(*transform, ros::Time::now(), parent_frame, child_frame));
     }
 }
 
@@ -1299,41 +2079,17 @@ void InertialSenseROS::INL2_states_callback(eDataIDs DID, const inl2_states_t *c
     {
         ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
         if (INL2_states_.enabled)
-            INL2_states_.pub = nh_.advertise<inertial_sense_ros::INL2States>("inl2_states", 1);
+            INL2_states_.pub = advertise<inertial_sense_ros::INL2States>(INL2_states_, "inl2_states");
     }
     inl2StatesStreaming_ = true;
     inl2_states_msg.header.stamp = ros_time_from_tow(msg->timeOfWeek);
     inl2_states_msg.header.frame_id = frame_id_;
-
-    inl2_states_msg.quatEcef.w = msg->qe2b[0];
-    inl2_states_msg.quatEcef.x = msg->qe2b[1];
-    inl2_states_msg.quatEcef.y = msg->qe2b[2];
-    inl2_states_msg.quatEcef.z = msg->qe2b[3];
-
-    inl2_states_msg.velEcef.x = msg->ve[0];
-    inl2_states_msg.velEcef.y = msg->ve[1];
-    inl2_states_msg.velEcef.z = msg->ve[2];
-
-    inl2_states_msg.posEcef.x = msg->ecef[0];
-    inl2_states_msg.posEcef.y = msg->ecef[1];
-    inl2_states_msg.posEcef.z = msg->ecef[2];
-
-    inl2_states_msg.gyroBias.x = msg->biasPqr[0];
-    inl2_states_msg.gyroBias.y = msg->biasPqr[1];
-    inl2_states_msg.gyroBias.z = msg->biasPqr[2];
-
-    inl2_states_msg.accelBias.x = msg->biasAcc[0];
-    inl2_states_msg.accelBias.y = msg->biasAcc[1];
-    inl2_states_msg.accelBias.z = msg->biasAcc[2];
-
-    inl2_states_msg.baroBias = msg->biasBaro;
-    inl2_states_msg.magDec = msg->magDec;
-    inl2_states_msg.magInc = msg->magInc;
+    did_converters::convert(*msg, inl2_states_msg);
 
     // Use custom INL2 states message
     if (INL2_states_.enabled)
     {
-        INL2_states_.pub.publish(inl2_states_msg);
+        publish(INL2_states_.pub, inl2_states_msg);
     }
 }
 
@@ -1343,46 +2099,7 @@ void InertialSenseROS::INS_covariance_callback(eDataIDs DID, const ros_covarianc
         ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
 
     insCovarianceStreaming_ = true;
-    float poseCovIn[36];
-    int ind1, ind2;
-
-    // Pose and twist covariances unwrapped from LD
-    LD2Cov(msg->covPoseLD, poseCovIn, 6);
-    LD2Cov(msg->covTwistLD, twistCov, 6);
-
-    // Need to change order of variables.
-    // Incoming order for msg->covPoseLD is [attitude, position]. Outgoing should be [position, attitude] => need to swap
-    // Incoming order for msg->covTwistLD is [lin_velocity, ang_rate]. Outgoing should be [lin_velocity, ang_rate] => no change
-    // Order change (block swap) in covariance matrix:
-    // |A  C| => |B  C'|
-    // |C' B|    |C  A |
-    // where A and B are symetric, C' is transposed C
-
-    for (int i = 0; i < 3; i++)
-    {
-        for (int j = 0; j <= i; j++)
-        {
-            // Swap blocks A and B
-            ind1 = (i + 3) * 6 + j + 3;
-            ind2 = i * 6 + j;
-            poseCov[ind2] = poseCovIn[ind1];
-            poseCov[ind1] = poseCovIn[ind2];
-            if (i != j)
-            {
-                // Copy lower diagonals to upper diagonals
-                poseCov[j * 6 + i] = poseCov[ind2];
-                poseCov[(j + 3) * 6 + (i + 3)] = poseCov[ind1];
-            }
-        }
-        // Swap blocks C and C'
-        for (int j = 0; j < 3; j++)
-        {
-            ind1 = (i + 3) * 6 + j;
-            ind2 = i * 6 + j + 3;
-            poseCov[ind2] = poseCovIn[ind1];
-            poseCov[ind1] = poseCovIn[ind2];
-        }
-    }
+    core_.covariance(*msg);
 }
 
 void InertialSenseROS::GPS_pos_callback(eDataIDs DID, const gps_pos_t *const msg)
@@ -1393,6 +2110,7 @@ void InertialSenseROS::GPS_pos_callback(eDataIDs DID, const gps_pos_t *const msg
             ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
 
         gps1PosStreaming_ = true;
+        gps1_fix_type_ = (msg->status & GPS_STATUS_FIX_MASK) >> GPS_STATUS_FIX_BIT_OFFSET;
     }
     else if (DID == DID_GPS2_POS)
     {
@@ -1402,8 +2120,9 @@ void InertialSenseROS::GPS_pos_callback(eDataIDs DID, const gps_pos_t *const msg
         gps2PosStreaming_ = true;
     }
 
-    GPS_week_ = msg->week;
-    GPS_towOffset_ = msg->towOffset;
+    core_.time_sync.gps_week = msg->week;
+    core_.time_sync.gps_tow_offset = msg->towOffset;
+    IS_PROBE2(time_sync_gps, msg->week, (int64_t)(msg->towOffset * 1.0e9));
     if (GPS1_.enabled && msg->status & GPS_STATUS_FIX_MASK && (DID == DID_GPS1_POS))
     {
         gps1_msg.header.stamp = ros_time_from_week_and_tow(msg->week, msg->timeOfWeekMs / 1.0e3);
@@ -1476,7 +2195,7 @@ void InertialSenseROS::GPS_pos_callback(eDataIDs DID, const gps_pos_t *const msg
         NavSatFix_msg.position_covariance[4] = varH;
         NavSatFix_msg.position_covariance[8] = varV;
         NavSatFix_msg.position_covariance_type = COVARIANCE_TYPE_DIAGONAL_KNOWN;
-        NavSatFix_.pub.publish(NavSatFix_msg);
+        publish(NavSatFix_.pub, NavSatFix_msg);
     }
 }
 
@@ -1497,18 +2216,18 @@ void InertialSenseROS::GPS_vel_callback(eDataIDs DID, const gps_vel_t *const msg
         gps2VelStreaming_ = true;
     }
 
-    if (GPS1_.enabled && (DID == DID_GPS1_VEL) && abs(GPS_towOffset_) > 0.001)
+    if (GPS1_.enabled && (DID == DID_GPS1_VEL) && core_.time_sync.has_gps_time())
     {
-        gps1_velEcef.header.stamp = ros_time_from_week_and_tow(GPS_week_, msg->timeOfWeekMs / 1.0e3);
+        gps1_velEcef.header.stamp = ros_time_from_week_and_tow(core_.time_sync.gps_week, msg->timeOfWeekMs / 1.0e3);
         gps1_velEcef.vector.x = msg->vel[0];
         gps1_velEcef.vector.y = msg->vel[1];
         gps1_velEcef.vector.z = msg->vel[2];
         gps1_sAcc = msg->sAcc;
         publishGPS1();
     }
-    if (GPS2_.enabled && (DID == DID_GPS2_VEL) && abs(GPS_towOffset_) > 0.001)
+    if (GPS2_.enabled && (DID == DID_GPS2_VEL) && core_.time_sync.has_gps_time())
     {
-        gps2_velEcef.header.stamp = ros_time_from_week_and_tow(GPS_week_, msg->timeOfWeekMs / 1.0e3);
+        gps2_velEcef.header.stamp = ros_time_from_week_and_tow(core_.time_sync.gps_week, msg->timeOfWeekMs / 1.0e3);
         gps2_velEcef.vector.x = msg->vel[0];
         gps2_velEcef.vector.y = msg->vel[1];
         gps2_velEcef.vector.z = msg->vel[2];
@@ -1524,7 +2243,7 @@ void InertialSenseROS::publishGPS1()
     {
         gps1_msg.velEcef = gps1_velEcef.vector;
         gps1_msg.sAcc = gps1_sAcc;
-        GPS1_.pub.publish(gps1_msg);
+        publish(GPS1_.pub, gps1_msg);
     }
 }
 
@@ -1535,13 +2254,35 @@ void InertialSenseROS::publishGPS2()
     {
         gps2_msg.velEcef = gps2_velEcef.vector;
         gps2_msg.sAcc = gps2_sAcc;
-        GPS2_.pub.publish(gps2_msg);
+        publish(GPS2_.pub, gps2_msg);
     }
 }
 
 void InertialSenseROS::update()
 {
-    IS_.Update();
+    if (link_supervisor_.connected())
+    {
+        read_device();
+        if (overload_policy_enabled_)
+        {
+            // Held packets wait for a read with time to spare
+            overload_.read_done(receive_time_, DispatchStats::now());
+            overload_.flush();
+        }
+    }
+    if (udp_telemetry_.is_open())
+        udp_telemetry_.poll(ros::WallTime::now().toSec());
+    publish_isb_raw();
+    service_device_commands();
+}
+
+void InertialSenseROS::publish_isb_raw()
+{
+    // Everything parsed by one IS_.Update() is published as one batch
+    if (!isb_raw_.enabled || isb_raw_writer_.empty())
+        return;
+    isb_raw_writer_.take(isb_raw_read_time_, isb_raw_msg_);
+    publish(isb_raw_.pub, isb_raw_msg_);
 }
 
 void InertialSenseROS::strobe_in_time_callback(eDataIDs DID, const strobe_in_time_t *const msg)
@@ -1553,38 +2294,38 @@ void InertialSenseROS::strobe_in_time_callback(eDataIDs DID, const strobe_in_tim
     if (strobe_pub_.getTopic().empty())
         strobe_pub_ = nh_.advertise<std_msgs::Header>("strobe_time", 1);
 
-    if (abs(GPS_towOffset_) > 0.001)
+    if (core_.time_sync.has_gps_time())
     {
         std_msgs::Header strobe_msg;
         strobe_msg.stamp = ros_time_from_week_and_tow(msg->week, msg->timeOfWeekMs * 1.0e-3);
-        strobe_pub_.publish(strobe_msg);
+        publish(strobe_pub_, strobe_msg);
     }
 }
 
 void InertialSenseROS::GPS_info_callback(eDataIDs DID, const gps_sat_t *const msg)
 {
-    if (DID = DID_GPS1_SAT)
+    if (DID == DID_GPS1_SAT)
     {
         if (!gps1InfoStreaming_)
         {
             ROS_INFO("%s (GPS1 info) response received", cISDataMappings::GetDataSetName(DID));
             if (GPS1_info_.enabled)
-                GPS1_info_.pub = nh_.advertise<inertial_sense_ros::GPSInfo>(gps1_topic_ + "/info", 1);
+                GPS1_info_.pub = advertise<inertial_sense_ros::GPSInfo>(GPS1_info_, gps1_topic_ + "/info");
             gps1InfoStreaming_ = true;
         }
     }
-    if (DID = DID_GPS2_SAT)
+    if (DID == DID_GPS2_SAT)
     {
         if (!gps2InfoStreaming_)
         {
             ROS_INFO("%s (GPS2 info) response received", cISDataMappings::GetDataSetName(DID));
             if (GPS2_info_.enabled)
-                GPS2_info_.pub = nh_.advertise<inertial_sense_ros::GPSInfo>(gps1_topic_ + "/info", 1);
+                GPS2_info_.pub = advertise<inertial_sense_ros::GPSInfo>(GPS2_info_, gps2_topic_ + "/info");
             gps2InfoStreaming_ = true;
         }
     }
 
-    if (abs(GPS_towOffset_) < 0.001)
+    if (!core_.time_sync.has_gps_time())
     { // Wait for valid msg->timeOfWeekMs
         return;
     }
@@ -1598,9 +2339,9 @@ void InertialSenseROS::GPS_info_callback(eDataIDs DID, const gps_sat_t *const ms
         gps_info_msg.sattelite_info[i].cno = msg->sat[i].cno;
     }
     if (DID == DID_GPS1_SAT)
-        GPS1_info_.pub.publish(gps_info_msg);
+        publish(GPS1_info_.pub, gps_info_msg);
     else if (DID == DID_GPS2_SAT)
-        GPS2_info_.pub.publish(gps_info_msg);
+        publish(GPS2_info_.pub, gps_info_msg);
 }
 
 void InertialSenseROS::mag_callback(eDataIDs DID, const magnetometer_t *const msg)
@@ -1609,7 +2350,7 @@ void InertialSenseROS::mag_callback(eDataIDs DID, const magnetometer_t *const ms
     {
         ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
         if (mag_.enabled)
-            mag_.pub = nh_.advertise<sensor_msgs::MagneticField>("mag", 1);
+            mag_.pub = advertise<sensor_msgs::MagneticField>(mag_, "mag");
     }
     magStreaming_ = true;
     sensor_msgs::MagneticField mag_msg;
@@ -1619,7 +2360,7 @@ void InertialSenseROS::mag_callback(eDataIDs DID, const magnetometer_t *const ms
     mag_msg.magnetic_field.y = msg->mag[1];
     mag_msg.magnetic_field.z = msg->mag[2];
 
-    mag_.pub.publish(mag_msg);
+    publish(mag_.pub, mag_msg);
 }
 
 void InertialSenseROS::baro_callback(eDataIDs DID, const barometer_t *const msg)
@@ -1628,7 +2369,7 @@ void InertialSenseROS::baro_callback(eDataIDs DID, const barometer_t *const msg)
     {
         ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
         if (baro_.enabled)
-            baro_.pub = nh_.advertise<sensor_msgs::FluidPressure>("baro", 1);
+            baro_.pub = advertise<sensor_msgs::FluidPressure>(baro_, "baro");
     }
 
     baroStreaming_ = true;
@@ -1638,33 +2379,22 @@ void InertialSenseROS::baro_callback(eDataIDs DID, const barometer_t *const msg)
     baro_msg.fluid_pressure = msg->bar;
     baro_msg.variance = msg->barTemp;
 
-    baro_.pub.publish(baro_msg);
+    publish(baro_.pub, baro_msg);
 }
 
 void InertialSenseROS::preint_IMU_callback(eDataIDs DID, const pimu_t *const msg)
 {
-
+    pimuStreaming_ = true;
+    int outputs = 0;
     if (preint_IMU_.enabled)
     {
         if (!preintImuStreaming_)
         {
             ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
-            preint_IMU_.pub = nh_.advertise<inertial_sense_ros::PreIntIMU>("preint_imu", 1);
+            preint_IMU_.pub = advertise<inertial_sense_ros::PreIntIMU>(preint_IMU_, "preint_imu");
         }
         preintImuStreaming_ = true;
-        preintIMU_msg.header.stamp = ros_time_from_start_time(msg->time);
-        preintIMU_msg.header.frame_id = frame_id_;
-        preintIMU_msg.dtheta.x = msg->theta[0];
-        preintIMU_msg.dtheta.y = msg->theta[1];
-        preintIMU_msg.dtheta.z = msg->theta[2];
-
-        preintIMU_msg.dvel.x = msg->vel[0];
-        preintIMU_msg.dvel.y = msg->vel[1];
-        preintIMU_msg.dvel.z = msg->vel[2];
-
-        preintIMU_msg.dt = msg->dt;
-
-        preint_IMU_.pub.publish(preintIMU_msg);
+        outputs |= InsCore::PREINT_IMU;
     }
 
     if (IMU_.enabled)
@@ -1672,52 +2402,81 @@ void InertialSenseROS::preint_IMU_callback(eDataIDs DID, const pimu_t *const msg
         if (!imuStreaming_)
         {
             ROS_INFO("IMU response received");
-            IMU_.pub = nh_.advertise<sensor_msgs::Imu>("imu", 1);
+            IMU_.pub = advertise<sensor_msgs::Imu>(IMU_, "imu");
         }
         imuStreaming_ = true;
-        imu_msg.header.stamp = ros_time_from_start_time(msg->time);
-        imu_msg.header.frame_id = frame_id_;
+        outputs |= InsCore::IMU;
+    }
+
+    // Always passed on, the odometry needs the angular rate
+    core_.pimu(*msg, outputs);
+}
+
+void InertialSenseROS::preint_imu(const ins_preint_imu_t &preint)
+{
+    preintIMU_msg.header.stamp = to_ros_time(preint.stamp);
+    preintIMU_msg.header.frame_id = frame_id_;
+    preintIMU_msg.dtheta.x = preint.dtheta[0];
+    preintIMU_msg.dtheta.y = preint.dtheta[1];
+    preintIMU_msg.dtheta.z = preint.dtheta[2];
+
+    preintIMU_msg.dvel.x = preint.dvel[0];
+    preintIMU_msg.dvel.y = preint.dvel[1];
+    preintIMU_msg.dvel.z = preint.dvel[2];
 
-        imu_msg.angular_velocity.x = msg->theta[0] / msg->dt;
-        imu_msg.angular_velocity.y = msg->theta[1] / msg->dt;
-        imu_msg.angular_velocity.z = msg->theta[2] / msg->dt;
+    preintIMU_msg.dt = preint.dt;
 
-        imu_msg.linear_acceleration.x = msg->vel[0] / msg->dt;
-        imu_msg.linear_acceleration.y = msg->vel[1] / msg->dt;
-        imu_msg.linear_acceleration.z = msg->vel[2] / msg->dt;
+    publish(preint_IMU_.pub, preintIMU_msg);
+}
 
-        imu_msg.orientation.w = enu_odom_msg.pose.pose.orientation.w;
-        imu_msg.orientation.x = enu_odom_msg.pose.pose.orientation.x;
-        imu_msg.orientation.y = enu_odom_msg.pose.pose.orientation.y;
-        imu_msg.orientation.z = enu_odom_msg.pose.pose.orientation.z;
+void InertialSenseROS::imu(const ins_imu_t &imu)
+{
+    if (shm_writer_.is_open())
+    {
+        shm_imu_state_t state;
+        state.stamp = imu.stamp.to_sec();
+        state.host_time = ros::WallTime::now().toSec();
+        for (int i = 0; i < 3; i++)
+        {
+            state.angular_velocity[i] = imu.angular_velocity[i];
+            state.linear_acceleration[i] = imu.linear_acceleration[i];
+        }
+        shm_writer_.write_imu(state);
+    }
 
-        imu_msg.orientation_covariance[0] = enu_odom_msg.pose.covariance[21];
-        imu_msg.orientation_covariance[4] = enu_odom_msg.pose.covariance[28];
-        imu_msg.orientation_covariance[8] = enu_odom_msg.pose.covariance[35];
+    imu_msg.header.stamp = to_ros_time(imu.stamp);
+    imu_msg.header.frame_id = frame_id_;
 
-        imu_msg.angular_velocity_covariance[0] = enu_odom_msg.twist.covariance[21];
-        imu_msg.angular_velocity_covariance[4] = enu_odom_msg.twist.covariance[28];
-        imu_msg.angular_velocity_covariance[8] = enu_odom_msg.twist.covariance[35];
+    imu_msg.angular_velocity.x = imu.angular_velocity[0];
+    imu_msg.angular_velocity.y = imu.angular_velocity[1];
+    imu_msg.angular_velocity.z = imu.angular_velocity[2];
 
-        // imu_msg.linear_acceleration_covariance[0] = 2 * enu_odom_msg.twist.covariance[0] / (msg->dt * msg->dt);
-        // imu_msg.linear_acceleration_covariance[4] = 2 * enu_odom_msg.twist.covariance[7] / (msg->dt * msg->dt);
-        // imu_msg.linear_acceleration_covariance[8] = 2 * enu_odom_msg.twist.covariance[14] / (msg->dt * msg->dt);
+    imu_msg.linear_acceleration.x = imu.linear_acceleration[0];
+    imu_msg.linear_acceleration.y = imu.linear_acceleration[1];
+    imu_msg.linear_acceleration.z = imu.linear_acceleration[2];
 
-        imu_msg.linear_acceleration_covariance[0] = enu_odom_msg.twist.covariance[0];
-        imu_msg.linear_acceleration_covariance[4] = enu_odom_msg.twist.covariance[7];
-        imu_msg.linear_acceleration_covariance[8] = enu_odom_msg.twist.covariance[14];
+    imu_msg.orientation.w = imu.orientation[0];
+    imu_msg.orientation.x = imu.orientation[1];
+    imu_msg.orientation.y = imu.orientation[2];
+    imu_msg.orientation.z = imu.orientation[3];
 
-        IMU_.pub.publish(imu_msg);
+    for (int i = 0; i < 3; i++)
+    {
+        imu_msg.orientation_covariance[4 * i] = imu.orientation_covariance[i];
+        imu_msg.angular_velocity_covariance[4 * i] = imu.angular_velocity_covariance[i];
+        imu_msg.linear_acceleration_covariance[4 * i] = imu.linear_acceleration_covariance[i];
     }
+
+    publish(IMU_.pub, imu_msg);
 }
 
 void InertialSenseROS::RTK_Misc_callback(eDataIDs DID, const gps_rtk_misc_t *const msg)
 {
     inertial_sense_ros::RTKInfo rtk_info;
-    if (abs(GPS_towOffset_) > 0.001)
+    if (core_.time_sync.has_gps_time())
     {
 
-        rtk_info.header.stamp = ros_time_from_week_and_tow(GPS_week_, msg->timeOfWeekMs / 1000.0);
+        rtk_info.header.stamp = ros_time_from_week_and_tow(core_.time_sync.gps_week, msg->timeOfWeekMs / 1000.0);
         rtk_info.baseAntcount = msg->baseAntennaCount;
         rtk_info.baseEph = msg->baseBeidouEphemerisCount + msg->baseGalileoEphemerisCount + msg->baseGlonassEphemerisCount + msg->baseGpsEphemerisCount;
         rtk_info.baseObs = msg->baseBeidouObservationCount + msg->baseGalileoObservationCount + msg->baseGlonassObservationCount + msg->baseGpsObservationCount;
@@ -1735,7 +2494,7 @@ void InertialSenseROS::RTK_Misc_callback(eDataIDs DID, const gps_rtk_misc_t *con
             ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
 
         rtkPosMiscStreaming_ = true;
-        RTK_pos_.pub.publish(rtk_info);
+        publish(RTK_pos_.pub, rtk_info);
     }
     if (DID == DID_GPS2_RTK_CMP_MISC)
     {
@@ -1743,16 +2502,16 @@ void InertialSenseROS::RTK_Misc_callback(eDataIDs DID, const gps_rtk_misc_t *con
             ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
 
         rtkCmpMiscStreaming_ = true;
-        RTK_cmp_.pub.publish(rtk_info);
+        publish(RTK_cmp_.pub, rtk_info);
     }
 }
 
 void InertialSenseROS::RTK_Rel_callback(eDataIDs DID, const gps_rtk_rel_t *const msg)
 {
     inertial_sense_ros::RTKRel rtk_rel;
-    if (abs(GPS_towOffset_) > 0.001)
+    if (core_.time_sync.has_gps_time())
     {
-        rtk_rel.header.stamp = ros_time_from_week_and_tow(GPS_week_, msg->timeOfWeekMs / 1000.0);
+        rtk_rel.header.stamp = ros_time_from_week_and_tow(core_.time_sync.gps_week, msg->timeOfWeekMs / 1000.0);
         rtk_rel.differential_age = msg->differentialAge;
         rtk_rel.ar_ratio = msg->arRatio;
         uint32_t fixStatus = msg->status & GPS_STATUS_FIX_MASK;
@@ -1789,14 +2548,14 @@ void InertialSenseROS::RTK_Rel_callback(eDataIDs DID, const gps_rtk_rel_t *const
         if (!rtkPosRelStreaming_)
             ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
         rtkPosRelStreaming_ = true;
-        RTK_pos_.pub2.publish(rtk_rel);
+        publish(RTK_pos_.pub2, rtk_rel);
     }
     if (DID == DID_GPS2_RTK_CMP_REL)
     {
         if (!rtkCmpRelStreaming_)
             ROS_INFO("%s response received", cISDataMappings::GetDataSetName(DID));
         rtkCmpRelStreaming_ = true;
-        RTK_cmp_.pub2.publish(rtk_rel);
+        publish(RTK_cmp_.pub2, rtk_rel);
     }
 
     // save for diagnostics TODO - Add more diagnostic info
@@ -1906,7 +2665,7 @@ void InertialSenseROS::GPS_obs_bundle_timer_callback(const ros::TimerEvent &e)
         {
             gps1_obs_Vec_.header.stamp = ros_time_from_gtime(gps1_obs_Vec_.obs[0].time.time, gps1_obs_Vec_.obs[0].time.sec);
             gps1_obs_Vec_.time = gps1_obs_Vec_.obs[0].time;
-            GPS1_raw_.pub.publish(gps1_obs_Vec_);
+            publish(GPS1_raw_.pub, gps1_obs_Vec_);
             gps1_obs_Vec_.obs.clear();
         }
     }
@@ -1917,7 +2676,7 @@ void InertialSenseROS::GPS_obs_bundle_timer_callback(const ros::TimerEvent &e)
         {
             gps2_obs_Vec_.header.stamp = ros_time_from_gtime(gps2_obs_Vec_.obs[0].time.time, gps2_obs_Vec_.obs[0].time.sec);
             gps2_obs_Vec_.time = gps2_obs_Vec_.obs[0].time;
-            GPS2_raw_.pub.publish(gps2_obs_Vec_);
+            publish(GPS2_raw_.pub, gps2_obs_Vec_);
             gps2_obs_Vec_.obs.clear();
         }
     }
@@ -1927,7 +2686,7 @@ void InertialSenseROS::GPS_obs_bundle_timer_callback(const ros::TimerEvent &e)
         {
             base_obs_Vec_.header.stamp = ros_time_from_gtime(base_obs_Vec_.obs[0].time.time, base_obs_Vec_.obs[0].time.sec);
             base_obs_Vec_.time = base_obs_Vec_.obs[0].time;
-            GPS_base_raw_.pub.publish(base_obs_Vec_);
+            publish(GPS_base_raw_.pub, base_obs_Vec_);
             base_obs_Vec_.obs.clear();
         }
     }
@@ -1936,89 +2695,31 @@ void InertialSenseROS::GPS_obs_bundle_timer_callback(const ros::TimerEvent &e)
 void InertialSenseROS::GPS_eph_callback(eDataIDs DID, const eph_t *const msg)
 {
     inertial_sense_ros::GNSSEphemeris eph;
-    eph.sat = msg->sat;
-    eph.iode = msg->iode;
-    eph.iodc = msg->iodc;
-    eph.sva = msg->sva;
-    eph.svh = msg->svh;
-    eph.week = msg->week;
-    eph.code = msg->code;
-    eph.flag = msg->flag;
-    eph.toe.time = msg->toe.time;
-    eph.toc.time = msg->toc.time;
-    eph.ttr.time = msg->ttr.time;
-    eph.toe.sec = msg->toe.sec;
-    eph.toc.sec = msg->toc.sec;
-    eph.ttr.sec = msg->ttr.sec;
-    eph.A = msg->A;
-    eph.e = msg->e;
-    eph.i0 = msg->i0;
-    eph.OMG0 = msg->OMG0;
-    eph.omg = msg->omg;
-    eph.M0 = msg->M0;
-    eph.deln = msg->deln;
-    eph.OMGd = msg->OMGd;
-    eph.idot = msg->idot;
-    eph.crc = msg->crc;
-    eph.crs = msg->crs;
-    eph.cuc = msg->cuc;
-    eph.cus = msg->cus;
-    eph.cic = msg->cic;
-    eph.cis = msg->cis;
-    eph.toes = msg->toes;
-    eph.fit = msg->fit;
-    eph.f0 = msg->f0;
-    eph.f1 = msg->f1;
-    eph.f2 = msg->f2;
-    eph.tgd[0] = msg->tgd[0];
-    eph.tgd[1] = msg->tgd[1];
-    eph.tgd[2] = msg->tgd[2];
-    eph.tgd[3] = msg->tgd[3];
-    eph.Adot = msg->Adot;
-    eph.ndot = msg->ndot;
+    did_converters::convert(*msg, eph);
     if (DID == DID_GPS1_RAW)
-        GPS1_raw_.pub2.publish(eph);
+        publish(GPS1_raw_.pub2, eph);
     else if (DID == DID_GPS2_RAW)
-        GPS2_raw_.pub2.publish(eph);
+        publish(GPS2_raw_.pub2, eph);
     else if (DID == DID_GPS_BASE_RAW)
-        GPS_base_raw_.pub2.publish(eph);
+        publish(GPS_base_raw_.pub2, eph);
 }
 
 void InertialSenseROS::GPS_geph_callback(eDataIDs DID, const geph_t *const msg)
 {
     inertial_sense_ros::GlonassEphemeris geph;
-    geph.sat = msg->sat;
-    geph.iode = msg->iode;
-    geph.frq = msg->frq;
-    geph.svh = msg->svh;
-    geph.sva = msg->sva;
-    geph.age = msg->age;
-    geph.toe.time = msg->toe.time;
-    geph.tof.time = msg->tof.time;
-    geph.toe.sec = msg->toe.sec;
-    geph.tof.sec = msg->tof.sec;
-    geph.pos[0] = msg->pos[0];
-    geph.pos[1] = msg->pos[1];
-    geph.pos[2] = msg->pos[2];
-    geph.vel[0] = msg->vel[0];
-    geph.vel[1] = msg->vel[1];
-    geph.vel[2] = msg->vel[2];
-    geph.acc[0] = msg->acc[0];
-    geph.acc[1] = msg->acc[1];
-    geph.acc[2] = msg->acc[2];
-    geph.taun = msg->taun;
-    geph.gamn = msg->gamn;
-    geph.dtaun = msg->dtaun;
+    did_converters::convert(*msg, geph);
     if (DID == DID_GPS1_RAW)
-        GPS1_raw_.pub3.publish(geph);
+        publish(GPS1_raw_.pub3, geph);
     else if (DID == DID_GPS2_RAW)
-        GPS2_raw_.pub3.publish(geph);
+        publish(GPS2_raw_.pub3, geph);
     else if (DID == DID_GPS_BASE_RAW)
-        GPS_base_raw_.pub3.publish(geph);
+        publish(GPS_base_raw_.pub3, geph);
 }
 
 void InertialSenseROS::diagnostics_callback(const ros::TimerEvent &event)
 {
+    if (overload_policy_enabled_ && overload_.skip(diagnostics_.priority, diagnostics_skipped_))
+        return;
     if (!diagnosticsStreaming_)
         ROS_INFO("Diagnostics response received");
     diagnosticsStreaming_ = true;
@@ -2093,7 +2794,160 @@ void InertialSenseROS::diagnostics_callback(const ros::TimerEvent &event)
         diag_array.status.push_back(rtk_status);
     }
 
-    diagnostics_.pub.publish(diag_array);
+    // Serial link bandwidth, planned against received
+    diagnostic_msgs::DiagnosticStatus budget_status;
+    budget_status.name = "Link Budget";
+    double measured_rate = link_budget_.measure(ros::WallTime::now().toSec());
+    std::map<uint32_t, double> lagging = link_budget_.lagging_streams(0.9);
+    budget_status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    budget_status.message = "Within budget";
+    if (link_budget_.over_budget() || measured_rate > link_budget_.headroom() * link_budget_.capacity())
+    {
+        budget_status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+        budget_status.message = "Over headroom";
+    }
+    else if (!lagging.empty() && link_supervisor_.connected())
+    {
+        budget_status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+        budget_status.message = "Streams below planned rate";
+    }
+    diagnostic_msgs::KeyValue planned_kv;
+    planned_kv.key = "Planned Utilization (%)";
+    planned_kv.value = std::to_string(100.0 * link_budget_.utilization());
+    budget_status.values.push_back(planned_kv);
+    diagnostic_msgs::KeyValue measured_kv;
+    measured_kv.key = "Measured Utilization (%)";
+    measured_kv.value = std::to_string(100.0 * measured_rate / link_budget_.capacity());
+    budget_status.values.push_back(measured_kv);
+    for (std::map<uint32_t, double>::const_iterator it = lagging.begin(); it != lagging.end(); ++it)
+    {
+        diagnostic_msgs::KeyValue lagging_kv;
+        lagging_kv.key = "DID " + std::to_string(it->first) + " Rate (% of planned)";
+        lagging_kv.value = std::to_string(100.0 * it->second);
+        budget_status.values.push_back(lagging_kv);
+    }
+    diag_array.status.push_back(budget_status);
+
+    // Serial link
+    diagnostic_msgs::DiagnosticStatus link_status;
+    link_status.name = "Serial Link";
+    double now = ros::WallTime::now().toSec();
+    if (link_supervisor_.connected())
+    {
+        link_status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        link_status.message = "Connected";
+    }
+    else
+    {
+        link_status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+        link_status.message = "Reconnecting for " + std::to_string(link_supervisor_.current_outage_duration(now)) + " s";
+    }
+    diagnostic_msgs::KeyValue outages;
+    outages.key = "Outages";
+    outages.value = std::to_string(link_supervisor_.outage_count());
+    link_status.values.push_back(outages);
+    diagnostic_msgs::KeyValue last_outage;
+    last_outage.key = "Last Outage Duration (s)";
+    last_outage.value = std::to_string(link_supervisor_.last_outage_duration());
+    link_status.values.push_back(last_outage);
+    diagnostic_msgs::KeyValue total_outage;
+    total_outage.key = "Total Outage Duration (s)";
+    total_outage.value = std::to_string(link_supervisor_.total_outage_duration() + link_supervisor_.current_outage_duration(now));
+    link_status.values.push_back(total_outage);
+    diag_array.status.push_back(link_status);
+
+    if (stream_monitor_enabled_)
+        add_stream_monitor_diagnostics(diag_array);
+    if (overload_policy_enabled_)
+        add_overload_diagnostics(diag_array);
+    if (udp_telemetry_.is_open())
+        add_udp_telemetry_diagnostics(diag_array);
+    add_dispatch_diagnostics(diag_array);
+    publish(diagnostics_.pub, diag_array);
+}
+
+void InertialSenseROS::add_dispatch_diagnostics(diagnostic_msgs::DiagnosticArray &diag_array)
+{
+    // Rate, device time discontinuities and latency of every data set since the last diagnostics
+    double elapsed;
+    std::vector<std::pair<uint32_t, DispatchStats::window_t>> windows = dispatch_stats_.take_window(diagnostics_window_, DispatchStats::now(), elapsed);
+    diagnostic_msgs::DiagnosticStatus streams_status;
+    streams_status.name = "Data Streams";
+    streams_status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    streams_status.message = "No gaps";
+    for (size_t i = 0; i < windows.size(); i++)
+    {
+        const DispatchStats::window_t &window = windows[i].second;
+        std::string name = cISDataMappings::GetDataSetName(windows[i].first);
+        if (window.gaps || window.duplicates)
+        {
+            streams_status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+            streams_status.message = "Gaps or duplicates in device time";
+        }
+
+        diagnostic_msgs::KeyValue kv;
+        kv.key = name + " Rate (Hz)";
+        kv.value = std::to_string(elapsed > 0.0 ? window.packets / elapsed : 0.0);
+        streams_status.values.push_back(kv);
+        kv.key = name + " Gaps";
+        kv.value = std::to_string(window.gaps);
+        streams_status.values.push_back(kv);
+        kv.key = name + " Duplicates";
+        kv.value = std::to_string(window.duplicates);
+        streams_status.values.push_back(kv);
+
+        static const char *latency_names[DispatchStats::LATENCY_COUNT] = {"Dispatch", "Handler", "Age"};
+        for (int l = 0; l < DispatchStats::LATENCY_COUNT; l++)
+        {
+            const DispatchStats::histogram_t &latency = window.latency[l];
+            if (latency.count == 0)
+                continue;
+            char value[64];
+            snprintf(value, sizeof(value), "%.3f / %.3f / %.3f", 1.0e3 * latency.percentile(50), 1.0e3 * latency.percentile(99), 1.0e3 * latency.max);
+            kv.key = name + " " + latency_names[l] + " p50/p99/max (ms)";
+            kv.value = value;
+            streams_status.values.push_back(kv);
+        }
+    }
+    diag_array.status.push_back(streams_status);
+}
+
+void InertialSenseROS::did_stats_callback(const ros::TimerEvent &event)
+{
+    if (overload_policy_enabled_ && overload_.skip(did_stats_.priority, did_stats_skipped_))
+        return;
+    double elapsed;
+    std::vector<std::pair<uint32_t, DispatchStats::window_t>> windows = dispatch_stats_.take_window(did_stats_window_, DispatchStats::now(), elapsed);
+    inertial_sense_ros::DIDStats msg;
+    msg.header.stamp = ros::Time::now();
+    msg.window = elapsed;
+    for (size_t i = 0; i < windows.size(); i++)
+    {
+        const DispatchStats::did_t *stats = dispatch_stats_.find(windows[i].first);
+        const DispatchStats::window_t &window = windows[i].second;
+        msg.did.push_back(windows[i].first);
+        msg.packets.push_back(stats->packets);
+        msg.bytes.push_back(stats->bytes);
+        msg.gaps.push_back(stats->gaps);
+        msg.missed.push_back(stats->missed);
+        msg.duplicates.push_back(stats->duplicates);
+        msg.rate.push_back(elapsed > 0.0 ? window.packets / elapsed : 0.0);
+        msg.period.push_back(stats->period);
+
+        const DispatchStats::histogram_t &dispatch = window.latency[DispatchStats::LATENCY_DISPATCH];
+        msg.dispatch_p50.push_back(1.0e3 * dispatch.percentile(50));
+        msg.dispatch_p99.push_back(1.0e3 * dispatch.percentile(99));
+        msg.dispatch_max.push_back(1.0e3 * dispatch.max);
+        const DispatchStats::histogram_t &handler = window.latency[DispatchStats::LATENCY_HANDLER];
+        msg.handler_p50.push_back(1.0e3 * handler.percentile(50));
+        msg.handler_p99.push_back(1.0e3 * handler.percentile(99));
+        msg.handler_max.push_back(1.0e3 * handler.max);
+        const DispatchStats::histogram_t &age = window.latency[DispatchStats::LATENCY_AGE];
+        msg.age_p50.push_back(1.0e3 * age.percentile(50));
+        msg.age_p99.push_back(1.0e3 * age.percentile(99));
+        msg.age_max.push_back(1.0e3 * age.max);
+    }
+    publish(did_stats_.pub, msg);
 }
 
 bool InertialSenseROS::set_current_position_as_refLLA(std_srvs::Trigger::Request &req, std_srvs::Trigger::Response &res)
@@ -2104,100 +2958,139 @@ bool InertialSenseROS::set_current_position_as_refLLA(std_srvs::Trigger::Request
     current_lla_[1] = lla_[1];
     current_lla_[2] = lla_[2];
 
-    IS_.SendData(DID_FLASH_CONFIG, reinterpret_cast<uint8_t *>(&current_lla_), sizeof(current_lla_), offsetof(nvm_flash_cfg_t, refLla));
+    res.success = set_refLLA(current_lla_, res.message);
+    return true;
+}
 
-    comManagerGetData(0, DID_FLASH_CONFIG, 0, 0, 1);
+bool InertialSenseROS::set_refLLA_to_value(inertial_sense_ros::refLLAUpdate::Request &req, inertial_sense_ros::refLLAUpdate::Response &res)
+{
+    double lla[3] = {req.lla[0], req.lla[1], req.lla[2]};
 
-    int i = 0;
-    nvm_flash_cfg_t current_flash = IS_.GetFlashConfig();
-    while (current_flash.refLla[0] == IS_.GetFlashConfig().refLla[0] && current_flash.refLla[1] == IS_.GetFlashConfig().refLla[1] && current_flash.refLla[2] == IS_.GetFlashConfig().refLla[2])
-    {
-        comManagerStep();
-        i++;
-        if (i > 100)
-        {
-            break;
-        }
-    }
+    res.success = set_refLLA(lla, res.message);
+    return true;
+}
 
-    if (current_lla_[0] == IS_.GetFlashConfig().refLla[0] && current_lla_[1] == IS_.GetFlashConfig().refLla[1] && current_lla_[2] == IS_.GetFlashConfig().refLla[2])
-    {
-        comManagerGetData(0, DID_FLASH_CONFIG, 0, 0, 0);
-        res.success = true;
-        res.message = ("Update was succesful.  refLla: Lat: " + std::to_string(current_lla_[0]) + "  Lon: " + std::to_string(current_lla_[1]) + "  Alt: " + std::to_string(current_lla_[2]));
+bool InertialSenseROS::set_refLLA(const double lla[3], std::string &message)
+{
+    std::array<double, 3> expected = {{lla[0], lla[1], lla[2]}};
+    std::shared_future<bool> result = send_device_command(DID_FLASH_CONFIG, expected.data(), sizeof(expected), offsetof(nvm_flash_cfg_t, refLla), DID_FLASH_CONFIG,
+                                                          [expected](const p_data_t *data)
+                                                          {
+                                                              // Only a readback covering refLla can confirm the write
+                                                              uint32_t offset = offsetof(nvm_flash_cfg_t, refLla);
+                                                              if (data->hdr.offset > offset || data->hdr.offset + data->hdr.size < offset + sizeof(expected))
+                                                                  return false;
+                                                              return memcmp(data->buf + (offset - data->hdr.offset), expected.data(), sizeof(expected)) == 0;
+                                                          });
+
+    if (await_device_command(result))
+    {
+        message = ("Update was succesful.  refLla: Lat: " + std::to_string(lla[0]) + "  Lon: " + std::to_string(lla[1]) + "  Alt: " + std::to_string(lla[2]));
+        return true;
     }
-    else
+
+    message = "Unable to update refLLA. Please try again.";
+    return false;
+}
+
+std::shared_future<bool> InertialSenseROS::await_device_data(eDataIDs DID, device_command_predicate_t predicate, double timeout, bool poll, device_command_handler_t on_complete)
+{
+    device_command_t cmd;
+    cmd.completion_did = DID;
+    cmd.predicate = predicate;
+    cmd.on_complete = on_complete;
+    cmd.poll = poll;
+    cmd.deadline = ros::Time::now() + ros::Duration(timeout);
+    cmd.next_poll = ros::Time::now() + ros::Duration(device_command_poll_period_);
+    cmd.result = std::make_shared<std::promise<bool>>();
+    std::shared_future<bool> future = cmd.result->get_future().share();
+    device_commands_.push_back(cmd);
+
+    if (poll)
     {
-        comManagerGetData(0, DID_FLASH_CONFIG, 0, 0, 0);
-        res.success = false;
-        res.message = "Unable to update refLLA. Please try again.";
+        // Request a single readback of the data set
+        comManagerGetData(0, DID, 0, 0, 0);
     }
 
-    return true;
+    return future;
 }
 
-bool InertialSenseROS::set_refLLA_to_value(inertial_sense_ros::refLLAUpdate::Request &req, inertial_sense_ros::refLLAUpdate::Response &res)
+std::shared_future<bool> InertialSenseROS::send_device_command(eDataIDs DID, const void *data, uint32_t size, uint32_t offset, eDataIDs completionDID, device_command_predicate_t predicate, bool poll)
 {
-    IS_.SendData(DID_FLASH_CONFIG, reinterpret_cast<uint8_t *>(&req.lla), sizeof(req.lla), offsetof(nvm_flash_cfg_t, refLla));
+    IS_.SendData(DID, reinterpret_cast<uint8_t *>(const_cast<void *>(data)), size, offset);
 
-    comManagerGetData(0, DID_FLASH_CONFIG, 0, 0, 1);
+    return await_device_data(completionDID, predicate, device_command_timeout_, poll);
+}
 
-    int i = 0;
-    nvm_flash_cfg_t current_flash = IS_.GetFlashConfig();
-    while (current_flash.refLla[0] == IS_.GetFlashConfig().refLla[0] && current_flash.refLla[1] == IS_.GetFlashConfig().refLla[1] && current_flash.refLla[2] == IS_.GetFlashConfig().refLla[2])
+bool InertialSenseROS::await_device_command(std::shared_future<bool> result)
+{
+    // Service callbacks run on the same thread as update(), so keep dispatching device data
+    // (and publishing every other stream) until the command has been resolved.
+    while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
     {
-        comManagerStep();
-        i++;
-        if (i > 100)
-        {
-            break;
-        }
+        if (!ros::ok())
+            return false;
+        update();
     }
+    return result.get();
+}
 
-    if (req.lla[0] == IS_.GetFlashConfig().refLla[0] && req.lla[1] == IS_.GetFlashConfig().refLla[1] && req.lla[2] == IS_.GetFlashConfig().refLla[2])
-    {
-        comManagerGetData(0, DID_FLASH_CONFIG, 0, 0, 0);
-        res.success = true;
-        res.message = ("Update was succesful.  refLla: Lat: " + std::to_string(req.lla[0]) + "  Lon: " + std::to_string(req.lla[1]) + "  Alt: " + std::to_string(req.lla[2]));
-    }
-    else
+void InertialSenseROS::process_device_commands(const p_data_t *data)
+{
+    for (std::list<device_command_t>::iterator it = device_commands_.begin(); it != device_commands_.end();)
     {
-        comManagerGetData(0, DID_FLASH_CONFIG, 0, 0, 0);
-        res.success = false;
-        res.message = "Unable to update refLLA. Please try again.";
+        if (it->completion_did == data->hdr.id && it->predicate(data))
+        {
+            device_command_t cmd = *it;
+            it = device_commands_.erase(it);
+            resolve_device_command(cmd, true);
+        }
+        else
+        {
+            ++it;
+        }
     }
-
-    return true;
 }
 
-bool InertialSenseROS::perform_mag_cal_srv_callback(std_srvs::Trigger::Request &req, std_srvs::Trigger::Response &res)
+void InertialSenseROS::service_device_commands()
 {
-    (void)req;
-    uint32_t single_axis_command = 2;
-    IS_.SendData(DID_MAG_CAL, reinterpret_cast<uint8_t *>(&single_axis_command), sizeof(uint32_t), offsetof(mag_cal_t, state));
-
-    is_comm_instance_t comm;
-    uint8_t buffer[2048];
-    is_comm_init(&comm, buffer, sizeof(buffer));
-    serial_port_t *serialPort = IS_.GetSerialPort();
-    uint8_t inByte;
-    int n;
+    if (device_commands_.empty())
+        return;
 
-    while ((n = serialPortReadCharTimeout(serialPort, &inByte, 20)) > 0)
+    ros::Time now = ros::Time::now();
+    for (std::list<device_command_t>::iterator it = device_commands_.begin(); it != device_commands_.end();)
     {
-        // Search comm buffer for valid packets
-        if (is_comm_parse_byte(&comm, inByte) == _PTYPE_INERTIAL_SENSE_DATA && comm.dataHdr.id == DID_INS_1)
+        if (now > it->deadline)
         {
-            ins_1_t *msg = (ins_1_t *)(comm.dataPtr + comm.dataHdr.offset);
-            if (msg->insStatus & 0x00400000)
-            {
-                res.success = true;
-                res.message = "Successfully initiated mag recalibration.";
-                return true;
-            }
+            ROS_WARN("%s command timed out", cISDataMappings::GetDataSetName(it->completion_did));
+            device_command_t cmd = *it;
+            it = device_commands_.erase(it);
+            resolve_device_command(cmd, false);
+            continue;
+        }
+        if (it->poll && now > it->next_poll)
+        {
+            // Device has not confirmed yet, request another readback
+            comManagerGetData(0, it->completion_did, 0, 0, 0);
+            it->next_poll = now + ros::Duration(device_command_poll_period_);
         }
+        ++it;
     }
+}
+
+void InertialSenseROS::resolve_device_command(device_command_t &cmd, bool completed)
+{
+    // Removed from the list before the handler runs, so handlers may register new commands
+    cmd.result->set_value(completed);
+    if (cmd.on_complete)
+        cmd.on_complete(completed);
+}
 
+bool InertialSenseROS::perform_mag_cal_srv_callback(std_srvs::Trigger::Request &req, std_srvs::Trigger::Response &res)
+{
+    (void)req;
+    uint32_t single_axis_command = 2;
+    res.success = start_mag_cal(single_axis_command, res.message);
     return true;
 }
 
@@ -2205,42 +3098,131 @@ bool InertialSenseROS::perform_multi_mag_cal_srv_callback(std_srvs::Trigger::Req
 {
     (void)req;
     uint32_t multi_axis_command = 1;
-    IS_.SendData(DID_MAG_CAL, reinterpret_cast<uint8_t *>(&multi_axis_command), sizeof(uint32_t), offsetof(mag_cal_t, state));
+    res.success = start_mag_cal(multi_axis_command, res.message);
+    return true;
+}
 
-    is_comm_instance_t comm;
-    uint8_t buffer[2048];
-    is_comm_init(&comm, buffer, sizeof(buffer));
-    serial_port_t *serialPort = IS_.GetSerialPort();
-    uint8_t inByte;
-    int n;
+bool InertialSenseROS::start_mag_cal(uint32_t command, std::string &message)
+{
+    if (mag_cal_running_)
+    {
+        message = "Mag recalibration already in progress.";
+        return false;
+    }
 
-    while ((n = serialPortReadCharTimeout(serialPort, &inByte, 20)) > 0)
+    // The recalibration is observed on the normal dispatch path, so INS1 has to be streaming
+    if (!ins1Streaming_)
     {
-        // Search comm buffer for valid packets
-        if (is_comm_parse_byte(&comm, inByte) == _PTYPE_INERTIAL_SENSE_DATA && comm.dataHdr.id == DID_INS_1)
-        {
-            ins_1_t *msg = (ins_1_t *)(comm.dataPtr + comm.dataHdr.offset);
-            if (msg->insStatus & 0x00400000)
-            {
-                res.success = true;
-                res.message = "Successfully initiated mag recalibration.";
-                return true;
-            }
-        }
+        register_stream<DID_INS_1, &InertialSenseROS::INS1_callback>(DID_INS_1_.period_multiple);
+        mag_cal_enabled_ins1_ = !DID_INS_1_.enabled;
+    }
+
+    // Report progress of the recalibration at ~2 Hz
+    if (mag_cal_progress_pub_.getTopic().empty())
+        mag_cal_progress_pub_ = nh_.advertise<std_msgs::Float32>("mag_cal/progress", 1);
+    register_stream<DID_MAG_CAL, &InertialSenseROS::mag_cal_callback>(std::max(1, 500 / navigation_dt_ms_));
+
+    std::shared_future<bool> result = send_device_command(DID_MAG_CAL, &command, sizeof(uint32_t), offsetof(mag_cal_t, state), DID_INS_1,
+                                                          [](const p_data_t *data)
+                                                          {
+                                                              const ins_1_t *ins1 = reinterpret_cast<const ins_1_t *>(data->buf);
+                                                              return (ins1->insStatus & 0x00400000) != 0; // Mag recalibrating
+                                                          },
+                                                          false);
+
+    if (!await_device_command(result))
+    {
+        finish_mag_cal(false);
+        message = "Unable to initiate mag recalibration. Please try again.";
+        return false;
     }
 
+    // Completion is reported asynchronously once the device reports the recalibration done
+    mag_cal_running_ = true;
+    await_device_data(DID_MAG_CAL,
+                      [](const p_data_t *data)
+                      {
+                          return reinterpret_cast<const mag_cal_t *>(data->buf)->state == 201; // Recalibration done
+                      },
+                      mag_cal_timeout_, false, std::bind(&InertialSenseROS::finish_mag_cal, this, std::placeholders::_1));
+
+    message = "Successfully initiated mag recalibration.";
     return true;
 }
 
-void InertialSenseROS::reset_device()
+void InertialSenseROS::mag_cal_callback(eDataIDs DID, const mag_cal_t *const msg)
+{
+    std_msgs::Float32 progress;
+    progress.data = msg->progress;
+    publish(mag_cal_progress_pub_, progress);
+}
+
+void InertialSenseROS::finish_mag_cal(bool completed)
+{
+    if (mag_cal_running_)
+    {
+        if (completed)
+            ROS_INFO("Mag recalibration complete.");
+        else
+            ROS_WARN("Mag recalibration did not complete within %.0f seconds.", mag_cal_timeout_);
+    }
+    mag_cal_running_ = false;
+
+    // Through request_stream, so the link budget, stream monitor and device cache forget them too
+    request_stream(DID_MAG_CAL, sizeof(mag_cal_t), 0);
+    if (mag_cal_enabled_ins1_)
+    {
+        request_stream(DID_INS_1, sizeof(ins_1_t), 0);
+        ins1Streaming_ = false;
+        mag_cal_enabled_ins1_ = false;
+    }
+}
+
+bool InertialSenseROS::reset_device()
 {
+    uint32_t serialNumber = IS_.GetDeviceInfo().serialNumber;
+
     // send reset command
     system_command_t reset_command;
     reset_command.command = 99;
     reset_command.invCommand = ~reset_command.command;
     IS_.SendData(DID_SYS_CMD, reinterpret_cast<uint8_t *>(&reset_command), sizeof(system_command_t), 0);
-    ROS_WARN("Device reset required.\n\nShutting down Node.\n");
-    ros::shutdown();
+    ROS_WARN("Device reset required, waiting for uINS %d to restart.", serialNumber);
+
+    return wait_for_device(serialNumber, device_reboot_timeout_);
+}
+
+bool InertialSenseROS::wait_for_device(uint32_t serialNumber, double timeout)
+{
+    // USB devices re-enumerate on reset, so the port is reopened rather than reused
+    IS_.Close();
+    ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(timeout);
+    ros::WallDuration(0.5).sleep();
+
+    while (ros::ok() && ros::WallTime::now() < deadline)
+    {
+        if (open_port())
+        {
+            // Device info is requested by Open(), the device is back once it answers
+            ros::WallTime answer_deadline = ros::WallTime::now() + ros::WallDuration(1.0);
+            while (ros::WallTime::now() < answer_deadline)
+            {
+                read_device();
+                if (IS_.GetDeviceInfo().serialNumber == serialNumber)
+                {
+                    ROS_INFO("uINS %d is back on \"%s\"", serialNumber, port_.c_str());
+                    link_supervisor_.data_received(ros::WallTime::now().toSec());
+                    return true;
+                }
+                ros::WallDuration(0.01).sleep();
+            }
+            IS_.Close();
+        }
+        ros::WallDuration(0.25).sleep();
+    }
+
+    ROS_ERROR("uINS %d did not come back within %.1f seconds", serialNumber, timeout);
+    return false;
 }
 
 bool InertialSenseROS::update_firmware_srv_callback(inertial_sense_ros::FirmwareUpdate::Request &req, inertial_sense_ros::FirmwareUpdate::Response &res)
@@ -2260,162 +3242,30 @@ bool InertialSenseROS::update_firmware_srv_callback(inertial_sense_ros::Firmware
 
 ros::Time InertialSenseROS::ros_time_from_week_and_tow(const uint32_t week, const double timeOfWeek)
 {
-    ros::Time rostime(0, 0);
-    //  If we have a GPS fix, then use it to set timestamp
-    if (abs(GPS_towOffset_) > 0.001)
-    {
-        uint64_t sec = UNIX_TO_GPS_OFFSET + floor(timeOfWeek) + week * 7 * 24 * 3600;
-        uint64_t nsec = (timeOfWeek - floor(timeOfWeek)) * 1e9;
-        rostime = ros::Time(sec, nsec);
-    }
-    else
-    {
-        // Otherwise, estimate the uINS boot time and offset the messages
-        if (!got_first_message_)
-        {
-            got_first_message_ = true;
-            INS_local_offset_ = ros::Time::now().toSec() - timeOfWeek;
-        }
-        else // low-pass filter offset to account for drift
-        {
-            double y_offset = ros::Time::now().toSec() - timeOfWeek;
-            INS_local_offset_ = 0.005 * y_offset + 0.995 * INS_local_offset_;
-        }
-        // Publish with ROS time
-        rostime = ros::Time(INS_local_offset_ + timeOfWeek);
-    }
-    return rostime;
+    return to_ros_time(core_.time_sync.from_week_and_tow(week, timeOfWeek));
 }
 
 ros::Time InertialSenseROS::ros_time_from_start_time(const double time)
 {
-    ros::Time rostime(0, 0);
-
-    //  If we have a GPS fix, then use it to set timestamp
-    if (abs(GPS_towOffset_) > 0.001)
-    {
-        double timeOfWeek = time + GPS_towOffset_;
-        uint64_t sec = (uint64_t)(UNIX_TO_GPS_OFFSET + floor(timeOfWeek) + GPS_week_ * 7 * 24 * 3600);
-        uint64_t nsec = (uint64_t)((timeOfWeek - floor(timeOfWeek)) * 1.0e9);
-        rostime = ros::Time(sec, nsec);
-    }
-    else
-    {
-        // Otherwise, estimate the uINS boot time and offset the messages
-        if (!got_first_message_)
-        {
-            got_first_message_ = true;
-            INS_local_offset_ = ros::Time::now().toSec() - time;
-        }
-        else // low-pass filter offset to account for drift
-        {
-            double y_offset = ros::Time::now().toSec() - time;
-            INS_local_offset_ = 0.005 * y_offset + 0.995 * INS_local_offset_;
-        }
-        // Publish with ROS time
-        rostime = ros::Time(INS_local_offset_ + time);
-    }
-    return rostime;
+    return to_ros_time(core_.time_sync.from_start_time(time));
 }
 
 ros::Time InertialSenseROS::ros_time_from_tow(const double tow)
 {
-    return ros_time_from_week_and_tow(GPS_week_, tow);
+    return to_ros_time(core_.time_sync.from_tow(tow));
 }
 
 double InertialSenseROS::tow_from_ros_time(const ros::Time &rt)
 {
-    return (rt.sec - UNIX_TO_GPS_OFFSET - GPS_week_ * 604800) + rt.nsec * 1.0e-9;
+    ins_stamp_t stamp;
+    stamp.sec = rt.sec;
+    stamp.nsec = rt.nsec;
+    return core_.time_sync.tow(stamp);
 }
 
 ros::Time InertialSenseROS::ros_time_from_gtime(const uint64_t sec, double subsec)
 {
-    ros::Time out;
-    out.sec = sec - LEAP_SECONDS;
-    out.nsec = subsec * 1e9;
-    return out;
-}
-
-void InertialSenseROS::LD2Cov(const float *LD, float *Cov, int width)
-{
-    for (int j = 0; j < width; j++)
-    {
-        for (int i = 0; i < width; i++)
-        {
-            if (i < j)
-            {
-                Cov[i * width + j] = Cov[j * width + i];
-            }
-            else
-            {
-                Cov[i * width + j] = LD[(i * i + i) / 2 + j];
-            }
-        }
-    }
-}
-
-void InertialSenseROS::rotMatB2R(const ixVector4 quat, ixMatrix3 R)
-{
-    R[0] = 1.0f - 2.0f * (quat[2] * quat[2] + quat[3] * quat[3]);
-    R[1] = 2.0f * (quat[1] * quat[2] - quat[0] * quat[3]);
-    R[2] = 2.0f * (quat[1] * quat[3] + quat[0] * quat[2]);
-    R[3] = 2.0f * (quat[1] * quat[2] + quat[0] * quat[3]);
-    R[4] = 1.0f - 2.0f * (quat[1] * quat[1] + quat[3] * quat[3]);
-    R[5] = 2.0f * (quat[2] * quat[3] - quat[0] * quat[1]);
-    R[6] = 2.0f * (quat[1] * quat[3] - quat[0] * quat[2]);
-    R[7] = 2.0f * (quat[2] * quat[3] + quat[0] * quat[1]);
-    R[8] = 1.0f - 2.0f * (quat[1] * quat[1] + quat[2] * quat[2]);
-}
-
-void InertialSenseROS::transform_6x6_covariance(float Pout[36], float Pin[36], ixMatrix3 R1, ixMatrix3 R2)
-{
-    // Assumption: input covariance matrix is transformed due to change of coordinates,
-    // so that fisrt 3 coordinates are rotated by R1 and the last 3 coordinates are rotated by R2
-    // This is how the transformation looks:
-    // |R1  0 | * |Pxx  Pxy'| * |R1' 0  | = |R1*Pxx*R1'  R1*Pxy'*R2'|
-    // |0   R2|   |Pxy  Pyy |   |0   R2'|   |R2*Pxy*R1'  R2*Pyy*R2' |
-
-    ixMatrix3 Pxx_in, Pxy_in, Pyy_in, Pxx_out, Pxy_out, Pyy_out, buf;
-
-    // Extract 3x3 blocks from input covariance
-    for (int i = 0; i < 3; i++)
-    {
-        for (int j = 0; j < 3; j++)
-        {
-            // Upper diagonal block in old frame
-            Pxx_in[i * 3 + j] = Pin[i * 6 + j];
-            // Lower left block of in old frame
-            Pxy_in[i * 3 + j] = Pin[(i + 3) * 6 + j];
-            // Lower diagonal block in old frame
-            Pyy_in[i * 3 + j] = Pin[(i + 3) * 6 + j + 3];
-        }
-    }
-    // Transform the 3x3 covariance blocks
-    // New upper diagonal block
-    mul_Mat3x3_Mat3x3(buf, R1, Pxx_in);
-    mul_Mat3x3_Mat3x3_Trans(Pxx_out, buf, R1);
-    // New lower left block
-    mul_Mat3x3_Mat3x3(buf, R2, Pxy_in);
-    mul_Mat3x3_Mat3x3_Trans(Pxy_out, buf, R1);
-    // New lower diagonal  block
-    mul_Mat3x3_Mat3x3(buf, R2, Pyy_in);
-    mul_Mat3x3_Mat3x3_Trans(Pyy_out, buf, R2);
-
-    // Copy the computed transformed blocks into output 6x6 covariance matrix
-    for (int i = 0; i < 3; i++)
-    {
-        for (int j = 0; j < 3; j++)
-        {
-            // Upper diagonal block in the new frame
-            Pout[i * 6 + j] = Pxx_in[i * 3 + j];
-            // Lower left block in the new frame
-            Pout[(i + 3) * 6 + j] = Pxy_in[i * 3 + j];
-            // Upper right block in the new frame
-            Pout[i * 6 + j + 3] = Pxy_in[j * 3 + i];
-            // Lower diagonal block in the new frame
-            Pout[(i + 3) * 6 + j + 3] = Pyy_in[i * 3 + j];
-        }
-    }
+    return to_ros_time(InsTimeSync::from_gtime(sec, subsec));
 }
 
 template <typename Type>
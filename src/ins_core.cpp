@@ -0,0 +1,471 @@
+#include "ins_core.h"
+
+#include <math.h>
+#include <chrono>
+
+#include "ISPose.h"
+#include "ISEarth.h"
+#include "ISMatrix.h"
+#include "probes.h"
+
+ins_stamp_t ins_stamp_t::from_sec(double t)
+{
+    // Same rounding as ros::Time(double)
+    ins_stamp_t stamp;
+    int64_t sec = (int64_t)floor(t);
+    int64_t nsec = (int64_t)llround((t - sec) * 1e9);
+    sec += nsec / 1000000000;
+    nsec %= 1000000000;
+    stamp.sec = (uint32_t)sec;
+    stamp.nsec = (uint32_t)nsec;
+    return stamp;
+}
+
+InsTimeSync::InsTimeSync()
+{
+    clock = []()
+    {
+        return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    };
+}
+
+bool InsTimeSync::has_gps_time() const
+{
+    return fabs(gps_tow_offset) > 0.001;
+}
+
+ins_stamp_t InsTimeSync::from_week_and_tow(uint32_t week, double timeOfWeek)
+{
+    //  If we have a GPS fix, then use it to set timestamp
+    if (has_gps_time())
+    {
+        ins_stamp_t stamp;
+        stamp.sec = (uint32_t)(UNIX_TO_GPS_OFFSET + floor(timeOfWeek) + week * 7 * 24 * 3600);
+        stamp.nsec = (uint32_t)((timeOfWeek - floor(timeOfWeek)) * 1e9);
+        return stamp;
+    }
+
+    // Otherwise, estimate the uINS boot time and offset the messages
+    if (!got_first_message)
+    {
+        got_first_message = true;
+        local_offset = clock() - timeOfWeek;
+    }
+    else // low-pass filter offset to account for drift
+    {
+        update_local_offset(clock() - timeOfWeek);
+    }
+    return ins_stamp_t::from_sec(local_offset + timeOfWeek);
+}
+
+ins_stamp_t InsTimeSync::from_start_time(double time)
+{
+    //  If we have a GPS fix, then use it to set timestamp
+    if (has_gps_time())
+    {
+        ins_stamp_t stamp;
+        double timeOfWeek = time + gps_tow_offset;
+        stamp.sec = (uint32_t)(UNIX_TO_GPS_OFFSET + floor(timeOfWeek) + gps_week * 7 * 24 * 3600);
+        stamp.nsec = (uint32_t)((timeOfWeek - floor(timeOfWeek)) * 1.0e9);
+        return stamp;
+    }
+
+    // Otherwise, estimate the uINS boot time and offset the messages
+    if (!got_first_message)
+    {
+        got_first_message = true;
+        local_offset = clock() - time;
+    }
+    else // low-pass filter offset to account for drift
+    {
+        update_local_offset(clock() - time);
+    }
+    return ins_stamp_t::from_sec(local_offset + time);
+}
+
+ins_stamp_t InsTimeSync::from_gtime(uint64_t sec, double subsec)
+{
+    ins_stamp_t stamp;
+    stamp.sec = (uint32_t)(sec - LEAP_SECONDS);
+    stamp.nsec = (uint32_t)(subsec * 1e9);
+    return stamp;
+}
+
+double InsTimeSync::tow(const ins_stamp_t &stamp) const
+{
+    return ((double)stamp.sec - UNIX_TO_GPS_OFFSET - (double)gps_week * 604800) + stamp.nsec * 1.0e-9;
+}
+
+void InsTimeSync::update_local_offset(double y_offset)
+{
+    if (seeded)
+    {
+        // The cached offset is only valid if the uINS has not restarted since it was saved
+        seeded = false;
+        if (fabs(y_offset - local_offset) > 1.0)
+        {
+            local_offset = y_offset;
+            return;
+        }
+    }
+    local_offset = 0.005 * y_offset + 0.995 * local_offset;
+    IS_PROBE2(time_sync_local, (int64_t)(local_offset * 1.0e9), (int64_t)(y_offset * 1.0e9));
+}
+
+void InsCore::set_ref_lla(const double lla[3])
+{
+    ref_lla_[0] = lla[0];
+    ref_lla_[1] = lla[1];
+    ref_lla_[2] = lla[2];
+}
+
+void InsCore::covariance(const ros_covariance_pose_twist_t &msg)
+{
+    float poseCovIn[36];
+    int ind1, ind2;
+
+    // Pose and twist covariances unwrapped from LD
+    LD2Cov(msg.covPoseLD, poseCovIn, 6);
+    LD2Cov(msg.covTwistLD, twist_cov_, 6);
+
+    // Need to change order of variables.
+    // Incoming order for msg.covPoseLD is [attitude, position]. Outgoing should be [position, attitude] => need to swap
+    // Incoming order for msg.covTwistLD is [lin_velocity, ang_rate]. Outgoing should be [lin_velocity, ang_rate] => no change
+    // Order change (block swap) in covariance matrix:
+    // |A  C| => |B  C'|
+    // |C' B|    |C  A |
+    // where A and B are symetric, C' is transposed C
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j <= i; j++)
+        {
+            // Swap blocks A and B
+            ind1 = (i + 3) * 6 + j + 3;
+            ind2 = i * 6 + j;
+            pose_cov_[ind2] = poseCovIn[ind1];
+            pose_cov_[ind1] = poseCovIn[ind2];
+            if (i != j)
+            {
+                // Copy lower diagonals to upper diagonals
+                pose_cov_[j * 6 + i] = pose_cov_[ind2];
+                pose_cov_[(j + 3) * 6 + (i + 3)] = pose_cov_[ind1];
+            }
+        }
+        // Swap blocks C and C'
+        for (int j = 0; j < 3; j++)
+        {
+            ind1 = (i + 3) * 6 + j;
+            ind2 = i * 6 + j + 3;
+            pose_cov_[ind2] = poseCovIn[ind1];
+            pose_cov_[ind1] = poseCovIn[ind2];
+        }
+    }
+}
+
+void InsCore::ins4(const ins_4_t &msg, int outputs)
+{
+    if (!(outputs & (ODOM_NED | ODOM_ENU | ODOM_ECEF | INS_STATE)))
+        return;
+
+    // Once per data set, the time sync filter updates with every conversion
+    ins_stamp_t stamp = time_sync.from_week_and_tow(msg.week, msg.timeOfWeek);
+    if ((outputs & INS_STATE) && sink_)
+        sink_->ins_state(msg, stamp);
+    if (!(outputs & (ODOM_NED | ODOM_ENU | ODOM_ECEF)))
+        return;
+
+    // Note: the covariance matrices need to be transformed into required frames of reference before output!
+    ixMatrix3 Rb2e, I;
+    ixVector4 qe2b, qe2n, qn2b = {1, 0, 0, 0};
+    ixVector3d Pe, lla;
+    ixVector3 ned = {0, 0, 0};
+
+    eye_MatN(I, 3);
+    qe2b[0] = msg.qe2b[0];
+    qe2b[1] = msg.qe2b[1];
+    qe2b[2] = msg.qe2b[2];
+    qe2b[3] = msg.qe2b[3];
+
+    rotMatB2R(qe2b, Rb2e);
+    Pe[0] = msg.ecef[0];
+    Pe[1] = msg.ecef[1];
+    Pe[2] = msg.ecef[2];
+    ecef2lla(Pe, lla);
+    quat_ecef2ned(lla[0], lla[1], qe2n);
+    lla_[0] = lla[0] * C_RAD2DEG;
+    lla_[1] = lla[1] * C_RAD2DEG;
+    lla_[2] = lla[2];
+
+    if (outputs & (ODOM_NED | ODOM_ENU))
+    {
+        // NED-to-body quaternion
+        mul_Quat_ConjQuat(qn2b, qe2b, qe2n);
+
+        // Position in NED, (rad,rad,m) lla to ned
+        ixVector3d refLlaRadians;
+        lla_Deg2Rad_d(refLlaRadians, ref_lla_);
+        lla2ned_d(refLlaRadians, lla, ned);
+    }
+
+    if (outputs & ODOM_ECEF)
+    {
+        ins_odometry_t &odom = odom_[InsSink::FRAME_ECEF];
+        odom.stamp = stamp;
+
+        // Pose
+        // Transform attitude body to ECEF
+        transform_6x6_covariance(odom.pose_covariance, pose_cov_, I, Rb2e);
+        // Twist
+        // Transform angular_rate from body to ECEF
+        transform_6x6_covariance(odom.twist_covariance, twist_cov_, I, Rb2e);
+
+        // Position
+        odom.position[0] = msg.ecef[0];
+        odom.position[1] = msg.ecef[1];
+        odom.position[2] = -msg.ecef[2];
+
+        // Attitude
+        for (int i = 0; i < 4; i++)
+            odom.orientation[i] = msg.qe2b[i];
+
+        // Linear Velocity
+        for (int i = 0; i < 3; i++)
+            odom.linear_velocity[i] = msg.ve[i];
+
+        // Angular Velocity
+        ixVector3 result;
+        ixEuler theta;
+        quat2euler(msg.qe2b, theta);
+        vectorBodyToReference(angular_rate_, theta, result);
+        for (int i = 0; i < 3; i++)
+            odom.angular_velocity[i] = result[i];
+
+        if (sink_)
+            sink_->odometry(InsSink::FRAME_ECEF, odom);
+    }
+
+    if (outputs & ODOM_NED)
+    {
+        ins_odometry_t &odom = odom_[InsSink::FRAME_NED];
+        ixMatrix3 Rb2n, Re2n, buf;
+        odom.stamp = stamp;
+
+        // Body-to-NED rotation matrix
+        rotMatB2R(qn2b, Rb2n);
+        // ECEF-to-NED rotation matrix
+        rotMatB2R(qe2n, buf);
+        transpose_Mat3(Re2n, buf);
+
+        // Pose
+        // Transform position from ECEF to NED and attitude from body to NED
+        transform_6x6_covariance(odom.pose_covariance, pose_cov_, Re2n, Rb2n);
+        // Twist
+        // Transform velocity from ECEF to NED and angular rate from body to NED
+        transform_6x6_covariance(odom.twist_covariance, twist_cov_, Re2n, Rb2n);
+
+        // Position
+        for (int i = 0; i < 3; i++)
+            odom.position[i] = ned[i];
+
+        // Attitude
+        for (int i = 0; i < 4; i++)
+            odom.orientation[i] = qn2b[i];
+
+        // Linear Velocity
+        ixVector3 result;
+        quatConjRot(result, qe2n, msg.ve);
+        for (int i = 0; i < 3; i++)
+            odom.linear_velocity[i] = result[i];
+
+        // Angular Velocity
+        // Transform from body frame to NED
+        quatRot(result, qn2b, angular_rate_);
+        for (int i = 0; i < 3; i++)
+            odom.angular_velocity[i] = result[i];
+
+        if (sink_)
+            sink_->odometry(InsSink::FRAME_NED, odom);
+    }
+
+    if (outputs & ODOM_ENU)
+    {
+        ins_odometry_t &odom = odom_[InsSink::FRAME_ENU];
+        ixVector4 qn2enu, qe2enu, qenu2b;
+        ixMatrix3 Rb2enu, Re2enu, buf;
+        ixEuler eul = {M_PI, 0, 0.5 * M_PI};
+        odom.stamp = stamp;
+
+        // ENU-to-NED quaternion
+        euler2quat(eul, qn2enu);
+        // ENU-to-body quaternion
+        mul_Quat_ConjQuat(qenu2b, qn2b, qn2enu);
+        // ECEF-to-ENU quaternion
+        mul_Quat_Quat(qe2enu, qn2enu, qe2n);
+        // Body-to-ENU rotation matrix
+        rotMatB2R(qenu2b, Rb2enu);
+        // ECEF-to-ENU rotation matrix
+        rotMatB2R(qe2enu, buf);
+        transpose_Mat3(Re2enu, buf);
+
+        // Pose
+        // Transform position from ECEF to ENU and attitude from body to ENU
+        transform_6x6_covariance(odom.pose_covariance, pose_cov_, Re2enu, Rb2enu);
+        // Twist
+        // Transform velocity from ECEF to ENU and angular rate from body to ENU
+        transform_6x6_covariance(odom.twist_covariance, twist_cov_, Re2enu, Rb2enu);
+
+        // Position
+        // Rearrange from NED to ENU
+        odom.position[0] = ned[1];
+        odom.position[1] = ned[0];
+        odom.position[2] = -ned[2];
+
+        // Attitude
+        for (int i = 0; i < 4; i++)
+            odom.orientation[i] = qenu2b[i];
+
+        // Linear Velocity
+        // same as NED but rearranged.
+        ixVector3 result;
+        quatConjRot(result, qe2n, msg.ve);
+        odom.linear_velocity[0] = result[1];
+        odom.linear_velocity[1] = result[0];
+        odom.linear_velocity[2] = -result[2];
+
+        // Angular Velocity
+        // Transform from body frame to ENU
+        quatRot(result, qenu2b, angular_rate_);
+        for (int i = 0; i < 3; i++)
+            odom.angular_velocity[i] = result[i];
+
+        if (sink_)
+            sink_->odometry(InsSink::FRAME_ENU, odom);
+    }
+}
+
+void InsCore::pimu(const pimu_t &msg, int outputs)
+{
+    angular_rate_[0] = msg.theta[0] / msg.dt;
+    angular_rate_[1] = msg.theta[1] / msg.dt;
+    angular_rate_[2] = msg.theta[2] / msg.dt;
+
+    if (!(outputs & (IMU | PREINT_IMU)))
+        return;
+
+    ins_stamp_t stamp = time_sync.from_start_time(msg.time);
+
+    if ((outputs & PREINT_IMU) && sink_)
+    {
+        ins_preint_imu_t preint;
+        preint.stamp = stamp;
+        for (int i = 0; i < 3; i++)
+        {
+            preint.dtheta[i] = msg.theta[i];
+            preint.dvel[i] = msg.vel[i];
+        }
+        preint.dt = msg.dt;
+        sink_->preint_imu(preint);
+    }
+
+    if ((outputs & IMU) && sink_)
+    {
+        // Orientation and covariances of the latest ENU odometry
+        const ins_odometry_t &enu = odom_[InsSink::FRAME_ENU];
+        ins_imu_t imu;
+        imu.stamp = stamp;
+        for (int i = 0; i < 3; i++)
+        {
+            imu.angular_velocity[i] = angular_rate_[i];
+            imu.linear_acceleration[i] = msg.vel[i] / msg.dt;
+            imu.orientation_covariance[i] = enu.pose_covariance[21 + 7 * i];
+            imu.angular_velocity_covariance[i] = enu.twist_covariance[21 + 7 * i];
+            imu.linear_acceleration_covariance[i] = enu.twist_covariance[7 * i];
+        }
+        for (int i = 0; i < 4; i++)
+            imu.orientation[i] = enu.orientation[i];
+        sink_->imu(imu);
+    }
+}
+
+void InsCore::LD2Cov(const float *LD, float *Cov, int width)
+{
+    for (int j = 0; j < width; j++)
+    {
+        for (int i = 0; i < width; i++)
+        {
+            if (i < j)
+            {
+                Cov[i * width + j] = Cov[j * width + i];
+            }
+            else
+            {
+                Cov[i * width + j] = LD[(i * i + i) / 2 + j];
+            }
+        }
+    }
+}
+
+void InsCore::rotMatB2R(const ixVector4 quat, ixMatrix3 R)
+{
+    R[0] = 1.0f - 2.0f * (quat[2] * quat[2] + quat[3] * quat[3]);
+    R[1] = 2.0f * (quat[1] * quat[2] - quat[0] * quat[3]);
+    R[2] = 2.0f * (quat[1] * quat[3] + quat[0] * quat[2]);
+    R[3] = 2.0f * (quat[1] * quat[2] + quat[0] * quat[3]);
+    R[4] = 1.0f - 2.0f * (quat[1] * quat[1] + quat[3] * quat[3]);
+    R[5] = 2.0f * (quat[2] * quat[3] - quat[0] * quat[1]);
+    R[6] = 2.0f * (quat[1] * quat[3] - quat[0] * quat[2]);
+    R[7] = 2.0f * (quat[2] * quat[3] + quat[0] * quat[1]);
+    R[8] = 1.0f - 2.0f * (quat[1] * quat[1] + quat[2] * quat[2]);
+}
+
+void InsCore::transform_6x6_covariance(float Pout[36], const float Pin[36], const ixMatrix3 R1, const ixMatrix3 R2)
+{
+    // Assumption: input covariance matrix is transformed due to change of coordinates,
+    // so that fisrt 3 coordinates are rotated by R1 and the last 3 coordinates are rotated by R2
+    // This is how the transformation looks:
+    // |R1  0 | * |Pxx  Pxy'| * |R1' 0  | = |R1*Pxx*R1'  R1*Pxy'*R2'|
+    // |0   R2|   |Pxy  Pyy |   |0   R2'|   |R2*Pxy*R1'  R2*Pyy*R2' |
+
+    ixMatrix3 Pxx_in, Pxy_in, Pyy_in, Pxx_out, Pxy_out, Pyy_out, buf;
+
+    // Extract 3x3 blocks from input covariance
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            // Upper diagonal block in old frame
+            Pxx_in[i * 3 + j] = Pin[i * 6 + j];
+            // Lower left block of in old frame
+            Pxy_in[i * 3 + j] = Pin[(i + 3) * 6 + j];
+            // Lower diagonal block in old frame
+            Pyy_in[i * 3 + j] = Pin[(i + 3) * 6 + j + 3];
+        }
+    }
+    // Transform the 3x3 covariance blocks
+    // New upper diagonal block
+    mul_Mat3x3_Mat3x3(buf, R1, Pxx_in);
+    mul_Mat3x3_Mat3x3_Trans(Pxx_out, buf, R1);
+    // New lower left block
+    mul_Mat3x3_Mat3x3(buf, R2, Pxy_in);
+    mul_Mat3x3_Mat3x3_Trans(Pxy_out, buf, R1);
+    // New lower diagonal  block
+    mul_Mat3x3_Mat3x3(buf, R2, Pyy_in);
+    mul_Mat3x3_Mat3x3_Trans(Pyy_out, buf, R2);
+
+    // Copy the computed transformed blocks into output 6x6 covariance matrix
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            // Upper diagonal block in the new frame
+            Pout[i * 6 + j] = Pxx_in[i * 3 + j];
+            // Lower left block in the new frame
+            Pout[(i + 3) * 6 + j] = Pxy_in[i * 3 + j];
+            // Upper right block in the new frame
+            Pout[i * 6 + j + 3] = Pxy_in[j * 3 + i];
+            // Lower diagonal block in the new frame
+            Pout[(i + 3) * 6 + j + 3] = Pyy_in[i * 3 + j];
+        }
+    }
+}
@@ -0,0 +1,158 @@
+/**
+ * \file isb_framer.cpp
+ */
+
+#include <isb_framer.h>
+
+#include <string.h>
+
+// Initial value of the 24 bit ISB packet checksum
+#define ISB_CHECKSUM_SEED 0x00AAAAAA
+
+static inline bool put_escaped(uint8_t byte, uint8_t *out, size_t capacity, size_t &n)
+{
+  bool escape = (byte == PSC_START_BYTE || byte == PSC_END_BYTE || byte == PSC_ESCAPE_BYTE);
+  if (n + (escape ? 2 : 1) > capacity)
+    return false;
+  if (escape)
+  {
+    out[n++] = PSC_ESCAPE_BYTE;
+    out[n++] = ~byte;
+  }
+  else
+  {
+    out[n++] = byte;
+  }
+  return true;
+}
+
+IsbFramer::IsbFramer() :
+  packets_(0),
+  checksum_errors_(0),
+  dropped_bytes_(0)
+{
+}
+
+bool IsbFramer::next(uint8_t *buf, size_t len, size_t &pos, IsbPacket &packet)
+{
+  while (pos < len)
+  {
+    uint8_t *start = (uint8_t*)memchr(buf + pos, PSC_START_BYTE, len - pos);
+    if (start == NULL)
+    {
+      dropped_bytes_ += len - pos;
+      pos = len;
+      return false;
+    }
+    dropped_bytes_ += start - (buf + pos);
+    pos = start - buf;
+
+    uint8_t *end = (uint8_t*)memchr(start + 1, PSC_END_BYTE, len - pos - 1);
+    if (end == NULL)
+      return false; // wait for the rest of the packet
+
+    // A start byte inside the frame means the packet before it was truncated, resync on it
+    uint8_t *restart = (uint8_t*)memchr(start + 1, PSC_START_BYTE, end - start - 1);
+    if (restart != NULL)
+    {
+      dropped_bytes_ += restart - start;
+      pos = restart - buf;
+      continue;
+    }
+
+    // Everything before start is consumed, so the packet can move down to an aligned address
+    uint8_t *out = buf + ((start - buf) & ~(size_t)7);
+    pos = end - buf + 1;
+    if (decode(start, end, out, packet))
+    {
+      packets_++;
+      return true;
+    }
+    dropped_bytes_ += end - start + 1;
+  }
+  return false;
+}
+
+bool IsbFramer::decode(uint8_t *start, uint8_t *end, uint8_t *out, IsbPacket &packet)
+{
+  // Unescape [start, end) into out.  out <= start, and unescaping never grows the packet.
+  size_t n = 0;
+  for (uint8_t *in = start; in < end; in++)
+  {
+    if (*in == PSC_ESCAPE_BYTE)
+    {
+      if (++in == end)
+        return false;
+      out[n++] = ~*in;
+    }
+    else
+    {
+      out[n++] = *in;
+    }
+  }
+
+  // start byte, pid, counter, flags, body, 3 checksum bytes
+  if (n < sizeof(packet_hdr_t) + 3)
+    return false;
+
+  uint32_t checksum = ISB_CHECKSUM_SEED;
+  int shift = 0;
+  for (size_t i = 1; i < n - 3; i++)
+  {
+    checksum ^= (uint32_t)out[i] << shift;
+    shift = (shift == 16) ? 0 : shift + 8;
+  }
+  uint32_t received = ((uint32_t)out[n - 3] << 16) | ((uint32_t)out[n - 2] << 8) | out[n - 1];
+  if (checksum != received)
+  {
+    checksum_errors_++;
+    return false;
+  }
+
+  packet.pid = out[1];
+  packet.counter = out[2];
+  packet.flags = out[3];
+  packet.body = out + sizeof(packet_hdr_t);
+  packet.body_size = n - sizeof(packet_hdr_t) - 3;
+  packet.hdr = NULL;
+  packet.data = NULL;
+
+  if ((packet.pid == PID_DATA || packet.pid == PID_SET_DATA) && packet.body_size >= sizeof(p_data_hdr_t))
+  {
+    const p_data_hdr_t *hdr = reinterpret_cast<const p_data_hdr_t*>(packet.body);
+    if (hdr->size != packet.body_size - sizeof(p_data_hdr_t))
+      return false;
+    packet.hdr = hdr;
+    packet.data = packet.body + sizeof(p_data_hdr_t);
+  }
+  return true;
+}
+
+size_t IsbFramer::encode(uint8_t pid, uint8_t counter, const void *body, size_t size, uint8_t *out, size_t capacity)
+{
+  uint8_t header[3] = { pid, counter, 0 };
+  uint32_t checksum = ISB_CHECKSUM_SEED;
+  int shift = 0;
+  size_t n = 0;
+
+  if (capacity < 1)
+    return 0;
+  out[n++] = PSC_START_BYTE;
+
+  for (size_t i = 0; i < sizeof(header) + size; i++)
+  {
+    uint8_t byte = (i < sizeof(header)) ? header[i] : ((const uint8_t*)body)[i - sizeof(header)];
+    checksum ^= (uint32_t)byte << shift;
+    shift = (shift == 16) ? 0 : shift + 8;
+    if (!put_escaped(byte, out, capacity, n))
+      return 0;
+  }
+
+  if (!put_escaped(checksum >> 16, out, capacity, n) ||
+      !put_escaped(checksum >> 8, out, capacity, n) ||
+      !put_escaped(checksum, out, capacity, n) ||
+      n + 1 > capacity)
+    return 0;
+  out[n++] = PSC_END_BYTE;
+  return n;
+}
@@ -0,0 +1,52 @@
+#include "isb_raw.h"
+
+#include <string.h>
+
+IsbRawWriter::IsbRawWriter() :
+    counter_(0)
+{
+}
+
+void IsbRawWriter::append(const p_data_t *data)
+{
+    // The data header and data are contiguous in p_data_t, which is the PID_DATA packet body
+    size_t bodySize = sizeof(p_data_hdr_t) + data->hdr.size;
+    size_t start = batch_.data.size();
+    size_t capacity = 2 * bodySize + 16;
+
+    batch_.data.resize(start + capacity);
+    size_t n = IsbFramer::encode(PID_DATA, counter_++, &data->hdr, bodySize, &batch_.data[start], capacity);
+    batch_.data.resize(start + n);
+    if (n == 0)
+        return;
+
+    batch_.did.push_back(data->hdr.id);
+    batch_.offset.push_back(data->hdr.offset);
+    batch_.end.push_back(start + n);
+}
+
+void IsbRawWriter::take(const ros::Time &stamp, inertial_sense_ros::ISBRaw &out)
+{
+    batch_.header.stamp = stamp;
+    batch_.header.frame_id = out.header.frame_id;
+    std::swap(batch_, out);
+    batch_.did.clear();
+    batch_.offset.clear();
+    batch_.end.clear();
+    batch_.data.clear();
+}
+
+IsbRawReader::IsbRawReader(const inertial_sense_ros::ISBRaw &raw) :
+    buffer_((raw.data.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t)),
+    size_(raw.data.size()),
+    pos_(0),
+    stamp_(raw.header.stamp)
+{
+    if (size_ > 0)
+        memcpy(buffer_.data(), raw.data.data(), size_);
+}
+
+bool IsbRawReader::next(IsbPacket &packet)
+{
+    return framer_.next(reinterpret_cast<uint8_t *>(buffer_.data()), size_, pos_, packet);
+}
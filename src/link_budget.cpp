@@ -0,0 +1,208 @@
+#include "link_budget.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include "ISComm.h"
+#include "data_sets.h"
+
+// start byte, packet header, data header, 3 checksum bytes and end byte
+static const size_t PACKET_OVERHEAD = 1 + 3 + sizeof(p_data_hdr_t) + 3 + 1;
+// 3 of 256 byte values are escaped with an extra byte
+static const double ESCAPE_OVERHEAD = 1.0 + 3.0 / 256.0;
+// bits on the wire per byte with 8N1 framing
+static const double BITS_PER_BYTE = 10.0;
+
+LinkBudget::LinkBudget(int baudrate, double headroom) :
+    baudrate_(baudrate),
+    headroom_(headroom)
+{
+}
+
+void LinkBudget::set_link(int baudrate, double headroom)
+{
+    baudrate_ = baudrate;
+    headroom_ = headroom;
+}
+
+void LinkBudget::set_source_periods(double navPeriodMs, double gpsPeriodMs)
+{
+    if (navPeriodMs > 0.0)
+        nav_period_ms_ = navPeriodMs;
+    if (gpsPeriodMs > 0.0)
+        gps_period_ms_ = gpsPeriodMs;
+}
+
+double LinkBudget::source_period_ms(uint32_t did) const
+{
+    switch (did)
+    {
+    case DID_GPS1_POS:
+    case DID_GPS1_VEL:
+    case DID_GPS1_SAT:
+    case DID_GPS1_RAW:
+    case DID_GPS2_POS:
+    case DID_GPS2_VEL:
+    case DID_GPS2_SAT:
+    case DID_GPS2_RAW:
+    case DID_GPS_BASE_RAW:
+    case DID_GPS1_RTK_POS_REL:
+    case DID_GPS1_RTK_POS_MISC:
+    case DID_GPS2_RTK_CMP_REL:
+    case DID_GPS2_RTK_CMP_MISC:
+        return gps_period_ms_;
+    case DID_STROBE_IN_TIME:
+        return 0.0; // only sent on strobe events
+    default:
+        return nav_period_ms_;
+    }
+}
+
+double LinkBudget::packet_size(size_t dataSize)
+{
+    return (PACKET_OVERHEAD + dataSize) * ESCAPE_OVERHEAD;
+}
+
+int LinkBudget::plan_stream(uint32_t did, size_t size, int periodMultiple)
+{
+    if (periodMultiple <= 0)
+    {
+        streams_.erase(did);
+        return periodMultiple;
+    }
+
+    stream_t &stream = streams_[did];
+    stream.size = size;
+    if (stream.requested_multiple != periodMultiple)
+    {
+        stream.requested_multiple = periodMultiple;
+        stream.period_multiple = periodMultiple;
+    }
+    // A scaled stream keeps its scaled period when it is requested again
+    return stream.period_multiple;
+}
+
+double LinkBudget::stream_rate(uint32_t did, const stream_t &stream) const
+{
+    return packet_size(stream.size) * planned_packet_rate(did, stream);
+}
+
+double LinkBudget::capacity() const
+{
+    return baudrate_ / BITS_PER_BYTE;
+}
+
+double LinkBudget::planned_rate() const
+{
+    double rate = 0.0;
+    for (stream_map_t::const_iterator it = streams_.begin(); it != streams_.end(); ++it)
+        rate += stream_rate(it->first, it->second);
+    return rate;
+}
+
+std::map<uint32_t, int> LinkBudget::scale_to_fit()
+{
+    std::map<uint32_t, int> changed;
+    if (!auto_scale_)
+        return changed;
+
+    // Each step at least halves the rate of one stream, so this terminates
+    while (over_budget())
+    {
+        stream_map_t::iterator heaviest = streams_.end();
+        double heaviest_rate = 0.0;
+        for (stream_map_t::iterator it = streams_.begin(); it != streams_.end(); ++it)
+        {
+            double rate = stream_rate(it->first, it->second);
+            if (rate > heaviest_rate)
+            {
+                heaviest = it;
+                heaviest_rate = rate;
+            }
+        }
+        if (heaviest == streams_.end())
+            break;
+
+        heaviest->second.period_multiple *= 2;
+        changed[heaviest->first] = heaviest->second.period_multiple;
+    }
+    return changed;
+}
+
+void LinkBudget::received(uint32_t did, size_t dataSize)
+{
+    size_t bytes = (size_t)packet_size(dataSize);
+    measured_bytes_ += bytes;
+    stream_map_t::iterator it = streams_.find(did);
+    if (it != streams_.end())
+    {
+        it->second.received_bytes += bytes;
+        it->second.received_packets++;
+        it->second.window_packets++;
+    }
+}
+
+double LinkBudget::measure(double now)
+{
+    double rate = 0.0;
+    if (last_measure_time_ >= 0.0 && now > last_measure_time_)
+    {
+        double dt = now - last_measure_time_;
+        rate = measured_bytes_ / dt;
+        for (stream_map_t::iterator it = streams_.begin(); it != streams_.end(); ++it)
+            it->second.measured_rate = it->second.window_packets / dt;
+    }
+    for (stream_map_t::iterator it = streams_.begin(); it != streams_.end(); ++it)
+        it->second.window_packets = 0;
+    measured_bytes_ = 0;
+    last_measure_time_ = now;
+    return rate;
+}
+
+double LinkBudget::planned_packet_rate(uint32_t did, const stream_t &stream) const
+{
+    double period_ms = source_period_ms(did) * stream.period_multiple;
+    return (period_ms > 0.0) ? 1000.0 / period_ms : 0.0;
+}
+
+std::map<uint32_t, double> LinkBudget::lagging_streams(double ratio) const
+{
+    std::map<uint32_t, double> lagging;
+    for (stream_map_t::const_iterator it = streams_.begin(); it != streams_.end(); ++it)
+    {
+        double planned = planned_packet_rate(it->first, it->second);
+        if (planned > 0.0 && it->second.measured_rate < ratio * planned)
+            lagging[it->first] = it->second.measured_rate / planned;
+    }
+    return lagging;
+}
+
+std::string LinkBudget::report() const
+{
+    std::vector<std::pair<double, uint32_t> > order;
+    for (stream_map_t::const_iterator it = streams_.begin(); it != streams_.end(); ++it)
+        order.push_back(std::make_pair(stream_rate(it->first, it->second), it->first));
+    std::sort(order.rbegin(), order.rend());
+
+    std::string report;
+    char line[128];
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        uint32_t did = order[i].second;
+        const stream_t &stream = streams_.find(did)->second;
+        double period_ms = source_period_ms(did) * stream.period_multiple;
+        if (period_ms <= 0.0)
+        {
+            snprintf(line, sizeof(line), "  DID %3u: %5zu B on events\n", did, stream.size);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "  DID %3u: %5zu B x %6.1f Hz = %7.0f B/s (%4.1f%%)%s\n", did, stream.size,
+                     1000.0 / period_ms, order[i].first, 100.0 * order[i].first / capacity(),
+                     stream.period_multiple != stream.requested_multiple ? " scaled" : "");
+        }
+        report += line;
+    }
+    return report;
+}
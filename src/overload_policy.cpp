@@ -0,0 +1,182 @@
+#include "overload_policy.h"
+
+#include <string.h>
+#include <algorithm>
+
+static const double HYSTERESIS = 0.1; // utilization drop before a level is left
+static const int MAX_SKIPPED_RUNS = 4;
+
+OverloadPolicy::OverloadPolicy(double shedLow, double shedNormal, double window, size_t coalesceLimit)
+    : shed_low_(shedLow), shed_normal_(shedNormal), window_(window), coalesce_limit_(std::max<size_t>(coalesceLimit, 1))
+{
+}
+
+void OverloadPolicy::set_policy(uint32_t did, priority_t priority, drop_t drop)
+{
+    stream_t &stream = streams_[did];
+    stream.priority = priority;
+    stream.drop = drop;
+    if (drop == DROP_NEVER || priority == PRIORITY_HIGH)
+        flush(stream);
+}
+
+void OverloadPolicy::dispatch(const p_data_t *data, double receiveTime)
+{
+    packets_++;
+    stream_map_t::iterator it = streams_.find(data->hdr.id);
+    if (it == streams_.end())
+    {
+        dispatch_(data, receiveTime);
+        return;
+    }
+
+    stream_t &stream = it->second;
+    if (stream.drop == DROP_NEVER || !shed(stream.priority))
+    {
+        // Keep the order of the stream's packets
+        flush(stream);
+        dispatch_(data, receiveTime);
+        return;
+    }
+
+    size_t limit = (stream.drop == DROP_LATEST) ? 1 : coalesce_limit_;
+    if (stream.pending.size() >= limit)
+    {
+        stream.pending.pop_front();
+        stream.dropped++;
+    }
+    stream.pending.emplace_back();
+    held_t &held = stream.pending.back();
+    held.receive_time = receiveTime;
+    held.data.hdr = data->hdr;
+    held.data.hdr.size = std::min<uint32_t>(data->hdr.size, sizeof(held.data.buf));
+    memcpy(held.data.buf, data->buf, held.data.hdr.size);
+    stream.deferred++;
+    holding_ = true;
+}
+
+void OverloadPolicy::flush(stream_t &stream)
+{
+    while (!stream.pending.empty())
+    {
+        // Popped only after the handler, which must not reach back into this stream
+        dispatch_(&stream.pending.front().data, stream.pending.front().receive_time);
+        stream.pending.pop_front();
+        stream.flushed++;
+    }
+}
+
+void OverloadPolicy::flush()
+{
+    if (!holding_)
+        return;
+    holding_ = false;
+    for (int priority = PRIORITY_HIGH; priority >= PRIORITY_LOW; priority--)
+    {
+        for (stream_map_t::iterator it = streams_.begin(); it != streams_.end(); ++it)
+        {
+            stream_t &stream = it->second;
+            if (stream.priority != priority || stream.pending.empty())
+                continue;
+            if (shed(stream.priority))
+                holding_ = true;
+            else
+                flush(stream);
+        }
+    }
+}
+
+void OverloadPolicy::read_done(double start, double end)
+{
+    if (window_start_ < 0.0)
+        window_start_ = start;
+    if (packets_ == 0)
+        idle_ += end - start;
+    packets_ = 0;
+
+    double elapsed = end - window_start_;
+    if (elapsed < window_)
+        return;
+    utilization_ = std::max(0.0, 1.0 - idle_ / elapsed);
+    window_start_ = end;
+    idle_ = 0.0;
+
+    int level = level_;
+    if (utilization_ > shed_normal_)
+        level = 2;
+    else if (utilization_ > shed_low_)
+        level = std::max(level, 1);
+    if (level == 2 && utilization_ < shed_normal_ - HYSTERESIS)
+        level = 1;
+    if (level == 1 && utilization_ < shed_low_ - HYSTERESIS)
+        level = 0;
+    if (level != level_)
+    {
+        level_ = level;
+        level_changes_++;
+    }
+}
+
+bool OverloadPolicy::skip(priority_t priority, int &consecutive)
+{
+    if (!shed(priority) || consecutive >= MAX_SKIPPED_RUNS)
+    {
+        consecutive = 0;
+        return false;
+    }
+    consecutive++;
+    skipped_runs_++;
+    return true;
+}
+
+bool OverloadPolicy::parse_priority(const std::string &name, priority_t &priority)
+{
+    for (int p = PRIORITY_LOW; p <= PRIORITY_HIGH; p++)
+    {
+        if (name == priority_name((priority_t)p))
+        {
+            priority = (priority_t)p;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool OverloadPolicy::parse_drop(const std::string &name, drop_t &drop)
+{
+    for (int d = DROP_LATEST; d <= DROP_NEVER; d++)
+    {
+        if (name == drop_name((drop_t)d))
+        {
+            drop = (drop_t)d;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *OverloadPolicy::priority_name(priority_t priority)
+{
+    switch (priority)
+    {
+    case PRIORITY_LOW:
+        return "low";
+    case PRIORITY_NORMAL:
+        return "normal";
+    default:
+        return "high";
+    }
+}
+
+const char *OverloadPolicy::drop_name(drop_t drop)
+{
+    switch (drop)
+    {
+    case DROP_LATEST:
+        return "latest";
+    case DROP_COALESCE:
+        return "coalesce";
+    default:
+        return "never";
+    }
+}
@@ -0,0 +1,69 @@
+#include "reconnect_supervisor.h"
+
+#include <sys/stat.h>
+#include <algorithm>
+
+ReconnectSupervisor::ReconnectSupervisor(const std::string &port, double linkTimeout, double minBackoff, double maxBackoff) : port_(port), link_timeout_(linkTimeout), min_backoff_(minBackoff), max_backoff_(maxBackoff), backoff_(minBackoff)
+{
+}
+
+void ReconnectSupervisor::set_handlers(open_fn_t open, close_fn_t close, resume_fn_t resume)
+{
+    open_ = open;
+    close_ = close;
+    resume_ = resume;
+}
+
+void ReconnectSupervisor::data_received(double now)
+{
+    last_rx_time_ = now;
+    data_seen_ = true;
+}
+
+bool ReconnectSupervisor::port_present() const
+{
+    struct stat st;
+    return port_.empty() || stat(port_.c_str(), &st) == 0;
+}
+
+void ReconnectSupervisor::lost(double now, const char *reason)
+{
+    connected_ = false;
+    outage_start_ = now;
+    outage_count_++;
+    backoff_ = min_backoff_;
+    next_attempt_ = now + backoff_;
+    if (close_)
+        close_(reason);
+}
+
+void ReconnectSupervisor::update(double now)
+{
+    if (connected_)
+    {
+        if (!port_present())
+            lost(now, "port removed");
+        else if (link_timeout_ > 0 && data_seen_ && now - last_rx_time_ > link_timeout_)
+            lost(now, "no data");
+        return;
+    }
+
+    if (now < next_attempt_)
+        return;
+
+    reconnect_attempts_++;
+    if (port_present() && open_ && open_())
+    {
+        connected_ = true;
+        // Restart the data timeout from the reconnect, the device may need a moment to stream again
+        last_rx_time_ = now;
+        last_outage_duration_ = now - outage_start_;
+        total_outage_duration_ += last_outage_duration_;
+        if (resume_)
+            resume_();
+        return;
+    }
+
+    backoff_ = std::min(2.0 * backoff_, max_backoff_);
+    next_attempt_ = now + backoff_;
+}
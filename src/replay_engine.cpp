@@ -0,0 +1,96 @@
+#include "replay_engine.h"
+
+#include <chrono>
+#include <thread>
+
+#include "isb_raw.h"
+
+BagReplaySource::BagReplaySource(const std::string &path, const std::string &topic)
+{
+    bag_.open(path, rosbag::bagmode::Read);
+    // Topics are recorded with the node's namespace, so match on the last name only
+    std::string suffix = "/" + topic;
+    view_.reset(new rosbag::View(bag_, [suffix, topic](const rosbag::ConnectionInfo *info)
+    {
+        const std::string &name = info->topic;
+        return info->datatype == "inertial_sense_ros/ISBRaw" &&
+               (name == topic || (name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0));
+    }));
+    it_ = view_->begin();
+}
+
+bool BagReplaySource::next(inertial_sense_ros::ISBRaw &batch)
+{
+    while (it_ != view_->end())
+    {
+        inertial_sense_ros::ISBRaw::ConstPtr msg = (it_++)->instantiate<inertial_sense_ros::ISBRaw>();
+        if (msg)
+        {
+            batch = *msg;
+            return true;
+        }
+    }
+    return false;
+}
+
+ReplayEngine::ReplayEngine(ReplaySource &source, double rate) :
+    source_(source),
+    rate_(rate)
+{
+    wall_now_ = []()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    };
+    wall_sleep_ = [](double seconds)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    };
+}
+
+void ReplayEngine::set_wall_clock(wall_now_t now, wall_sleep_t sleep)
+{
+    wall_now_ = now;
+    wall_sleep_ = sleep;
+}
+
+ReplayEngine::stats_t ReplayEngine::run(ReplayTarget &target)
+{
+    stats_t stats;
+    inertial_sense_ros::ISBRaw batch;
+    double wall_start = wall_now_();
+    ros::Time first;
+
+    while (target.ok() && source_.next(batch))
+    {
+        if (stats.batches == 0)
+            first = batch.header.stamp;
+        double recorded = (batch.header.stamp - first).toSec();
+
+        // Batches are released no earlier than their recorded offset, never reordered
+        if (rate_ > 0.0)
+        {
+            double wait = wall_start + recorded / rate_ - wall_now_();
+            if (wait > 0.0)
+                wall_sleep_(wait);
+        }
+
+        target.set_time(batch.header.stamp);
+        IsbRawReader reader(batch);
+        IsbPacket packet;
+        while (reader.next(packet))
+        {
+            // The data directly follows its header in the framed packet, as in p_data_t
+            if (packet.pid != PID_DATA || packet.hdr == NULL)
+                continue;
+            target.deliver(reinterpret_cast<const p_data_t *>(packet.hdr));
+            stats.packets++;
+        }
+        target.batch_done();
+        stats.checksum_errors += reader.checksum_errors();
+        stats.recorded_duration = recorded;
+        stats.batches++;
+    }
+
+    stats.wall_duration = wall_now_() - wall_start;
+    return stats;
+}
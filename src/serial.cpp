@@ -37,15 +37,23 @@
 
 #include <serial.h>
 
+#include <boost/array.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
 
 using boost::asio::serial_port_base;
 
 Serial::Serial(std::string port, int baud_rate) :
   io_service_(),
-  write_in_progress_(false),
   serial_port_(io_service_),
   port_(port),
-  baud_rate_(baud_rate)
+  baud_rate_(baud_rate),
+  read_index_(0),
+  read_pending_(0),
+  write_head_(0),
+  write_count_(0),
+  write_in_progress_(false)
 {
   listener_ = NULL;
 }
@@ -71,18 +79,34 @@ void Serial::open()
     throw SerialException(e);
   }
 
+  std::string error;
+  if (!tuning_.apply_to_port(port_, error))
+    std::cerr << "Serial tuning of " << port_ << " incomplete: " << error << std::endl;
+
   // start reading from the port
   async_read();
   io_thread_ = boost::thread(boost::bind(&boost::asio::io_service::run, &this->io_service_));
+
+  if (!tuning_.apply_to_thread(io_thread_.native_handle(), error))
+    std::cerr << "Serial io thread tuning incomplete: " << error << std::endl;
 }
 
 void Serial::close()
 {
-  mutex_lock lock(mutex_);
+  {
+    mutex_lock lock(mutex_);
 
-  io_service_.stop();
-  serial_port_.close();
+    io_service_.stop();
+    serial_port_.close();
 
+    // Anything still queued can no longer be sent, release blocked writers
+    write_head_ = 0;
+    write_count_ = 0;
+    write_in_progress_ = false;
+    write_space_.notify_all();
+  }
+
+  // The io thread may be waiting on mutex_ in a write handler, so join without holding it
   if (io_thread_.joinable())
   {
     io_thread_.join();
@@ -102,12 +126,12 @@ void Serial::async_read()
   if (!serial_port_.is_open()) return;
 
   serial_port_.async_read_some(
-        boost::asio::buffer(read_buf_raw_, BUFFER_SIZE),
-        boost::bind(
+        boost::asio::buffer(read_buf_[read_index_] + read_pending_, READ_BUFFER_SIZE - read_pending_),
+        make_alloc_handler(read_handler_memory_, boost::bind(
           &Serial::async_read_end,
           this,
           boost::asio::placeholders::error,
-          boost::asio::placeholders::bytes_transferred));
+          boost::asio::placeholders::bytes_transferred)));
 }
 
 void Serial::async_read_end(const boost::system::error_code &error, size_t bytes_transferred)
@@ -116,81 +140,110 @@ void Serial::async_read_end(const boost::system::error_code &error, size_t bytes
 
   if (error)
   {
-    close();
+    // Close the port and stop the io service here rather than with close(), which would join the
+    // io thread from itself; close() from the owner still joins it later
+    std::cerr << error.message() << std::endl;
+    read_pending_ = 0;
+    mutex_lock lock(mutex_);
+    boost::system::error_code ignored;
+    serial_port_.close(ignored);
+    io_service_.stop();
+    write_head_ = 0;
+    write_count_ = 0;
+    write_in_progress_ = false;
+    write_space_.notify_all();
     return;
   }
 
-  listener_->handle_bytes(read_buf_raw_, bytes_transferred);
+  uint8_t *buf = read_buf_[read_index_];
+  size_t len = read_pending_ + bytes_transferred;
+  if (listener_ != NULL)
+    listener_->handle_bytes(buf + read_pending_, bytes_transferred);
+
+  size_t pos = 0;
+  IsbPacket packet;
+  while (framer_.next(buf, len, pos, packet))
+  {
+    if (listener_ != NULL)
+      listener_->handle_packet(packet);
+  }
+
+  // Carry an incomplete packet over to the other buffer, unless it can never complete
+  read_pending_ = len - pos;
+  if (read_pending_ == READ_BUFFER_SIZE)
+    read_pending_ = 0;
+  read_index_ ^= 1;
+  memcpy(read_buf_[read_index_], buf + pos, read_pending_);
 
   async_read();
 }
 
-void Serial::write(const uint8_t* bytes, uint8_t len)
+void Serial::write(const uint8_t* bytes, size_t len)
 {
-  assert(len <= BUFFER_SIZE); //! \todo Do something less catastrophic here
-
-  WriteBuffer *buffer = new WriteBuffer();
-  buffer->len = len;
-  for (int i = 0; i < len; i++)
-  {
-    buffer->data[i] = bytes[i];
-  }
-
+  mutex_lock lock(mutex_);
+  while (len > 0)
   {
-    mutex_lock lock(mutex_);
-    write_queue_.push_back(buffer);
+    while (write_count_ == WRITE_BUFFER_SIZE && serial_port_.is_open())
+      write_space_.wait(lock);
+
+    if (!serial_port_.is_open())
+      throw SerialException("write to closed port " + port_);
+
+    // Copy as much as fits between the tail of the ring and either the head or the end of the storage
+    size_t tail = (write_head_ + write_count_) % WRITE_BUFFER_SIZE;
+    size_t n = std::min(len, std::min(WRITE_BUFFER_SIZE - write_count_, WRITE_BUFFER_SIZE - tail));
+    memcpy(write_ring_ + tail, bytes, n);
+    write_count_ += n;
+    bytes += n;
+    len -= n;
+
+    if (!write_in_progress_)
+      async_write();
   }
-
-  async_write(true);
 }
 
-void Serial::async_write(bool check_write_state)
+void Serial::async_write()
 {
-  if (check_write_state && write_in_progress_)
+  if (write_count_ == 0)
+  {
+    write_in_progress_ = false;
     return;
+  }
 
-  mutex_lock lock(mutex_);
-  if (write_queue_.empty())
-    return;
+  // The queued bytes are at most two contiguous runs of the ring, send both with one writev
+  size_t first = std::min(write_count_, WRITE_BUFFER_SIZE - write_head_);
+  boost::array<boost::asio::const_buffer, 2> buffers = {{
+    boost::asio::buffer(write_ring_ + write_head_, first),
+    boost::asio::buffer(write_ring_, write_count_ - first)
+  }};
 
   write_in_progress_ = true;
-  WriteBuffer *buffer = write_queue_.front();
   serial_port_.async_write_some(
-        boost::asio::buffer(buffer->dpos(), buffer->nbytes()),
-        boost::bind(
+        buffers,
+        make_alloc_handler(write_handler_memory_, boost::bind(
           &Serial::async_write_end,
           this,
           boost::asio::placeholders::error,
-          boost::asio::placeholders::bytes_transferred));
-
+          boost::asio::placeholders::bytes_transferred)));
 }
 
 void Serial::async_write_end(const boost::system::error_code &error, std::size_t bytes_transferred)
 {
+  mutex_lock lock(mutex_);
   if (error)
   {
+    // Drop what is queued rather than closing from the io thread, which would join itself
     std::cerr << error.message() << std::endl;
-    close();
-    return;
-  }
-
-  mutex_lock lock(mutex_);
-  if (write_queue_.empty())
-  {
+    write_head_ = 0;
+    write_count_ = 0;
     write_in_progress_ = false;
+    write_space_.notify_all();
     return;
   }
 
-  WriteBuffer *buffer = write_queue_.front();
-  buffer->pos += bytes_transferred;
-  if (buffer->nbytes() == 0)
-  {
-    write_queue_.pop_front();
-    delete buffer;
-  }
+  write_head_ = (write_head_ + bytes_transferred) % WRITE_BUFFER_SIZE;
+  write_count_ -= bytes_transferred;
+  write_space_.notify_all();
 
-  if (write_queue_.empty())
-    write_in_progress_ = false;
-  else
-    async_write(false);
+  async_write();
 }
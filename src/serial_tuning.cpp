@@ -0,0 +1,129 @@
+#include "serial_tuning.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <linux/serial.h>
+#include <fstream>
+
+static std::string errno_string(const std::string &what)
+{
+    return what + ": " + strerror(errno);
+}
+
+// FTDI adapters hold received bytes for up to latency_timer ms (16 by default) before sending them over USB
+static bool set_latency_timer(const std::string &port, int milliseconds, std::string &error)
+{
+    char path[PATH_MAX];
+    if (realpath(port.c_str(), path) == NULL)
+    {
+        error = errno_string("realpath " + port);
+        return false;
+    }
+    std::string tty = path;
+    tty = tty.substr(tty.find_last_of('/') + 1);
+
+    std::string timer = "/sys/bus/usb-serial/devices/" + tty + "/latency_timer";
+    if (access(timer.c_str(), F_OK) != 0)
+        return true; // not a usb-serial adapter with a latency timer (e.g. CDC-ACM)
+
+    std::ofstream file(timer.c_str());
+    file << milliseconds << std::endl;
+    if (!file)
+    {
+        error = "unable to write " + timer;
+        return false;
+    }
+    return true;
+}
+
+bool SerialTuning::apply_to_port(const std::string &port, std::string &error) const
+{
+    if (!low_latency && vmin < 0 && vtime < 0)
+        return true;
+
+    int fd = open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        error = errno_string("open " + port);
+        return false;
+    }
+
+    bool ok = true;
+    if (low_latency)
+    {
+        struct serial_struct serial;
+        if (ioctl(fd, TIOCGSERIAL, &serial) == 0)
+        {
+            serial.flags |= ASYNC_LOW_LATENCY;
+            if (ioctl(fd, TIOCSSERIAL, &serial) != 0)
+            {
+                error = errno_string("ASYNC_LOW_LATENCY");
+                ok = false;
+            }
+        }
+        // Drivers without TIOCGSERIAL (e.g. cdc_acm) don't batch on the host side
+        ok = set_latency_timer(port, latency_timer_ms, error) && ok;
+    }
+
+    if (vmin >= 0 || vtime >= 0)
+    {
+        struct termios options;
+        if (tcgetattr(fd, &options) != 0)
+        {
+            error = errno_string("tcgetattr");
+            ok = false;
+        }
+        else
+        {
+            if (vmin >= 0)
+                options.c_cc[VMIN] = vmin;
+            if (vtime >= 0)
+                options.c_cc[VTIME] = vtime;
+            if (tcsetattr(fd, TCSANOW, &options) != 0)
+            {
+                error = errno_string("tcsetattr");
+                ok = false;
+            }
+        }
+    }
+
+    close(fd);
+    return ok;
+}
+
+bool SerialTuning::apply_to_thread(pthread_t thread, std::string &error) const
+{
+    bool ok = true;
+    if (thread_priority > 0)
+    {
+        struct sched_param param;
+        param.sched_priority = thread_priority;
+        int result = pthread_setschedparam(thread, SCHED_FIFO, &param);
+        if (result != 0)
+        {
+            error = std::string("SCHED_FIFO: ") + strerror(result);
+            ok = false;
+        }
+    }
+
+    if (thread_cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(thread_cpu, &cpus);
+        int result = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+        if (result != 0)
+        {
+            error = std::string("CPU affinity: ") + strerror(result);
+            ok = false;
+        }
+    }
+    return ok;
+}
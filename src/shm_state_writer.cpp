@@ -0,0 +1,81 @@
+#include "shm_state_writer.h"
+
+#include <errno.h>
+#include <new>
+
+bool ShmStateWriter::open(const std::string &name, uint32_t slots)
+{
+    close();
+    if (slots == 0)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    uint64_t insOffset, imuOffset;
+    uint64_t size = shm_state_size(slots, &insOffset, &imuOffset);
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, size) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        shm_unlink(name.c_str());
+        errno = error;
+        return false;
+    }
+    void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        errno = error;
+        return false;
+    }
+
+    // ftruncate zeroed the segment, the magic is set once everything else is in place
+    name_ = name;
+    map_ = map;
+    size_ = size;
+    header_ = new (map_) shm_header_t;
+    header_->version = SHM_STATE_VERSION;
+    header_->slots = slots;
+    header_->writer_pid = getpid();
+    header_->closed.store(0, std::memory_order_relaxed);
+    header_->ins_offset = insOffset;
+    header_->imu_offset = imuOffset;
+    header_->size = size;
+    header_->ins_count.store(0, std::memory_order_relaxed);
+    header_->imu_count.store(0, std::memory_order_relaxed);
+    ins_ = (shm_slot_t<shm_ins_state_t> *)((uint8_t *)map_ + insOffset);
+    imu_ = (shm_slot_t<shm_imu_state_t> *)((uint8_t *)map_ + imuOffset);
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = SHM_STATE_MAGIC;
+    return true;
+}
+
+void ShmStateWriter::close()
+{
+    if (!header_)
+        return;
+    header_->closed.store(1, std::memory_order_release);
+    munmap(map_, size_);
+    shm_unlink(name_.c_str());
+    map_ = nullptr;
+    header_ = nullptr;
+}
+
+void ShmStateWriter::write_ins(const shm_ins_state_t &state)
+{
+    if (header_)
+        shm_write(ins_, header_->slots, header_->ins_count, state);
+}
+
+void ShmStateWriter::write_imu(const shm_imu_state_t &state)
+{
+    if (header_)
+        shm_write(imu_, header_->slots, header_->imu_count, state);
+}
@@ -0,0 +1,100 @@
+#include "stream_monitor.h"
+
+#include <math.h>
+#include <algorithm>
+
+StreamMonitor::StreamMonitor(double stallPeriods, double minTimeout, double retryInterval)
+    : stall_periods_(stallPeriods), min_timeout_(minTimeout), retry_interval_(retryInterval)
+{
+}
+
+void StreamMonitor::watch(uint32_t did, double period, double now)
+{
+    if (period <= 0.0)
+    {
+        // Counters are kept in case the stream comes back
+        stream_map_t::iterator it = streams_.find(did);
+        if (it != streams_.end())
+        {
+            it->second.period = 0.0;
+            it->second.stalled = false;
+        }
+        return;
+    }
+
+    stream_t &stream = streams_[did];
+    if (stream.period == period)
+        return;
+    stream.period = period;
+    stream.last_received = now;
+    stream.has_time = false;
+    stream.stalled = false;
+}
+
+void StreamMonitor::received(uint32_t did, double now, bool hasTime, double deviceTime)
+{
+    stream_map_t::iterator it = streams_.find(did);
+    if (it == streams_.end() || it->second.period <= 0.0)
+        return;
+    stream_t &stream = it->second;
+    stream.packets++;
+    stream.last_received = now;
+    stream.stalled = false;
+    if (!hasTime)
+        return;
+
+    if (stream.has_time)
+    {
+        double dt = deviceTime - stream.last_time;
+        if (dt < -0.5 * stream.period)
+        {
+            stream.restarts++;
+        }
+        else if (dt > 1.5 * stream.period)
+        {
+            stream.gaps++;
+            stream.missed += (uint32_t)lround(dt / stream.period) - 1;
+        }
+    }
+    stream.has_time = true;
+    stream.last_time = deviceTime;
+}
+
+std::vector<uint32_t> StreamMonitor::check(double now)
+{
+    std::vector<uint32_t> due;
+    for (stream_map_t::iterator it = streams_.begin(); it != streams_.end(); ++it)
+    {
+        stream_t &stream = it->second;
+        if (stream.period <= 0.0 || now - stream.last_received < timeout(stream))
+            continue;
+        if (!stream.stalled)
+        {
+            stream.stalled = true;
+            stream.stalls++;
+        }
+        if (now - stream.last_request >= retry_interval_)
+        {
+            stream.last_request = now;
+            stream.reenables++;
+            due.push_back(it->first);
+        }
+    }
+    return due;
+}
+
+double StreamMonitor::timeout(const stream_t &stream) const
+{
+    return std::max(stall_periods_ * stream.period, min_timeout_);
+}
+
+int StreamMonitor::stalled_count() const
+{
+    int count = 0;
+    for (stream_map_t::const_iterator it = streams_.begin(); it != streams_.end(); ++it)
+    {
+        if (it->second.stalled)
+            count++;
+    }
+    return count;
+}
@@ -0,0 +1,122 @@
+#include "udp_telemetry.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+
+bool UdpTelemetry::open(const std::string &address, int port, int ttl, const std::string &interface, std::string &error)
+{
+    close();
+    memset(&address_, 0, sizeof(address_));
+    address_.sin_family = AF_INET;
+    address_.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &address_.sin_addr) != 1)
+    {
+        error = "invalid address " + address;
+        return false;
+    }
+
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_ < 0)
+    {
+        error = strerror(errno);
+        return false;
+    }
+    if (IN_MULTICAST(ntohl(address_.sin_addr.s_addr)))
+    {
+        unsigned char hops = (unsigned char)std::max(0, std::min(ttl, 255));
+        unsigned char loop = 1; // receivers on this host
+        bool ok = setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops)) == 0 &&
+                  setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) == 0;
+        if (ok && !interface.empty())
+        {
+            in_addr local;
+            if (inet_pton(AF_INET, interface.c_str(), &local) != 1)
+            {
+                error = "invalid interface address " + interface;
+                close();
+                return false;
+            }
+            ok = setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) == 0;
+        }
+        if (!ok)
+        {
+            error = strerror(errno);
+            close();
+            return false;
+        }
+    }
+
+    pending_ = 0;
+    next_due_ = 0.0;
+    return true;
+}
+
+void UdpTelemetry::close()
+{
+    if (socket_ >= 0)
+        ::close(socket_);
+    socket_ = -1;
+}
+
+void UdpTelemetry::configure(double rate, int batch)
+{
+    period_ = rate > 0.0 ? 1.0 / rate : 0.0;
+    batch_ = std::max(1, std::min(batch, UDP_TELEMETRY_MAX_BATCH));
+}
+
+bool UdpTelemetry::add(udp_ins_record_t &record, double now)
+{
+    if (socket_ < 0)
+        return false;
+    if (period_ > 0.0)
+    {
+        // A tenth of a period early is on time, the states arrive with jitter
+        if (now < next_due_ - 0.1 * period_)
+            return false;
+        next_due_ = (now - next_due_ > period_) ? now + period_ : next_due_ + period_;
+    }
+
+    record.sequence = record_sequence_++;
+    if (pending_ == 0)
+        first_pending_ = now;
+    memcpy(datagram_ + sizeof(udp_telemetry_header_t) + pending_ * sizeof(udp_ins_record_t), &record, sizeof(record));
+    if (++pending_ >= batch_)
+        send(now);
+    return true;
+}
+
+void UdpTelemetry::poll(double now)
+{
+    if (pending_ == 0)
+        return;
+    double wait = period_ > 0.0 ? batch_ * period_ : 0.1;
+    if (now - first_pending_ >= wait)
+        send(now);
+}
+
+void UdpTelemetry::send(double now)
+{
+    udp_telemetry_header_t header;
+    header.magic = UDP_TELEMETRY_MAGIC;
+    header.version = UDP_TELEMETRY_VERSION;
+    header.count = (uint8_t)pending_;
+    header.record_size = sizeof(udp_ins_record_t);
+    header.sequence = datagram_sequence_++;
+    header.send_time = now;
+    memcpy(datagram_, &header, sizeof(header));
+
+    size_t size = sizeof(header) + pending_ * sizeof(udp_ins_record_t);
+    if (sendto(socket_, datagram_, size, MSG_DONTWAIT, (const sockaddr *)&address_, sizeof(address_)) == (ssize_t)size)
+    {
+        records_sent_ += pending_;
+        datagrams_sent_++;
+    }
+    else
+    {
+        send_errors_++;
+    }
+    pending_ = 0;
+}
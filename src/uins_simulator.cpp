@@ -0,0 +1,687 @@
+#include "uins_simulator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#define SIM_GRAVITY 9.80665
+#define SIM_WGS84_A 6378137.0
+#define SIM_WGS84_E2 6.69437999014e-3
+#define SIM_L1_WAVELENGTH 0.190293672798 // m
+#define SIM_GPS_UNIX_OFFSET 315964800    // s from the UNIX epoch to the GPS epoch
+#define SIM_LEAP_SECONDS 18
+#define SIM_DEG2RAD (M_PI / 180.0)
+
+static const size_t RX_BUFFER_SIZE = 8192;
+
+// Quaternions are w, x, y, z and compose rotations like the ZYX euler convention
+static void quat_mult(const double a[4], const double b[4], double out[4])
+{
+    double r[4] = {
+        a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3],
+        a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+        a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1],
+        a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0]};
+    memcpy(out, r, sizeof(r));
+}
+
+static void quat_axis(int axis, double angle, double out[4])
+{
+    out[0] = cos(angle / 2);
+    out[1] = out[2] = out[3] = 0.0;
+    out[1 + axis] = sin(angle / 2);
+}
+
+// Body to NED rotation of roll, pitch, yaw
+static void euler_to_dcm(const double euler[3], double C[3][3])
+{
+    double sr = sin(euler[0]), cr = cos(euler[0]);
+    double sp = sin(euler[1]), cp = cos(euler[1]);
+    double sy = sin(euler[2]), cy = cos(euler[2]);
+    C[0][0] = cp * cy; C[0][1] = sr * sp * cy - cr * sy; C[0][2] = cr * sp * cy + sr * sy;
+    C[1][0] = cp * sy; C[1][1] = sr * sp * sy + cr * cy; C[1][2] = cr * sp * sy - sr * cy;
+    C[2][0] = -sp;     C[2][1] = sr * cp;                C[2][2] = cr * cp;
+}
+
+SimMotion::state_t SimMotion::at(double t) const
+{
+    state_t s;
+    double w = speed / radius;
+    double a = w * t;
+    double wc = 2.0 * M_PI / climb_period;
+
+    s.ned[0] = radius * sin(a);
+    s.ned[1] = radius * (1.0 - cos(a));
+    s.ned[2] = -climb * sin(wc * t);
+    s.vel_ned[0] = speed * cos(a);
+    s.vel_ned[1] = speed * sin(a);
+    s.vel_ned[2] = -climb * wc * cos(wc * t);
+    double acc_ned[3] = {-speed * w * sin(a), speed * w * cos(a), climb * wc * wc * sin(wc * t)};
+
+    // Coordinated turn, nose along the velocity
+    s.euler[0] = atan(speed * w / SIM_GRAVITY);
+    s.euler[1] = atan2(-s.vel_ned[2], speed);
+    s.euler[2] = atan2(s.vel_ned[1], s.vel_ned[0]);
+    s.pqr[0] = -sin(s.euler[1]) * w;
+    s.pqr[1] = cos(s.euler[1]) * sin(s.euler[0]) * w;
+    s.pqr[2] = cos(s.euler[1]) * cos(s.euler[0]) * w;
+
+    double C[3][3];
+    euler_to_dcm(s.euler, C);
+    double force_ned[3] = {acc_ned[0], acc_ned[1], acc_ned[2] - SIM_GRAVITY};
+    for (int i = 0; i < 3; i++)
+    {
+        s.accel[i] = C[0][i] * force_ned[0] + C[1][i] * force_ned[1] + C[2][i] * force_ned[2];
+        s.uvw[i] = C[0][i] * s.vel_ned[0] + C[1][i] * s.vel_ned[1] + C[2][i] * s.vel_ned[2];
+    }
+
+    double lat0 = ref_lla[0] * SIM_DEG2RAD;
+    double lat = lat0 + s.ned[0] / SIM_WGS84_A;
+    double lon = ref_lla[1] * SIM_DEG2RAD + s.ned[1] / (SIM_WGS84_A * cos(lat0));
+    double alt = ref_lla[2] - s.ned[2];
+    s.lla[0] = lat / SIM_DEG2RAD;
+    s.lla[1] = lon / SIM_DEG2RAD;
+    s.lla[2] = alt;
+
+    double N = SIM_WGS84_A / sqrt(1.0 - SIM_WGS84_E2 * sin(lat) * sin(lat));
+    s.ecef[0] = (N + alt) * cos(lat) * cos(lon);
+    s.ecef[1] = (N + alt) * cos(lat) * sin(lon);
+    s.ecef[2] = (N * (1.0 - SIM_WGS84_E2) + alt) * sin(lat);
+
+    // NED to ECEF
+    double Cn2e[3][3] = {
+        {-sin(lat) * cos(lon), -sin(lon), -cos(lat) * cos(lon)},
+        {-sin(lat) * sin(lon), cos(lon), -cos(lat) * sin(lon)},
+        {cos(lat), 0.0, -sin(lat)}};
+    for (int i = 0; i < 3; i++)
+        s.vel_ecef[i] = Cn2e[i][0] * s.vel_ned[0] + Cn2e[i][1] * s.vel_ned[1] + Cn2e[i][2] * s.vel_ned[2];
+
+    double qz[4], qy[4], qx[4], qn2b[4], qe2n[4], qe2b[4];
+    quat_axis(2, s.euler[2], qz);
+    quat_axis(1, s.euler[1], qy);
+    quat_axis(0, s.euler[0], qx);
+    quat_mult(qz, qy, qn2b);
+    quat_mult(qn2b, qx, qn2b);
+    quat_axis(2, lon, qz);
+    quat_axis(1, -lat - M_PI / 2, qy);
+    quat_mult(qz, qy, qe2n);
+    quat_mult(qe2n, qn2b, qe2b);
+    for (int i = 0; i < 4; i++)
+    {
+        s.qn2b[i] = qn2b[i];
+        s.qe2b[i] = qe2b[i];
+    }
+    return s;
+}
+
+UinsSimulator::UinsSimulator(const options_t &options) :
+    options_(options),
+    master_fd_(-1),
+    rx_(RX_BUFFER_SIZE / sizeof(uint64_t)),
+    rx_len_(0),
+    counter_(0),
+    tx_budget_(0.0),
+    tx_budget_time_(0.0),
+    silent_until_(0.0),
+    sim_base_(0.0),
+    boot_at_(-10.0),
+    nav_tick_(0),
+    gps_tick_(-1)
+{
+    memset(&dev_info_, 0, sizeof(dev_info_));
+    dev_info_.serialNumber = options_.serial_number;
+    memcpy(dev_info_.firmwareVer, options_.firmware_ver, sizeof(dev_info_.firmwareVer));
+    dev_info_.protocolVer[0] = PROTOCOL_VERSION_CHAR0;
+    dev_info_.protocolVer[1] = PROTOCOL_VERSION_CHAR1;
+    dev_info_.protocolVer[2] = PROTOCOL_VERSION_CHAR2;
+    dev_info_.protocolVer[3] = PROTOCOL_VERSION_CHAR3;
+    strncpy(dev_info_.manufacturer, "Simulated uINS", sizeof(dev_info_.manufacturer) - 1);
+
+    memset(&flash_, 0, sizeof(flash_));
+    flash_.size = sizeof(flash_);
+    flash_.startupNavDtMs = options_.nav_period_ms;
+    flash_.startupGPSDtMs = options_.gps_period_ms;
+    flash_.ser0BaudRate = options_.baudrate > 0 ? options_.baudrate : 921600;
+    flash_.ser1BaudRate = flash_.ser0BaudRate;
+    memcpy(flash_.refLla, motion_.ref_lla, sizeof(flash_.refLla));
+    nav_period_ = flash_.startupNavDtMs * 1.0e-3;
+    gps_period_ = flash_.startupGPSDtMs * 1.0e-3;
+
+    // GPS time follows the host clock, so the node's time sync sees plausible offsets
+    double unixTime = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    double gps = unixTime - SIM_GPS_UNIX_OFFSET + SIM_LEAP_SECONDS;
+    gps_week_ = (uint32_t)(gps / 604800.0);
+    tow_start_ = gps - gps_week_ * 604800.0;
+    clock_ = []()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    };
+    start_ = now();
+    tx_budget_time_ = start_;
+}
+
+void UinsSimulator::set_clock(clock_fn_t now)
+{
+    clock_ = now;
+    start_ = now();
+    tx_budget_time_ = start_;
+}
+
+UinsSimulator::~UinsSimulator()
+{
+    if (!link_.empty())
+        unlink(link_.c_str());
+    if (master_fd_ >= 0)
+        close(master_fd_);
+}
+
+bool UinsSimulator::open(const std::string &link, std::string &error)
+{
+    int slave = -1;
+    char name[256];
+    if (openpty(&master_fd_, &slave, name, NULL, NULL) != 0)
+    {
+        error = std::string("openpty: ") + strerror(errno);
+        return false;
+    }
+    slave_name_ = name;
+
+    // Raw bytes in both directions.  The slave stays available while the master is open, so the
+    // node can close and reopen it, e.g. across a reset
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    close(slave);
+    fcntl(master_fd_, F_SETFL, fcntl(master_fd_, F_GETFL) | O_NONBLOCK);
+
+    if (!link.empty())
+    {
+        unlink(link.c_str());
+        if (symlink(slave_name_.c_str(), link.c_str()) != 0)
+        {
+            error = "symlink " + link + ": " + strerror(errno);
+            return false;
+        }
+        link_ = link;
+    }
+    return true;
+}
+
+double UinsSimulator::now() const
+{
+    return clock_();
+}
+
+void UinsSimulator::run(const volatile bool &stop)
+{
+    while (!stop)
+        step(0.1);
+}
+
+void UinsSimulator::step(double timeout)
+{
+    double t = now();
+    double due = silent_until_ > 0.0 ? silent_until_ : start_ + nav_tick_ * nav_period_;
+    double wait = std::max(0.0, std::min(timeout, due - t));
+    if (!tx_.empty())
+        wait = std::min(wait, 0.001);
+
+    struct pollfd pfd = {master_fd_, POLLIN, 0};
+    int ready = poll(&pfd, 1, (int)ceil(wait * 1000.0));
+    if (ready > 0 && (pfd.revents & POLLHUP))
+        usleep((useconds_t)(std::min(wait, 0.01) * 1.0e6)); // nobody has the port open, e.g. while the node reconnects
+    else if (ready > 0 && (pfd.revents & POLLIN))
+        receive();
+
+    t = now();
+    if (silent_until_ > 0.0)
+    {
+        if (t < silent_until_)
+            return;
+        // Boot with the flash configuration written before the reset
+        double resumed = sim_time() + (silent_until_ - (start_ + nav_tick_ * nav_period_));
+        nav_period_ = std::max<uint32_t>(1, flash_.startupNavDtMs) * 1.0e-3;
+        gps_period_ = std::max<uint32_t>(1, flash_.startupGPSDtMs) * 1.0e-3;
+        start_ = silent_until_;
+        sim_base_ = resumed;
+        boot_at_ = resumed;
+        nav_tick_ = 0;
+        gps_tick_ = -1;
+        silent_until_ = 0.0;
+        broadcasts_ = persistent_;
+    }
+
+    // Produce every navigation period that is due, in order, skipping ahead if hopelessly behind
+    int produced = 0;
+    while (start_ + nav_tick_ * nav_period_ <= t)
+    {
+        if (t - (start_ + nav_tick_ * nav_period_) > nav_period_)
+            stats_.late_ticks++;
+        double simT = sim_time();
+        int64_t gpsTick = (int64_t)floor(simT / gps_period_);
+        bool gpsEpoch = gpsTick != gps_tick_;
+        gps_tick_ = gpsTick;
+        produce(simT, gpsEpoch);
+        nav_tick_++;
+        if (++produced >= 1000)
+        {
+            uint64_t skipped = (uint64_t)((t - start_) / nav_period_) + 1 - nav_tick_;
+            stats_.late_ticks += skipped;
+            nav_tick_ += skipped;
+            break;
+        }
+    }
+    flush();
+}
+
+static bool gps_source(uint32_t DID)
+{
+    switch (DID)
+    {
+    case DID_GPS1_POS:
+    case DID_GPS2_POS:
+    case DID_GPS1_VEL:
+    case DID_GPS2_VEL:
+    case DID_GPS1_SAT:
+    case DID_GPS2_SAT:
+    case DID_GPS1_RAW:
+    case DID_GPS2_RAW:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void UinsSimulator::produce(double t, bool gpsEpoch)
+{
+    uint64_t navTick = nav_tick_;
+    for (std::map<uint32_t, int>::const_iterator it = broadcasts_.begin(); it != broadcasts_.end(); ++it)
+    {
+        uint64_t tick = navTick;
+        if (gps_source(it->first))
+        {
+            if (!gpsEpoch)
+                continue;
+            tick = (uint64_t)gps_tick_;
+        }
+        if (tick % it->second != 0 || !fill(it->first, t, body_))
+            continue;
+        send_data(it->first, body_.data(), body_.size());
+
+        // One satellite's ephemeris per second follows the observations
+        uint64_t epochsPerSecond = std::max<uint64_t>(1, (uint64_t)llround(1.0 / gps_period_));
+        if ((it->first == DID_GPS1_RAW || it->first == DID_GPS2_RAW) && tick % epochsPerSecond == 0)
+        {
+            gps_raw_t raw;
+            memset(&raw, 0, sizeof(raw));
+            raw.receiverIndex = it->first == DID_GPS1_RAW ? 1 : 2;
+            raw.dataType = raw_data_type_ephemeris;
+            eph_t &eph = raw.data.eph;
+            eph.sat = 1 + (int)(tick % options_.num_sats);
+            eph.week = gps_week_;
+            eph.toe.time = SIM_GPS_UNIX_OFFSET + gps_week_ * 604800 + (time_t)tow(t);
+            eph.toc = eph.ttr = eph.toe;
+            eph.A = 26559710.0;
+            eph.e = 0.01;
+            eph.i0 = 0.96;
+            eph.toes = floor(tow(t));
+            send_data(it->first, &raw, offsetof(gps_raw_t, data) + sizeof(eph_t));
+        }
+    }
+}
+
+bool UinsSimulator::fill(uint32_t DID, double t, std::vector<uint8_t> &out)
+{
+    SimMotion::state_t s = motion_.at(t);
+    double tow = this->tow(t);
+    double boot = t - boot_at_;
+    uint32_t towMs = (uint32_t)llround(tow * 1000.0);
+
+#define SIM_FILL(TYPE, NAME)        \
+    out.assign(sizeof(TYPE), 0);    \
+    TYPE &NAME = *reinterpret_cast<TYPE *>(out.data())
+
+    switch (DID)
+    {
+    case DID_DEV_INFO:
+        out.assign((const uint8_t *)&dev_info_, (const uint8_t *)&dev_info_ + sizeof(dev_info_));
+        return true;
+
+    case DID_FLASH_CONFIG:
+        out.assign((const uint8_t *)&flash_, (const uint8_t *)&flash_ + sizeof(flash_));
+        return true;
+
+    case DID_INS_1:
+    {
+        SIM_FILL(ins_1_t, ins);
+        ins.week = gps_week_;
+        ins.timeOfWeek = tow;
+        for (int i = 0; i < 3; i++)
+        {
+            ins.theta[i] = s.euler[i];
+            ins.uvw[i] = s.uvw[i];
+            ins.lla[i] = s.lla[i];
+            ins.ned[i] = s.ned[i];
+        }
+        return true;
+    }
+
+    case DID_INS_2:
+    {
+        SIM_FILL(ins_2_t, ins);
+        ins.week = gps_week_;
+        ins.timeOfWeek = tow;
+        memcpy(ins.qn2b, s.qn2b, sizeof(ins.qn2b));
+        for (int i = 0; i < 3; i++)
+        {
+            ins.uvw[i] = s.uvw[i];
+            ins.lla[i] = s.lla[i];
+        }
+        return true;
+    }
+
+    case DID_INS_4:
+    {
+        SIM_FILL(ins_4_t, ins);
+        ins.week = gps_week_;
+        ins.timeOfWeek = tow;
+        memcpy(ins.qe2b, s.qe2b, sizeof(ins.qe2b));
+        for (int i = 0; i < 3; i++)
+        {
+            ins.ve[i] = s.vel_ecef[i];
+            ins.ecef[i] = s.ecef[i];
+        }
+        return true;
+    }
+
+    case DID_INL2_STATES:
+    {
+        SIM_FILL(inl2_states_t, inl2);
+        inl2.timeOfWeek = tow;
+        memcpy(inl2.qe2b, s.qe2b, sizeof(inl2.qe2b));
+        for (int i = 0; i < 3; i++)
+        {
+            inl2.ve[i] = s.vel_ecef[i];
+            inl2.ecef[i] = s.ecef[i];
+        }
+        inl2.magDec = 0.19f;
+        inl2.magInc = 1.14f;
+        return true;
+    }
+
+    case DID_PIMU:
+    {
+        SIM_FILL(pimu_t, pimu);
+        pimu.time = boot;
+        pimu.dt = nav_period_;
+        for (int i = 0; i < 3; i++)
+        {
+            pimu.theta[i] = s.pqr[i] * nav_period_;
+            pimu.vel[i] = s.accel[i] * nav_period_;
+        }
+        return true;
+    }
+
+    case DID_MAGNETOMETER:
+    {
+        // Earth field of roughly 0.5 gauss pointing north and down, rotated into the body
+        SIM_FILL(magnetometer_t, mag);
+        double field[3] = {0.21, 0.04, 0.45};
+        double C[3][3];
+        euler_to_dcm(s.euler, C);
+        mag.time = boot;
+        for (int i = 0; i < 3; i++)
+            mag.mag[i] = C[0][i] * field[0] + C[1][i] * field[1] + C[2][i] * field[2];
+        return true;
+    }
+
+    case DID_BAROMETER:
+    {
+        SIM_FILL(barometer_t, baro);
+        baro.time = boot;
+        baro.bar = 101.325 * exp(-s.lla[2] / 8434.0);
+        baro.mslBar = 101.325;
+        baro.barTemp = 20.0;
+        return true;
+    }
+
+    case DID_GPS1_POS:
+    case DID_GPS2_POS:
+    {
+        SIM_FILL(gps_pos_t, pos);
+        pos.week = gps_week_;
+        pos.timeOfWeekMs = towMs;
+        pos.status = GPS_STATUS_FIX_3D | (options_.num_sats & GPS_STATUS_NUM_SATS_USED_MASK);
+        for (int i = 0; i < 3; i++)
+        {
+            pos.ecef[i] = s.ecef[i];
+            pos.lla[i] = s.lla[i];
+        }
+        pos.hMSL = s.lla[2];
+        pos.hAcc = 0.8f;
+        pos.vAcc = 1.2f;
+        pos.pDop = 1.4f;
+        pos.cnoMean = 44.0f;
+        pos.towOffset = tow - boot;
+        pos.leapS = SIM_LEAP_SECONDS;
+        return true;
+    }
+
+    case DID_GPS1_VEL:
+    case DID_GPS2_VEL:
+    {
+        SIM_FILL(gps_vel_t, vel);
+        vel.timeOfWeekMs = towMs;
+        for (int i = 0; i < 3; i++)
+            vel.vel[i] = s.vel_ecef[i];
+        vel.sAcc = 0.1f;
+        return true;
+    }
+
+    case DID_GPS1_SAT:
+    case DID_GPS2_SAT:
+    {
+        SIM_FILL(gps_sat_t, sat);
+        int count = std::min<int>(options_.num_sats, sizeof(sat.sat) / sizeof(sat.sat[0]));
+        sat.timeOfWeekMs = towMs;
+        sat.numSats = count;
+        for (int i = 0; i < count; i++)
+        {
+            sat.sat[i].gnssId = 0;
+            sat.sat[i].svId = 1 + i;
+            sat.sat[i].cno = 38 + (i * 7) % 12;
+            sat.sat[i].elev = 15 + (i * 23) % 70;
+            sat.sat[i].azim = (i * 57) % 360;
+        }
+        return true;
+    }
+
+    case DID_GPS1_RAW:
+    case DID_GPS2_RAW:
+    {
+        // Observations are sent with only as many entries as there are satellites
+        SIM_FILL(gps_raw_t, raw);
+        int count = std::min<int>(options_.num_sats, sizeof(raw.data.obs) / sizeof(raw.data.obs[0]));
+        raw.receiverIndex = DID == DID_GPS1_RAW ? 1 : 2;
+        raw.dataType = raw_data_type_observation;
+        raw.obsCount = count;
+        for (int i = 0; i < count; i++)
+        {
+            obsd_t &obs = raw.data.obs[i];
+            double range = 2.0e7 + 1.5e5 * i + 600.0 * sin(0.001 * tow + i);
+            double rate = 0.6 * cos(0.001 * tow + i);
+            obs.time.time = SIM_GPS_UNIX_OFFSET + gps_week_ * 604800 + (time_t)floor(tow);
+            obs.time.sec = tow - floor(tow);
+            obs.sat = 1 + i;
+            obs.SNR[0] = 4 * (38 + (i * 7) % 12);
+            obs.code[0] = 1; // L1 C/A
+            obs.P[0] = range;
+            obs.L[0] = range / SIM_L1_WAVELENGTH;
+            obs.D[0] = -rate / SIM_L1_WAVELENGTH;
+        }
+        out.resize(offsetof(gps_raw_t, data) + count * sizeof(obsd_t));
+        return true;
+    }
+
+    default:
+        return false;
+    }
+#undef SIM_FILL
+}
+
+void UinsSimulator::send_data(uint32_t DID, const void *data, uint32_t size)
+{
+    p_data_hdr_t hdr = {DID, size, 0};
+    packet_.resize(sizeof(hdr) + size);
+    memcpy(packet_.data(), &hdr, sizeof(hdr));
+    memcpy(packet_.data() + sizeof(hdr), data, size);
+    send(PID_DATA, packet_.data(), packet_.size());
+    stats_.sent[DID]++;
+}
+
+void UinsSimulator::send(uint8_t pid, const void *body, size_t size)
+{
+    size_t capacity = 2 * size + 16; // every byte escaped, plus framing
+    size_t start = tx_.size();
+    tx_.resize(start + capacity);
+    size_t n = IsbFramer::encode(pid, counter_++, body, size, &tx_[start], capacity);
+    tx_.resize(start + n);
+    if (tx_.size() > options_.tx_buffer)
+    {
+        // Does not fit into the transmit buffer
+        tx_.resize(start);
+        stats_.packets_dropped++;
+        return;
+    }
+    stats_.packets_sent++;
+}
+
+void UinsSimulator::flush()
+{
+    if (tx_.empty())
+        return;
+
+    size_t allowed = tx_.size();
+    if (options_.baudrate > 0)
+    {
+        double t = now();
+        double rate = options_.baudrate / 10.0;
+        tx_budget_ = std::min(tx_budget_ + (t - tx_budget_time_) * rate, std::max(64.0, rate * 0.002));
+        tx_budget_time_ = t;
+        allowed = std::min(allowed, (size_t)tx_budget_);
+    }
+
+    ssize_t n = allowed > 0 ? write(master_fd_, tx_.data(), allowed) : 0;
+    if (n < 0 && errno == EIO)
+        n = allowed; // nobody has the port open, the bytes are lost on the wire
+    if (n <= 0)
+        return;
+    tx_.erase(tx_.begin(), tx_.begin() + n);
+    stats_.bytes_sent += n;
+    if (options_.baudrate > 0)
+        tx_budget_ -= n;
+}
+
+void UinsSimulator::receive()
+{
+    uint8_t *buf = reinterpret_cast<uint8_t *>(rx_.data());
+    ssize_t n = read(master_fd_, buf + rx_len_, RX_BUFFER_SIZE - rx_len_);
+    if (n <= 0)
+        return;
+    rx_len_ += n;
+
+    size_t pos = 0;
+    IsbPacket packet;
+    while (framer_.next(buf, rx_len_, pos, packet))
+        handle_packet(packet);
+
+    // Keep the start of an incomplete packet, drop everything if it can never fit
+    if (pos < rx_len_ && pos > 0)
+        memmove(buf, buf + pos, rx_len_ - pos);
+    rx_len_ = (rx_len_ - pos < RX_BUFFER_SIZE) ? rx_len_ - pos : 0;
+}
+
+void UinsSimulator::handle_packet(const IsbPacket &packet)
+{
+    stats_.requests++;
+    if (silent_until_ > 0.0)
+        return; // rebooting
+
+    switch (packet.pid)
+    {
+    case PID_GET_DATA:
+    {
+        if (packet.body_size < sizeof(p_data_get_t))
+            break;
+        p_data_get_t request;
+        memcpy(&request, packet.body, sizeof(request));
+        if (request.bc_period_multiple > 0)
+            broadcasts_[request.id] = request.bc_period_multiple;
+        else if (fill(request.id, sim_time(), body_))
+            send_data(request.id, body_.data(), body_.size());
+        break;
+    }
+
+    case PID_SET_DATA:
+        if (packet.hdr != NULL)
+            handle_set_data(packet.hdr, packet.data);
+        break;
+
+    case PID_STOP_BROADCASTS_ALL_PORTS:
+    case PID_STOP_BROADCASTS_CURRENT_PORT:
+        broadcasts_.clear();
+        break;
+
+    case PID_STOP_DID_BROADCAST:
+    {
+        uint32_t DID;
+        if (packet.body_size >= sizeof(DID))
+        {
+            memcpy(&DID, packet.body, sizeof(DID));
+            broadcasts_.erase(DID);
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+void UinsSimulator::handle_set_data(const p_data_hdr_t *hdr, const uint8_t *data)
+{
+    if (hdr->id == DID_FLASH_CONFIG)
+    {
+        if (hdr->offset + hdr->size <= sizeof(flash_))
+            memcpy(reinterpret_cast<uint8_t *>(&flash_) + hdr->offset, data, hdr->size);
+    }
+    else if (hdr->id == DID_SYS_CMD && hdr->offset == 0 && hdr->size >= sizeof(system_command_t))
+    {
+        system_command_t command;
+        memcpy(&command, data, sizeof(command));
+        if (command.invCommand != ~command.command)
+            return;
+        if (command.command == SYS_CMD_SAVE_PERSISTENT_MESSAGES)
+            persistent_ = broadcasts_;
+        else if (command.command == SYS_CMD_SOFTWARE_RESET)
+            reset();
+    }
+
+    p_ack_hdr_t ack = {PID_SET_DATA, 0};
+    send(PID_ACK, &ack, sizeof(ack));
+}
+
+void UinsSimulator::reset()
+{
+    broadcasts_.clear();
+    tx_.clear();
+    silent_until_ = now() + options_.reboot_time;
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include "data_sets.h"
+#include "dispatch_stats.h"
+
+static DispatchStats::sample_t sample(uint32_t did, double deviceTime, double dispatch = 1.0e-4, double handler = 1.0e-5)
+{
+    DispatchStats::sample_t s;
+    s.did = did;
+    s.size = 64;
+    s.has_device_time = true;
+    s.device_time = deviceTime;
+    s.receive = 10.0;
+    s.entry = s.receive + dispatch;
+    s.done = s.entry + handler;
+    return s;
+}
+
+TEST(DispatchStats, HistogramPercentiles)
+{
+    DispatchStats::histogram_t h;
+    EXPECT_EQ(0.0, h.percentile(50));
+    for (int i = 1; i <= 100; i++)
+        h.add(i * 1.0e-3);
+    EXPECT_EQ(100u, h.count);
+    EXPECT_DOUBLE_EQ(0.1, h.max);
+    // Buckets are a quarter octave wide, percentiles are their upper bound
+    EXPECT_GE(h.percentile(50), 0.050);
+    EXPECT_LT(h.percentile(50), 0.050 * 1.19);
+    EXPECT_GE(h.percentile(99), 0.099);
+    EXPECT_LE(h.percentile(99), 0.1);
+    EXPECT_DOUBLE_EQ(0.1, h.percentile(100));
+
+    // Out of range values land in the first and last bucket
+    EXPECT_EQ(0, DispatchStats::histogram_t::bucket(-1.0));
+    EXPECT_EQ(DispatchStats::histogram_t::BUCKETS - 1, DispatchStats::histogram_t::bucket(1000.0));
+}
+
+TEST(DispatchStats, GapsAndDuplicatesFromDeviceTime)
+{
+    DispatchStats stats;
+    double t = 1000.0;
+    for (int i = 0; i < 10; i++, t += 0.004)
+        stats.record(sample(DID_INS_4, t));
+    // Three packets missing, then one repeated
+    t += 3 * 0.004;
+    stats.record(sample(DID_INS_4, t));
+    stats.record(sample(DID_INS_4, t));
+    t += 0.004;
+    stats.record(sample(DID_INS_4, t));
+
+    const DispatchStats::did_t *ins = stats.find(DID_INS_4);
+    ASSERT_NE(nullptr, ins);
+    EXPECT_EQ(13u, ins->packets);
+    EXPECT_EQ(13u * 64, ins->bytes);
+    EXPECT_EQ(1u, ins->gaps);
+    EXPECT_EQ(3u, ins->missed);
+    EXPECT_EQ(1u, ins->duplicates);
+    EXPECT_NEAR(0.004, ins->period, 1e-6);
+    EXPECT_EQ(nullptr, stats.find(DID_PIMU));
+}
+
+TEST(DispatchStats, RateChangeIsNotAGap)
+{
+    DispatchStats stats;
+    double t = 0.0;
+    for (int i = 0; i < 10; i++, t += 0.004)
+        stats.record(sample(DID_PIMU, t));
+    stats.reset_timing(DID_PIMU);
+    for (int i = 0; i < 10; i++, t += 0.016)
+        stats.record(sample(DID_PIMU, t));
+    // A restarted device starts over as well
+    t = 0.05;
+    for (int i = 0; i < 10; i++, t += 0.016)
+        stats.record(sample(DID_PIMU, t));
+    EXPECT_EQ(0u, stats.find(DID_PIMU)->gaps);
+}
+
+TEST(DispatchStats, WindowsAreIndependent)
+{
+    DispatchStats stats;
+    int diagnostics = stats.add_window();
+    int topic = stats.add_window();
+    double elapsed;
+
+    for (int i = 0; i < 4; i++)
+        stats.record(sample(DID_INS_1, i * 0.01, 2.0e-3, 5.0e-4));
+    std::vector<std::pair<uint32_t, DispatchStats::window_t>> window = stats.take_window(diagnostics, DispatchStats::now(), elapsed);
+    ASSERT_EQ(1u, window.size());
+    EXPECT_EQ((uint32_t)DID_INS_1, window[0].first);
+    EXPECT_EQ(4u, window[0].second.packets);
+    EXPECT_NEAR(2.0e-3, window[0].second.latency[DispatchStats::LATENCY_DISPATCH].max, 1e-9);
+    EXPECT_NEAR(5.0e-4, window[0].second.latency[DispatchStats::LATENCY_HANDLER].max, 1e-9);
+    EXPECT_EQ(0u, window[0].second.latency[DispatchStats::LATENCY_AGE].count);
+    EXPECT_GE(elapsed, 0.0);
+
+    stats.record(sample(DID_INS_1, 0.04));
+    window = stats.take_window(diagnostics, DispatchStats::now(), elapsed);
+    EXPECT_EQ(1u, window[0].second.packets);
+    window = stats.take_window(topic, DispatchStats::now(), elapsed);
+    EXPECT_EQ(5u, window[0].second.packets);
+    EXPECT_EQ(5u, stats.find(DID_INS_1)->packets);
+}
+
+TEST(DispatchStats, DeviceTimeOfDataSets)
+{
+    p_data_t data;
+    memset(&data, 0, sizeof(data));
+    double time;
+    bool sinceBoot;
+
+    data.hdr.id = DID_GPS1_POS;
+    data.hdr.size = sizeof(gps_pos_t);
+    reinterpret_cast<gps_pos_t *>(data.buf)->timeOfWeekMs = 345600125;
+    ASSERT_TRUE(DispatchStats::device_time(&data, time, sinceBoot));
+    EXPECT_DOUBLE_EQ(345600.125, time);
+    EXPECT_FALSE(sinceBoot);
+
+    data.hdr.id = DID_PIMU;
+    data.hdr.size = sizeof(pimu_t);
+    reinterpret_cast<pimu_t *>(data.buf)->time = 12.5;
+    ASSERT_TRUE(DispatchStats::device_time(&data, time, sinceBoot));
+    EXPECT_DOUBLE_EQ(12.5, time);
+    EXPECT_TRUE(sinceBoot);
+
+    // Partial data sets may not include the time
+    data.hdr.offset = 8;
+    EXPECT_FALSE(DispatchStats::device_time(&data, time, sinceBoot));
+    data.hdr.offset = 0;
+    data.hdr.id = DID_GPS1_RAW;
+    EXPECT_FALSE(DispatchStats::device_time(&data, time, sinceBoot));
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "flash_config_planner.h"
+
+static nvm_flash_cfg_t make_current()
+{
+    nvm_flash_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.startupNavDtMs = 8;
+    cfg.ioConfig = 0x00100;
+    cfg.refLla[0] = 40.0;
+    cfg.refLla[1] = -111.5;
+    cfg.refLla[2] = 1400.0;
+    return cfg;
+}
+
+TEST(FlashConfigPlanner, NothingChanged)
+{
+    FlashConfigPlanner planner(make_current());
+    EXPECT_TRUE(planner.changes().empty());
+    EXPECT_FALSE(planner.changed(0, sizeof(nvm_flash_cfg_t)));
+    // Nothing to confirm, any readback will do
+    EXPECT_TRUE(planner.verify(NULL, 0, 0));
+}
+
+TEST(FlashConfigPlanner, OnlyChangedBytesAreWritten)
+{
+    FlashConfigPlanner planner(make_current(), 0);
+    planner.desired().startupNavDtMs = 4;
+
+    const std::vector<FlashConfigPlanner::range_t> &changes = planner.changes();
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(offsetof(nvm_flash_cfg_t, startupNavDtMs), changes[0].offset);
+    EXPECT_EQ(1u, changes[0].size); // 8 to 4 changes the low byte only
+    EXPECT_TRUE(planner.changed(offsetof(nvm_flash_cfg_t, startupNavDtMs), sizeof(uint32_t)));
+    EXPECT_FALSE(planner.changed(offsetof(nvm_flash_cfg_t, ioConfig), sizeof(uint32_t)));
+    EXPECT_EQ(8u, planner.current().startupNavDtMs);
+}
+
+TEST(FlashConfigPlanner, CloseRangesAreMerged)
+{
+    nvm_flash_cfg_t current = make_current();
+    uint32_t first = offsetof(nvm_flash_cfg_t, refLla);
+    uint32_t last = offsetof(nvm_flash_cfg_t, refLla) + 2 * sizeof(double);
+
+    // Apart by more than the gap: two writes
+    FlashConfigPlanner apart(current, 4);
+    apart.desired().refLla[0] = 41.0;
+    apart.desired().refLla[2] = 1500.0;
+    ASSERT_EQ(2u, apart.changes().size());
+    EXPECT_LE(first, apart.changes()[0].offset);
+    EXPECT_LE(last, apart.changes()[1].offset);
+
+    // Within the gap: one write spanning both
+    FlashConfigPlanner merged(current, 2 * sizeof(double));
+    merged.desired().refLla[0] = 41.0;
+    merged.desired().refLla[2] = 1500.0;
+    ASSERT_EQ(1u, merged.changes().size());
+    EXPECT_EQ(apart.changes()[0].offset, merged.changes()[0].offset);
+    EXPECT_EQ(apart.changes()[1].offset + apart.changes()[1].size, merged.changes()[0].offset + merged.changes()[0].size);
+}
+
+TEST(FlashConfigPlanner, VerifyReadback)
+{
+    FlashConfigPlanner planner(make_current());
+    planner.desired().ioConfig = 0x00200;
+    planner.desired().startupNavDtMs = 4;
+
+    // Read through the const interface, as the node's write_flash_config does
+    const FlashConfigPlanner &planned = planner;
+    nvm_flash_cfg_t readback = planned.desired();
+    const uint8_t *buf = reinterpret_cast<const uint8_t *>(&readback);
+    EXPECT_TRUE(planned.verify(buf, 0, sizeof(readback)));
+
+    // A readback that does not cover every change cannot confirm it
+    uint32_t ioOffset = offsetof(nvm_flash_cfg_t, ioConfig);
+    EXPECT_FALSE(planned.verify(buf + ioOffset, ioOffset, sizeof(uint32_t)));
+
+    // The device kept the old value
+    readback.ioConfig = 0x00100;
+    EXPECT_FALSE(planned.verify(buf, 0, sizeof(readback)));
+}
@@ -0,0 +1,228 @@
+#include <gtest/gtest.h>
+#include <math.h>
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+#include "ins_core.h"
+
+class RecordingSink : public InsSink
+{
+public:
+    void odometry(frame_t frame, const ins_odometry_t &odom) override
+    {
+        frames.push_back(frame);
+        odoms.push_back(odom);
+    }
+    void imu(const ins_imu_t &imu) override { imus.push_back(imu); }
+    void preint_imu(const ins_preint_imu_t &preint) override { preints.push_back(preint); }
+    void ins_state(const ins_4_t &msg, const ins_stamp_t &stamp) override { state_stamps.push_back(stamp); }
+
+    std::vector<frame_t> frames;
+    std::vector<ins_odometry_t> odoms;
+    std::vector<ins_imu_t> imus;
+    std::vector<ins_preint_imu_t> preints;
+    std::vector<ins_stamp_t> state_stamps;
+};
+
+// Salt Lake City
+static const double REF_LLA[3] = {40.7608, -111.8910, 1300.0};
+static const double REF_ECEF[3] = {-1766021.7, -4460133.6, 4144383.5};
+
+static ins_4_t make_ins4()
+{
+    ins_4_t ins;
+    memset(&ins, 0, sizeof(ins));
+    ins.week = 2230;
+    ins.timeOfWeek = 345600.125;
+    ins.qe2b[0] = 0.4196f;
+    ins.qe2b[1] = -0.5470f;
+    ins.qe2b[2] = 0.2339f;
+    ins.qe2b[3] = 0.6863f;
+    ins.ve[0] = 1.2f;
+    ins.ve[1] = -3.4f;
+    ins.ve[2] = 0.7f;
+    memcpy(ins.ecef, REF_ECEF, sizeof(ins.ecef));
+    return ins;
+}
+
+static ros_covariance_pose_twist_t make_covariance()
+{
+    ros_covariance_pose_twist_t cov;
+    memset(&cov, 0, sizeof(cov));
+    for (int i = 0, k = 0; i < 6; i++)
+        for (int j = 0; j <= i; j++, k++)
+            cov.covPoseLD[k] = cov.covTwistLD[k] = 10 * i + j;
+    return cov;
+}
+
+TEST(InsCore, LD2CovIsSymmetric)
+{
+    ros_covariance_pose_twist_t cov = make_covariance();
+    float full[36];
+    InsCore::LD2Cov(cov.covPoseLD, full, 6);
+    for (int i = 0; i < 6; i++)
+    {
+        for (int j = 0; j <= i; j++)
+        {
+            EXPECT_EQ(10 * i + j, full[i * 6 + j]);
+            EXPECT_EQ(full[i * 6 + j], full[j * 6 + i]);
+        }
+    }
+}
+
+TEST(InsCore, PoseCovarianceIsReorderedToPositionAttitude)
+{
+    InsCore core;
+    core.covariance(make_covariance());
+
+    // Incoming [attitude, position], row i column j holds 10 * max(i, j) + min(i, j)
+    const float *pose = core.pose_covariance();
+    const float *twist = core.twist_covariance();
+    for (int i = 0; i < 6; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            int in_i = (i + 3) % 6, in_j = (j + 3) % 6;
+            EXPECT_EQ(10 * std::max(in_i, in_j) + std::min(in_i, in_j), pose[i * 6 + j]) << i << "," << j;
+            EXPECT_EQ(10 * std::max(i, j) + std::min(i, j), twist[i * 6 + j]) << i << "," << j;
+        }
+    }
+}
+
+TEST(InsCore, OnlyRequestedFramesAreOutput)
+{
+    RecordingSink sink;
+    InsCore core(&sink);
+    core.set_ref_lla(REF_LLA);
+    ins_4_t ins = make_ins4();
+
+    core.ins4(ins, 0);
+    EXPECT_TRUE(sink.frames.empty());
+
+    core.ins4(ins, InsCore::ODOM_ENU | InsCore::ODOM_ECEF);
+    ASSERT_EQ(2u, sink.frames.size());
+    EXPECT_EQ(InsSink::FRAME_ECEF, sink.frames[0]);
+    EXPECT_EQ(InsSink::FRAME_ENU, sink.frames[1]);
+    EXPECT_EQ(sink.odoms[0].stamp.sec, sink.odoms[1].stamp.sec);
+    EXPECT_EQ(sink.odoms[0].stamp.nsec, sink.odoms[1].stamp.nsec);
+}
+
+TEST(InsCore, InsStateSharesTheOdometryStamp)
+{
+    RecordingSink sink;
+    InsCore core(&sink);
+    core.set_ref_lla(REF_LLA);
+    ins_4_t ins = make_ins4();
+
+    core.ins4(ins, InsCore::INS_STATE);
+    ASSERT_EQ(1u, sink.state_stamps.size());
+    EXPECT_TRUE(sink.frames.empty());
+
+    core.ins4(ins, InsCore::INS_STATE | InsCore::ODOM_NED);
+    ASSERT_EQ(2u, sink.state_stamps.size());
+    ASSERT_EQ(1u, sink.odoms.size());
+    EXPECT_EQ(sink.state_stamps[1].sec, sink.odoms[0].stamp.sec);
+    EXPECT_EQ(sink.state_stamps[1].nsec, sink.odoms[0].stamp.nsec);
+}
+
+TEST(InsCore, EnuIsNedRearranged)
+{
+    RecordingSink sink;
+    InsCore core(&sink);
+    core.set_ref_lla(REF_LLA);
+    ins_4_t ins = make_ins4();
+    ins.ecef[0] += 10.0;
+    ins.ecef[2] -= 5.0;
+
+    core.ins4(ins, InsCore::ODOM_NED | InsCore::ODOM_ENU);
+    const ins_odometry_t &ned = core.last_odometry(InsSink::FRAME_NED);
+    const ins_odometry_t &enu = core.last_odometry(InsSink::FRAME_ENU);
+    EXPECT_GT(fabs(ned.position[0]) + fabs(ned.position[1]), 1.0);
+    EXPECT_NEAR(ned.position[1], enu.position[0], 1e-3);
+    EXPECT_NEAR(ned.position[0], enu.position[1], 1e-3);
+    EXPECT_NEAR(-ned.position[2], enu.position[2], 1e-3);
+    EXPECT_NEAR(ned.linear_velocity[1], enu.linear_velocity[0], 1e-5);
+    EXPECT_NEAR(ned.linear_velocity[0], enu.linear_velocity[1], 1e-5);
+    EXPECT_NEAR(-ned.linear_velocity[2], enu.linear_velocity[2], 1e-5);
+
+    // Speed is the same in every frame
+    const double *v = ned.linear_velocity;
+    double speed = sqrt(ins.ve[0] * ins.ve[0] + ins.ve[1] * ins.ve[1] + ins.ve[2] * ins.ve[2]);
+    EXPECT_NEAR(speed, sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]), 1e-4);
+}
+
+TEST(InsCore, ImuUsesLatestEnuOrientationAndRate)
+{
+    RecordingSink sink;
+    InsCore core(&sink);
+    core.set_ref_lla(REF_LLA);
+    core.covariance(make_covariance());
+    core.ins4(make_ins4(), InsCore::ODOM_ENU);
+
+    pimu_t pimu;
+    memset(&pimu, 0, sizeof(pimu));
+    pimu.time = 100.0;
+    pimu.dt = 0.01f;
+    pimu.theta[2] = 0.001f;
+    pimu.vel[2] = -0.0981f;
+    core.pimu(pimu, InsCore::IMU | InsCore::PREINT_IMU);
+
+    ASSERT_EQ(1u, sink.imus.size());
+    ASSERT_EQ(1u, sink.preints.size());
+    const ins_odometry_t &enu = core.last_odometry(InsSink::FRAME_ENU);
+    EXPECT_NEAR(0.1, sink.imus[0].angular_velocity[2], 1e-6);
+    EXPECT_NEAR(-9.81, sink.imus[0].linear_acceleration[2], 1e-5);
+    for (int i = 0; i < 4; i++)
+        EXPECT_EQ(enu.orientation[i], sink.imus[0].orientation[i]);
+    EXPECT_EQ(enu.pose_covariance[35], sink.imus[0].orientation_covariance[2]);
+    EXPECT_EQ(sink.imus[0].stamp.sec, sink.preints[0].stamp.sec);
+    EXPECT_FLOAT_EQ(0.001f, sink.preints[0].dtheta[2]);
+}
+
+TEST(InsTimeSync, GpsTimeIsUnixTime)
+{
+    InsTimeSync time_sync;
+    time_sync.gps_week = 2230;
+    time_sync.gps_tow_offset = 345000.25;
+    ASSERT_TRUE(time_sync.has_gps_time());
+
+    ins_stamp_t stamp = time_sync.from_week_and_tow(2230, 345600.5);
+    EXPECT_EQ((uint32_t)(UNIX_TO_GPS_OFFSET + 2230 * 604800 + 345600), stamp.sec);
+    EXPECT_EQ(500000000u, stamp.nsec);
+    EXPECT_NEAR(345600.5, time_sync.tow(stamp), 1e-6);
+
+    // Start time plus the offset is the same time of week
+    stamp = time_sync.from_start_time(600.25);
+    EXPECT_EQ((uint32_t)(UNIX_TO_GPS_OFFSET + 2230 * 604800 + 345600), stamp.sec);
+    EXPECT_EQ(500000000u, stamp.nsec);
+
+    stamp = InsTimeSync::from_gtime(1660000000, 0.25);
+    EXPECT_EQ(1660000000u - LEAP_SECONDS, stamp.sec);
+    EXPECT_EQ(250000000u, stamp.nsec);
+}
+
+TEST(InsTimeSync, LocalOffsetFollowsClockWithoutGps)
+{
+    double now = 1000.0;
+    InsTimeSync time_sync;
+    time_sync.clock = [&now]()
+    {
+        return now;
+    };
+
+    // First message seeds the offset, later ones are low-pass filtered
+    ins_stamp_t stamp = time_sync.from_start_time(10.0);
+    EXPECT_NEAR(1000.0, stamp.to_sec(), 1e-6);
+    now = 1002.0;
+    stamp = time_sync.from_start_time(11.0);
+    EXPECT_NEAR(990.0 + 0.005, time_sync.local_offset, 1e-9);
+    EXPECT_NEAR(1001.005, stamp.to_sec(), 1e-6);
+
+    // A seeded offset more than a second off is replaced by the first measurement
+    time_sync.seeded = true;
+    now = 2000.0;
+    time_sync.from_start_time(12.0);
+    EXPECT_FALSE(time_sync.seeded);
+    EXPECT_NEAR(1988.0, time_sync.local_offset, 1e-9);
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "ins_state.h"
+
+// Same fields as inertial_sense_ros::INSState, which needs the generated messages
+struct ins_state_msg_t
+{
+    double ecef[3];
+    float qe2b[4];
+    float ve[3];
+    float angular_velocity[3];
+    double ref_lla[3];
+    std::vector<float> pose_covariance;
+    std::vector<float> twist_covariance;
+};
+
+static const double REF_LLA[3] = {40.0, -111.5, 1400.0};
+
+// State north of the reference by the given distance, yawed and moving in NED, covariance diagonal in NED
+static ins_state_msg_t make_state(double north, double yaw, const double vned[3], const double variance[6])
+{
+    ins_state_msg_t msg = {};
+    for (int i = 0; i < 3; i++)
+        msg.ref_lla[i] = REF_LLA[i];
+
+    double Rn2e[3][3], Re2n[3][3];
+    ins_state_ecef_to_ned(REF_LLA[0], REF_LLA[1], Re2n);
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            Rn2e[i][j] = Re2n[j][i];
+
+    double refEcef[3], offset[3], ned[3] = {north, 0, 0};
+    ins_state_lla_to_ecef(REF_LLA, refEcef);
+    ins_state_rotate(Rn2e, ned, offset);
+    for (int i = 0; i < 3; i++)
+        msg.ecef[i] = refEcef[i] + offset[i];
+
+    double qn2b[4] = {cos(yaw / 2), 0, 0, sin(yaw / 2)}, Rb2n[3][3], Rb2e[3][3], qe2b[4];
+    ins_state_quat_to_matrix(qn2b, Rb2n);
+    ins_state_mul(Rn2e, Rb2n, Rb2e);
+    ins_state_matrix_to_quat(Rb2e, qe2b);
+    double ve[3];
+    ins_state_rotate(Rn2e, vned, ve);
+    for (int i = 0; i < 4; i++)
+        msg.qe2b[i] = qe2b[i];
+    for (int i = 0; i < 3; i++)
+        msg.ve[i] = ve[i];
+    msg.angular_velocity[2] = 0.5f;
+
+    if (variance)
+    {
+        // Position in NED to ECEF, attitude stays in body
+        double D[36] = {}, I[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, P[36];
+        for (int i = 0; i < 6; i++)
+            D[i * 6 + i] = variance[i];
+        ins_state_transform_covariance(D, Rn2e, I, P);
+        msg.pose_covariance.resize(INS_STATE_COVARIANCE_SIZE);
+        msg.twist_covariance.resize(INS_STATE_COVARIANCE_SIZE);
+        ins_state_pack_covariance(P, &msg.pose_covariance[0]);
+        ins_state_pack_covariance(P, &msg.twist_covariance[0]);
+    }
+    return msg;
+}
+
+TEST(InsState, PackCovariance)
+{
+    double full[36], unpacked[36];
+    for (int row = 0; row < 6; row++)
+        for (int col = 0; col < 6; col++)
+            full[row * 6 + col] = row <= col ? row * 10 + col : col * 10 + row;
+
+    float packed[INS_STATE_COVARIANCE_SIZE];
+    ins_state_pack_covariance(full, packed);
+    EXPECT_EQ(0.0f, packed[0]);
+    EXPECT_EQ(5.0f, packed[5]);
+    EXPECT_EQ(11.0f, packed[6]);
+    EXPECT_EQ(55.0f, packed[INS_STATE_COVARIANCE_SIZE - 1]);
+
+    ins_state_unpack_covariance(packed, unpacked);
+    for (int i = 0; i < 36; i++)
+        EXPECT_EQ(full[i], unpacked[i]) << i;
+}
+
+TEST(InsState, EcefToLla)
+{
+    double ecef[3], lla[3];
+    ins_state_lla_to_ecef(REF_LLA, ecef);
+    ins_state_ecef_to_lla(ecef, lla);
+    EXPECT_NEAR(REF_LLA[0], lla[0], 1.0e-9);
+    EXPECT_NEAR(REF_LLA[1], lla[1], 1.0e-9);
+    EXPECT_NEAR(REF_LLA[2], lla[2], 1.0e-4);
+}
+
+TEST(InsState, Ned)
+{
+    double vned[3] = {1.0, 2.0, -0.5};
+    ins_state_msg_t msg = make_state(100.0, 0.3, vned, NULL);
+
+    ins_state_frame_t ned;
+    ins_state_to_frame(msg, INS_STATE_NED, ned);
+    EXPECT_NEAR(100.0, ned.position[0], 1.0e-3);
+    EXPECT_NEAR(0.0, ned.position[1], 1.0e-3);
+    EXPECT_NEAR(0.0, ned.position[2], 1.0e-3);
+    EXPECT_FALSE(ned.has_covariance);
+
+    // Float quaternion and velocity, and the NED frame 100 m north is tilted by 16 urad
+    EXPECT_NEAR(cos(0.15), ned.orientation[0], 1.0e-4);
+    EXPECT_NEAR(sin(0.15), ned.orientation[3], 1.0e-4);
+    for (int i = 0; i < 3; i++)
+        EXPECT_NEAR(vned[i], ned.linear_velocity[i], 1.0e-4);
+    EXPECT_NEAR(0.5, ned.angular_velocity[2], 1.0e-4);
+}
+
+TEST(InsState, EnuAndEcef)
+{
+    double vned[3] = {1.0, 2.0, -0.5};
+    ins_state_msg_t msg = make_state(100.0, 0.0, vned, NULL);
+
+    ins_state_frame_t enu;
+    ins_state_to_frame(msg, INS_STATE_ENU, enu);
+    EXPECT_NEAR(0.0, enu.position[0], 1.0e-3);
+    EXPECT_NEAR(100.0, enu.position[1], 1.0e-3);
+    EXPECT_NEAR(2.0, enu.linear_velocity[0], 1.0e-4);
+    EXPECT_NEAR(1.0, enu.linear_velocity[1], 1.0e-4);
+    EXPECT_NEAR(0.5, enu.linear_velocity[2], 1.0e-4);
+    EXPECT_NEAR(-0.5, enu.angular_velocity[2], 1.0e-4);
+
+    ins_state_frame_t ecef;
+    ins_state_to_frame(msg, INS_STATE_ECEF, ecef);
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(msg.ecef[i], ecef.position[i]);
+        EXPECT_NEAR(msg.ve[i], ecef.linear_velocity[i], 1.0e-6);
+    }
+    for (int i = 0; i < 4; i++)
+        EXPECT_NEAR(msg.qe2b[i] * (msg.qe2b[0] < 0 ? -1 : 1), ecef.orientation[i], 1.0e-6);
+}
+
+TEST(InsState, Covariance)
+{
+    double vned[3] = {0, 0, 0};
+    double variance[6] = {1.0, 4.0, 9.0, 0.01, 0.02, 0.03};
+    ins_state_msg_t msg = make_state(0.0, 0.0, vned, variance);
+
+    ins_state_frame_t ned;
+    ins_state_to_frame(msg, INS_STATE_NED, ned);
+    ASSERT_TRUE(ned.has_covariance);
+    // Attitude covariance in body rotates into NED, with no yaw it stays as it was
+    for (int row = 0; row < 6; row++)
+        for (int col = 0; col < 6; col++)
+            EXPECT_NEAR(row == col ? variance[row] : 0.0, ned.pose_covariance[row * 6 + col], 1.0e-5) << row << "," << col;
+
+    ins_state_frame_t enu;
+    ins_state_to_frame(msg, INS_STATE_ENU, enu);
+    EXPECT_NEAR(4.0, enu.pose_covariance[0], 1.0e-5);
+    EXPECT_NEAR(1.0, enu.pose_covariance[7], 1.0e-5);
+    EXPECT_NEAR(9.0, enu.twist_covariance[14], 1.0e-5);
+}
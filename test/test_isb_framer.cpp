@@ -0,0 +1,248 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+
+#include "isb_framer.h"
+#include "serial.h"
+
+struct TestData
+{
+    double a;
+    uint32_t b;
+    uint8_t c[12];
+};
+
+// Build an escaped ISB data packet the way the uINS sends it
+static std::vector<uint8_t> encode(uint32_t did, const void *data, uint32_t size, uint8_t counter)
+{
+    std::vector<uint8_t> plain = {PID_DATA, counter, 0};
+    p_data_hdr_t hdr = {did, size, 0};
+    plain.insert(plain.end(), (const uint8_t *)&hdr, (const uint8_t *)&hdr + sizeof(hdr));
+    plain.insert(plain.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+
+    uint32_t checksum = 0x00AAAAAA;
+    for (size_t i = 0; i < plain.size(); i++)
+        checksum ^= (uint32_t)plain[i] << (8 * (i % 3));
+    plain.push_back(checksum >> 16);
+    plain.push_back(checksum >> 8);
+    plain.push_back(checksum);
+
+    std::vector<uint8_t> packet = {PSC_START_BYTE};
+    for (uint8_t byte : plain)
+    {
+        if (byte == PSC_START_BYTE || byte == PSC_END_BYTE || byte == PSC_ESCAPE_BYTE)
+        {
+            packet.push_back(PSC_ESCAPE_BYTE);
+            packet.push_back(~byte);
+        }
+        else
+        {
+            packet.push_back(byte);
+        }
+    }
+    packet.push_back(PSC_END_BYTE);
+    return packet;
+}
+
+static TestData make_data(int i)
+{
+    TestData data;
+    memset(&data, 0, sizeof(data));
+    data.a = 1.5 * i;
+    data.b = 0xFEFDFF00 + i; // needs escaping
+    memset(data.c, 0xFF, sizeof(data.c));
+    data.c[0] = i;
+    return data;
+}
+
+TEST(IsbFramer, FramesEscapedPacketsInPlace)
+{
+    std::vector<uint8_t> stream = {'$', 'G', 'P', 'G', 'G', 'A', '\n'};
+    for (int i = 0; i < 3; i++)
+    {
+        TestData data = make_data(i);
+        std::vector<uint8_t> packet = encode(42, &data, sizeof(data), i);
+        stream.insert(stream.end(), packet.begin(), packet.end());
+    }
+
+    alignas(8) uint8_t buf[512];
+    memcpy(buf, stream.data(), stream.size());
+
+    IsbFramer framer;
+    IsbPacket packet;
+    size_t pos = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_TRUE(framer.next(buf, stream.size(), pos, packet));
+        EXPECT_EQ(i, packet.counter);
+        EXPECT_EQ(NULL, packet.view<TestData>(43));
+        const TestData *view = packet.view<TestData>(42);
+        ASSERT_NE((const TestData *)NULL, view);
+        EXPECT_EQ(0u, (uintptr_t)view % 8);
+        EXPECT_EQ(1.5 * i, view->a);
+        EXPECT_EQ(0xFEFDFF00 + i, view->b);
+        EXPECT_EQ(i, view->c[0]);
+        EXPECT_EQ(0xFF, view->c[11]);
+    }
+    EXPECT_FALSE(framer.next(buf, stream.size(), pos, packet));
+    EXPECT_EQ(stream.size(), pos);
+    EXPECT_EQ(3u, framer.packets());
+    EXPECT_EQ(7u, framer.dropped_bytes());
+}
+
+TEST(IsbFramer, ResyncsAfterCorruptAndTruncatedPackets)
+{
+    TestData data = make_data(1);
+    std::vector<uint8_t> good = encode(42, &data, sizeof(data), 1);
+    std::vector<uint8_t> corrupt = good;
+    corrupt[8] ^= 0x01;
+    std::vector<uint8_t> truncated(good.begin(), good.begin() + 10);
+
+    std::vector<uint8_t> stream;
+    stream.insert(stream.end(), corrupt.begin(), corrupt.end());
+    stream.insert(stream.end(), truncated.begin(), truncated.end());
+    stream.insert(stream.end(), good.begin(), good.end());
+    stream.insert(stream.end(), good.begin(), good.begin() + 5); // incomplete at the end
+
+    alignas(8) uint8_t buf[512];
+    memcpy(buf, stream.data(), stream.size());
+
+    IsbFramer framer;
+    IsbPacket packet;
+    size_t pos = 0;
+    ASSERT_TRUE(framer.next(buf, stream.size(), pos, packet));
+    ASSERT_NE((const TestData *)NULL, packet.view<TestData>(42));
+    EXPECT_EQ(data.b, packet.view<TestData>(42)->b);
+    EXPECT_FALSE(framer.next(buf, stream.size(), pos, packet));
+    EXPECT_EQ(stream.size() - 5, pos);
+    EXPECT_EQ(1u, framer.checksum_errors());
+}
+
+TEST(IsbFramer, EncodeRoundTrip)
+{
+    TestData data = make_data(7);
+    std::vector<uint8_t> expected = encode(42, &data, sizeof(data), 7);
+
+    uint8_t body[sizeof(p_data_hdr_t) + sizeof(TestData)];
+    p_data_hdr_t hdr = {42, sizeof(data), 0};
+    memcpy(body, &hdr, sizeof(hdr));
+    memcpy(body + sizeof(hdr), &data, sizeof(data));
+
+    alignas(8) uint8_t buf[256];
+    EXPECT_EQ(0u, IsbFramer::encode(PID_DATA, 7, body, sizeof(body), buf, expected.size() - 1));
+    ASSERT_EQ(expected.size(), IsbFramer::encode(PID_DATA, 7, body, sizeof(body), buf, sizeof(buf)));
+    EXPECT_EQ(0, memcmp(expected.data(), buf, expected.size()));
+}
+
+class PacketCollector : public SerialListener
+{
+public:
+    void handle_bytes(const uint8_t *bytes, size_t len) override { bytes_ += len; }
+
+    void handle_packet(const IsbPacket &packet) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const TestData *data = packet.view<TestData>(42);
+        if (data != NULL)
+            received_.push_back(*data);
+    }
+
+    std::vector<TestData> received()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return received_;
+    }
+
+    size_t bytes_ = 0;
+
+private:
+    std::mutex mutex_;
+    std::vector<TestData> received_;
+};
+
+TEST(Serial, FramesPacketsSpanningReads)
+{
+    int master, slave;
+    char name[256];
+    struct termios tio;
+    ASSERT_EQ(0, openpty(&master, &slave, name, NULL, NULL));
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    PacketCollector collector;
+    Serial serial(name, 921600);
+    serial.register_listener(&collector);
+    serial.open();
+
+    // Dribble the packets out in chunks that don't line up with packet boundaries
+    const int count = 200;
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < count; i++)
+    {
+        TestData data = make_data(i);
+        std::vector<uint8_t> packet = encode(42, &data, sizeof(data), i);
+        stream.insert(stream.end(), packet.begin(), packet.end());
+    }
+    for (size_t i = 0; i < stream.size(); i += 13)
+    {
+        ASSERT_GT(write(master, &stream[i], std::min<size_t>(13, stream.size() - i)), 0);
+        if (i % 130 == 0)
+            usleep(1000);
+    }
+
+    for (int i = 0; i < 200 && collector.received().size() < (size_t)count; i++)
+        usleep(10000);
+    serial.close();
+    close(slave);
+    close(master);
+
+    std::vector<TestData> received = collector.received();
+    ASSERT_EQ((size_t)count, received.size());
+    for (int i = 0; i < count; i++)
+    {
+        EXPECT_EQ(1.5 * i, received[i].a);
+        EXPECT_EQ(0xFEFDFF00 + i, received[i].b);
+    }
+    EXPECT_EQ(stream.size(), collector.bytes_);
+    EXPECT_EQ(0u, serial.framer().dropped_bytes());
+}
+
+TEST(Serial, ReadErrorClosesThePortFromTheIoThread)
+{
+    int master, slave;
+    char name[256];
+    struct termios tio;
+    ASSERT_EQ(0, openpty(&master, &slave, name, NULL, NULL));
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    Serial serial(name, 921600);
+    serial.open();
+    close(slave);
+    // Hanging up the master fails the pending read with EIO
+    close(master);
+
+    const uint8_t byte = 0;
+    bool closed = false;
+    for (int i = 0; i < 200 && !closed; i++)
+    {
+        try
+        {
+            serial.write(&byte, 1);
+            usleep(10000);
+        }
+        catch (const SerialException &)
+        {
+            closed = true;
+        }
+    }
+    EXPECT_TRUE(closed);
+    serial.close();
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+#include "isb_raw.h"
+
+// A data set packet as handed over by the SDK, with room for any data set used here
+struct TestPacket
+{
+    p_data_hdr_t hdr;
+    uint8_t buf[sizeof(ins_1_t)];
+};
+
+static TestPacket make_ins1(int i)
+{
+    TestPacket packet;
+    ins_1_t ins1;
+    memset(&ins1, 0xFF, sizeof(ins1)); // needs escaping
+    ins1.week = 2200;
+    ins1.timeOfWeek = 100.0 + i;
+    ins1.theta[2] = 0.5f * i;
+    ins1.lla[0] = 40.0;
+    packet.hdr.id = DID_INS_1;
+    packet.hdr.size = sizeof(ins1);
+    packet.hdr.offset = 0;
+    memcpy(packet.buf, &ins1, sizeof(ins1));
+    return packet;
+}
+
+TEST(IsbRaw, RoundTrip)
+{
+    IsbRawWriter writer;
+    EXPECT_TRUE(writer.empty());
+    for (int i = 0; i < 3; i++)
+    {
+        TestPacket packet = make_ins1(i);
+        writer.append(reinterpret_cast<const p_data_t *>(&packet));
+    }
+
+    inertial_sense_ros::ISBRaw raw;
+    writer.take(ros::Time(12, 500), raw);
+    EXPECT_TRUE(writer.empty());
+    ASSERT_EQ(3u, raw.did.size());
+    ASSERT_EQ(3u, raw.offset.size());
+    ASSERT_EQ(3u, raw.end.size());
+    EXPECT_EQ(raw.data.size(), raw.end.back());
+    EXPECT_EQ(ros::Time(12, 500), raw.header.stamp);
+
+    IsbRawReader reader(raw);
+    IsbPacket packet;
+    inertial_sense_ros::DID_INS1 ins1;
+    int count = 0;
+    while (reader.next(packet))
+    {
+        EXPECT_EQ(DID_INS_1, raw.did[count]);
+        EXPECT_EQ(0, raw.offset[count]);
+        ASSERT_TRUE(IsbRawReader::decode<DID_INS_1>(packet, ins1));
+        EXPECT_EQ(2200u, ins1.week);
+        EXPECT_DOUBLE_EQ(100.0 + count, ins1.timeOfWeek);
+        EXPECT_FLOAT_EQ(0.5f * count, ins1.theta[2]);
+        EXPECT_DOUBLE_EQ(40.0, ins1.lla[0]);
+        EXPECT_EQ(NULL, IsbRawReader::view<DID_INS_2>(packet));
+        count++;
+    }
+    EXPECT_EQ(3, count);
+    EXPECT_EQ(0u, reader.checksum_errors());
+}
+
+TEST(IsbRaw, BatchesAreIndependent)
+{
+    IsbRawWriter writer;
+    inertial_sense_ros::ISBRaw raw;
+    TestPacket packet = make_ins1(0);
+
+    writer.append(reinterpret_cast<const p_data_t *>(&packet));
+    writer.append(reinterpret_cast<const p_data_t *>(&packet));
+    writer.take(ros::Time(1, 0), raw);
+    size_t first = raw.data.size();
+
+    writer.append(reinterpret_cast<const p_data_t *>(&packet));
+    writer.take(ros::Time(2, 0), raw);
+    EXPECT_EQ(1u, raw.did.size());
+    EXPECT_EQ(first / 2, raw.data.size());
+    EXPECT_EQ(raw.data.size(), raw.end[0]);
+}
+
+TEST(IsbRaw, CorruptPacketIsSkipped)
+{
+    IsbRawWriter writer;
+    inertial_sense_ros::ISBRaw raw;
+    for (int i = 0; i < 2; i++)
+    {
+        TestPacket packet = make_ins1(i);
+        writer.append(reinterpret_cast<const p_data_t *>(&packet));
+    }
+    writer.take(ros::Time(1, 0), raw);
+    raw.data[raw.end[0] / 2] ^= 0x01;
+
+    IsbRawReader reader(raw);
+    IsbPacket packet;
+    inertial_sense_ros::DID_INS1 ins1;
+    ASSERT_TRUE(reader.next(packet));
+    ASSERT_TRUE(IsbRawReader::decode<DID_INS_1>(packet, ins1));
+    EXPECT_DOUBLE_EQ(101.0, ins1.timeOfWeek);
+    EXPECT_FALSE(reader.next(packet));
+    EXPECT_EQ(1u, reader.checksum_errors());
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include "link_budget.h"
+#include "ISComm.h"
+#include "data_sets.h"
+
+TEST(LinkBudget, PlansByteRateFromSizeAndPeriod)
+{
+    LinkBudget budget(921600, 0.8);
+    budget.set_source_periods(4.0, 200.0);
+    EXPECT_DOUBLE_EQ(92160.0, budget.capacity()); // 8N1: 10 bits per byte
+    EXPECT_EQ(0.0, budget.planned_rate());
+
+    EXPECT_EQ(1, budget.plan_stream(DID_INS_4, 100, 1));
+    EXPECT_EQ(2, budget.plan_stream(DID_PIMU, 60, 2));
+    double ins4 = LinkBudget::packet_size(100) * 250.0;
+    double pimu = LinkBudget::packet_size(60) * 125.0;
+    EXPECT_DOUBLE_EQ(ins4, budget.stream_rate(DID_INS_4, budget.streams().at(DID_INS_4)));
+    EXPECT_DOUBLE_EQ(ins4 + pimu, budget.planned_rate());
+    EXPECT_DOUBLE_EQ((ins4 + pimu) / 92160.0, budget.utilization());
+    EXPECT_FALSE(budget.over_budget());
+
+    // Packet overhead counts, and escaping makes a packet a little larger than its bytes
+    EXPECT_GT(LinkBudget::packet_size(100), 100.0 + sizeof(p_data_hdr_t));
+    EXPECT_DOUBLE_EQ(LinkBudget::packet_size(100) - LinkBudget::packet_size(0), 100.0 * (1.0 + 3.0 / 256.0));
+
+    // A slower link cannot carry the same plan
+    budget.set_link(115200, 0.8);
+    EXPECT_TRUE(budget.over_budget());
+
+    // A period multiple of 0 disables the stream
+    EXPECT_EQ(0, budget.plan_stream(DID_PIMU, 60, 0));
+    EXPECT_EQ(0u, budget.streams().count(DID_PIMU));
+    EXPECT_DOUBLE_EQ(ins4, budget.planned_rate());
+}
+
+TEST(LinkBudget, GpsStreamsFollowTheGpsPeriod)
+{
+    LinkBudget budget;
+    budget.set_source_periods(2.0, 200.0);
+    budget.plan_stream(DID_INS_1, 100, 4);
+    budget.plan_stream(DID_GPS1_POS, 100, 1);
+    budget.plan_stream(DID_GPS1_RAW, 1000, 1);
+    budget.plan_stream(DID_GPS2_RTK_CMP_REL, 100, 2);
+    budget.plan_stream(DID_STROBE_IN_TIME, 20, 1);
+
+    const LinkBudget::stream_map_t &streams = budget.streams();
+    EXPECT_DOUBLE_EQ(125.0, budget.planned_packet_rate(DID_INS_1, streams.at(DID_INS_1)));
+    EXPECT_DOUBLE_EQ(5.0, budget.planned_packet_rate(DID_GPS1_POS, streams.at(DID_GPS1_POS)));
+    EXPECT_DOUBLE_EQ(5.0, budget.planned_packet_rate(DID_GPS1_RAW, streams.at(DID_GPS1_RAW)));
+    EXPECT_DOUBLE_EQ(2.5, budget.planned_packet_rate(DID_GPS2_RTK_CMP_REL, streams.at(DID_GPS2_RTK_CMP_REL)));
+    // Strobe times are only sent on events and are not planned
+    EXPECT_EQ(0.0, budget.planned_packet_rate(DID_STROBE_IN_TIME, streams.at(DID_STROBE_IN_TIME)));
+    EXPECT_EQ(0.0, budget.stream_rate(DID_STROBE_IN_TIME, streams.at(DID_STROBE_IN_TIME)));
+
+    // Faster GPS, the navigation period stays as it was
+    budget.set_source_periods(0.0, 100.0);
+    EXPECT_DOUBLE_EQ(10.0, budget.planned_packet_rate(DID_GPS1_POS, streams.at(DID_GPS1_POS)));
+    EXPECT_DOUBLE_EQ(125.0, budget.planned_packet_rate(DID_INS_1, streams.at(DID_INS_1)));
+}
+
+TEST(LinkBudget, ScaleToFit)
+{
+    LinkBudget budget(115200, 0.8);
+    budget.set_source_periods(4.0, 200.0);
+    budget.plan_stream(DID_INS_4, 100, 1); // about 30 kB/s on an 11.5 kB/s link
+    budget.plan_stream(DID_PIMU, 60, 1);
+    budget.plan_stream(DID_GPS1_POS, 100, 1);
+    ASSERT_TRUE(budget.over_budget());
+
+    // Only warns unless enabled
+    EXPECT_TRUE(budget.scale_to_fit().empty());
+    EXPECT_TRUE(budget.over_budget());
+
+    budget.set_auto_scale(true);
+    std::map<uint32_t, int> changed = budget.scale_to_fit();
+    EXPECT_FALSE(budget.over_budget());
+    EXPECT_LE(budget.utilization(), budget.headroom());
+    ASSERT_EQ(1u, changed.count(DID_INS_4));
+    EXPECT_EQ(budget.streams().at(DID_INS_4).period_multiple, changed[DID_INS_4]);
+    EXPECT_EQ(1, budget.streams().at(DID_INS_4).requested_multiple);
+    // The light GPS stream is not touched while heavier streams can give way
+    EXPECT_EQ(0u, changed.count(DID_GPS1_POS));
+    EXPECT_EQ(1, budget.streams().at(DID_GPS1_POS).period_multiple);
+
+    // Requested again as configured, the stream keeps its scaled period
+    int scaled = changed[DID_INS_4];
+    EXPECT_EQ(scaled, budget.plan_stream(DID_INS_4, 100, 1));
+    // A new configuration starts over from what it asks for
+    EXPECT_EQ(8, budget.plan_stream(DID_INS_4, 100, 8));
+    EXPECT_EQ(8, budget.streams().at(DID_INS_4).requested_multiple);
+}
+
+TEST(LinkBudget, MeasuredRateAgainstPlan)
+{
+    LinkBudget budget;
+    budget.set_source_periods(10.0, 200.0);
+    budget.plan_stream(DID_INS_4, 100, 1); // 100 Hz
+    budget.plan_stream(DID_GPS1_POS, 100, 1); // 5 Hz
+
+    EXPECT_EQ(0.0, budget.measure(0.0)); // opens the first window
+    for (int i = 0; i < 50; i++)
+        budget.received(DID_INS_4, 100);
+    for (int i = 0; i < 5; i++)
+        budget.received(DID_GPS1_POS, 100);
+    budget.received(DID_INS_1, 100); // not planned, still uses the link
+    double rate = budget.measure(1.0);
+    EXPECT_NEAR(56 * LinkBudget::packet_size(100), rate, 56.0);
+    EXPECT_DOUBLE_EQ(50.0, budget.streams().at(DID_INS_4).measured_rate);
+    EXPECT_EQ(50u, budget.streams().at(DID_INS_4).received_packets);
+
+    std::map<uint32_t, double> lagging = budget.lagging_streams(0.9);
+    ASSERT_EQ(1u, lagging.size());
+    EXPECT_DOUBLE_EQ(0.5, lagging[DID_INS_4]);
+
+    // An empty window
+    EXPECT_EQ(0.0, budget.measure(2.0));
+    EXPECT_EQ(2u, budget.lagging_streams(0.9).size());
+}
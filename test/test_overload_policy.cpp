@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+#include "overload_policy.h"
+
+static const uint32_t INS = 4;
+static const uint32_t GPS_SAT = 33;
+static const uint32_t GPS_RAW = 99;
+static const uint32_t GPS_POS = 13;
+
+class OverloadPolicyTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        policy.set_dispatch([this](const p_data_t *data, double receiveTime)
+                            {
+                                uint32_t value;
+                                memcpy(&value, data->buf, sizeof(value));
+                                dispatched.push_back(std::make_pair(data->hdr.id, value));
+                                received.push_back(receiveTime);
+                            });
+        policy.set_policy(GPS_SAT, OverloadPolicy::PRIORITY_LOW, OverloadPolicy::DROP_LATEST);
+        policy.set_policy(GPS_RAW, OverloadPolicy::PRIORITY_LOW, OverloadPolicy::DROP_COALESCE);
+        policy.set_policy(GPS_POS, OverloadPolicy::PRIORITY_NORMAL, OverloadPolicy::DROP_LATEST);
+    }
+
+    void packet(uint32_t did, uint32_t value)
+    {
+        p_data_t data;
+        data.hdr.id = did;
+        data.hdr.size = sizeof(value);
+        data.hdr.offset = 0;
+        memcpy(data.buf, &value, sizeof(value));
+        policy.dispatch(&data, now);
+    }
+
+    // One measurement window of reads at the given utilization
+    void load(double utilization)
+    {
+        for (int i = 0; i < 10; i++, now += 0.01)
+        {
+            if (i < 10 * utilization)
+                packet(INS, 0);
+            policy.read_done(now, now + 0.01);
+        }
+        dispatched.clear();
+        received.clear();
+    }
+
+    OverloadPolicy policy{0.8, 0.95, 0.095, 3}; // windows close on the last read of load()
+    std::vector<std::pair<uint32_t, uint32_t>> dispatched;
+    std::vector<double> received;
+    double now = 0.0;
+};
+
+TEST_F(OverloadPolicyTest, LevelsFollowUtilizationWithHysteresis)
+{
+    load(0.5);
+    EXPECT_EQ(0, policy.level());
+    EXPECT_NEAR(0.5, policy.utilization(), 0.01);
+    load(0.9);
+    EXPECT_EQ(1, policy.level());
+    EXPECT_TRUE(policy.shed(OverloadPolicy::PRIORITY_LOW));
+    EXPECT_FALSE(policy.shed(OverloadPolicy::PRIORITY_NORMAL));
+    load(1.0);
+    EXPECT_EQ(2, policy.level());
+    EXPECT_FALSE(policy.shed(OverloadPolicy::PRIORITY_HIGH));
+    load(0.9);
+    EXPECT_EQ(2, policy.level());
+    load(0.8);
+    EXPECT_EQ(1, policy.level());
+    load(0.5);
+    EXPECT_EQ(0, policy.level());
+    EXPECT_EQ(4u, policy.level_changes());
+}
+
+TEST_F(OverloadPolicyTest, NothingIsHeldWithoutLoad)
+{
+    packet(GPS_SAT, 1);
+    packet(GPS_RAW, 2);
+    packet(INS, 3);
+    ASSERT_EQ(3u, dispatched.size());
+    EXPECT_EQ(GPS_SAT, dispatched[0].first);
+    EXPECT_EQ(INS, dispatched[2].first);
+}
+
+TEST_F(OverloadPolicyTest, ShedStreamsAreHeldAndFlushedByPriority)
+{
+    load(1.0);
+    ASSERT_EQ(2, policy.level());
+
+    packet(GPS_SAT, 1);
+    packet(GPS_SAT, 2); // replaces 1
+    for (uint32_t i = 10; i < 15; i++)
+        packet(GPS_RAW, i); // queue of 3 keeps 12, 13, 14
+    double posReceived = now;
+    packet(GPS_POS, 20);
+    packet(INS, 30);
+    ASSERT_EQ(1u, dispatched.size());
+    EXPECT_EQ(INS, dispatched[0].first);
+
+    // Still overloaded, nothing is converted
+    policy.flush();
+    EXPECT_EQ(1u, dispatched.size());
+
+    // Normal priority comes back first
+    load(0.8);
+    ASSERT_EQ(1, policy.level());
+    policy.flush();
+    ASSERT_EQ(1u, dispatched.size());
+    EXPECT_EQ(std::make_pair(GPS_POS, 20u), dispatched[0]);
+    // Converted with the time it was read, not the time of the flush
+    EXPECT_EQ(posReceived, received[0]);
+    EXPECT_LT(posReceived, now);
+
+    load(0.5);
+    policy.flush();
+    ASSERT_EQ(4u, dispatched.size());
+    EXPECT_EQ(std::make_pair(GPS_SAT, 2u), dispatched[0]);
+    EXPECT_EQ(std::make_pair(GPS_RAW, 12u), dispatched[1]);
+    EXPECT_EQ(std::make_pair(GPS_RAW, 14u), dispatched[3]);
+
+    const OverloadPolicy::stream_t &sat = policy.streams().at(GPS_SAT);
+    EXPECT_EQ(2u, sat.deferred);
+    EXPECT_EQ(1u, sat.dropped);
+    EXPECT_EQ(1u, sat.flushed);
+    EXPECT_EQ(2u, policy.streams().at(GPS_RAW).dropped);
+}
+
+TEST_F(OverloadPolicyTest, ArrivalAfterLoadDropsKeepsStreamOrder)
+{
+    load(1.0);
+    packet(GPS_RAW, 1);
+    packet(GPS_RAW, 2);
+    load(0.5);
+    // Next packet of the stream arrives before the flush after the read
+    packet(GPS_RAW, 3);
+    ASSERT_EQ(3u, dispatched.size());
+    EXPECT_EQ(1u, dispatched[0].second);
+    EXPECT_EQ(3u, dispatched[2].second);
+}
+
+TEST_F(OverloadPolicyTest, PeriodicTasksAreThinnedNotSilenced)
+{
+    int consecutive = 0;
+    EXPECT_FALSE(policy.skip(OverloadPolicy::PRIORITY_LOW, consecutive));
+    load(1.0);
+    int skipped = 0;
+    for (int i = 0; i < 10; i++)
+        skipped += policy.skip(OverloadPolicy::PRIORITY_LOW, consecutive);
+    EXPECT_EQ(8, skipped);
+    EXPECT_FALSE(policy.skip(OverloadPolicy::PRIORITY_HIGH, consecutive));
+}
+
+TEST(OverloadPolicy, ParsesNames)
+{
+    OverloadPolicy::priority_t priority;
+    OverloadPolicy::drop_t drop;
+    ASSERT_TRUE(OverloadPolicy::parse_priority("low", priority));
+    EXPECT_EQ(OverloadPolicy::PRIORITY_LOW, priority);
+    ASSERT_TRUE(OverloadPolicy::parse_drop("coalesce", drop));
+    EXPECT_EQ(OverloadPolicy::DROP_COALESCE, drop);
+    EXPECT_FALSE(OverloadPolicy::parse_priority("urgent", priority));
+    EXPECT_FALSE(OverloadPolicy::parse_drop("", drop));
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <pty.h>
+#include <unistd.h>
+#include <string.h>
+#include <termios.h>
+#include <string>
+
+#include "reconnect_supervisor.h"
+
+// Stand-in for a USB serial device: a pty whose slave is exposed under a fixed path that
+// disappears when the device is unplugged, like /dev/ttyACM0 does.
+class PtyDevice
+{
+public:
+    explicit PtyDevice(const std::string &path) : path_(path) {}
+    ~PtyDevice() { unplug(); }
+
+    void plug()
+    {
+        char name[256];
+        struct termios tio;
+        ASSERT_EQ(0, openpty(&master_, &slave_, name, NULL, NULL));
+        tcgetattr(slave_, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave_, TCSANOW, &tio);
+        ASSERT_EQ(0, symlink(name, path_.c_str()));
+    }
+
+    void unplug()
+    {
+        unlink(path_.c_str());
+        if (master_ >= 0)
+            close(master_);
+        if (slave_ >= 0)
+            close(slave_);
+        master_ = slave_ = -1;
+    }
+
+    void send(const char *data) { ASSERT_GT(write(master_, data, strlen(data)), 0); }
+
+private:
+    std::string path_;
+    int master_ = -1;
+    int slave_ = -1;
+};
+
+class ReconnectTest : public ::testing::Test
+{
+protected:
+    ReconnectTest() : path_("/tmp/test_reconnect_supervisor_" + std::to_string(getpid())),
+                      device_(path_),
+                      supervisor_(path_, 1.0, 0.5, 4.0)
+    {
+        supervisor_.set_handlers(
+            [this]()
+            {
+                fd_ = open(path_.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+                opens_++;
+                return fd_ >= 0;
+            },
+            [this](const std::string &reason)
+            {
+                if (fd_ >= 0)
+                    close(fd_);
+                fd_ = -1;
+                reason_ = reason;
+            },
+            [this]() { resumes_++; });
+    }
+
+    ~ReconnectTest()
+    {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    // Read whatever the device sent and report it to the supervisor like the dispatch path does
+    void poll(double now)
+    {
+        char buf[64];
+        if (fd_ >= 0 && read(fd_, buf, sizeof(buf)) > 0)
+            supervisor_.data_received(now);
+        supervisor_.update(now);
+    }
+
+    std::string path_;
+    PtyDevice device_;
+    ReconnectSupervisor supervisor_;
+    int fd_ = -1;
+    int opens_ = 0;
+    int resumes_ = 0;
+    std::string reason_;
+};
+
+TEST_F(ReconnectTest, ReopensPortThatDisappearsAndReappears)
+{
+    device_.plug();
+    fd_ = open(path_.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    ASSERT_GE(fd_, 0);
+
+    device_.send("ins");
+    poll(0.0);
+    EXPECT_TRUE(supervisor_.connected());
+
+    // Cable glitch: the port node vanishes
+    device_.unplug();
+    poll(0.1);
+    EXPECT_FALSE(supervisor_.connected());
+    EXPECT_EQ("port removed", reason_);
+    EXPECT_EQ(1, supervisor_.outage_count());
+
+    // Attempts back off while the device is away: 0.6, 1.6, 3.6, 7.6 (capped doubling)
+    for (double t = 0.2; t < 3.0; t += 0.1)
+        poll(t);
+    EXPECT_FALSE(supervisor_.connected());
+    EXPECT_EQ(2, supervisor_.reconnect_attempts());
+    EXPECT_EQ(0, opens_);
+
+    device_.plug();
+    for (double t = 3.0; t < 3.55; t += 0.1)
+        poll(t);
+    EXPECT_FALSE(supervisor_.connected()); // next attempt not due yet
+    poll(3.65);
+    EXPECT_TRUE(supervisor_.connected());
+    EXPECT_EQ(1, opens_);
+    EXPECT_EQ(1, resumes_);
+    EXPECT_NEAR(3.55, supervisor_.last_outage_duration(), 1e-9);
+    EXPECT_NEAR(3.55, supervisor_.total_outage_duration(), 1e-9);
+
+    // Data flows again over the reopened port
+    device_.send("ins");
+    poll(4.0);
+    EXPECT_TRUE(supervisor_.connected());
+}
+
+TEST_F(ReconnectTest, DetectsSilentLink)
+{
+    device_.plug();
+    fd_ = open(path_.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    ASSERT_GE(fd_, 0);
+
+    // No timeout before the first packet arrived
+    poll(5.0);
+    EXPECT_TRUE(supervisor_.connected());
+
+    device_.send("ins");
+    poll(6.0);
+    poll(6.9);
+    EXPECT_TRUE(supervisor_.connected());
+    poll(7.1);
+    EXPECT_FALSE(supervisor_.connected());
+    EXPECT_EQ("no data", reason_);
+
+    // Port is still there, so the next attempt reopens it
+    poll(7.65);
+    EXPECT_TRUE(supervisor_.connected());
+    EXPECT_NEAR(0.55, supervisor_.last_outage_duration(), 1e-9);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
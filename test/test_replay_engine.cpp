@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+#include "isb_raw.h"
+#include "replay_engine.h"
+
+class VectorSource : public ReplaySource
+{
+public:
+    bool next(inertial_sense_ros::ISBRaw &batch) override
+    {
+        if (index >= batches.size())
+            return false;
+        batch = batches[index++];
+        return true;
+    }
+
+    std::vector<inertial_sense_ros::ISBRaw> batches;
+    size_t index = 0;
+};
+
+class RecordingTarget : public ReplayTarget
+{
+public:
+    void set_time(const ros::Time &stamp) override { now = stamp; }
+
+    void deliver(const p_data_t *data) override
+    {
+        dids.push_back(data->hdr.id);
+        times.push_back(now);
+        if (data->hdr.id == DID_INS_1)
+            tows.push_back(reinterpret_cast<const ins_1_t *>(data->buf)->timeOfWeek);
+    }
+
+    void batch_done() override { batches++; }
+
+    ros::Time now;
+    std::vector<uint32_t> dids;
+    std::vector<ros::Time> times;
+    std::vector<double> tows;
+    int batches = 0;
+};
+
+// A source with one batch every 10 ms of recorded time, each holding an INS1 and a PIMU packet
+static void fill(VectorSource &source, int count)
+{
+    IsbRawWriter writer;
+    for (int i = 0; i < count; i++)
+    {
+        struct
+        {
+            p_data_hdr_t hdr;
+            uint8_t buf[sizeof(ins_1_t)];
+        } packet;
+        ins_1_t ins1;
+        memset(&ins1, 0, sizeof(ins1));
+        ins1.timeOfWeek = 100.0 + 0.01 * i;
+        packet.hdr = {DID_INS_1, sizeof(ins1), 0};
+        memcpy(packet.buf, &ins1, sizeof(ins1));
+        writer.append(reinterpret_cast<const p_data_t *>(&packet));
+
+        pimu_t pimu;
+        memset(&pimu, 0, sizeof(pimu));
+        packet.hdr = {DID_PIMU, sizeof(pimu), 0};
+        memcpy(packet.buf, &pimu, sizeof(pimu));
+        writer.append(reinterpret_cast<const p_data_t *>(&packet));
+
+        inertial_sense_ros::ISBRaw batch;
+        writer.take(ros::Time(1000, 0) + ros::Duration(0.01 * i), batch);
+        source.batches.push_back(batch);
+    }
+}
+
+class ReplayEngineTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        wall = 0.0;
+        slept = 0.0;
+    }
+
+    void use_fake_clock(ReplayEngine &engine)
+    {
+        engine.set_wall_clock([this]() { return wall; }, [this](double seconds) { wall += seconds; slept += seconds; });
+    }
+
+    double wall;
+    double slept;
+};
+
+TEST_F(ReplayEngineTest, DeliversEveryPacketInOrderWithRecordedTime)
+{
+    VectorSource source;
+    fill(source, 5);
+    RecordingTarget target;
+    ReplayEngine engine(source, 0.0);
+    use_fake_clock(engine);
+
+    ReplayEngine::stats_t stats = engine.run(target);
+    EXPECT_EQ(5u, stats.batches);
+    EXPECT_EQ(10u, stats.packets);
+    EXPECT_EQ(0u, stats.checksum_errors);
+    EXPECT_NEAR(0.04, stats.recorded_duration, 1e-6);
+    EXPECT_EQ(5, target.batches);
+    ASSERT_EQ(10u, target.dids.size());
+    for (int i = 0; i < 5; i++)
+    {
+        EXPECT_EQ(DID_INS_1, target.dids[2 * i]);
+        EXPECT_EQ(DID_PIMU, target.dids[2 * i + 1]);
+        EXPECT_EQ(ros::Time(1000, 0) + ros::Duration(0.01 * i), target.times[2 * i]);
+        EXPECT_DOUBLE_EQ(100.0 + 0.01 * i, target.tows[i]);
+    }
+}
+
+TEST_F(ReplayEngineTest, AsFastAsPossibleNeverSleeps)
+{
+    VectorSource source;
+    fill(source, 20);
+    RecordingTarget target;
+    ReplayEngine engine(source, 0.0);
+    use_fake_clock(engine);
+    engine.run(target);
+    EXPECT_EQ(0.0, slept);
+}
+
+TEST_F(ReplayEngineTest, PacesAtRate)
+{
+    for (double rate : {1.0, 4.0})
+    {
+        VectorSource source;
+        fill(source, 11);
+        RecordingTarget target;
+        ReplayEngine engine(source, rate);
+        SetUp();
+        use_fake_clock(engine);
+        ReplayEngine::stats_t stats = engine.run(target);
+        EXPECT_NEAR(0.1 / rate, slept, 1e-6);
+        EXPECT_NEAR(0.1 / rate, stats.wall_duration, 1e-6);
+    }
+}
+
+TEST_F(ReplayEngineTest, OutputDoesNotDependOnRate)
+{
+    VectorSource fast, slow;
+    fill(fast, 8);
+    fill(slow, 8);
+    RecordingTarget fastTarget, slowTarget;
+    ReplayEngine fastEngine(fast, 0.0), slowEngine(slow, 2.0);
+    use_fake_clock(fastEngine);
+    use_fake_clock(slowEngine);
+    fastEngine.run(fastTarget);
+    slowEngine.run(slowTarget);
+    EXPECT_EQ(fastTarget.dids, slowTarget.dids);
+    EXPECT_EQ(fastTarget.times, slowTarget.times);
+    EXPECT_EQ(fastTarget.tows, slowTarget.tows);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+
+#include "shm_state_writer.h"
+
+static std::string segment_name()
+{
+    return "/inertial_sense_test_" + std::to_string(getpid());
+}
+
+static shm_ins_state_t make_ins(uint32_t i)
+{
+    shm_ins_state_t state;
+    double *fields = &state.stamp;
+    for (size_t j = 0; j < offsetof(shm_ins_state_t, ins_status) / sizeof(double); j++)
+        fields[j] = i;
+    state.ins_status = i;
+    state.hdw_status = i;
+    return state;
+}
+
+static bool consistent(const shm_ins_state_t &state)
+{
+    const double *fields = &state.stamp;
+    for (size_t j = 0; j < offsetof(shm_ins_state_t, ins_status) / sizeof(double); j++)
+    {
+        if (fields[j] != state.ins_status)
+            return false;
+    }
+    return state.hdw_status == state.ins_status;
+}
+
+TEST(ShmState, ReaderSeesLatestAndEveryStateInOrder)
+{
+    ShmStateWriter writer;
+    ASSERT_TRUE(writer.open(segment_name(), 8));
+    ShmStateReader reader(segment_name());
+    ASSERT_TRUE(reader.open());
+    EXPECT_EQ(8u, reader.slots());
+
+    shm_ins_state_t ins;
+    EXPECT_FALSE(reader.latest_ins(ins));
+    for (uint32_t i = 0; i < 5; i++)
+        writer.write_ins(make_ins(i));
+    ASSERT_TRUE(reader.latest_ins(ins));
+    EXPECT_EQ(4u, ins.ins_status);
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        ASSERT_TRUE(reader.next_ins(ins));
+        EXPECT_EQ(i, ins.ins_status);
+    }
+    EXPECT_FALSE(reader.next_ins(ins));
+
+    // The reader falls a ring and a half behind
+    for (uint32_t i = 5; i < 17; i++)
+        writer.write_ins(make_ins(i));
+    ASSERT_TRUE(reader.next_ins(ins));
+    EXPECT_EQ(9u, ins.ins_status);
+    EXPECT_EQ(4u, reader.lost());
+
+    shm_imu_state_t imu = {};
+    imu.angular_velocity[2] = 0.5;
+    writer.write_imu(imu);
+    ASSERT_TRUE(reader.latest_imu(imu));
+    EXPECT_EQ(0.5, imu.angular_velocity[2]);
+    EXPECT_FALSE(reader.writer_gone());
+
+    writer.close();
+    EXPECT_TRUE(reader.writer_gone());
+    EXPECT_FALSE(reader.open());
+}
+
+TEST(ShmState, SlotLeftMidWriteFailsTheRead)
+{
+    shm_slot_t<shm_ins_state_t> ring[2] = {};
+    std::atomic<uint64_t> count(0);
+    shm_write(ring, 2, count, make_ins(1));
+    shm_ins_state_t ins;
+    ASSERT_TRUE(shm_read(ring, 2, 0, ins));
+    EXPECT_EQ(1u, ins.ins_status);
+
+    // A writer that died between the two sequence updates
+    ring[0].seq.fetch_add(1);
+    EXPECT_FALSE(shm_read(ring, 2, 0, ins));
+}
+
+TEST(ShmState, ConcurrentReadsAreNeverTorn)
+{
+    ShmStateWriter writer;
+    ASSERT_TRUE(writer.open(segment_name(), 4));
+    ShmStateReader reader(segment_name());
+    ASSERT_TRUE(reader.open());
+
+    // The writer keeps going until the reader has caught it in every slot many times over
+    std::atomic<int> reads(0);
+    std::atomic<uint32_t> written(0);
+    std::thread thread([&]()
+    {
+        for (uint32_t i = 1; reads < 100000; i++)
+        {
+            writer.write_ins(make_ins(i));
+            written = i;
+        }
+    });
+
+    int torn = 0;
+    uint32_t last = 0;
+    bool ordered = true;
+    shm_ins_state_t ins;
+    while (reads < 100000)
+    {
+        if (!reader.latest_ins(ins))
+            continue;
+        reads++;
+        torn += !consistent(ins);
+        ordered &= ins.ins_status >= last;
+        last = ins.ins_status;
+    }
+    thread.join();
+    EXPECT_EQ(0, torn);
+    EXPECT_TRUE(ordered);
+    EXPECT_GT(written, 4u);
+    ASSERT_TRUE(reader.latest_ins(ins));
+    EXPECT_EQ(written, ins.ins_status);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include "stream_monitor.h"
+
+static const uint32_t INS = 4;
+static const uint32_t GPS = 13;
+
+TEST(StreamMonitor, SilentStreamIsRequestedAgainUntilItResumes)
+{
+    StreamMonitor monitor(10.0, 1.0, 2.0);
+    monitor.watch(INS, 0.004, 0.0);
+    monitor.watch(GPS, 0.2, 0.0);
+
+    double t = 0.0;
+    for (int i = 0; i < 1250; i++, t += 0.004)
+    {
+        monitor.received(INS, t, true, 100.0 + t);
+        if (i % 50 == 0)
+            monitor.received(GPS, t, true, 100.0 + t);
+        EXPECT_TRUE(monitor.check(t).empty());
+    }
+
+    // INS stops, GPS continues
+    double stop = t;
+    for (int i = 0; i < 5; i++, t += 0.2)
+        monitor.received(GPS, t, false, 0.0);
+    EXPECT_TRUE(monitor.check(stop + 0.9).empty());
+    t = stop + 1.0;
+    std::vector<uint32_t> due = monitor.check(t);
+    ASSERT_EQ(1u, due.size());
+    EXPECT_EQ(INS, due[0]);
+    EXPECT_EQ(1, monitor.stalled_count());
+
+    // Requested at most once per retry interval while it stays silent
+    monitor.received(GPS, t + 1.0, false, 0.0);
+    EXPECT_TRUE(monitor.check(t + 1.0).empty());
+    monitor.received(GPS, t + 2.0, false, 0.0);
+    EXPECT_EQ(1u, monitor.check(t + 2.0).size());
+    const StreamMonitor::stream_t &ins = monitor.streams().at(INS);
+    EXPECT_EQ(1u, ins.stalls);
+    EXPECT_EQ(2u, ins.reenables);
+
+    monitor.received(INS, t + 2.1, false, 0.0);
+    EXPECT_EQ(0, monitor.stalled_count());
+    EXPECT_TRUE(monitor.check(t + 2.2).empty());
+}
+
+TEST(StreamMonitor, TimeJumpsAreGapsAndRestarts)
+{
+    StreamMonitor monitor;
+    monitor.watch(INS, 0.01, 0.0);
+    monitor.received(INS, 0.00, true, 50.00);
+    monitor.received(INS, 0.01, true, 50.01);
+    monitor.received(INS, 0.02, true, 50.05); // three missing
+    monitor.received(INS, 0.03, true, 50.06);
+    monitor.received(INS, 0.04, true, 0.5);   // uINS reset
+    monitor.received(INS, 0.05, true, 0.51);
+
+    const StreamMonitor::stream_t &ins = monitor.streams().at(INS);
+    EXPECT_EQ(6u, ins.packets);
+    EXPECT_EQ(1u, ins.gaps);
+    EXPECT_EQ(3u, ins.missed);
+    EXPECT_EQ(1u, ins.restarts);
+}
+
+TEST(StreamMonitor, PeriodChangeRestartsTimeout)
+{
+    StreamMonitor monitor(10.0, 0.5, 2.0);
+    monitor.watch(INS, 0.1, 0.0);
+    EXPECT_TRUE(monitor.check(0.9).empty());
+    // Watching again with the same period keeps the timeout running
+    monitor.watch(INS, 0.1, 0.9);
+    EXPECT_EQ(1u, monitor.check(1.0).size());
+
+    // A slower period gets a longer timeout, unwatched streams are never due
+    monitor.watch(INS, 0.5, 1.0);
+    EXPECT_EQ(0, monitor.stalled_count());
+    EXPECT_TRUE(monitor.check(5.9).empty());
+    EXPECT_EQ(1u, monitor.check(6.0).size());
+    monitor.watch(INS, 0.0, 6.0);
+    EXPECT_TRUE(monitor.check(100.0).empty());
+    EXPECT_EQ(0, monitor.stalled_count());
+}
@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "udp_telemetry.h"
+
+static double wall_time()
+{
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+// Receiver on the local host, counting records lost by their sequence and the latency of each datagram
+class Receiver
+{
+public:
+    explicit Receiver(const char *group = NULL)
+    {
+        socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(group ? INADDR_ANY : INADDR_LOOPBACK);
+        bind(socket_, (sockaddr *)&address, sizeof(address));
+        socklen_t length = sizeof(address);
+        getsockname(socket_, (sockaddr *)&address, &length);
+        port = ntohs(address.sin_port);
+        timeval timeout = {0, 200000};
+        setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (group)
+        {
+            ip_mreq membership;
+            inet_pton(AF_INET, group, &membership.imr_multiaddr);
+            membership.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+            joined = setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) == 0;
+        }
+    }
+    ~Receiver() { close(socket_); }
+
+    // Until nothing arrives for the timeout, latencies are only meaningful when run alongside the sender
+    void receive()
+    {
+        uint8_t data[2048];
+        ssize_t size;
+        while ((size = recv(socket_, data, sizeof(data), 0)) > 0)
+        {
+            double now = wall_time();
+            udp_telemetry_header_t header = {};
+            int count = udp_telemetry_parse(data, size, header);
+            ASSERT_GE(count, 1);
+            datagrams++;
+            latency.push_back(now - header.send_time);
+            for (int i = 0; i < count; i++)
+            {
+                udp_ins_record_t record;
+                udp_telemetry_record(data, i, record);
+                if (!records.empty())
+                    lost += record.sequence - records.back().sequence - 1;
+                records.push_back(record);
+            }
+        }
+    }
+
+    double latency_max() const { return latency.empty() ? 0.0 : *std::max_element(latency.begin(), latency.end()); }
+
+    int port = 0;
+    bool joined = false;
+    int datagrams = 0;
+    uint32_t lost = 0;
+    std::vector<double> latency;
+    std::vector<udp_ins_record_t> records;
+
+private:
+    int socket_;
+};
+
+static udp_ins_record_t make_record(int i)
+{
+    udp_ins_record_t record = {};
+    record.time = 1.6e9 + i * 0.004;
+    record.lla[0] = 40.0;
+    record.lla[1] = -111.0;
+    record.lla[2] = 1400.0 + i;
+    record.qn2b[0] = 1.0f;
+    record.fix_type = 3;
+    return record;
+}
+
+TEST(UdpTelemetry, RateAndBatchingOnLoopback)
+{
+    Receiver receiver;
+    UdpTelemetry telemetry;
+    std::string error;
+    ASSERT_TRUE(telemetry.open("127.0.0.1", receiver.port, 1, "", error)) << error;
+    telemetry.configure(50.0, 5);
+
+    // Two seconds of 250 Hz states, sent as 50 Hz records in batches of 5
+    double now = wall_time();
+    int taken = 0;
+    for (int i = 0; i < 500; i++)
+    {
+        udp_ins_record_t record = make_record(i);
+        taken += telemetry.add(record, now + i * 0.004);
+    }
+    EXPECT_NEAR(100, taken, 1);
+    EXPECT_EQ(taken / 5, (int)telemetry.datagrams_sent());
+
+    receiver.receive();
+    EXPECT_EQ(0u, receiver.lost);
+    ASSERT_EQ(taken / 5 * 5, (int)receiver.records.size());
+    EXPECT_EQ(0u, receiver.records[0].sequence);
+    EXPECT_EQ(1405.0, receiver.records[1].lla[2]);
+    EXPECT_EQ(3, receiver.records[1].fix_type);
+    EXPECT_EQ(0u, telemetry.send_errors());
+}
+
+TEST(UdpTelemetry, PartialBatchIsSentByPoll)
+{
+    Receiver receiver;
+    UdpTelemetry telemetry;
+    std::string error;
+    ASSERT_TRUE(telemetry.open("127.0.0.1", receiver.port, 1, "", error)) << error;
+    telemetry.configure(10.0, 4);
+
+    udp_ins_record_t record = make_record(0);
+    double now = wall_time();
+    ASSERT_TRUE(telemetry.add(record, now));
+    telemetry.poll(now + 0.3);
+    EXPECT_EQ(0u, telemetry.datagrams_sent());
+    telemetry.poll(now + 0.4);
+    EXPECT_EQ(1u, telemetry.datagrams_sent());
+    receiver.receive();
+    EXPECT_EQ(1u, receiver.records.size());
+}
+
+TEST(UdpTelemetry, MulticastLossAndLatency)
+{
+    Receiver receiver("239.255.73.1");
+    if (!receiver.joined)
+        GTEST_SKIP() << "no multicast on the loopback interface";
+    UdpTelemetry telemetry;
+    std::string error;
+    ASSERT_TRUE(telemetry.open("239.255.73.1", receiver.port, 0, "127.0.0.1", error)) << error;
+    telemetry.configure(0.0, 1);
+
+    std::thread thread(&Receiver::receive, &receiver);
+    for (int i = 0; i < 200; i++)
+    {
+        udp_ins_record_t record = make_record(i);
+        telemetry.add(record, wall_time());
+        usleep(1000);
+    }
+    thread.join();
+    if (receiver.records.empty())
+        GTEST_SKIP() << "multicast is not delivered on this host";
+    EXPECT_EQ(200u, receiver.records.size() + receiver.lost);
+    EXPECT_EQ(0u, receiver.lost);
+    EXPECT_LT(receiver.latency_max(), 0.05);
+}
+
+TEST(UdpTelemetry, RejectsForeignDatagrams)
+{
+    uint8_t data[sizeof(udp_telemetry_header_t) + sizeof(udp_ins_record_t)] = {};
+    udp_telemetry_header_t header;
+    EXPECT_EQ(-1, udp_telemetry_parse(data, sizeof(data), header));
+    header.magic = UDP_TELEMETRY_MAGIC;
+    header.version = UDP_TELEMETRY_VERSION;
+    header.count = 2; // but only one record follows
+    header.record_size = sizeof(udp_ins_record_t);
+    memcpy(data, &header, sizeof(header));
+    EXPECT_EQ(-1, udp_telemetry_parse(data, sizeof(data), header));
+}
@@ -0,0 +1,284 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "uins_simulator.h"
+
+static double steady_now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Bytes cross the pseudo-terminal asynchronously, give up waiting for them after this long
+static const double PTY_TIMEOUT = 1.0;
+
+// The node's side of the pseudo-terminal.  The simulator runs on the host's clock, which only
+// advances in run(), so what the simulator produces does not depend on scheduling.
+class Host
+{
+public:
+    Host(UinsSimulator &sim) : sim_(sim), rx_(1024), len_(0), counter_(0), now_us_(0), sent_(0), received_(0)
+    {
+        sim_.set_clock([this]() { return now_us_ * 1.0e-6; });
+        fd_ = open(sim.port().c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+        struct termios tio;
+        tcgetattr(fd_, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(fd_, TCSANOW, &tio);
+    }
+
+    ~Host() { close(fd_); }
+
+    bool ok() const { return fd_ >= 0; }
+
+    void send(uint8_t pid, const void *body, size_t size)
+    {
+        uint8_t out[256];
+        size_t n = IsbFramer::encode(pid, counter_++, body, size, out, sizeof(out));
+        ASSERT_EQ((ssize_t)n, write(fd_, out, n));
+        sent_++;
+    }
+
+    // Lets the simulator handle everything sent so far, without advancing its clock
+    void deliver()
+    {
+        double timeout = steady_now() + PTY_TIMEOUT;
+        while (sim_.stats().requests < sent_ && steady_now() < timeout)
+        {
+            sim_.step(0.0);
+            usleep(100);
+        }
+        ASSERT_EQ(sent_, sim_.stats().requests);
+    }
+
+    void get_data(uint32_t did, uint32_t periodMultiple)
+    {
+        p_data_get_t request = {did, 0, 0, periodMultiple};
+        send(PID_GET_DATA, &request, sizeof(request));
+    }
+
+    void set_data(uint32_t did, const void *data, uint32_t size, uint32_t offset)
+    {
+        std::vector<uint8_t> body(sizeof(p_data_hdr_t) + size);
+        p_data_hdr_t hdr = {did, size, offset};
+        memcpy(body.data(), &hdr, sizeof(hdr));
+        memcpy(body.data() + sizeof(hdr), data, size);
+        send(PID_SET_DATA, body.data(), body.size());
+    }
+
+    // Delivers what was sent, then advances the clock by the given time in 1 ms steps and collects
+    // every data packet the simulator sent
+    std::vector<std::vector<uint8_t>> run(double seconds)
+    {
+        std::vector<std::vector<uint8_t>> packets;
+        deliver();
+        int64_t end = now_us_ + (int64_t)llround(seconds * 1.0e6);
+        while (now_us_ < end)
+        {
+            now_us_ = std::min<int64_t>(now_us_ + 1000, end);
+            sim_.step(0.0);
+            receive(packets);
+        }
+        return packets;
+    }
+
+    double now() const { return now_us_ * 1.0e-6; }
+
+    static int count(const std::vector<std::vector<uint8_t>> &packets, uint32_t did)
+    {
+        int n = 0;
+        for (size_t i = 0; i < packets.size(); i++)
+            n += reinterpret_cast<const p_data_hdr_t *>(packets[i].data())->id == did;
+        return n;
+    }
+
+    int acks_ = 0;
+
+private:
+    // Reads until every byte the simulator wrote has arrived
+    void receive(std::vector<std::vector<uint8_t>> &packets)
+    {
+        double timeout = steady_now() + PTY_TIMEOUT;
+        while (received_ < sim_.stats().bytes_sent && steady_now() < timeout)
+        {
+            uint8_t *buf = reinterpret_cast<uint8_t *>(rx_.data());
+            ssize_t n = read(fd_, buf + len_, rx_.size() * sizeof(uint64_t) - len_);
+            if (n <= 0)
+            {
+                usleep(100);
+                continue;
+            }
+            len_ += n;
+            received_ += n;
+            size_t pos = 0;
+            IsbPacket packet;
+            while (framer_.next(buf, len_, pos, packet))
+            {
+                if (packet.pid == PID_DATA && packet.hdr != NULL)
+                    packets.push_back(std::vector<uint8_t>((const uint8_t *)packet.hdr, packet.data + packet.hdr->size));
+                else if (packet.pid == PID_ACK)
+                    acks_++;
+            }
+            memmove(buf, buf + pos, len_ - pos);
+            len_ -= pos;
+        }
+        ASSERT_EQ(sim_.stats().bytes_sent, received_);
+    }
+
+    UinsSimulator &sim_;
+    int fd_;
+    IsbFramer framer_;
+    std::vector<uint64_t> rx_;
+    size_t len_;
+    uint8_t counter_;
+    int64_t now_us_;
+    uint64_t sent_;     // packets written to the simulator
+    uint64_t received_; // bytes read from the simulator
+};
+
+static UinsSimulator::options_t test_options()
+{
+    UinsSimulator::options_t options;
+    options.nav_period_ms = 10;
+    options.gps_period_ms = 100;
+    options.reboot_time = 0.1;
+    options.serial_number = 12345;
+    return options;
+}
+
+TEST(UinsSimulator, AnswersDeviceInfoRequest)
+{
+    UinsSimulator sim(test_options());
+    std::string error;
+    ASSERT_TRUE(sim.open("", error)) << error;
+    Host host(sim);
+    ASSERT_TRUE(host.ok());
+
+    host.get_data(DID_DEV_INFO, 0);
+    std::vector<std::vector<uint8_t>> packets = host.run(0.001);
+    ASSERT_EQ(1, Host::count(packets, DID_DEV_INFO));
+    const p_data_hdr_t *hdr = reinterpret_cast<const p_data_hdr_t *>(packets[0].data());
+    ASSERT_EQ(sizeof(dev_info_t), hdr->size);
+    dev_info_t info;
+    memcpy(&info, hdr + 1, sizeof(info));
+    EXPECT_EQ(12345u, info.serialNumber);
+    EXPECT_EQ(PROTOCOL_VERSION_CHAR0, info.protocolVer[0]);
+}
+
+TEST(UinsSimulator, BroadcastsAtPeriodMultipleUntilStopped)
+{
+    UinsSimulator sim(test_options());
+    std::string error;
+    ASSERT_TRUE(sim.open("", error)) << error;
+    Host host(sim);
+    ASSERT_TRUE(host.ok());
+
+    host.get_data(DID_INS_4, 1);
+    host.get_data(DID_INS_1, 5);
+    host.get_data(DID_GPS1_POS, 1);
+    // Navigation tick 0 at 0 s may come before or after the requests, count from tick 1 at 10 ms
+    host.run(0.005);
+    std::vector<std::vector<uint8_t>> packets = host.run(0.49);
+    EXPECT_EQ(49, Host::count(packets, DID_INS_4));     // ticks 1 to 49
+    EXPECT_EQ(9, Host::count(packets, DID_INS_1));      // ticks 5, 10, ... 45
+    EXPECT_EQ(4, Host::count(packets, DID_GPS1_POS));   // 100 ms epochs at ticks 10, 20, 30, 40
+
+    // Time of week advances by the navigation period
+    double lastTow = 0.0;
+    for (size_t i = 0; i < packets.size(); i++)
+    {
+        const p_data_hdr_t *hdr = reinterpret_cast<const p_data_hdr_t *>(packets[i].data());
+        if (hdr->id != DID_INS_4)
+            continue;
+        ins_4_t ins;
+        memcpy(&ins, hdr + 1, sizeof(ins));
+        if (lastTow > 0.0)
+        {
+            EXPECT_NEAR(0.01, ins.timeOfWeek - lastTow, 1e-6);
+        }
+        lastTow = ins.timeOfWeek;
+    }
+
+    host.send(PID_STOP_BROADCASTS_ALL_PORTS, NULL, 0);
+    EXPECT_EQ(0u, host.run(0.1).size());
+}
+
+TEST(UinsSimulator, ResetRestoresPersistentBroadcastsAndFlashRates)
+{
+    UinsSimulator sim(test_options());
+    std::string error;
+    ASSERT_TRUE(sim.open("", error)) << error;
+    Host host(sim);
+    ASSERT_TRUE(host.ok());
+
+    host.get_data(DID_INS_2, 1);
+    system_command_t command;
+    command.command = SYS_CMD_SAVE_PERSISTENT_MESSAGES;
+    command.invCommand = ~command.command;
+    host.set_data(DID_SYS_CMD, &command, sizeof(command), 0);
+    uint32_t navDtMs = 20;
+    host.set_data(DID_FLASH_CONFIG, &navDtMs, sizeof(navDtMs), offsetof(nvm_flash_cfg_t, startupNavDtMs));
+    host.run(0.05);
+    EXPECT_EQ(2, host.acks_);
+    EXPECT_DOUBLE_EQ(0.01, sim.nav_period());
+
+    // Reset at 50 ms, the device is silent for its reboot time of 100 ms
+    command.command = SYS_CMD_SOFTWARE_RESET;
+    command.invCommand = ~command.command;
+    host.set_data(DID_SYS_CMD, &command, sizeof(command), 0);
+    EXPECT_EQ(0, Host::count(host.run(0.095), DID_INS_2));
+    EXPECT_DOUBLE_EQ(0.01, sim.nav_period());
+
+    // After rebooting at 150 ms, INS_2 streams again at the rate written to flash
+    EXPECT_EQ(2, Host::count(host.run(0.035), DID_INS_2)); // 150 and 170 ms
+    EXPECT_DOUBLE_EQ(0.02, sim.nav_period());
+    EXPECT_EQ(25, Host::count(host.run(0.5), DID_INS_2)); // 190 to 670 ms
+}
+
+TEST(UinsSimulator, BaudRateLimitDropsPackets)
+{
+    UinsSimulator::options_t options = test_options();
+    options.nav_period_ms = 2;
+    options.baudrate = 115200;
+    UinsSimulator sim(options);
+    std::string error;
+    ASSERT_TRUE(sim.open("", error)) << error;
+    Host host(sim);
+    ASSERT_TRUE(host.ok());
+
+    // INS_1 + INS_4 + PIMU at 500 Hz is far beyond 11.5 kB/s
+    host.get_data(DID_INS_1, 1);
+    host.get_data(DID_INS_4, 1);
+    host.get_data(DID_PIMU, 1);
+    host.run(0.5);
+    EXPECT_GT(sim.stats().packets_dropped, 0u);
+    // 0.5 s of 11520 B/s, give or take the 64 byte burst the link budget allows
+    EXPECT_NEAR(11520 * 0.5, sim.stats().bytes_sent, 64);
+}
+
+TEST(SimMotion, MeasurementsAgreeWithTrajectory)
+{
+    SimMotion motion;
+    double dt = 1e-3;
+    for (double t = 0.0; t < 30.0; t += 7.3)
+    {
+        SimMotion::state_t a = motion.at(t);
+        SimMotion::state_t b = motion.at(t + dt);
+        for (int i = 0; i < 3; i++)
+            EXPECT_NEAR(a.vel_ned[i], (b.ned[i] - a.ned[i]) / dt, 1e-2);
+        EXPECT_NEAR(motion.speed, sqrt(a.uvw[0] * a.uvw[0] + a.uvw[1] * a.uvw[1] + a.uvw[2] * a.uvw[2]), 0.1);
+        double norm = 0.0, accel = 0.0;
+        for (int i = 0; i < 4; i++)
+            norm += a.qe2b[i] * a.qe2b[i];
+        for (int i = 0; i < 3; i++)
+            accel += a.accel[i] * a.accel[i];
+        EXPECT_NEAR(1.0, norm, 1e-6);
+        EXPECT_NEAR(9.81, sqrt(accel), 0.1);
+    }
+}